@@ -13,6 +13,7 @@ DirectXFramework::DirectXFramework() : DirectXFramework(800, 600)
 DirectXFramework::DirectXFramework(unsigned int width, unsigned int height) : Framework(width, height)
 {
 	_dxFramework = this;
+	_parallelSceneUpdateEnabled = false;
 
 	// Set default background colour
 	_backgroundColour[0] = 0.0f;
@@ -68,6 +69,12 @@ bool DirectXFramework::Initialise()
 	_resourceManager = make_shared<ResourceManager>();
 	_sceneGraph = make_shared<SceneGraph>();
 	_camera = make_shared<Camera>();
+	_threadPool = make_shared<ThreadPool>();
+	// Scene transform updates stay on this thread unless SetParallelSceneUpdateEnabled has been called
+	if (_parallelSceneUpdateEnabled)
+	{
+		_sceneGraph->SetThreadPool(_threadPool);
+	}
 	CreateSceneGraph();
 	return _sceneGraph->Initialise();
 }
@@ -5,6 +5,7 @@
 #include "SceneGraph.h"
 #include "ResourceManager.h"
 #include "Camera.h"
+#include "ThreadPool.h"
 
 class DirectXFramework : public Framework
 {
@@ -35,6 +36,12 @@ public:
 
 	inline shared_ptr<Camera> GetCamera() { return _camera; }
 
+	inline shared_ptr<ThreadPool> GetThreadPool() { return _threadPool; }
+
+	// Splits large scene transform updates across the thread pool.  Off by default; call it before
+	// Initialise (e.g. in the constructor) to turn it on.
+	inline void SetParallelSceneUpdateEnabled(bool parallelSceneUpdateEnabled) { _parallelSceneUpdateEnabled = parallelSceneUpdateEnabled; }
+
 private:
 	ComPtr<ID3D11Device>				_device;
 	ComPtr<ID3D11DeviceContext>			_deviceContext;
@@ -64,5 +71,8 @@ private:
 	shared_ptr<ResourceManager>			_resourceManager;
 
 	shared_ptr<Camera> _camera;
+
+	shared_ptr<ThreadPool>				_threadPool;
+	bool								_parallelSceneUpdateEnabled;
 };
 
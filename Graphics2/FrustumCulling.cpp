@@ -0,0 +1,252 @@
+#include "FrustumCulling.h"
+#include <immintrin.h>
+#include <cfloat>
+
+void BoundingBoxArrays::Clear()
+{
+	CentreX.clear();
+	CentreY.clear();
+	CentreZ.clear();
+	ExtentsX.clear();
+	ExtentsY.clear();
+	ExtentsZ.clear();
+	Radius.clear();
+}
+
+void BoundingBoxArrays::Reserve(size_t count)
+{
+	CentreX.reserve(count);
+	CentreY.reserve(count);
+	CentreZ.reserve(count);
+	ExtentsX.reserve(count);
+	ExtentsY.reserve(count);
+	ExtentsZ.reserve(count);
+	Radius.reserve(count);
+}
+
+void BoundingBoxArrays::Add(const SceneBounds& bounds)
+{
+	XMFLOAT3 centre = bounds.Centre;
+	XMFLOAT3 extents = bounds.Extents;
+	float radius = bounds.Radius;
+	if (bounds.Type == SceneBoundsType::Empty)
+	{
+		// No plane is far enough away for a box with a negative radius to reach
+		centre = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		extents = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		radius = -FLT_MAX;
+	}
+	else if (bounds.Type == SceneBoundsType::Infinite)
+	{
+		centre = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		extents = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		radius = FLT_MAX;
+	}
+	CentreX.push_back(centre.x);
+	CentreY.push_back(centre.y);
+	CentreZ.push_back(centre.z);
+	ExtentsX.push_back(extents.x);
+	ExtentsY.push_back(extents.y);
+	ExtentsZ.push_back(extents.z);
+	Radius.push_back(radius);
+}
+
+void BoundingBoxArrays::Add(const XMFLOAT3& minimum, const XMFLOAT3& maximum)
+{
+	CentreX.push_back((minimum.x + maximum.x) * 0.5f);
+	CentreY.push_back((minimum.y + maximum.y) * 0.5f);
+	CentreZ.push_back((minimum.z + maximum.z) * 0.5f);
+	ExtentsX.push_back((maximum.x - minimum.x) * 0.5f);
+	ExtentsY.push_back((maximum.y - minimum.y) * 0.5f);
+	ExtentsZ.push_back((maximum.z - minimum.z) * 0.5f);
+	Radius.push_back(FLT_MAX);
+}
+
+// Tests one box, in the same order of operations as SceneFrustum::Test.  Returns 0 if it is
+// outside, 1 if it intersects and 2 if it is inside.
+static inline unsigned int TestBox(const SceneFrustum& frustum, const BoundingBoxArrays& boxes, unsigned int i)
+{
+	unsigned int result = 2;
+	for (unsigned int p = 0; p < 6; p++)
+	{
+		const XMFLOAT4& plane = frustum.GetPlane(p);
+		float distance = plane.x * boxes.CentreX[i] + plane.y * boxes.CentreY[i] + plane.z * boxes.CentreZ[i] + plane.w;
+		float boxRadius = fabsf(plane.x) * boxes.ExtentsX[i] + fabsf(plane.y) * boxes.ExtentsY[i] + fabsf(plane.z) * boxes.ExtentsZ[i];
+		float radius = min(boxRadius, boxes.Radius[i]);
+		if (distance < -radius)
+		{
+			return 0;
+		}
+		if (distance < radius)
+		{
+			result = 1;
+		}
+	}
+	return result;
+}
+
+// Appends the boxes of a batch whose bits are set in visibleMask to the visible list without branching
+// on each box.  Every lane is written, but the count only moves on past the visible ones.
+static inline unsigned int CompactBatch(unsigned int base, unsigned int lanes, unsigned int visibleMask, unsigned int insideMask,
+										unsigned int * visibleIndices, BYTE * insideFlags, unsigned int count)
+{
+	if (insideFlags != nullptr)
+	{
+		for (unsigned int lane = 0; lane < lanes; lane++)
+		{
+			visibleIndices[count] = base + lane;
+			insideFlags[count] = (BYTE)((insideMask >> lane) & 1);
+			count += (visibleMask >> lane) & 1;
+		}
+	}
+	else
+	{
+		for (unsigned int lane = 0; lane < lanes; lane++)
+		{
+			visibleIndices[count] = base + lane;
+			count += (visibleMask >> lane) & 1;
+		}
+	}
+	return count;
+}
+
+unsigned int CullBoxes(const SceneFrustum& frustum, const BoundingBoxArrays& boxes, unsigned int first, unsigned int end,
+					   unsigned int * visibleIndices, BYTE * insideFlags)
+{
+	unsigned int count = 0;
+	unsigned int i = first;
+	const float * centreX = boxes.CentreX.data();
+	const float * centreY = boxes.CentreY.data();
+	const float * centreZ = boxes.CentreZ.data();
+	const float * extentsX = boxes.ExtentsX.data();
+	const float * extentsY = boxes.ExtentsY.data();
+	const float * extentsZ = boxes.ExtentsZ.data();
+	const float * radii = boxes.Radius.data();
+
+	// Each plane's coefficients and their absolute values, ready to be broadcast
+	float planes[6][7];
+	for (unsigned int p = 0; p < 6; p++)
+	{
+		const XMFLOAT4& plane = frustum.GetPlane(p);
+		planes[p][0] = plane.x;
+		planes[p][1] = plane.y;
+		planes[p][2] = plane.z;
+		planes[p][3] = plane.w;
+		planes[p][4] = fabsf(plane.x);
+		planes[p][5] = fabsf(plane.y);
+		planes[p][6] = fabsf(plane.z);
+	}
+
+#if defined(__AVX2__)
+	const __m256 signBit = _mm256_set1_ps(-0.0f);
+	__m256 planeVectors[6][7];
+	for (unsigned int p = 0; p < 6; p++)
+	{
+		for (unsigned int k = 0; k < 7; k++)
+		{
+			planeVectors[p][k] = _mm256_set1_ps(planes[p][k]);
+		}
+	}
+	for (; i + 8 <= end; i += 8)
+	{
+		__m256 cx = _mm256_loadu_ps(centreX + i);
+		__m256 cy = _mm256_loadu_ps(centreY + i);
+		__m256 cz = _mm256_loadu_ps(centreZ + i);
+		__m256 ex = _mm256_loadu_ps(extentsX + i);
+		__m256 ey = _mm256_loadu_ps(extentsY + i);
+		__m256 ez = _mm256_loadu_ps(extentsZ + i);
+		__m256 sphereRadius = _mm256_loadu_ps(radii + i);
+		__m256 outside = _mm256_setzero_ps();
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (unsigned int p = 0; p < 6; p++)
+		{
+			// Multiplies and adds are kept separate so the results match the scalar test exactly
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeVectors[p][0], cx),
+																		_mm256_mul_ps(planeVectors[p][1], cy)),
+														  _mm256_mul_ps(planeVectors[p][2], cz)),
+											planeVectors[p][3]);
+			__m256 boxRadius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeVectors[p][4], ex),
+														   _mm256_mul_ps(planeVectors[p][5], ey)),
+											 _mm256_mul_ps(planeVectors[p][6], ez));
+			__m256 radius = _mm256_min_ps(boxRadius, sphereRadius);
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, _mm256_xor_ps(radius, signBit), _CMP_LT_OQ));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, radius, _CMP_GE_OQ));
+		}
+		unsigned int visibleMask = ~(unsigned int)_mm256_movemask_ps(outside) & 0xFF;
+		count = CompactBatch(i, 8, visibleMask, (unsigned int)_mm256_movemask_ps(inside), visibleIndices, insideFlags, count);
+	}
+#else
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+	__m128 planeVectors[6][7];
+	for (unsigned int p = 0; p < 6; p++)
+	{
+		for (unsigned int k = 0; k < 7; k++)
+		{
+			planeVectors[p][k] = _mm_set1_ps(planes[p][k]);
+		}
+	}
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 cx = _mm_loadu_ps(centreX + i);
+		__m128 cy = _mm_loadu_ps(centreY + i);
+		__m128 cz = _mm_loadu_ps(centreZ + i);
+		__m128 ex = _mm_loadu_ps(extentsX + i);
+		__m128 ey = _mm_loadu_ps(extentsY + i);
+		__m128 ez = _mm_loadu_ps(extentsZ + i);
+		__m128 sphereRadius = _mm_loadu_ps(radii + i);
+		__m128 outside = _mm_setzero_ps();
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (unsigned int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeVectors[p][0], cx),
+															   _mm_mul_ps(planeVectors[p][1], cy)),
+													_mm_mul_ps(planeVectors[p][2], cz)),
+										 planeVectors[p][3]);
+			__m128 boxRadius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeVectors[p][4], ex),
+													 _mm_mul_ps(planeVectors[p][5], ey)),
+										  _mm_mul_ps(planeVectors[p][6], ez));
+			__m128 radius = _mm_min_ps(boxRadius, sphereRadius);
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_xor_ps(radius, signBit)));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, radius));
+		}
+		unsigned int visibleMask = ~(unsigned int)_mm_movemask_ps(outside) & 0xF;
+		count = CompactBatch(i, 4, visibleMask, (unsigned int)_mm_movemask_ps(inside), visibleIndices, insideFlags, count);
+	}
+#endif
+
+	// The boxes left over after the last full batch
+	for (; i < end; i++)
+	{
+		unsigned int result = TestBox(frustum, boxes, i);
+		if (result != 0)
+		{
+			visibleIndices[count] = i;
+			if (insideFlags != nullptr)
+			{
+				insideFlags[count] = (BYTE)(result == 2);
+			}
+			count++;
+		}
+	}
+	return count;
+}
+
+unsigned int CullBoxesScalar(const SceneFrustum& frustum, const BoundingBoxArrays& boxes, unsigned int first, unsigned int end,
+							 unsigned int * visibleIndices, BYTE * insideFlags)
+{
+	unsigned int count = 0;
+	for (unsigned int i = first; i < end; i++)
+	{
+		unsigned int result = TestBox(frustum, boxes, i);
+		if (result != 0)
+		{
+			visibleIndices[count] = i;
+			if (insideFlags != nullptr)
+			{
+				insideFlags[count] = (BYTE)(result == 2);
+			}
+			count++;
+		}
+	}
+	return count;
+}
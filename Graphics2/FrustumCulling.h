@@ -0,0 +1,43 @@
+#pragma once
+#include "DirectXCore.h"
+#include "SceneBounds.h"
+#include <vector>
+
+using namespace std;
+
+// Axis-aligned boxes kept as one array per coordinate, so a batch of boxes can be loaded into a
+// register at once.  Each box can also have a sphere about its centre, as for SceneBounds.
+struct BoundingBoxArrays
+{
+	vector<float>	CentreX;
+	vector<float>	CentreY;
+	vector<float>	CentreZ;
+	vector<float>	ExtentsX;
+	vector<float>	ExtentsY;
+	vector<float>	ExtentsZ;
+	vector<float>	Radius;			// FLT_MAX where only the box is known
+
+	inline unsigned int GetCount() const { return (unsigned int)CentreX.size(); }
+
+	void Clear();
+	void Reserve(size_t count);
+
+	// Empty bounds are added as a box that is outside every frustum, and infinite bounds as one that
+	// intersects every frustum, so both cull as SceneFrustum::Test would
+	void Add(const SceneBounds& bounds);
+	void Add(const XMFLOAT3& minimum, const XMFLOAT3& maximum);
+};
+
+// Tests boxes [first, end) against frustum, writes the indices of those that are not outside it to
+// visibleIndices in increasing order and returns how many there are.  visibleIndices must have room for
+// end - first indices.  If insideFlags is not nullptr, insideFlags[i] is set to 1 if the box at
+// visibleIndices[i] is entirely inside the frustum and 0 if it only intersects it.
+//
+// Boxes are tested eight at a time against all six planes using AVX2 when it is enabled at compile time,
+// otherwise four at a time with SSE2.  The results are exactly those of SceneFrustum::Test.
+unsigned int CullBoxes(const SceneFrustum& frustum, const BoundingBoxArrays& boxes, unsigned int first, unsigned int end,
+					   unsigned int * visibleIndices, BYTE * insideFlags = nullptr);
+
+// Scalar version of CullBoxes.  Produces exactly the same results.
+unsigned int CullBoxesScalar(const SceneFrustum& frustum, const BoundingBoxArrays& boxes, unsigned int first, unsigned int end,
+							 unsigned int * visibleIndices, BYTE * insideFlags = nullptr);
@@ -17,44 +17,124 @@ void Graphics2::CreateSceneGraph()
 	
 	// Terrain
 	_terrainNode = make_shared<TerrainNode>(L"Terrain1", L"Example_HeightMap.raw",
-											1023, 1023, 1024, 10);
+											1023, 1023, 1024, 10, TerrainVertexLayout::SharedGrid);
+	_terrainNode->EnableLevelOfDetail(32, 2.0f);
+	_terrainNode->EnableOcclusionCulling(1);
+	_terrainNode->EnableLightMap();
+	_terrainNode->SetLightDirection(XMFLOAT3(1.0f, -0.5f, 0.0f));
+	_terrainNode->EnableEditing();
+	_terrainNode->SetVertexFormat(TerrainVertexFormat::Compact);
 	sceneGraph->Add(_terrainNode);
 
-	// Trees
+	// Trees (placed on the terrain each frame in UpdateSceneGraph)
 	shared_ptr<MeshNode> tree = make_shared<MeshNode>(L"Tree1", L"Trees\\CL04_M.fbx");
-	tree->SetWorldTransform(XMMatrixScaling(0.1f, 0.1f, 0.05f) * XMMatrixRotationAxis(XMVectorSet(0.0f, -1.0f, 1.0f, 0.0f), XM_PI) * XMMatrixTranslation(0, 435.0f, 0));
+	AddGroundedNode(tree, XMMatrixScaling(0.1f, 0.1f, 0.05f) * XMMatrixRotationAxis(XMVectorSet(0.0f, -1.0f, 1.0f, 0.0f), XM_PI), 0, 0, 0);
 	sceneGraph->Add(tree);
 	tree = make_shared<MeshNode>(L"Tree2", L"Trees\\CL04_M.fbx");
-	tree->SetWorldTransform(XMMatrixScaling(0.1f, 0.1f, 0.05f) * XMMatrixRotationAxis(XMVectorSet(0.0f, -1.0f, 1.0f, 0.0f), XM_PI) * XMMatrixTranslation(100, 400.0f, 0));
+	AddGroundedNode(tree, XMMatrixScaling(0.1f, 0.1f, 0.05f) * XMMatrixRotationAxis(XMVectorSet(0.0f, -1.0f, 1.0f, 0.0f), XM_PI), 100, 0, 0);
 	sceneGraph->Add(tree);
 	tree = make_shared<MeshNode>(L"Tree3", L"Trees\\CL04_M.fbx");
-	tree->SetWorldTransform(XMMatrixScaling(0.5, 0.5, 0.5) * XMMatrixRotationAxis(XMVectorSet(0.0f, -1.0f, 1.0f, 0.0f), XM_PI) * XMMatrixTranslation(600, 50.0f, 1300));
+	AddGroundedNode(tree, XMMatrixScaling(0.5, 0.5, 0.5) * XMMatrixRotationAxis(XMVectorSet(0.0f, -1.0f, 1.0f, 0.0f), XM_PI), 600, 1300, 0);
 	sceneGraph->Add(tree);
 
 	// Plane
 	shared_ptr<MeshNode> plane = make_shared<MeshNode>(L"Plane1", L"Plane\\Bonanza.3DS");
 	plane->SetWorldTransform(XMMatrixScaling(3, 3, 3) * XMMatrixTranslation(0, 600.0f, 0.0f));
 	sceneGraph->Add(plane);
+	_planeNode = SceneNodeHandle(sceneGraph, L"Plane1");
 
 	_angle = 0.0f;
 }
 
 void Graphics2::UpdateSceneGraph()
 {
-	SceneGraphPointer sceneGraph = GetSceneGraph();
 	XMVECTOR cameraPosition = GetCamera()->GetCameraPosition();
 
 	_angle += 1;
-	sceneGraph->Find(L"Plane1")->SetWorldTransform(XMMatrixScaling(3, 3, 3) * XMMatrixTranslation(300.0f, 0.0f, -700.0f) * XMMatrixRotationAxis(XMVectorSet(0.0f, -1.0f, 1.0f, 0.0f), XM_PI) * XMMatrixRotationAxis(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), _angle * XM_PI / 180.0f));
+	_planeNode.Get()->SetWorldTransform(XMMatrixScaling(3, 3, 3) * XMMatrixTranslation(300.0f, 0.0f, -700.0f) * XMMatrixRotationAxis(XMVectorSet(0.0f, -1.0f, 1.0f, 0.0f), XM_PI) * XMMatrixRotationAxis(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), _angle * XM_PI / 180.0f));
 
 	GetKeyInput();
 
-	// Checks if camera position is at height of terrain to stop camera going through it
+	// Stops the camera going through the terrain by sweeping it from where it was to where it wants to be
 	GetCamera()->Update();
-	XMVECTOR newCameraPosition = GetCamera()->GetCameraPosition();
-	if (XMVectorGetY(newCameraPosition) < _terrainNode->GetHeightAtPoint(XMVectorGetX(cameraPosition), XMVectorGetZ(cameraPosition)) + 1)
+	XMFLOAT3 from;
+	XMFLOAT3 to;
+	XMStoreFloat3(&from, cameraPosition);
+	XMStoreFloat3(&to, GetCamera()->GetCameraPosition());
+	XMFLOAT3 position = MoveCameraAgainstTerrain(from, to);
+	GetCamera()->SetCameraPosition(position.x, position.y, position.z);
+	UpdateGroundHeights(XMLoadFloat3(&position));
+}
+
+// Moves a sphere around the camera from one position towards another, stopping where it first touches
+// the terrain and sliding the rest of the way along the surface.  Each hit leaves the sphere a little
+// way off the surface, so the next sweep doesn't start out touching it.
+XMFLOAT3 Graphics2::MoveCameraAgainstTerrain(const XMFLOAT3& from, const XMFLOAT3& to)
+{
+	const float cameraRadius = 1.0f;
+	const float separation = 0.01f;
+	const int maximumSlides = 3;
+
+	// Push the camera out first if the terrain has been raised around it (e.g. by an edit)
+	XMVECTOR position = XMLoadFloat3(&from);
+	TerrainContact contact;
+	if (_terrainNode->SphereOverlap(from, cameraRadius, contact))
+	{
+		position = XMVectorAdd(position, XMVectorScale(XMLoadFloat3(&contact.Normal), contact.Depth + separation));
+	}
+	XMVECTOR movement = XMVectorSubtract(XMLoadFloat3(&to), XMLoadFloat3(&from));
+	for (int slide = 0; slide < maximumSlides && XMVectorGetX(XMVector3LengthSq(movement)) > 0.0f; slide++)
+	{
+		XMFLOAT3 start;
+		XMFLOAT3 end;
+		XMStoreFloat3(&start, position);
+		XMStoreFloat3(&end, XMVectorAdd(position, movement));
+		if (!_terrainNode->SweepSphere(start, end, cameraRadius, contact))
+		{
+			position = XMVectorAdd(position, movement);
+			break;
+		}
+		XMVECTOR normal = XMLoadFloat3(&contact.Normal);
+		position = XMVectorAdd(XMVectorAdd(position, XMVectorScale(movement, contact.Time)), XMVectorScale(normal, separation));
+		XMVECTOR remaining = XMVectorScale(movement, 1.0f - contact.Time);
+		movement = XMVectorSubtract(remaining, XMVectorScale(normal, XMVectorGetX(XMVector3Dot(remaining, normal))));
+	}
+	XMFLOAT3 result;
+	XMStoreFloat3(&result, position);
+	return result;
+}
+
+void Graphics2::AddGroundedNode(SceneNodePointer node, FXMMATRIX transformation, float x, float z, float heightOffset)
+{
+	GroundedNode groundedNode;
+	groundedNode.Node = node;
+	XMStoreFloat4x4(&groundedNode.Transformation, transformation);
+	groundedNode.HeightOffset = heightOffset;
+	_groundedNodes.push_back(groundedNode);
+	if (_groundPoints.empty())
 	{
-		GetCamera()->SetCameraPosition(XMVectorGetX(cameraPosition), XMVectorGetY(cameraPosition), XMVectorGetZ(cameraPosition));
+		// The first point is kept for the camera
+		_groundPoints.push_back(XMFLOAT2());
+	}
+	_groundPoints.push_back(XMFLOAT2(x, z));
+}
+
+// Looks up the height of the ground under the camera and every grounded node in one batch.  The
+// camera's height ends up in _groundHeights[0].
+void Graphics2::UpdateGroundHeights(FXMVECTOR cameraPosition)
+{
+	if (_groundPoints.empty())
+	{
+		_groundPoints.push_back(XMFLOAT2());
+	}
+	_groundPoints[0] = XMFLOAT2(XMVectorGetX(cameraPosition), XMVectorGetZ(cameraPosition));
+	_groundHeights.resize(_groundPoints.size());
+	_terrainNode->GetHeightsAtPoints(&_groundPoints[0], (unsigned int)_groundPoints.size(), &_groundHeights[0]);
+	for (size_t i = 0; i < _groundedNodes.size(); i++)
+	{
+		const XMFLOAT2& point = _groundPoints[i + 1];
+		_groundedNodes[i].Node->SetWorldTransform(XMLoadFloat4x4(&_groundedNodes[i].Transformation) *
+												  XMMatrixTranslation(point.x, _groundHeights[i + 1] + _groundedNodes[i].HeightOffset, point.y));
 	}
 }
 
@@ -99,6 +179,23 @@ void Graphics2::GetKeyInput()
 		}
 	}
 
+	// C makes a crater where the camera is looking (once per key press)
+	bool craterKeyDown = GetAsyncKeyState(0x43) < 0;
+	if (craterKeyDown && !_craterKeyDown)
+	{
+		XMMATRIX cameraTransformation = XMMatrixInverse(nullptr, GetCamera()->GetViewMatrix());
+		XMFLOAT3 origin;
+		XMFLOAT3 direction;
+		XMStoreFloat3(&origin, GetCamera()->GetCameraPosition());
+		XMStoreFloat3(&direction, cameraTransformation.r[2]);
+		TerrainRayHit hit;
+		if (_terrainNode->RayCast(origin, direction, 10000.0f, hit))
+		{
+			_terrainNode->CreateCrater(hit.Position.x, hit.Position.z, 150.0f, 60.0f);
+		}
+	}
+	_craterKeyDown = craterKeyDown;
+
 	// Arrow keys for looking
 	if (GetAsyncKeyState(VK_RIGHT) < 0)
 	{
@@ -12,10 +12,28 @@ public:
 	void UpdateSceneGraph();
 	void GetKeyInput();
 private:
+	// A node that is kept on the surface of the terrain
+	struct GroundedNode
+	{
+		SceneNodePointer	Node;
+		XMFLOAT4X4			Transformation;
+		float				HeightOffset;
+	};
+
 	float _angle = 0.0f;
 	float _red = 0.0f;
 	float _green = 0.0f;
 	float _blue = 0.0f;
+	bool _craterKeyDown = false;
 
 	shared_ptr<TerrainNode> _terrainNode;
+	SceneNodeHandle			_planeNode;
+
+	vector<GroundedNode>	_groundedNodes;
+	vector<XMFLOAT2>		_groundPoints;
+	vector<float>			_groundHeights;
+
+	void AddGroundedNode(SceneNodePointer node, FXMMATRIX transformation, float x, float z, float heightOffset);
+	void UpdateGroundHeights(FXMVECTOR cameraPosition);
+	XMFLOAT3 MoveCameraAgainstTerrain(const XMFLOAT3& from, const XMFLOAT3& to);
 };
@@ -0,0 +1,205 @@
+#include "HeightMapFile.h"
+#include <immintrin.h>
+#include <cmath>
+#include <cfloat>
+
+HeightMapFile::HeightMapFile()
+{
+	_format = HeightMapFormat::Unknown;
+	_width = 0;
+	_height = 0;
+}
+
+HeightMapFile::~HeightMapFile()
+{
+}
+
+unsigned int HeightMapFile::GetSampleSize(HeightMapFormat format)
+{
+	switch (format)
+	{
+		case HeightMapFormat::UInt8:
+			return 1;
+
+		case HeightMapFormat::UInt16:
+			return 2;
+
+		case HeightMapFormat::Float32:
+			return 4;
+
+		default:
+			return 0;
+	}
+}
+
+// Whether every sample, read as a 32-bit float, is 0 or a normal number from 0 to 1, as in a float height
+// map.  An 8-bit map of any height would need a quarter of its samples to be below 64 and to avoid
+// making denormals and NaNs everywhere else, so this rejects them almost at once.
+static bool IsNormalisedFloat32(const BYTE * data, size_t size)
+{
+	for (size_t offset = 0; offset + sizeof(float) <= size; offset += sizeof(float))
+	{
+		float value;
+		memcpy(&value, data + offset, sizeof(float));
+		if (!(value >= 0.0f && value <= 1.0f) || (value != 0.0f && value < FLT_MIN))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool HeightMapFile::Open(const wstring& filename, HeightMapFormat format, unsigned int width, unsigned int height)
+{
+	Close();
+	if (!_file.Open(filename))
+	{
+		return Fail(filename, L"could not be opened, or is empty");
+	}
+	size_t fileSize = _file.GetSize();
+
+	// The formats to try, in order of preference
+	HeightMapFormat formats[] = { HeightMapFormat::UInt16, HeightMapFormat::UInt8, HeightMapFormat::Float32 };
+	for (HeightMapFormat candidate : formats)
+	{
+		if (format != HeightMapFormat::Unknown && format != candidate)
+		{
+			continue;
+		}
+		size_t sampleSize = GetSampleSize(candidate);
+		if (fileSize % sampleSize != 0)
+		{
+			continue;
+		}
+		size_t numberOfSamples = fileSize / sampleSize;
+		if (width != 0 && height != 0)
+		{
+			if (numberOfSamples == (size_t)width * height)
+			{
+				_format = candidate;
+				_width = width;
+				_height = height;
+				return true;
+			}
+		}
+		else
+		{
+			size_t side = (size_t)sqrt((double)numberOfSamples);
+			// Allow for sqrt rounding down
+			while ((side + 1) * (side + 1) <= numberOfSamples)
+			{
+				side++;
+			}
+			if (side >= 2 && side * side == numberOfSamples)
+			{
+				// A square float map of side n is also a square 8-bit map of side 2n, so the samples decide
+				if (candidate == HeightMapFormat::UInt8 && format == HeightMapFormat::Unknown && side % 2 == 0 &&
+					IsNormalisedFloat32(_file.GetData(), fileSize))
+				{
+					continue;
+				}
+				_format = candidate;
+				_width = (unsigned int)side;
+				_height = (unsigned int)side;
+				return true;
+			}
+		}
+	}
+
+	wstring message = L"is " + to_wstring(fileSize) + L" bytes, which is not ";
+	if (width != 0 && height != 0)
+	{
+		message += to_wstring(width) + L" x " + to_wstring(height);
+	}
+	else
+	{
+		message += L"a square grid of";
+	}
+	switch (format)
+	{
+		case HeightMapFormat::UInt8:
+			message += L" 8-bit samples";
+			break;
+
+		case HeightMapFormat::UInt16:
+			message += L" 16-bit samples";
+			break;
+
+		case HeightMapFormat::Float32:
+			message += L" 32-bit samples";
+			break;
+
+		default:
+			message += L" 8, 16 or 32-bit samples";
+			break;
+	}
+	return Fail(filename, message);
+}
+
+void HeightMapFile::Close()
+{
+	_file.Close();
+	_format = HeightMapFormat::Unknown;
+	_width = 0;
+	_height = 0;
+}
+
+bool HeightMapFile::Fail(const wstring& filename, const wstring& message)
+{
+	_errorMessage = L"Height map " + filename + L" " + message;
+	Close();
+	return false;
+}
+
+void HeightMapFile::ConvertRows(float * heightValues, unsigned int firstRow, unsigned int endRow)
+{
+	size_t first = (size_t)firstRow * _width;
+	size_t end = (size_t)endRow * _width;
+	size_t i = first;
+	switch (_format)
+	{
+		case HeightMapFormat::UInt8:
+		{
+			const BYTE * samples = _file.GetData();
+#if defined(__AVX2__)
+			const __m256 scale = _mm256_set1_ps(1.0f / 256);
+			for (; i + 8 <= end; i += 8)
+			{
+				__m256i values = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(samples + i)));
+				_mm256_storeu_ps(heightValues + i, _mm256_mul_ps(_mm256_cvtepi32_ps(values), scale));
+			}
+#endif
+			for (; i < end; i++)
+			{
+				heightValues[i] = (float)samples[i] / 256;
+			}
+			break;
+		}
+
+		case HeightMapFormat::UInt16:
+		{
+			const USHORT * samples = (const USHORT *)_file.GetData();
+#if defined(__AVX2__)
+			// Multiplying by a power of two gives exactly the same result as dividing
+			const __m256 scale = _mm256_set1_ps(1.0f / 65536);
+			for (; i + 8 <= end; i += 8)
+			{
+				__m256i values = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(samples + i)));
+				_mm256_storeu_ps(heightValues + i, _mm256_mul_ps(_mm256_cvtepi32_ps(values), scale));
+			}
+#endif
+			for (; i < end; i++)
+			{
+				heightValues[i] = (float)samples[i] / 65536;
+			}
+			break;
+		}
+
+		case HeightMapFormat::Float32:
+			memcpy(heightValues + first, _file.GetData() + first * sizeof(float), (end - first) * sizeof(float));
+			break;
+
+		default:
+			break;
+	}
+}
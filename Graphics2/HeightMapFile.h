@@ -0,0 +1,55 @@
+#pragma once
+#include "MappedFile.h"
+
+// Size and type of the samples in a raw height map
+enum class HeightMapFormat
+{
+	Unknown,			// Work the format out from the size of the file
+	UInt8,				// Normalised by dividing by 256
+	UInt16,				// Normalised by dividing by 65536
+	Float32				// Used as they are
+};
+
+// A raw height map (a grid of samples with no header) mapped straight from disk.
+//
+// If the format or the dimensions are not given, they are worked out from the size of the file.
+// Only square maps can be worked out and 16-bit samples are tried first, then 8-bit, then 32-bit,
+// so a 2 MiB file is read as 1024 * 1024 16-bit samples and a 1 MiB file as 1024 * 1024 8-bit samples.
+// A square 32-bit map is the same size as an 8-bit one of twice the side, so a file that could be
+// either is read as 32-bit if every sample is a float from 0 to 1.  Give the format to be sure.
+class HeightMapFile
+{
+public:
+	HeightMapFile();
+	~HeightMapFile();
+
+	// width and height are the number of samples in each row and column, or 0 to work them out.
+	// Returns false, with a description in GetErrorMessage, if the file can't be opened or its size
+	// doesn't match.
+	bool Open(const wstring& filename, HeightMapFormat format = HeightMapFormat::Unknown, unsigned int width = 0, unsigned int height = 0);
+	void Close();
+
+	inline unsigned int GetWidth() { return _width; }
+	inline unsigned int GetHeight() { return _height; }
+	inline HeightMapFormat GetFormat() { return _format; }
+	inline const wstring& GetErrorMessage() { return _errorMessage; }
+
+	// The raw contents of the file
+	inline const BYTE * GetData() { return _file.GetData(); }
+	inline size_t GetDataSize() { return _file.GetSize(); }
+
+	// Converts rows [firstRow, endRow) to normalised heights, writing row z to heightValues + z * width.
+	// Works straight from the mapped file, eight samples at a time with AVX2.
+	void ConvertRows(float * heightValues, unsigned int firstRow, unsigned int endRow);
+
+	static unsigned int GetSampleSize(HeightMapFormat format);
+
+private:
+	MappedFile			_file;
+	HeightMapFormat		_format;
+	unsigned int		_width;
+	unsigned int		_height;
+	wstring				_errorMessage;
+
+	bool Fail(const wstring& filename, const wstring& message);
+};
@@ -0,0 +1,64 @@
+#include "MappedFile.h"
+
+MappedFile::MappedFile()
+{
+	_file = INVALID_HANDLE_VALUE;
+	_mapping = nullptr;
+	_data = nullptr;
+	_size = 0;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const wstring& filename)
+{
+	Close();
+	_file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (_file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+	_mapping = CreateFileMappingW(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (_mapping == nullptr)
+	{
+		Close();
+		return false;
+	}
+	_data = (const BYTE *)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (_data == nullptr)
+	{
+		Close();
+		return false;
+	}
+	_size = (size_t)size.QuadPart;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (_data != nullptr)
+	{
+		UnmapViewOfFile(_data);
+		_data = nullptr;
+	}
+	if (_mapping != nullptr)
+	{
+		CloseHandle(_mapping);
+		_mapping = nullptr;
+	}
+	if (_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(_file);
+		_file = INVALID_HANDLE_VALUE;
+	}
+	_size = 0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "core.h"
+
+using namespace std;
+
+// Read-only view of a whole file mapped into memory.  Pages are only read from disk when
+// they are first touched, and nothing is copied.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	// Returns false if the file cannot be opened or mapped.  Empty files cannot be mapped.
+	bool Open(const wstring& filename);
+	void Close();
+
+	inline bool IsOpen() { return _data != nullptr; }
+	inline const BYTE * GetData() { return _data; }
+	inline size_t GetSize() { return _size; }
+
+private:
+	HANDLE			_file;
+	HANDLE			_mapping;
+	const BYTE *	_data;
+	size_t			_size;
+
+	// A mapping can't be copied, as both copies would unmap it
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+};
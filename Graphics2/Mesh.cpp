@@ -37,6 +37,11 @@ SubMesh::~SubMesh(void)
 
 // Mesh methods
 
+Mesh::Mesh()
+{
+	_bounds = SceneBounds::Infinite();
+}
+
 size_t Mesh::GetSubMeshCount()
 {
 	return _subMeshList.size();
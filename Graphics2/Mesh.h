@@ -1,6 +1,7 @@
 #pragma once
 #include "core.h"
 #include "DirectXCore.h"
+#include "SceneBounds.h"
 #include <vector>
 
 // Core material class.  Ideally, this should be extended to include more material attributes that can be
@@ -78,15 +79,21 @@ private:
 class Mesh
 {
 public:
+	Mesh();
+
 	size_t								GetSubMeshCount();
 	shared_ptr<SubMesh>					GetSubMesh(unsigned int i);
 	void								AddSubMesh(shared_ptr<SubMesh> subMesh);
 	shared_ptr<Node>				    GetRootNode();
 	void								SetRootNode(shared_ptr<Node> node);
+	// Of the vertices of all the sub-meshes, in model space
+	inline const SceneBounds&			GetBounds() { return _bounds; }
+	inline void							SetBounds(const SceneBounds& bounds) { _bounds = bounds; }
 
 private:
 	vector<shared_ptr<SubMesh>> 		_subMeshList;
 	shared_ptr<Node>					_rootNode;
+	SceneBounds							_bounds;
 };
 
 
@@ -9,6 +9,7 @@ bool MeshNode::Initialise()
 	{
 		return false;
 	}
+	SetLocalBounds(_mesh->GetBounds());
 	return _renderer->Initialise();
 }
 
@@ -0,0 +1,273 @@
+#include "ProceduralHeightMap.h"
+#include "TerrainCache.h"
+#include <immintrin.h>
+#include <cmath>
+
+// Size of the square tiles the grid is split into when it is generated
+const unsigned int TileSize = 64;
+
+// Converts the 16-bit halves of a hash into gradient components in the range -1 to 1
+const float GradientScale = 2.0f / 65535.0f;
+
+// Offsets that keep the two warp noises (and the final noise) from lining up
+const float WarpOffsetX = 5.2f;
+const float WarpOffsetZ = 1.3f;
+const UINT32 WarpSeedX = 1013;
+const UINT32 WarpSeedZ = 2027;
+
+// The scalar and AVX2 versions below must carry out the same floating point operations in the
+// same order, so that a sample gets the same height whichever version calculates it.
+
+static inline UINT32 HashLattice(int x, int z, UINT32 seed)
+{
+	UINT32 hash = (UINT32)x * 374761393u + (UINT32)z * 668265263u + seed * 2246822519u;
+	hash = (hash ^ (hash >> 13)) * 1274126177u;
+	return hash ^ (hash >> 16);
+}
+
+static inline float Gradient(int x, int z, UINT32 seed, float dx, float dz)
+{
+	UINT32 hash = HashLattice(x, z, seed);
+	float gradientX = (float)(int)(hash & 0xFFFF) * GradientScale - 1.0f;
+	float gradientZ = (float)(int)(hash >> 16) * GradientScale - 1.0f;
+	return gradientX * dx + gradientZ * dz;
+}
+
+static inline float Fade(float t)
+{
+	return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+// Gradient noise in the range -1 to 1 (roughly)
+static float Noise(float x, float z, UINT32 seed)
+{
+	float floorX = floorf(x);
+	float floorZ = floorf(z);
+	int cellX = (int)floorX;
+	int cellZ = (int)floorZ;
+	float tx = x - floorX;
+	float tz = z - floorZ;
+	float n00 = Gradient(cellX, cellZ, seed, tx, tz);
+	float n10 = Gradient(cellX + 1, cellZ, seed, tx - 1.0f, tz);
+	float n01 = Gradient(cellX, cellZ + 1, seed, tx, tz - 1.0f);
+	float n11 = Gradient(cellX + 1, cellZ + 1, seed, tx - 1.0f, tz - 1.0f);
+	float u = Fade(tx);
+	float v = Fade(tz);
+	float top = n00 + u * (n10 - n00);
+	float bottom = n01 + u * (n11 - n01);
+	return top + v * (bottom - top);
+}
+
+static float FractalNoise(float x, float z, UINT32 seed, unsigned int octaves, float lacunarity, float gain, bool ridged)
+{
+	float sum = 0.0f;
+	float amplitude = 1.0f;
+	for (unsigned int octave = 0; octave < octaves; octave++)
+	{
+		float noise = Noise(x, z, seed + octave);
+		if (ridged)
+		{
+			noise = 1.0f - fabsf(noise);
+			noise = noise * noise;
+		}
+		sum = sum + noise * amplitude;
+		x = x * lacunarity;
+		z = z * lacunarity;
+		amplitude = amplitude * gain;
+	}
+	return sum;
+}
+
+#if defined(__AVX2__)
+
+static inline __m256i HashLattice8(__m256i x, __m256i z, __m256i seedTerm)
+{
+	__m256i hash = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(x, _mm256_set1_epi32(374761393)),
+													 _mm256_mullo_epi32(z, _mm256_set1_epi32(668265263))), seedTerm);
+	hash = _mm256_mullo_epi32(_mm256_xor_si256(hash, _mm256_srli_epi32(hash, 13)), _mm256_set1_epi32(1274126177));
+	return _mm256_xor_si256(hash, _mm256_srli_epi32(hash, 16));
+}
+
+static inline __m256 Gradient8(__m256i x, __m256i z, __m256i seedTerm, __m256 dx, __m256 dz)
+{
+	__m256i hash = HashLattice8(x, z, seedTerm);
+	__m256 scale = _mm256_set1_ps(GradientScale);
+	__m256 one = _mm256_set1_ps(1.0f);
+	__m256 gradientX = _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(hash, _mm256_set1_epi32(0xFFFF))), scale), one);
+	__m256 gradientZ = _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(hash, 16)), scale), one);
+	return _mm256_add_ps(_mm256_mul_ps(gradientX, dx), _mm256_mul_ps(gradientZ, dz));
+}
+
+static inline __m256 Fade8(__m256 t)
+{
+	__m256 inner = _mm256_add_ps(_mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f))), _mm256_set1_ps(10.0f));
+	return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), inner);
+}
+
+static __m256 Noise8(__m256 x, __m256 z, UINT32 seed)
+{
+	__m256 floorX = _mm256_floor_ps(x);
+	__m256 floorZ = _mm256_floor_ps(z);
+	__m256i cellX = _mm256_cvttps_epi32(floorX);
+	__m256i cellZ = _mm256_cvttps_epi32(floorZ);
+	__m256i cellX1 = _mm256_add_epi32(cellX, _mm256_set1_epi32(1));
+	__m256i cellZ1 = _mm256_add_epi32(cellZ, _mm256_set1_epi32(1));
+	__m256 tx = _mm256_sub_ps(x, floorX);
+	__m256 tz = _mm256_sub_ps(z, floorZ);
+	__m256 one = _mm256_set1_ps(1.0f);
+	__m256 tx1 = _mm256_sub_ps(tx, one);
+	__m256 tz1 = _mm256_sub_ps(tz, one);
+	__m256i seedTerm = _mm256_set1_epi32((int)(seed * 2246822519u));
+	__m256 n00 = Gradient8(cellX, cellZ, seedTerm, tx, tz);
+	__m256 n10 = Gradient8(cellX1, cellZ, seedTerm, tx1, tz);
+	__m256 n01 = Gradient8(cellX, cellZ1, seedTerm, tx, tz1);
+	__m256 n11 = Gradient8(cellX1, cellZ1, seedTerm, tx1, tz1);
+	__m256 u = Fade8(tx);
+	__m256 v = Fade8(tz);
+	__m256 top = _mm256_add_ps(n00, _mm256_mul_ps(u, _mm256_sub_ps(n10, n00)));
+	__m256 bottom = _mm256_add_ps(n01, _mm256_mul_ps(u, _mm256_sub_ps(n11, n01)));
+	return _mm256_add_ps(top, _mm256_mul_ps(v, _mm256_sub_ps(bottom, top)));
+}
+
+static __m256 FractalNoise8(__m256 x, __m256 z, UINT32 seed, unsigned int octaves, float lacunarity, float gain, bool ridged)
+{
+	__m256 sum = _mm256_setzero_ps();
+	__m256 lacunarities = _mm256_set1_ps(lacunarity);
+	__m256 one = _mm256_set1_ps(1.0f);
+	__m256 signMask = _mm256_set1_ps(-0.0f);
+	float amplitude = 1.0f;
+	for (unsigned int octave = 0; octave < octaves; octave++)
+	{
+		__m256 noise = Noise8(x, z, seed + octave);
+		if (ridged)
+		{
+			noise = _mm256_sub_ps(one, _mm256_andnot_ps(signMask, noise));
+			noise = _mm256_mul_ps(noise, noise);
+		}
+		sum = _mm256_add_ps(sum, _mm256_mul_ps(noise, _mm256_set1_ps(amplitude)));
+		x = _mm256_mul_ps(x, lacunarities);
+		z = _mm256_mul_ps(z, lacunarities);
+		amplitude = amplitude * gain;
+	}
+	return sum;
+}
+
+#endif
+
+ProceduralHeightMap::ProceduralHeightMap(const ProceduralHeightMapSettings& settings)
+{
+	_settings = settings;
+
+	// Scale the sum of the octaves back to the range of a single octave
+	float amplitude = 1.0f;
+	float totalAmplitude = 0.0f;
+	for (unsigned int octave = 0; octave < _settings.Octaves; octave++)
+	{
+		totalAmplitude += amplitude;
+		amplitude *= _settings.Gain;
+	}
+	_heightScale = totalAmplitude > 0.0f ? 1.0f / totalAmplitude : 0.0f;
+}
+
+ProceduralHeightMap::~ProceduralHeightMap()
+{
+}
+
+UINT64 ProceduralHeightMap::GetHash()
+{
+	return TerrainCache::Hash(&_settings, sizeof(_settings));
+}
+
+float ProceduralHeightMap::GetHeight(unsigned int x, unsigned int z)
+{
+	float frequency = _settings.Frequency;
+	float sampleX = (float)(int)x;
+	float sampleZ = (float)(int)z;
+
+	// Move the sample by a noise of its own before looking up its height
+	float warpFrequency = frequency * 0.5f;
+	float warpX = FractalNoise(sampleX * warpFrequency + WarpOffsetX, sampleZ * warpFrequency, _settings.Seed + WarpSeedX,
+							   _settings.WarpOctaves, _settings.Lacunarity, _settings.Gain, false);
+	float warpZ = FractalNoise(sampleX * warpFrequency, sampleZ * warpFrequency + WarpOffsetZ, _settings.Seed + WarpSeedZ,
+							   _settings.WarpOctaves, _settings.Lacunarity, _settings.Gain, false);
+	sampleX = sampleX + warpX * _settings.WarpStrength;
+	sampleZ = sampleZ + warpZ * _settings.WarpStrength;
+
+	bool ridged = _settings.NoiseType == ProceduralNoiseType::Ridged;
+	float noise = FractalNoise(sampleX * frequency, sampleZ * frequency, _settings.Seed, _settings.Octaves, _settings.Lacunarity, _settings.Gain, ridged);
+	float height = noise * _heightScale;
+	if (!ridged)
+	{
+		// The summed noise rarely goes beyond -0.5 to 0.5
+		height = height + 0.5f;
+	}
+	return min(max(height, 0.0f), 1.0f);
+}
+
+void ProceduralHeightMap::GenerateArea(float * heightValues, unsigned int width, unsigned int firstX, unsigned int firstZ, unsigned int endX, unsigned int endZ,
+									   unsigned int originX, unsigned int originZ)
+{
+	for (unsigned int z = firstZ; z < endZ; z++)
+	{
+		float * row = heightValues + (size_t)z * width;
+		unsigned int x = firstX;
+#if defined(__AVX2__)
+		float frequency = _settings.Frequency;
+		float warpFrequency = frequency * 0.5f;
+		__m256 frequencies = _mm256_set1_ps(frequency);
+		__m256 warpFrequencies = _mm256_set1_ps(warpFrequency);
+		__m256 warpStrength = _mm256_set1_ps(_settings.WarpStrength);
+		__m256 heightScale = _mm256_set1_ps(_heightScale);
+		__m256 half = _mm256_set1_ps(0.5f);
+		__m256 sampleZ = _mm256_set1_ps((float)(int)(originZ + z));
+		bool ridged = _settings.NoiseType == ProceduralNoiseType::Ridged;
+		for (; x + 8 <= endX; x += 8)
+		{
+			__m256 sampleX = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32((int)(originX + x)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+			__m256 warpX = FractalNoise8(_mm256_add_ps(_mm256_mul_ps(sampleX, warpFrequencies), _mm256_set1_ps(WarpOffsetX)), _mm256_mul_ps(sampleZ, warpFrequencies),
+										 _settings.Seed + WarpSeedX, _settings.WarpOctaves, _settings.Lacunarity, _settings.Gain, false);
+			__m256 warpZ = FractalNoise8(_mm256_mul_ps(sampleX, warpFrequencies), _mm256_add_ps(_mm256_mul_ps(sampleZ, warpFrequencies), _mm256_set1_ps(WarpOffsetZ)),
+										 _settings.Seed + WarpSeedZ, _settings.WarpOctaves, _settings.Lacunarity, _settings.Gain, false);
+			__m256 warpedX = _mm256_add_ps(sampleX, _mm256_mul_ps(warpX, warpStrength));
+			__m256 warpedZ = _mm256_add_ps(sampleZ, _mm256_mul_ps(warpZ, warpStrength));
+			__m256 noise = FractalNoise8(_mm256_mul_ps(warpedX, frequencies), _mm256_mul_ps(warpedZ, frequencies), _settings.Seed,
+										 _settings.Octaves, _settings.Lacunarity, _settings.Gain, ridged);
+			__m256 height = _mm256_mul_ps(noise, heightScale);
+			if (!ridged)
+			{
+				height = _mm256_add_ps(height, half);
+			}
+			height = _mm256_min_ps(_mm256_max_ps(height, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+			_mm256_storeu_ps(row + x, height);
+		}
+#endif
+		// Anything left over (or everything without AVX2) one sample at a time
+		for (; x < endX; x++)
+		{
+			row[x] = GetHeight(originX + x, originZ + z);
+		}
+	}
+}
+
+void ProceduralHeightMap::Generate(float * heightValues, unsigned int width, unsigned int height, ThreadPool * threadPool, unsigned int originX, unsigned int originZ)
+{
+	unsigned int tilesAcross = (width + TileSize - 1) / TileSize;
+	unsigned int tilesDown = (height + TileSize - 1) / TileSize;
+	auto generateTiles = [&](unsigned int firstTile, unsigned int endTile)
+	{
+		for (unsigned int tile = firstTile; tile < endTile; tile++)
+		{
+			unsigned int tileX = (tile % tilesAcross) * TileSize;
+			unsigned int tileZ = (tile / tilesAcross) * TileSize;
+			GenerateArea(heightValues, width, tileX, tileZ, min(tileX + TileSize, width), min(tileZ + TileSize, height), originX, originZ);
+		}
+	};
+	if (threadPool == nullptr)
+	{
+		generateTiles(0, tilesAcross * tilesDown);
+	}
+	else
+	{
+		threadPool->ParallelFor(tilesAcross * tilesDown, generateTiles);
+	}
+}
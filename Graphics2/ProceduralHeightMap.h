@@ -0,0 +1,58 @@
+#pragma once
+#include "core.h"
+#include "ThreadPool.h"
+
+// How the octaves of noise are combined
+enum class ProceduralNoiseType
+{
+	FractalBrownianMotion,		// Rolling hills
+	Ridged						// Sharp ridges and valleys
+};
+
+struct ProceduralHeightMapSettings
+{
+	unsigned int			Seed = 1;
+	ProceduralNoiseType		NoiseType = ProceduralNoiseType::FractalBrownianMotion;
+	unsigned int			Octaves = 8;
+	float					Frequency = 1.0f / 256.0f;	// Of the first octave, in cycles per sample
+	float					Lacunarity = 2.0f;			// Frequency multiplier from one octave to the next
+	float					Gain = 0.5f;				// Amplitude multiplier from one octave to the next
+	float					WarpStrength = 64.0f;		// How far (in samples) the domain warp can move a sample, 0 for none
+	unsigned int			WarpOctaves = 3;
+};
+
+// Generates heights from seeded gradient noise instead of reading them from a file, so terrains of
+// any size can be created.  The noise is summed over several octaves as fractal Brownian motion or
+// ridged noise, sampled at a position that has itself been displaced by noise (domain warping).
+//
+// Every sample is a function of its position and the settings only, and the AVX2 path (eight samples
+// at a time) carries out exactly the same operations as the scalar one, so the heights are identical
+// however the work is split between threads.
+class ProceduralHeightMap
+{
+public:
+	ProceduralHeightMap(const ProceduralHeightMapSettings& settings);
+	~ProceduralHeightMap();
+
+	// Fills a width * height grid with heights in the range 0.0f - 1.0f, row z starting at
+	// heightValues + z * width.  The grid is split into tiles that are spread across threadPool
+	// (if it is not nullptr).  Sample (x, z) of the grid is sample (originX + x, originZ + z) of the
+	// height map, so grids generated next to each other match along their shared edges.
+	void Generate(float * heightValues, unsigned int width, unsigned int height, ThreadPool * threadPool, unsigned int originX = 0, unsigned int originZ = 0);
+
+	// Fills samples [firstX, endX) x [firstZ, endZ) of a grid width samples wide
+	void GenerateArea(float * heightValues, unsigned int width, unsigned int firstX, unsigned int firstZ, unsigned int endX, unsigned int endZ,
+					  unsigned int originX = 0, unsigned int originZ = 0);
+
+	// The height of a single sample
+	float GetHeight(unsigned int x, unsigned int z);
+
+	// Hash of the settings, used in place of the hash of a height map file
+	UINT64 GetHash();
+
+	inline const ProceduralHeightMapSettings& GetSettings() { return _settings; }
+
+private:
+	ProceduralHeightMapSettings	_settings;
+	float						_heightScale;
+};
@@ -4,6 +4,7 @@
 #include "WICTextureLoader.h"
 #include <locale>
 #include <codecvt>
+#include <cfloat>
 #include "MeshRenderer.h"
 
 #pragma comment(lib, "../Assimp/lib/release/assimp-vc140-mt.lib")
@@ -342,6 +343,8 @@ shared_ptr<Mesh> ResourceManager::LoadModelFromFile(wstring modelName)
     }
     // Now we have created all of the materials, build up the mesh
 	shared_ptr<Mesh> resourceMesh = make_shared<Mesh>();
+	XMFLOAT3 boundsMinimum(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 boundsMaximum(-FLT_MAX, -FLT_MAX, -FLT_MAX);
     for (unsigned int sm = 0; sm < scene->mNumMeshes; sm++)
     {
 	    aiMesh * subMesh = scene->mMeshes[sm];
@@ -363,6 +366,8 @@ shared_ptr<Mesh> ResourceManager::LoadModelFromFile(wstring modelName)
 	    for (unsigned int i = 0; i < numVertices; i++)
 	    {
 			currentVertex->Position = XMFLOAT3(subMeshVertices->x, subMeshVertices->y, subMeshVertices->z);
+			boundsMinimum = XMFLOAT3(min(boundsMinimum.x, subMeshVertices->x), min(boundsMinimum.y, subMeshVertices->y), min(boundsMinimum.z, subMeshVertices->z));
+			boundsMaximum = XMFLOAT3(max(boundsMaximum.x, subMeshVertices->x), max(boundsMaximum.y, subMeshVertices->y), max(boundsMaximum.z, subMeshVertices->z));
 			currentVertex->Normal = XMFLOAT3(subMeshNormals->x, subMeshNormals->y, subMeshNormals->z);
 		    subMeshVertices++;
 		    subMeshNormals++;
@@ -466,6 +471,25 @@ shared_ptr<Mesh> ResourceManager::LoadModelFromFile(wstring modelName)
 		delete[] modelVertices;
 		delete[] modelIndices;
     }
+	// The sphere is centred on the box, but only needs to be big enough for the vertices rather than
+	// the corners of the box
+	XMFLOAT3 boundsCentre((boundsMinimum.x + boundsMaximum.x) * 0.5f, (boundsMinimum.y + boundsMaximum.y) * 0.5f, (boundsMinimum.z + boundsMaximum.z) * 0.5f);
+	float boundsRadiusSquared = 0.0f;
+	for (unsigned int sm = 0; sm < scene->mNumMeshes; sm++)
+	{
+		aiMesh * subMesh = scene->mMeshes[sm];
+		for (unsigned int i = 0; i < subMesh->mNumVertices; i++)
+		{
+			float x = subMesh->mVertices[i].x - boundsCentre.x;
+			float y = subMesh->mVertices[i].y - boundsCentre.y;
+			float z = subMesh->mVertices[i].z - boundsCentre.z;
+			boundsRadiusSquared = max(boundsRadiusSquared, x * x + y * y + z * z);
+		}
+	}
+	if (scene->mNumMeshes > 0)
+	{
+		resourceMesh->SetBounds(SceneBounds::FromBox(boundsMinimum, boundsMaximum, sqrtf(boundsRadiusSquared)));
+	}
 	// Now build the hierarchy of nodes
 	resourceMesh->SetRootNode(CreateNodes(scene->mRootNode));
 	return resourceMesh;
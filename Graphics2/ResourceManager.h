@@ -2,9 +2,9 @@
 #include "Mesh.h"
 #include "Renderer.h"
 #include <map>
-#include <assimp\importer.hpp>
-#include <assimp\scene.h>
-#include <assimp\postprocess.h>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
 
 struct VERTEX
 {
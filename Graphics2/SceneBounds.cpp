@@ -0,0 +1,146 @@
+#include "SceneBounds.h"
+#include <algorithm>
+
+SceneBounds SceneBounds::Empty()
+{
+	return { SceneBoundsType::Empty, XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f };
+}
+
+SceneBounds SceneBounds::Infinite()
+{
+	return { SceneBoundsType::Infinite, XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f };
+}
+
+SceneBounds SceneBounds::FromBox(const XMFLOAT3& minimum, const XMFLOAT3& maximum, float radius)
+{
+	SceneBounds bounds;
+	bounds.Type = SceneBoundsType::Finite;
+	bounds.Centre = XMFLOAT3((minimum.x + maximum.x) * 0.5f, (minimum.y + maximum.y) * 0.5f, (minimum.z + maximum.z) * 0.5f);
+	bounds.Extents = XMFLOAT3((maximum.x - minimum.x) * 0.5f, (maximum.y - minimum.y) * 0.5f, (maximum.z - minimum.z) * 0.5f);
+	float boxRadius = sqrtf(bounds.Extents.x * bounds.Extents.x + bounds.Extents.y * bounds.Extents.y + bounds.Extents.z * bounds.Extents.z);
+	bounds.Radius = radius < 0.0f ? boxRadius : min(radius, boxRadius);
+	return bounds;
+}
+
+SceneBounds SceneBounds::Transform(const XMFLOAT4X4& transformation) const
+{
+	if (Type != SceneBoundsType::Finite)
+	{
+		return *this;
+	}
+	// The centre is transformed as a point.  Each new extent is the sum of the old extents projected
+	// onto that axis, and the sphere grows by the largest scale of the three axes.
+	const float (&m)[4][4] = transformation.m;
+	SceneBounds bounds;
+	bounds.Type = SceneBoundsType::Finite;
+	bounds.Centre.x = Centre.x * m[0][0] + Centre.y * m[1][0] + Centre.z * m[2][0] + m[3][0];
+	bounds.Centre.y = Centre.x * m[0][1] + Centre.y * m[1][1] + Centre.z * m[2][1] + m[3][1];
+	bounds.Centre.z = Centre.x * m[0][2] + Centre.y * m[1][2] + Centre.z * m[2][2] + m[3][2];
+	bounds.Extents.x = Extents.x * fabsf(m[0][0]) + Extents.y * fabsf(m[1][0]) + Extents.z * fabsf(m[2][0]);
+	bounds.Extents.y = Extents.x * fabsf(m[0][1]) + Extents.y * fabsf(m[1][1]) + Extents.z * fabsf(m[2][1]);
+	bounds.Extents.z = Extents.x * fabsf(m[0][2]) + Extents.y * fabsf(m[1][2]) + Extents.z * fabsf(m[2][2]);
+	float scale = 0.0f;
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		scale = max(scale, m[i][0] * m[i][0] + m[i][1] * m[i][1] + m[i][2] * m[i][2]);
+	}
+	float boxRadius = sqrtf(bounds.Extents.x * bounds.Extents.x + bounds.Extents.y * bounds.Extents.y + bounds.Extents.z * bounds.Extents.z);
+	bounds.Radius = min(Radius * sqrtf(scale), boxRadius);
+	return bounds;
+}
+
+void SceneBounds::Merge(const SceneBounds& bounds)
+{
+	if (bounds.Type == SceneBoundsType::Empty || Type == SceneBoundsType::Infinite)
+	{
+		return;
+	}
+	if (Type == SceneBoundsType::Empty || bounds.Type == SceneBoundsType::Infinite)
+	{
+		*this = bounds;
+		return;
+	}
+	XMFLOAT3 minimum(min(Centre.x - Extents.x, bounds.Centre.x - bounds.Extents.x),
+					 min(Centre.y - Extents.y, bounds.Centre.y - bounds.Extents.y),
+					 min(Centre.z - Extents.z, bounds.Centre.z - bounds.Extents.z));
+	XMFLOAT3 maximum(max(Centre.x + Extents.x, bounds.Centre.x + bounds.Extents.x),
+					 max(Centre.y + Extents.y, bounds.Centre.y + bounds.Extents.y),
+					 max(Centre.z + Extents.z, bounds.Centre.z + bounds.Extents.z));
+	SceneBounds merged = FromBox(minimum, maximum);
+	// A sphere about the new centre that holds both spheres, if that is smaller than the one around the box
+	float radius = 0.0f;
+	const SceneBounds * parts[] = { this, &bounds };
+	for (const SceneBounds * part : parts)
+	{
+		float dx = part->Centre.x - merged.Centre.x;
+		float dy = part->Centre.y - merged.Centre.y;
+		float dz = part->Centre.z - merged.Centre.z;
+		radius = max(radius, sqrtf(dx * dx + dy * dy + dz * dz) + part->Radius);
+	}
+	merged.Radius = min(merged.Radius, radius);
+	*this = merged;
+}
+
+SceneFrustum::SceneFrustum()
+{
+	for (XMFLOAT4& plane : _planes)
+	{
+		plane = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+}
+
+SceneFrustum::SceneFrustum(FXMMATRIX viewProjectionTransformation)
+{
+	// A point is inside when -w <= x <= w, -w <= y <= w and 0 <= z <= w after transformation, and each of
+	// those is a plane made from the columns of the matrix
+	XMFLOAT4X4 matrix;
+	XMStoreFloat4x4(&matrix, viewProjectionTransformation);
+	const float (&m)[4][4] = matrix.m;
+	// For each plane, how much of the w column and of the x, y or z column it takes
+	const float planeColumns[6][3] =
+	{
+		{ 1.0f, 1.0f, 0.0f },		// Left:	x + w >= 0
+		{ 1.0f, -1.0f, 0.0f },		// Right:	w - x >= 0
+		{ 1.0f, 1.0f, 1.0f },		// Bottom:	y + w >= 0
+		{ 1.0f, -1.0f, 1.0f },		// Top:		w - y >= 0
+		{ 0.0f, 1.0f, 2.0f },		// Near:	z >= 0
+		{ 1.0f, -1.0f, 2.0f }		// Far:		w - z >= 0
+	};
+	for (unsigned int i = 0; i < 6; i++)
+	{
+		float w = planeColumns[i][0];
+		float sign = planeColumns[i][1];
+		unsigned int column = (unsigned int)planeColumns[i][2];
+		float a = w * m[0][3] + sign * m[0][column];
+		float b = w * m[1][3] + sign * m[1][column];
+		float c = w * m[2][3] + sign * m[2][column];
+		float d = w * m[3][3] + sign * m[3][column];
+		float length = sqrtf(a * a + b * b + c * c);
+		float scale = length > 0.0f ? 1.0f / length : 0.0f;
+		_planes[i] = XMFLOAT4(a * scale, b * scale, c * scale, d * scale);
+	}
+}
+
+SceneCullResult SceneFrustum::Test(const SceneBounds& bounds) const
+{
+	if (bounds.Type != SceneBoundsType::Finite)
+	{
+		return bounds.Type == SceneBoundsType::Empty ? SceneCullResult::Outside : SceneCullResult::Intersecting;
+	}
+	SceneCullResult result = SceneCullResult::Inside;
+	for (const XMFLOAT4& plane : _planes)
+	{
+		float distance = plane.x * bounds.Centre.x + plane.y * bounds.Centre.y + plane.z * bounds.Centre.z + plane.w;
+		float boxRadius = fabsf(plane.x) * bounds.Extents.x + fabsf(plane.y) * bounds.Extents.y + fabsf(plane.z) * bounds.Extents.z;
+		float radius = min(boxRadius, bounds.Radius);
+		if (distance < -radius)
+		{
+			return SceneCullResult::Outside;
+		}
+		if (distance < radius)
+		{
+			result = SceneCullResult::Intersecting;
+		}
+	}
+	return result;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "DirectXCore.h"
+
+using namespace std;
+
+enum class SceneBoundsType
+{
+	Empty,				// Nothing is drawn, so it can never be seen
+	Finite,
+	Infinite			// Always drawn, e.g. the sky
+};
+
+// An axis-aligned box and a sphere about the same centre, both holding everything a node (or a
+// subgraph) draws.  Culling uses whichever of the two fits more tightly against each plane.
+struct SceneBounds
+{
+	SceneBoundsType		Type;
+	XMFLOAT3			Centre;
+	XMFLOAT3			Extents;		// Half the size of the box along each axis
+	float				Radius;			// Of the sphere
+
+	static SceneBounds Empty();
+	static SceneBounds Infinite();
+
+	// radius is the sphere's radius, or less than 0 to put the sphere around the box
+	static SceneBounds FromBox(const XMFLOAT3& minimum, const XMFLOAT3& maximum, float radius = -1.0f);
+
+	// The bounds after transformation, which can be bigger than the transformed volume but never smaller
+	SceneBounds Transform(const XMFLOAT4X4& transformation) const;
+
+	// Grows these bounds to hold bounds as well
+	void Merge(const SceneBounds& bounds);
+};
+
+enum class SceneCullResult
+{
+	Outside,
+	Intersecting,
+	Inside
+};
+
+// The six planes of a view frustum, with their normals pointing inwards
+class SceneFrustum
+{
+public:
+	SceneFrustum();
+
+	// Extracts the planes from the combined view and projection transformation (row vectors, with
+	// depth from 0 to 1 as Direct3D uses), so the frustum is in world space
+	SceneFrustum(FXMMATRIX viewProjectionTransformation);
+
+	SceneCullResult Test(const SceneBounds& bounds) const;
+
+	inline const XMFLOAT4& GetPlane(unsigned int index) const { return _planes[index]; }
+
+private:
+	XMFLOAT4			_planes[6];
+};
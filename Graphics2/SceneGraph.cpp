@@ -1,4 +1,31 @@
 #include "SceneGraph.h"
+#include "DirectXFramework.h"
+#include <algorithm>
+
+SceneGraph::SceneGraph(wstring name) : SceneNode(name)
+{
+	_version = 1;
+	// A graph doesn't draw anything itself, so its bounds are just those of its children
+	_localBounds = SceneBounds::Empty();
+	_worldBounds = SceneBounds::Empty();
+	_cullStatistics = { 0, 0, 0, 0 };
+	_childNodesChanged = true;
+}
+
+SceneGraph::~SceneGraph(void)
+{
+	// Children can outlive the graph, so make sure they don't refer to it or its hierarchy
+	if (_transformHierarchy == &_transforms)
+	{
+		RemoveFromTransformHierarchy();
+	}
+	for (SceneGraphIterator listIterator = begin(_children);
+		listIterator != end(_children);
+		listIterator++)
+	{
+		(*listIterator)->_parentGraph = nullptr;
+	}
+}
 
 bool SceneGraph::Initialise(void)
 {
@@ -15,6 +42,22 @@ bool SceneGraph::Initialise(void)
 }
 
 void SceneGraph::Update(FXMMATRIX& currentWorldTransformation)
+{
+	if (_transformHierarchy != nullptr && _transformHierarchy != &_transforms)
+	{
+		// Part of a parent graph's hierarchy, which looks after the transforms.  This is only called
+		// if Update is used on this graph directly.
+		UpdateRecursive(currentWorldTransformation);
+		return;
+	}
+	if (!_transforms.IsBuilt())
+	{
+		_transforms.Build(*this);
+	}
+	_transforms.Update(currentWorldTransformation);
+}
+
+void SceneGraph::UpdateRecursive(FXMMATRIX& currentWorldTransformation)
 {
 	SceneNode::Update(currentWorldTransformation);
 	// Recursively update all child nodes
@@ -24,11 +67,22 @@ void SceneGraph::Update(FXMMATRIX& currentWorldTransformation)
 		listIterator++)
 	{
 		(*listIterator)->Update(combineWorldTransformation);
+		_worldBounds.Merge((*listIterator)->GetWorldBounds());
 	}
 }
 
 void SceneGraph::Render(void)
 {
+	DirectXFramework * framework = DirectXFramework::GetDXFramework();
+	if (_parentGraph == nullptr && framework != nullptr && framework->GetCamera() != nullptr)
+	{
+		SceneFrustum frustum(framework->GetCamera()->GetViewMatrix() * framework->GetProjectionTransformation());
+		for (SceneNode * node : CullVisibleNodes(frustum))
+		{
+			node->Render();
+		}
+		return;
+	}
 	// Recursively render all child nodes
 	for (SceneGraphIterator listIterator = begin(_children);
 		listIterator != end(_children);
@@ -38,6 +92,70 @@ void SceneGraph::Render(void)
 	}
 }
 
+void SceneGraph::Cull(const SceneFrustum& frustum, SceneCullResult result, vector<SceneNode *>& visibleNodes, SceneCullStatistics& statistics)
+{
+	if (result == SceneCullResult::Inside)
+	{
+		for (SceneGraphIterator listIterator = begin(_children);
+			listIterator != end(_children);
+			listIterator++)
+		{
+			(*listIterator)->Cull(frustum, SceneCullResult::Inside, visibleNodes, statistics);
+		}
+		return;
+	}
+	if (_childNodesChanged)
+	{
+		_childNodes.clear();
+		_childIsGraph.clear();
+		for (SceneGraphIterator listIterator = begin(_children);
+			listIterator != end(_children);
+			listIterator++)
+		{
+			_childNodes.push_back(listIterator->get());
+			_childIsGraph.push_back(dynamic_cast<SceneGraph *>(listIterator->get()) != nullptr ? 1 : 0);
+		}
+		_childNodesChanged = false;
+	}
+	unsigned int childCount = (unsigned int)_childNodes.size();
+	if (childCount == 0)
+	{
+		return;
+	}
+	_childBounds.Clear();
+	for (SceneNode * child : _childNodes)
+	{
+		_childBounds.Add(child->_worldBounds);
+	}
+	_visibleChildIndices.resize(childCount);
+	_insideChildFlags.resize(childCount);
+	unsigned int visibleCount = CullBoxes(frustum, _childBounds, 0, childCount, &_visibleChildIndices[0], &_insideChildFlags[0]);
+
+	statistics.NodesTested += childCount;
+	statistics.NodesCulled += childCount - visibleCount;
+	unsigned int subgraphs = 0;
+	for (BYTE isGraph : _childIsGraph)
+	{
+		subgraphs += isGraph;
+	}
+	for (unsigned int i = 0; i < visibleCount; i++)
+	{
+		unsigned int index = _visibleChildIndices[i];
+		subgraphs -= _childIsGraph[index];
+		_childNodes[index]->Cull(frustum, _insideChildFlags[i] != 0 ? SceneCullResult::Inside : SceneCullResult::Intersecting, visibleNodes, statistics);
+	}
+	statistics.SubgraphsCulled += subgraphs;
+}
+
+const vector<SceneNode *>& SceneGraph::CullVisibleNodes(const SceneFrustum& frustum)
+{
+	_visibleNodes.clear();
+	_cullStatistics = { 0, 0, 0, 0 };
+	// This graph is the one being drawn, so only its children are tested
+	Cull(frustum, SceneCullResult::Intersecting, _visibleNodes, _cullStatistics);
+	return _visibleNodes;
+}
+
 void SceneGraph::Shutdown(void)
 {
 	// Recursively shutdown all child nodes
@@ -51,37 +169,146 @@ void SceneGraph::Shutdown(void)
 
 void SceneGraph::Add(SceneNodePointer node)
 {
+	// Moving a node from one graph to another takes it out of the first graph's children, name index
+	// and transform hierarchy
+	if (node->_parentGraph != nullptr)
+	{
+		node->_parentGraph->Remove(node);
+	}
 	_children.push_back(node);
+	_childNodesChanged = true;
+	node->_parentGraph = this;
+	UpdateNameIndex(node.get(), true);
+	if (_transformHierarchy != nullptr)
+	{
+		_transformHierarchy->Invalidate();
+	}
 }
 
 void SceneGraph::Remove(SceneNodePointer node)
 {
-	for (SceneGraphIterator listIterator = begin(_children);
-		listIterator != end(_children);
-		listIterator++)
+	// The index says whether the node is anywhere below this graph, and the node knows which graph
+	// holds it, so only that graph's children need to be searched
+	if (node == nullptr || !Contains(node.get()))
 	{
-		// First remove this node from further down the list if it occurs there
-		(*listIterator)->Remove(node);
-		// If this is the node to remove, take it out of the list
-		if (*listIterator == node)
-		{
-			_children.erase(listIterator);
-		}
+		return;
 	}
+	SceneGraph * parentGraph = node->_parentGraph;
+	SceneNodeList& siblings = parentGraph->_children;
+	SceneGraphIterator listIterator = find(begin(siblings), end(siblings), node);
+	if (listIterator == end(siblings))
+	{
+		return;
+	}
+	if (parentGraph->_transformHierarchy != nullptr)
+	{
+		node->RemoveFromTransformHierarchy();
+		parentGraph->_transformHierarchy->Invalidate();
+	}
+	parentGraph->UpdateNameIndex(node.get(), false);
+	node->_parentGraph = nullptr;
+	siblings.erase(listIterator);
+	parentGraph->_childNodesChanged = true;
 }
 
 SceneNodePointer SceneGraph::Find(wstring name)
 {
-	if (_name == name)
+	// A name that has never been interned can't belong to any node
+	unsigned int nameId = SceneNameTable::Find(name);
+	return nameId != 0 ? Find(nameId) : nullptr;
+}
+
+SceneNodePointer SceneGraph::Find(unsigned int nameId)
+{
+	if (_nameId == nameId)
 	{
 		return shared_from_this();
 	}
-	SceneNodePointer returnValue = nullptr;
+	auto found = _nameIndex.find(nameId);
+	if (found == _nameIndex.end() || found->second.empty())
+	{
+		return nullptr;
+	}
+	return found->second.front()->shared_from_this();
+}
+
+bool SceneGraph::Contains(SceneNode * node)
+{
+	auto found = _nameIndex.find(node->_nameId);
+	return found != _nameIndex.end() && find(begin(found->second), end(found->second), node) != end(found->second);
+}
+
+void SceneGraph::UpdateNameIndex(SceneNode * node, bool adding)
+{
+	// The node and, if it is a graph, everything below it are added to or removed from the index of
+	// this graph and of every graph above it
+	SceneGraph * nodeGraph = dynamic_cast<SceneGraph *>(node);
+	for (SceneGraph * graph = this; graph != nullptr; graph = graph->_parentGraph)
+	{
+		graph->UpdateNameIndexEntry(node->_nameId, node, adding);
+		if (nodeGraph != nullptr)
+		{
+			for (auto& entry : nodeGraph->_nameIndex)
+			{
+				for (SceneNode * indexedNode : entry.second)
+				{
+					graph->UpdateNameIndexEntry(entry.first, indexedNode, adding);
+				}
+			}
+		}
+		graph->_version++;
+	}
+}
+
+void SceneGraph::UpdateNameIndexEntry(unsigned int nameId, SceneNode * node, bool adding)
+{
+	if (adding)
+	{
+		_nameIndex[nameId].push_back(node);
+		return;
+	}
+	auto found = _nameIndex.find(nameId);
+	if (found != _nameIndex.end())
+	{
+		vector<SceneNode *>& nodes = found->second;
+		auto indexedNode = find(begin(nodes), end(nodes), node);
+		if (indexedNode != end(nodes))
+		{
+			nodes.erase(indexedNode);
+		}
+		if (nodes.empty())
+		{
+			_nameIndex.erase(found);
+		}
+	}
+}
+
+void SceneGraph::AddToTransformHierarchy(SceneTransformHierarchy& hierarchy, int parentIndex)
+{
+	int index = (int)hierarchy.Add(this, parentIndex);
+	for (SceneGraphIterator listIterator = begin(_children);
+		listIterator != end(_children);
+		listIterator++)
+	{
+		(*listIterator)->AddToTransformHierarchy(hierarchy, index);
+	}
+}
+
+void SceneGraph::RemoveFromTransformHierarchy()
+{
+	SceneNode::RemoveFromTransformHierarchy();
 	for (SceneGraphIterator listIterator = begin(_children);
 		listIterator != end(_children);
 		listIterator++)
 	{
-		returnValue = (*listIterator)->Find(name);
+		(*listIterator)->RemoveFromTransformHierarchy();
 	}
-	return returnValue;
+}
+
+SceneNodeHandle::SceneNodeHandle(SceneGraphPointer graph, const wstring& name)
+{
+	_graph = graph;
+	_nameId = SceneNameTable::Intern(name);
+	_node = graph->Find(_nameId);
+	_version = graph->GetVersion();
 }
@@ -1,6 +1,8 @@
 #pragma once
 #include "SceneNode.h"
+#include "FrustumCulling.h"
 #include <list>
+#include <unordered_map>
 
 using namespace std;
 
@@ -10,21 +12,105 @@ typedef SceneNodeList::iterator SceneGraphIterator;
 class SceneGraph : public SceneNode
 {
 public:
-	SceneGraph() : SceneNode(L"Root") {};
-	SceneGraph(wstring name) : SceneNode(name) {};
-	~SceneGraph(void) {};
+	SceneGraph() : SceneGraph(L"Root") {};
+	SceneGraph(wstring name);
+	~SceneGraph(void);
 
 	virtual bool Initialise(void);
+
+	// The graph that Update is called on flattens everything below it into a transform hierarchy, so
+	// only the nodes that have moved (and their descendants) have their transforms recalculated
 	virtual void Update(FXMMATRIX& currentWorldTransformation);
+
+	// Updates every node below this one by walking the graph
+	void UpdateRecursive(FXMMATRIX& currentWorldTransformation);
+
+	// Called on the root graph, only the nodes whose bounds are inside or intersect the camera's
+	// frustum are rendered
 	virtual void Render(void);
 	virtual void Shutdown(void);
 
+	// Tests the bounds of all the children at once (see CullBoxes).  Nothing below a child graph that is
+	// outside frustum is tested, nor below one that is entirely inside it.
+	void Cull(const SceneFrustum& frustum, SceneCullResult result, vector<SceneNode *>& visibleNodes, SceneCullStatistics& statistics);
+
+	// Finds the nodes below this graph that can be seen in frustum, in the order they would be rendered,
+	// as of the last Update.  Doesn't need a device, so it can be used with any camera.
+	const vector<SceneNode *>& CullVisibleNodes(const SceneFrustum& frustum);
+
+	// From the last Render or CullVisibleNodes
+	inline const SceneCullStatistics& GetCullStatistics() { return _cullStatistics; }
+
+	// A node can only be in one graph at a time, so adding a node that is already in a graph moves it
 	void Add(SceneNodePointer node);
 	void Remove(SceneNodePointer node);
+
+	// Finds a node anywhere below this graph (or this graph itself) with a single lookup in the
+	// graph's index.  If several nodes have the same name, the one that was added first is returned.
 	SceneNodePointer Find(wstring name);
+	SceneNodePointer Find(unsigned int nameId);
+
+	// Changes whenever a node is added or removed anywhere below this graph
+	inline unsigned int GetVersion() { return _version; }
+
+	void AddToTransformHierarchy(SceneTransformHierarchy& hierarchy, int parentIndex);
+	void RemoveFromTransformHierarchy();
+
+	inline SceneTransformHierarchy& GetTransformHierarchy() { return _transforms; }
+
+	// Large transform updates are split across threadPool (if it is not nullptr).  By default there is
+	// no pool and every update is done on the calling thread.  That is deliberate: the pool is opt-in
+	// (see DirectXFramework::SetParallelSceneUpdateEnabled) until SceneTransformHierarchyBench shows it
+	// beating the serial update on the target machine.
+	inline void SetThreadPool(shared_ptr<ThreadPool> threadPool) { _threadPool = threadPool; _transforms.SetThreadPool(threadPool.get()); }
 
 private:
-	SceneNodeList _children;
+	SceneNodeList			_children;
+	SceneTransformHierarchy	_transforms;	// Only used if Update is called on this graph rather than on a parent
+	shared_ptr<ThreadPool>	_threadPool;
+	vector<SceneNode *>		_visibleNodes;
+	SceneCullStatistics		_cullStatistics;
+
+	// The children in an array, rebuilt when they change, and their bounds gathered for culling
+	vector<SceneNode *>		_childNodes;
+	vector<BYTE>			_childIsGraph;
+	bool					_childNodesChanged;
+	BoundingBoxArrays		_childBounds;
+	vector<unsigned int>	_visibleChildIndices;
+	vector<BYTE>			_insideChildFlags;
+
+	// Every node below this graph by name ID, in the order they were added
+	unordered_map<unsigned int, vector<SceneNode *>>	_nameIndex;
+	unsigned int										_version;
+
+	bool Contains(SceneNode * node);
+	void UpdateNameIndex(SceneNode * node, bool adding);
+	void UpdateNameIndexEntry(unsigned int nameId, SceneNode * node, bool adding);
 };
 
 typedef shared_ptr<SceneGraph>			 SceneGraphPointer;
+
+// Remembers the node found by name in a graph, so that it is only looked up again after nodes
+// have been added to or removed from the graph.  Get returns nullptr if there is no such node.
+class SceneNodeHandle
+{
+public:
+	SceneNodeHandle() { _nameId = 0; _version = 0; };
+	SceneNodeHandle(SceneGraphPointer graph, const wstring& name);
+
+	inline const SceneNodePointer& Get()
+	{
+		if (_graph != nullptr && _graph->GetVersion() != _version)
+		{
+			_node = _graph->Find(_nameId);
+			_version = _graph->GetVersion();
+		}
+		return _node;
+	}
+
+private:
+	SceneGraphPointer	_graph;
+	SceneNodePointer	_node;
+	unsigned int		_nameId;
+	unsigned int		_version;			// Of the graph when _node was found
+};
@@ -0,0 +1,36 @@
+#include "SceneNameTable.h"
+
+unsigned int SceneNameTable::Intern(const wstring& name)
+{
+	lock_guard<mutex> lock(GetMutex());
+	unordered_map<wstring, unsigned int>& names = GetNames();
+	auto found = names.find(name);
+	if (found != names.end())
+	{
+		return found->second;
+	}
+	unsigned int id = (unsigned int)names.size() + 1;
+	names.emplace(name, id);
+	return id;
+}
+
+unsigned int SceneNameTable::Find(const wstring& name)
+{
+	lock_guard<mutex> lock(GetMutex());
+	unordered_map<wstring, unsigned int>& names = GetNames();
+	auto found = names.find(name);
+	return found != names.end() ? found->second : 0;
+}
+
+// Created on first use, as nodes can be created while other statics are being initialised
+unordered_map<wstring, unsigned int>& SceneNameTable::GetNames()
+{
+	static unordered_map<wstring, unsigned int> names;
+	return names;
+}
+
+mutex& SceneNameTable::GetMutex()
+{
+	static mutex nameMutex;
+	return nameMutex;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <mutex>
+
+using namespace std;
+
+// Gives every distinct node name a small integer ID, so the scene graph can index and compare
+// names without hashing or comparing strings.  Nodes can be created on any thread.
+class SceneNameTable
+{
+public:
+	// Returns the ID of name, adding it if it hasn't been seen before.  IDs start at 1.
+	static unsigned int Intern(const wstring& name);
+
+	// Returns the ID of name, or 0 if no node has ever been given it
+	static unsigned int Find(const wstring& name);
+
+private:
+	static unordered_map<wstring, unsigned int>& GetNames();
+	static mutex& GetMutex();
+};
@@ -1,6 +1,9 @@
 #pragma once
 #include "core.h"
 #include "DirectXCore.h"
+#include "SceneTransformHierarchy.h"
+#include "SceneNameTable.h"
+#include "SceneBounds.h"
 
 using namespace std;
 
@@ -8,22 +11,59 @@ using namespace std;
 // This scene graph implements the Composite Design Pattern
 
 class SceneNode;
+class SceneGraph;
 
 typedef shared_ptr<SceneNode>	SceneNodePointer;
 
+struct SceneCullStatistics
+{
+	unsigned int	NodesTested;		// Nodes whose bounds were tested against the frustum
+	unsigned int	NodesVisible;		// Nodes that were drawn
+	unsigned int	NodesCulled;		// Nodes outside the frustum, which includes whole graphs
+	unsigned int	SubgraphsCulled;	// and how many of those were graphs, so nothing below them was tested
+};
+
 class SceneNode : public enable_shared_from_this<SceneNode>
 {
 public:
-	SceneNode(wstring name) {_name = name; XMStoreFloat4x4(&_worldTransformation, XMMatrixIdentity()); };
+	SceneNode(wstring name)
+	{
+		_name = name;
+		_nameId = SceneNameTable::Intern(name);
+		_parentGraph = nullptr;
+		XMStoreFloat4x4(&_worldTransformation, XMMatrixIdentity());
+		XMStoreFloat4x4(&_combinedWorldTransformation, XMMatrixIdentity());
+		_transformHierarchy = nullptr;
+		_transformIndex = 0;
+		_updatedEveryFrame = false;
+		_localBounds = SceneBounds::Infinite();
+		_worldBounds = SceneBounds::Infinite();
+	};
 	~SceneNode(void) {};
 
 	// Core methods
 	virtual bool Initialise() = 0;
-	virtual void Update(FXMMATRIX& currentWorldTransformation) { XMStoreFloat4x4(&_combinedWorldTransformation, XMLoadFloat4x4(&_worldTransformation) * currentWorldTransformation); }
+
+	// For a node in a transform hierarchy, this is only called if _updatedEveryFrame is set, before the
+	// hierarchy recalculates its transforms, so a node can move itself (or others) here and be drawn
+	// where it has moved to in the same frame.  Its combined transform and world bounds are then
+	// replaced with the ones the hierarchy worked out.
+	virtual void Update(FXMMATRIX& currentWorldTransformation)
+	{
+		XMStoreFloat4x4(&_combinedWorldTransformation, XMLoadFloat4x4(&_worldTransformation) * currentWorldTransformation);
+		_worldBounds = _localBounds.Transform(_combinedWorldTransformation);
+	}
 	virtual void Render() = 0;
 	virtual void Shutdown() = 0;
 
-	void SetWorldTransform(FXMMATRIX& worldTransformation) { XMStoreFloat4x4(&_worldTransformation, worldTransformation); }
+	void SetWorldTransform(FXMMATRIX& worldTransformation)
+	{
+		XMStoreFloat4x4(&_worldTransformation, worldTransformation);
+		if (_transformHierarchy != nullptr)
+		{
+			_transformHierarchy->SetLocalTransform(_transformIndex, _worldTransformation);
+		}
+	}
 		
 	// Although only required in the composite class, these are provided
 	// in order to simplify the code base.
@@ -31,9 +71,53 @@ public:
 	virtual void Remove(SceneNodePointer node) {};
 	virtual	SceneNodePointer Find(wstring name) { return (_name == name) ? shared_from_this() : nullptr; }
 
+	// The bounds of what the node draws, before its world transform is applied.  Nodes that don't
+	// set them are treated as being everywhere, so they are never culled.
+	void SetLocalBounds(const SceneBounds& bounds)
+	{
+		_localBounds = bounds;
+		if (_transformHierarchy != nullptr)
+		{
+			_transformHierarchy->SetLocalBounds(_transformIndex, _localBounds);
+		}
+	}
+	inline const SceneBounds& GetLocalBounds() { return _localBounds; }
+
+	// The bounds in world space as of the last Update, including everything below the node
+	inline const SceneBounds& GetWorldBounds() { return _worldBounds; }
+
+	// Called once the node's world bounds have been found to be inside or to intersect frustum (result), to
+	// add the node to visibleNodes.  Nodes that draw several parts of their own can cull those here too.
+	virtual void Cull(const SceneFrustum& frustum, SceneCullResult result, vector<SceneNode *>& visibleNodes, SceneCullStatistics& statistics)
+	{
+		statistics.NodesVisible++;
+		visibleNodes.push_back(this);
+	}
+
+	inline const wstring& GetName() { return _name; }
+	inline unsigned int GetNameId() { return _nameId; }
+
+	// Used by the root SceneGraph to flatten the graph into its transform hierarchy.  Nodes in a
+	// hierarchy have their combined transforms set by it rather than by Update.
+	virtual void AddToTransformHierarchy(SceneTransformHierarchy& hierarchy, int parentIndex) { hierarchy.Add(this, parentIndex); }
+	virtual void RemoveFromTransformHierarchy() { _transformHierarchy = nullptr; }
+
 protected:
 	XMFLOAT4X4			_worldTransformation;
 	XMFLOAT4X4			_combinedWorldTransformation;
 	wstring				_name;
+	unsigned int		_nameId;			// From SceneNameTable
+	SceneGraph *		_parentGraph;		// The graph the node has been added to, if any
+	SceneBounds			_localBounds;
+	SceneBounds			_worldBounds;
+
+	SceneTransformHierarchy *	_transformHierarchy;
+	unsigned int				_transformIndex;
+	// Set by nodes that do more in Update than work out their transform, so it is still called every
+	// frame when they are in a transform hierarchy
+	bool						_updatedEveryFrame;
+
+	friend class SceneTransformHierarchy;
+	friend class SceneGraph;
 };
 
@@ -0,0 +1,240 @@
+#include "SceneTransformHierarchy.h"
+#include "SceneNode.h"
+#include <algorithm>
+#include <functional>
+
+// Below this many nodes to recalculate, splitting the work between threads costs more than it saves
+const unsigned int ParallelUpdateMinimumNodes = 4096;
+const unsigned int ParallelUpdateGrainSize = 1024;
+
+SceneTransformHierarchy::SceneTransformHierarchy()
+{
+	XMStoreFloat4x4(&_parentTransformation, XMMatrixIdentity());
+	_updatedNodeCount = 0;
+	_built = false;
+	_threadPool = nullptr;
+}
+
+SceneTransformHierarchy::~SceneTransformHierarchy()
+{
+}
+
+void SceneTransformHierarchy::Build(SceneNode& root)
+{
+	_localTransforms.clear();
+	_worldTransforms.clear();
+	_localBounds.clear();
+	_nodeBounds.clear();
+	_subtreeBounds.clear();
+	_parentIndices.clear();
+	_subtreeEnds.clear();
+	_nodes.clear();
+	_localDirty.clear();
+	_dirtyIndices.clear();
+	_everyFrameIndices.clear();
+	root.AddToTransformHierarchy(*this, -1);
+
+	// Children come after their parents, so working backwards passes the end of each subtree up
+	unsigned int count = (unsigned int)_nodes.size();
+	for (unsigned int i = count; i-- > 1;)
+	{
+		unsigned int parent = (unsigned int)_parentIndices[i];
+		_subtreeEnds[parent] = max(_subtreeEnds[parent], _subtreeEnds[i]);
+	}
+
+	// Everything has to be calculated the first time
+	if (count > 0)
+	{
+		_localDirty[0] = 1;
+		_dirtyIndices.push_back(0);
+	}
+	_built = true;
+}
+
+unsigned int SceneTransformHierarchy::Add(SceneNode * node, int parentIndex)
+{
+	unsigned int index = (unsigned int)_nodes.size();
+	_localTransforms.push_back(node->_worldTransformation);
+	_worldTransforms.push_back(node->_worldTransformation);
+	_localBounds.push_back(node->_localBounds);
+	_nodeBounds.push_back(node->_localBounds);
+	_subtreeBounds.push_back(node->_localBounds);
+	_parentIndices.push_back(parentIndex);
+	_subtreeEnds.push_back(index + 1);
+	_nodes.push_back(node);
+	_localDirty.push_back(0);
+	if (node->_updatedEveryFrame)
+	{
+		_everyFrameIndices.push_back(index);
+	}
+	node->_transformHierarchy = this;
+	node->_transformIndex = index;
+	return index;
+}
+
+void SceneTransformHierarchy::Update(FXMMATRIX& parentTransformation)
+{
+	XMFLOAT4X4 parent;
+	XMStoreFloat4x4(&parent, parentTransformation);
+	if (memcmp(&parent, &_parentTransformation, sizeof(XMFLOAT4X4)) != 0 && !_nodes.empty())
+	{
+		_parentTransformation = parent;
+		if (_localDirty[0] == 0)
+		{
+			_localDirty[0] = 1;
+			_dirtyIndices.push_back(0);
+		}
+	}
+
+	// Nodes that ask to be updated every frame go first, so that anything they move is recalculated
+	// below in the same frame.  They can do anything, so they are left on this thread.
+	for (unsigned int index : _everyFrameIndices)
+	{
+		_nodes[index]->Update(XMLoadFloat4x4(GetParentWorld(index)));
+	}
+
+	// Going through the dirty nodes in order means a dirty node inside a subtree that has already been
+	// found can be skipped.  What is left is a set of separate subtrees, each a contiguous range.
+	sort(_dirtyIndices.begin(), _dirtyIndices.end());
+	_dirtyRanges.clear();
+	_updatedNodeCount = 0;
+	unsigned int done = 0;
+	for (unsigned int dirtyIndex : _dirtyIndices)
+	{
+		_localDirty[dirtyIndex] = 0;
+		if (dirtyIndex < done)
+		{
+			continue;
+		}
+		done = _subtreeEnds[dirtyIndex];
+		_dirtyRanges.push_back({ dirtyIndex, done, _updatedNodeCount });
+		_updatedNodeCount += done - dirtyIndex;
+	}
+	_dirtyIndices.clear();
+
+	if (_threadPool == nullptr || _threadPool->GetThreadCount() == 1 || _updatedNodeCount < ParallelUpdateMinimumNodes)
+	{
+		for (const DirtyRange& range : _dirtyRanges)
+		{
+			UpdateRange(range.First, range.First, range.End);
+		}
+	}
+	else
+	{
+		// The subtrees are laid end to end and split into pieces that can be done in any order
+		_threadPool->ParallelForDynamic(_updatedNodeCount, ParallelUpdateGrainSize, [this](unsigned int begin, unsigned int end)
+		{
+			auto range = upper_bound(_dirtyRanges.begin(), _dirtyRanges.end(), begin, [](unsigned int position, const DirtyRange& dirtyRange)
+			{
+				return position < dirtyRange.Offset;
+			}) - 1;
+			while (begin < end)
+			{
+				unsigned int first = range->First + (begin - range->Offset);
+				unsigned int count = min(end - begin, range->End - first);
+				UpdateRange(range->First, first, first + count);
+				begin += count;
+				range++;
+			}
+		});
+	}
+
+	UpdateBounds();
+
+	// SceneNode::Update sets the combined transform and bounds of just the node, from its parent's
+	// transform before this update, so put back the ones worked out here
+	for (unsigned int index : _everyFrameIndices)
+	{
+		_nodes[index]->_combinedWorldTransformation = _worldTransforms[index];
+		_nodes[index]->_worldBounds = _subtreeBounds[index];
+	}
+}
+
+void SceneTransformHierarchy::UpdateBounds()
+{
+	// Working backwards through each dirty subtree means every child's bounds are finished before its
+	// parent's are merged from them
+	for (const DirtyRange& range : _dirtyRanges)
+	{
+		for (unsigned int i = range.End; i-- > range.First;)
+		{
+			MergeChildBounds(i);
+		}
+	}
+
+	// Then the ancestors of each subtree, deepest first.  A node always comes after its ancestors, so
+	// that is the reverse of their order.
+	_boundsAncestors.clear();
+	for (const DirtyRange& range : _dirtyRanges)
+	{
+		for (int ancestor = _parentIndices[range.First]; ancestor >= 0; ancestor = _parentIndices[ancestor])
+		{
+			_boundsAncestors.push_back((unsigned int)ancestor);
+		}
+	}
+	sort(_boundsAncestors.begin(), _boundsAncestors.end(), greater<unsigned int>());
+	_boundsAncestors.erase(unique(_boundsAncestors.begin(), _boundsAncestors.end()), _boundsAncestors.end());
+	for (unsigned int ancestor : _boundsAncestors)
+	{
+		MergeChildBounds(ancestor);
+	}
+}
+
+void SceneTransformHierarchy::MergeChildBounds(unsigned int index)
+{
+	SceneBounds bounds = _nodeBounds[index];
+	for (unsigned int child = index + 1; child < _subtreeEnds[index]; child = _subtreeEnds[child])
+	{
+		bounds.Merge(_subtreeBounds[child]);
+	}
+	_subtreeBounds[index] = bounds;
+	_nodes[index]->_worldBounds = bounds;
+}
+
+void SceneTransformHierarchy::UpdateRange(unsigned int top, unsigned int first, unsigned int end)
+{
+	// Every node after first in the range has its parent either in [first, end) or among the ancestors of
+	// first.  Those below top might be being written by another thread, so they are worked out again here.
+	// Doing exactly the same calculations gives exactly the same results whichever thread does them.
+	// The scratch space is kept per thread, so once a thread has done a piece as deep as this one it
+	// doesn't allocate
+	static thread_local vector<unsigned int> ancestorIndices;
+	static thread_local vector<XMFLOAT4X4> ancestorTransforms;
+	ancestorIndices.clear();
+	if (first > top)
+	{
+		for (int ancestor = _parentIndices[first]; ancestor >= (int)top; ancestor = _parentIndices[ancestor])
+		{
+			ancestorIndices.push_back((unsigned int)ancestor);
+		}
+		ancestorTransforms.resize(ancestorIndices.size());
+		for (size_t i = ancestorIndices.size(); i-- > 0;)
+		{
+			const XMFLOAT4X4 * parentWorld = i + 1 < ancestorIndices.size() ? &ancestorTransforms[i + 1] : GetParentWorld(ancestorIndices[i]);
+			XMStoreFloat4x4(&ancestorTransforms[i], XMLoadFloat4x4(&_localTransforms[ancestorIndices[i]]) * XMLoadFloat4x4(parentWorld));
+		}
+	}
+
+	for (unsigned int i = first; i < end; i++)
+	{
+		int parentIndex = _parentIndices[i];
+		const XMFLOAT4X4 * parentWorld;
+		if (parentIndex >= (int)first || parentIndex < (int)top)
+		{
+			parentWorld = GetParentWorld(i);
+		}
+		else
+		{
+			unsigned int ancestor = 0;
+			while (ancestorIndices[ancestor] != (unsigned int)parentIndex)
+			{
+				ancestor++;
+			}
+			parentWorld = &ancestorTransforms[ancestor];
+		}
+		XMMATRIX world = XMLoadFloat4x4(&_localTransforms[i]) * XMLoadFloat4x4(parentWorld);
+		XMStoreFloat4x4(&_worldTransforms[i], world);
+		XMStoreFloat4x4(&_nodes[i]->_combinedWorldTransformation, world);
+		_nodeBounds[i] = _localBounds[i].Transform(_worldTransforms[i]);
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include "DirectXCore.h"
+#include "ThreadPool.h"
+#include "SceneBounds.h"
+#include <vector>
+
+using namespace std;
+
+class SceneNode;
+
+// The transforms of every node of a scene graph, flattened into arrays in parent-before-child
+// (depth first) order so they can be updated in a single pass over contiguous memory.
+//
+// Each node's subtree is the range of entries from the node to the end of its last descendant.
+// Setting a node's transform marks it as dirty, and Update recalculates the combined transforms
+// of just the dirty subtrees, so a frame where nothing has moved costs next to nothing.  The
+// hierarchy is owned by the root SceneGraph and rebuilt when nodes are added or removed.
+//
+// Given a thread pool, large updates are split into pieces of the dirty subtrees that threads take
+// (and steal from each other) in any order.  A piece works out the ancestors of its first node for
+// itself rather than wait for the piece that holds them, so the results are identical to a serial update.
+//
+// The world bounds of each node are worked out alongside its transform, then merged up into the bounds
+// of each subtree so a graph can be culled as a whole.  Only the dirty subtrees and their ancestors
+// have their bounds merged again.
+class SceneTransformHierarchy
+{
+public:
+	SceneTransformHierarchy();
+	~SceneTransformHierarchy();
+
+	// Flattens the graph below root (including root)
+	void Build(SceneNode& root);
+
+	// Called by SceneNode::AddToTransformHierarchy.  parentIndex is -1 for the root.
+	unsigned int Add(SceneNode * node, int parentIndex);
+
+	// Marks the hierarchy as needing to be built again after nodes have been added or removed
+	inline void Invalidate() { _built = false; }
+	inline bool IsBuilt() { return _built; }
+
+	inline void SetLocalTransform(unsigned int index, const XMFLOAT4X4& transformation)
+	{
+		_localTransforms[index] = transformation;
+		if (_localDirty[index] == 0)
+		{
+			_localDirty[index] = 1;
+			_dirtyIndices.push_back(index);
+		}
+	}
+
+	inline void SetLocalBounds(unsigned int index, const SceneBounds& bounds)
+	{
+		_localBounds[index] = bounds;
+		if (_localDirty[index] == 0)
+		{
+			_localDirty[index] = 1;
+			_dirtyIndices.push_back(index);
+		}
+	}
+
+	// Nodes that ask to be updated every frame first have Update called with their parent's transform as of
+	// the last Update, then the combined transforms and bounds of the dirty subtrees (including anything
+	// those nodes moved) are recalculated and copied to their nodes.
+	void Update(FXMMATRIX& parentTransformation);
+
+	// threadPool can be nullptr to do every update on the calling thread
+	inline void SetThreadPool(ThreadPool * threadPool) { _threadPool = threadPool; }
+
+	inline unsigned int GetNodeCount() { return (unsigned int)_nodes.size(); }
+
+	// Nodes whose combined transforms were recalculated in the last Update
+	inline unsigned int GetUpdatedNodeCount() { return _updatedNodeCount; }
+
+private:
+	// A subtree to recalculate.  Offset is where it starts when the subtrees are laid end to end.
+	struct DirtyRange
+	{
+		unsigned int	First;
+		unsigned int	End;
+		unsigned int	Offset;
+	};
+
+	vector<XMFLOAT4X4>		_localTransforms;
+	vector<XMFLOAT4X4>		_worldTransforms;
+	vector<SceneBounds>		_localBounds;
+	vector<SceneBounds>		_nodeBounds;			// In world space, of what each node draws itself
+	vector<SceneBounds>		_subtreeBounds;			// and of what it and all its descendants draw
+	vector<int>				_parentIndices;
+	vector<unsigned int>	_subtreeEnds;			// One past the last descendant of each node
+	vector<SceneNode *>		_nodes;
+	vector<BYTE>			_localDirty;
+	vector<unsigned int>	_dirtyIndices;
+	vector<unsigned int>	_everyFrameIndices;
+	vector<DirtyRange>		_dirtyRanges;
+	vector<unsigned int>	_boundsAncestors;
+	ThreadPool *			_threadPool;
+	XMFLOAT4X4				_parentTransformation;
+	unsigned int			_updatedNodeCount;
+	bool					_built;
+
+	void UpdateRange(unsigned int top, unsigned int first, unsigned int end);
+	void UpdateBounds();
+	void MergeChildBounds(unsigned int index);
+
+	inline const XMFLOAT4X4 * GetParentWorld(unsigned int index)
+	{
+		int parentIndex = _parentIndices[index];
+		return parentIndex < 0 ? &_parentTransformation : &_worldTransforms[parentIndex];
+	}
+};
@@ -0,0 +1,220 @@
+#include "TerrainBlendMap.h"
+#include <immintrin.h>
+#include <cmath>
+
+// The same operations are carried out in the same order in the scalar and vector versions so that
+// they give identical results.  With slope blending off, the texels are the same as the ones the
+// terrain has always used.
+
+struct BlendMapParameters
+{
+	float	HeightScale;
+	float	GradientScale;		// Turns the sum of the differences along two edges of a cell into a slope
+	float	SlopeStart;
+	float	SlopeFactor;		// 1 / (End - Start)
+	bool	SlopeEnabled;
+};
+
+static BlendMapParameters GetParameters(float worldHeight, float spacing, const TerrainSlopeBlend& slopeBlend)
+{
+	BlendMapParameters parameters;
+	parameters.HeightScale = worldHeight;
+	parameters.GradientScale = worldHeight / (2.0f * spacing);
+	parameters.SlopeEnabled = slopeBlend.End > slopeBlend.Start;
+	parameters.SlopeStart = slopeBlend.Start;
+	parameters.SlopeFactor = parameters.SlopeEnabled ? 1.0f / (slopeBlend.End - slopeBlend.Start) : 0.0f;
+	return parameters;
+}
+
+// value * scale / 255, rounded, for value and scale in the range 0 - 255
+static inline int ScaleByte(int value, int scale)
+{
+	int product = value * scale + 128;
+	return (product + (product >> 8)) >> 8;
+}
+
+static inline DWORD CalculateTexel(float topLeft, float topRight, float bottomLeft, float bottomRight, const BlendMapParameters& parameters)
+{
+	// The average height of the six corners of the cell's two triangles
+	float hs = parameters.HeightScale;
+	float y = topLeft * hs;
+	y = y + topRight * hs;
+	y = y + bottomLeft * hs;
+	y = y + bottomLeft * hs;
+	y = y + topRight * hs;
+	y = y + bottomRight * hs;
+	y = y / 6.0f;
+
+	int r = 0;
+	int g = 0;
+	int b = 0;
+	if (y < 200.0f)
+	{
+		b = (int)(200.0f - y);
+		r = 200 - b;
+	}
+	else if (y <= 400.0f)
+	{
+		r = (int)(400.0f - y);
+	}
+	if (y >= 650.0f && y < 900.0f)
+	{
+		g = (int)(y - 650.0f);
+	}
+
+	if (parameters.SlopeEnabled)
+	{
+		float gx = ((topRight - topLeft) + (bottomRight - bottomLeft)) * parameters.GradientScale;
+		float gz = ((bottomLeft - topLeft) + (bottomRight - topRight)) * parameters.GradientScale;
+		float slope = sqrtf(gx * gx + gz * gz);
+		float weight = fminf(fmaxf((slope - parameters.SlopeStart) * parameters.SlopeFactor, 0.0f), 1.0f);
+		int stone = (int)(weight * 255.0f + 0.5f);
+		g = g > stone ? g : stone;
+		b = ScaleByte(b, 255 - stone);
+	}
+	return (DWORD)((b << 16) | (g << 8) | r);
+}
+
+static void CalculateTexelsScalar(const float * row, const float * nextRow, unsigned int firstColumn, unsigned int endColumn,
+								  const BlendMapParameters& parameters, DWORD * texels)
+{
+	for (unsigned int x = firstColumn; x < endColumn; x++)
+	{
+		texels[x - firstColumn] = CalculateTexel(row[x], row[x + 1], nextRow[x], nextRow[x + 1], parameters);
+	}
+}
+
+#if defined(__AVX2__)
+
+// Returns the first column that still needs to be done
+static unsigned int CalculateTexels8(const float * row, const float * nextRow, unsigned int firstColumn, unsigned int endColumn,
+									 const BlendMapParameters& parameters, DWORD * texels)
+{
+	__m256 hs = _mm256_set1_ps(parameters.HeightScale);
+	__m256 gradientScale = _mm256_set1_ps(parameters.GradientScale);
+	__m256 slopeStart = _mm256_set1_ps(parameters.SlopeStart);
+	__m256 slopeFactor = _mm256_set1_ps(parameters.SlopeFactor);
+	unsigned int x = firstColumn;
+	for (; x + 8 <= endColumn; x += 8)
+	{
+		__m256 topLeft = _mm256_loadu_ps(row + x);
+		__m256 topRight = _mm256_loadu_ps(row + x + 1);
+		__m256 bottomLeft = _mm256_loadu_ps(nextRow + x);
+		__m256 bottomRight = _mm256_loadu_ps(nextRow + x + 1);
+		__m256 y = _mm256_mul_ps(topLeft, hs);
+		y = _mm256_add_ps(y, _mm256_mul_ps(topRight, hs));
+		y = _mm256_add_ps(y, _mm256_mul_ps(bottomLeft, hs));
+		y = _mm256_add_ps(y, _mm256_mul_ps(bottomLeft, hs));
+		y = _mm256_add_ps(y, _mm256_mul_ps(topRight, hs));
+		y = _mm256_add_ps(y, _mm256_mul_ps(bottomRight, hs));
+		y = _mm256_div_ps(y, _mm256_set1_ps(6.0f));
+
+		// Lanes outside a band can hold anything after the conversions, so they are masked off
+		__m256i low = _mm256_castps_si256(_mm256_cmp_ps(y, _mm256_set1_ps(200.0f), _CMP_LT_OQ));
+		__m256i middle = _mm256_andnot_si256(low, _mm256_castps_si256(_mm256_cmp_ps(y, _mm256_set1_ps(400.0f), _CMP_LE_OQ)));
+		__m256i high = _mm256_castps_si256(_mm256_and_ps(_mm256_cmp_ps(y, _mm256_set1_ps(650.0f), _CMP_GE_OQ), _mm256_cmp_ps(y, _mm256_set1_ps(900.0f), _CMP_LT_OQ)));
+		__m256i b = _mm256_and_si256(low, _mm256_cvttps_epi32(_mm256_sub_ps(_mm256_set1_ps(200.0f), y)));
+		__m256i r = _mm256_or_si256(_mm256_and_si256(low, _mm256_sub_epi32(_mm256_set1_epi32(200), b)),
+									_mm256_and_si256(middle, _mm256_cvttps_epi32(_mm256_sub_ps(_mm256_set1_ps(400.0f), y))));
+		__m256i g = _mm256_and_si256(high, _mm256_cvttps_epi32(_mm256_sub_ps(y, _mm256_set1_ps(650.0f))));
+
+		if (parameters.SlopeEnabled)
+		{
+			__m256 gx = _mm256_mul_ps(_mm256_add_ps(_mm256_sub_ps(topRight, topLeft), _mm256_sub_ps(bottomRight, bottomLeft)), gradientScale);
+			__m256 gz = _mm256_mul_ps(_mm256_add_ps(_mm256_sub_ps(bottomLeft, topLeft), _mm256_sub_ps(bottomRight, topRight)), gradientScale);
+			__m256 slope = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(gx, gx), _mm256_mul_ps(gz, gz)));
+			__m256 weight = _mm256_mul_ps(_mm256_sub_ps(slope, slopeStart), slopeFactor);
+			weight = _mm256_min_ps(_mm256_max_ps(weight, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+			__m256i stone = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(weight, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f)));
+			g = _mm256_max_epi32(g, stone);
+			__m256i product = _mm256_add_epi32(_mm256_mullo_epi32(b, _mm256_sub_epi32(_mm256_set1_epi32(255), stone)), _mm256_set1_epi32(128));
+			b = _mm256_srli_epi32(_mm256_add_epi32(product, _mm256_srli_epi32(product, 8)), 8);
+		}
+		__m256i texel = _mm256_or_si256(_mm256_or_si256(r, _mm256_slli_epi32(g, 8)), _mm256_slli_epi32(b, 16));
+		_mm256_storeu_si256((__m256i *)(texels + x - firstColumn), texel);
+	}
+	return x;
+}
+
+#endif
+
+void CalculateBlendMapTexels(const float * heightValues, unsigned int numberOfXPoints, float worldHeight, float spacing, const TerrainSlopeBlend& slopeBlend,
+							 unsigned int firstColumn, unsigned int endColumn, unsigned int firstRow, unsigned int endRow, DWORD * texels, size_t rowPitch)
+{
+	BlendMapParameters parameters = GetParameters(worldHeight, spacing, slopeBlend);
+	for (unsigned int z = firstRow; z < endRow; z++)
+	{
+		const float * row = heightValues + (size_t)z * numberOfXPoints;
+		const float * nextRow = row + numberOfXPoints;
+		DWORD * rowTexels = texels + (z - firstRow) * rowPitch;
+		unsigned int x = firstColumn;
+#if defined(__AVX2__)
+		x = CalculateTexels8(row, nextRow, firstColumn, endColumn, parameters, rowTexels);
+#endif
+		// Anything left over (or everything without AVX2) one cell at a time
+		CalculateTexelsScalar(row, nextRow, x, endColumn, parameters, rowTexels + x - firstColumn);
+	}
+}
+
+void CalculateBlendMapTexelsScalar(const float * heightValues, unsigned int numberOfXPoints, float worldHeight, float spacing, const TerrainSlopeBlend& slopeBlend,
+								   unsigned int firstColumn, unsigned int endColumn, unsigned int firstRow, unsigned int endRow, DWORD * texels, size_t rowPitch)
+{
+	BlendMapParameters parameters = GetParameters(worldHeight, spacing, slopeBlend);
+	for (unsigned int z = firstRow; z < endRow; z++)
+	{
+		const float * row = heightValues + (size_t)z * numberOfXPoints;
+		CalculateTexelsScalar(row, row + numberOfXPoints, firstColumn, endColumn, parameters, texels + (z - firstRow) * rowPitch);
+	}
+}
+
+unsigned int CalculateMipLevelCount(unsigned int width, unsigned int height)
+{
+	unsigned int levels = 1;
+	while (width > 1 || height > 1)
+	{
+		width = GetMipSize(width, 1);
+		height = GetMipSize(height, 1);
+		levels++;
+	}
+	return levels;
+}
+
+void DownsampleTexels(const DWORD * source, unsigned int sourceWidth, unsigned int sourceHeight, DWORD * destination,
+					  unsigned int firstX, unsigned int firstY, unsigned int endX, unsigned int endY)
+{
+	unsigned int destinationWidth = GetMipSize(sourceWidth, 1);
+	__m128i zero = _mm_setzero_si128();
+	__m128i two = _mm_set1_epi16(2);
+	for (unsigned int y = firstY; y < endY; y++)
+	{
+		// A source that is only one texel high or wide is used twice
+		const BYTE * rowA = (const BYTE *)(source + (size_t)(2 * y) * sourceWidth);
+		const BYTE * rowB = (const BYTE *)(source + (size_t)(2 * y + 1 < sourceHeight ? 2 * y + 1 : 2 * y) * sourceWidth);
+		BYTE * destinationRow = (BYTE *)(destination + (size_t)y * destinationWidth);
+		unsigned int x = firstX;
+		if (sourceWidth > 1)
+		{
+			// Two destination texels from four source texels in each row
+			for (; x + 2 <= endX; x += 2)
+			{
+				__m128i a = _mm_loadu_si128((const __m128i *)(rowA + 8 * x));
+				__m128i b = _mm_loadu_si128((const __m128i *)(rowB + 8 * x));
+				__m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+				__m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+				__m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+				sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+				_mm_storel_epi64((__m128i *)(destinationRow + 4 * x), _mm_packus_epi16(sum, sum));
+			}
+		}
+		for (; x < endX; x++)
+		{
+			unsigned int left = 2 * x;
+			unsigned int right = 2 * x + 1 < sourceWidth ? 2 * x + 1 : 2 * x;
+			for (unsigned int channel = 0; channel < 4; channel++)
+			{
+				unsigned int sum = rowA[4 * left + channel] + rowA[4 * right + channel] + rowB[4 * left + channel] + rowB[4 * right + channel];
+				destinationRow[4 * x + channel] = (BYTE)((sum + 2) >> 2);
+			}
+		}
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "DirectXCore.h"
+
+// How steep the terrain has to be for the stone layer to show through.  Slopes are measured as the
+// rise over the run across a cell.  Below Start the layers only depend on height, from End onwards
+// the stone layer is fully on.  Slope blending is off if End is not greater than Start.
+struct TerrainSlopeBlend
+{
+	float	Start;
+	float	End;
+};
+
+// Calculates the blend map texels of cells [firstColumn, endColumn) x [firstRow, endRow) straight from the
+// height grid.  Cell x, z has the samples x, z to x + 1, z + 1 of the grid at its corners.  The texel for
+// the cell is written to texels[(z - firstRow) * rowPitch + x - firstColumn].
+//
+// The layers are chosen from the average height of the corners of the cell's two triangles: light and
+// dark dirt low down, stone high up.  The stone layer is then brought in where the cell is steep, fading
+// out the light dirt layer that would be drawn over it.
+//
+// Cells are processed eight at a time using AVX2 when it is enabled at compile time.
+void CalculateBlendMapTexels(const float * heightValues, unsigned int numberOfXPoints, float worldHeight, float spacing, const TerrainSlopeBlend& slopeBlend,
+							 unsigned int firstColumn, unsigned int endColumn, unsigned int firstRow, unsigned int endRow, DWORD * texels, size_t rowPitch);
+
+// Scalar version of CalculateBlendMapTexels.  Produces exactly the same results.
+void CalculateBlendMapTexelsScalar(const float * heightValues, unsigned int numberOfXPoints, float worldHeight, float spacing, const TerrainSlopeBlend& slopeBlend,
+								   unsigned int firstColumn, unsigned int endColumn, unsigned int firstRow, unsigned int endRow, DWORD * texels, size_t rowPitch);
+
+// The number of levels in a full mip chain for a texture of the given size
+unsigned int CalculateMipLevelCount(unsigned int width, unsigned int height);
+
+inline unsigned int GetMipSize(unsigned int size, unsigned int level)
+{
+	size >>= level;
+	return size > 0 ? size : 1;
+}
+
+// Calculates texels [firstX, endX) x [firstY, endY) of the next mip level down from source, each one the
+// average of the 2 x 2 texels above it.  Texel x, y is written to destination[y * destinationWidth + x],
+// where destinationWidth is GetMipSize(sourceWidth, 1).  Uses SSE2 for pairs of texels.
+void DownsampleTexels(const DWORD * source, unsigned int sourceWidth, unsigned int sourceHeight, DWORD * destination,
+					  unsigned int firstX, unsigned int firstY, unsigned int endX, unsigned int endY);
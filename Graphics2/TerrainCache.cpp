@@ -0,0 +1,181 @@
+#include "TerrainCache.h"
+#include <algorithm>
+
+const UINT32 TerrainCacheMagic = 0x4e435254;		// "TRCN"
+const UINT32 TerrainCacheVersion = 3;
+const size_t TerrainCacheAlignment = 16;
+
+struct TerrainCacheHeader
+{
+	UINT32		Magic;
+	UINT32		Version;
+	UINT64		Key;
+	UINT32		SectionCount;
+	UINT32		Padding;
+};
+
+struct TerrainCacheSectionEntry
+{
+	UINT32		Section;
+	UINT32		Padding;
+	UINT64		Offset;
+	UINT64		Size;
+};
+
+static size_t AlignCacheOffset(size_t offset)
+{
+	return (offset + TerrainCacheAlignment - 1) & ~(TerrainCacheAlignment - 1);
+}
+
+TerrainCache::TerrainCache()
+{
+}
+
+TerrainCache::~TerrainCache()
+{
+}
+
+bool TerrainCache::Open(const wstring& filename, UINT64 key)
+{
+	if (!_file.Open(filename))
+	{
+		return false;
+	}
+	const TerrainCacheHeader * header = (const TerrainCacheHeader *)_file.GetData();
+	size_t tableEnd = sizeof(TerrainCacheHeader);
+	if (_file.GetSize() < tableEnd ||
+		header->Magic != TerrainCacheMagic ||
+		header->Version != TerrainCacheVersion ||
+		header->Key != key)
+	{
+		Close();
+		return false;
+	}
+
+	// Make sure every section lies inside the file
+	tableEnd += header->SectionCount * sizeof(TerrainCacheSectionEntry);
+	if (_file.GetSize() < tableEnd)
+	{
+		Close();
+		return false;
+	}
+	const TerrainCacheSectionEntry * entries = (const TerrainCacheSectionEntry *)(header + 1);
+	for (UINT32 i = 0; i < header->SectionCount; i++)
+	{
+		if (entries[i].Offset < tableEnd || entries[i].Offset > _file.GetSize() || entries[i].Size > _file.GetSize() - entries[i].Offset)
+		{
+			Close();
+			return false;
+		}
+	}
+	return true;
+}
+
+void TerrainCache::Close()
+{
+	_file.Close();
+}
+
+const BYTE * TerrainCache::GetSection(TerrainCacheSection section, size_t& size)
+{
+	size = 0;
+	if (!_file.IsOpen())
+	{
+		return nullptr;
+	}
+	const TerrainCacheHeader * header = (const TerrainCacheHeader *)_file.GetData();
+	const TerrainCacheSectionEntry * entries = (const TerrainCacheSectionEntry *)(header + 1);
+	for (UINT32 i = 0; i < header->SectionCount; i++)
+	{
+		if (entries[i].Section == (UINT32)section)
+		{
+			size = (size_t)entries[i].Size;
+			return _file.GetData() + entries[i].Offset;
+		}
+	}
+	return nullptr;
+}
+
+void TerrainCache::AddSection(TerrainCacheSection section, const void * data, size_t size)
+{
+	SectionData sectionData;
+	sectionData.Section = section;
+	sectionData.Data = data;
+	sectionData.Size = size;
+	_sectionsToWrite.push_back(sectionData);
+}
+
+bool TerrainCache::Write(const wstring& filename, UINT64 key)
+{
+	TerrainCacheHeader header;
+	header.Magic = TerrainCacheMagic;
+	header.Version = TerrainCacheVersion;
+	header.Key = key;
+	header.SectionCount = (UINT32)_sectionsToWrite.size();
+	header.Padding = 0;
+
+	vector<TerrainCacheSectionEntry> entries(_sectionsToWrite.size());
+	size_t offset = sizeof(TerrainCacheHeader) + entries.size() * sizeof(TerrainCacheSectionEntry);
+	for (size_t i = 0; i < _sectionsToWrite.size(); i++)
+	{
+		offset = AlignCacheOffset(offset);
+		entries[i].Section = (UINT32)_sectionsToWrite[i].Section;
+		entries[i].Padding = 0;
+		entries[i].Offset = offset;
+		entries[i].Size = _sectionsToWrite[i].Size;
+		offset += _sectionsToWrite[i].Size;
+	}
+
+	wstring temporaryFilename = filename + L".tmp";
+	HANDLE file = CreateFileW(temporaryFilename.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	// Writes in pieces of no more than 1GB, as WriteFile takes a DWORD size
+	size_t written = 0;
+	auto writeData = [&](const void * data, size_t size) -> bool
+	{
+		const BYTE * bytes = (const BYTE *)data;
+		while (size > 0)
+		{
+			DWORD piece = (DWORD)min(size, (size_t)1 << 30);
+			DWORD pieceWritten = 0;
+			if (!WriteFile(file, bytes, piece, &pieceWritten, nullptr) || pieceWritten != piece)
+			{
+				return false;
+			}
+			bytes += piece;
+			size -= piece;
+			written += piece;
+		}
+		return true;
+	};
+	const BYTE padding[TerrainCacheAlignment] = {};
+	bool succeeded = writeData(&header, sizeof(header)) && writeData(entries.data(), entries.size() * sizeof(TerrainCacheSectionEntry));
+	for (size_t i = 0; succeeded && i < _sectionsToWrite.size(); i++)
+	{
+		succeeded = writeData(padding, (size_t)entries[i].Offset - written) && writeData(_sectionsToWrite[i].Data, _sectionsToWrite[i].Size);
+	}
+	CloseHandle(file);
+	_sectionsToWrite.clear();
+
+	if (!succeeded || !MoveFileExW(temporaryFilename.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		DeleteFileW(temporaryFilename.c_str());
+		return false;
+	}
+	return true;
+}
+
+UINT64 TerrainCache::Hash(const void * data, size_t size, UINT64 hash)
+{
+	const UINT64 prime = 1099511628211ULL;
+	const BYTE * bytes = (const BYTE *)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * prime;
+	}
+	return hash;
+}
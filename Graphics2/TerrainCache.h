@@ -0,0 +1,58 @@
+#pragma once
+#include "MappedFile.h"
+#include <vector>
+
+// Sections that can be stored in a terrain cache file
+enum class TerrainCacheSection : UINT32
+{
+	Vertices,
+	Indices,
+	BlendMap,
+	HeightPyramid,
+	Chunks
+};
+
+// Binary file holding the results of generating a terrain, so that later runs can map them
+// straight from disk instead of generating them again.
+//
+// The file starts with a header containing a version number and a key (see CalculateKey).  If
+// either doesn't match when the file is opened, the file is treated as missing and the terrain
+// is generated again.  Increase TerrainCacheVersion whenever the layout of any section changes.
+//
+// Each section is stored 16 byte aligned and handed out as a pointer into the mapped file.
+class TerrainCache
+{
+public:
+	TerrainCache();
+	~TerrainCache();
+
+	// Returns false if the file doesn't exist, is for a different version or key, or is damaged
+	bool Open(const wstring& filename, UINT64 key);
+	void Close();
+
+	inline bool IsOpen() { return _file.IsOpen(); }
+
+	// Returns nullptr if the section is not in the file
+	const BYTE * GetSection(TerrainCacheSection section, size_t& size);
+
+	// Sections to be written by Write
+	void AddSection(TerrainCacheSection section, const void * data, size_t size);
+
+	// Writes the added sections to a temporary file and then replaces filename with it, so a
+	// partly written cache is never left behind.
+	bool Write(const wstring& filename, UINT64 key);
+
+	// Hashes data (64-bit FNV-1a).  A previous hash can be passed in to combine several values.
+	static UINT64 Hash(const void * data, size_t size, UINT64 hash = 14695981039346656037ULL);
+
+private:
+	struct SectionData
+	{
+		TerrainCacheSection		Section;
+		const void *			Data;
+		size_t					Size;
+	};
+
+	MappedFile					_file;
+	vector<SectionData>			_sectionsToWrite;
+};
@@ -0,0 +1,687 @@
+#include "TerrainCollision.h"
+#include <cmath>
+#include <cfloat>
+
+// Closest a point can be to a triangle and still be treated as touching it
+const float TouchingDistance = 1e-4f;
+
+static inline float Dot(FXMVECTOR a, FXMVECTOR b)
+{
+	return XMVectorGetX(XMVector3Dot(a, b));
+}
+
+static inline float Clamp01(float value)
+{
+	return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+}
+
+// Ericson, Real-Time Collision Detection, 5.1.5.  The triangle is divided into the regions where the
+// closest point is a corner, a point on an edge or a point inside it.
+static XMVECTOR ClosestPointOnTriangle(FXMVECTOR point, FXMVECTOR a, FXMVECTOR b, GXMVECTOR c)
+{
+	XMVECTOR ab = XMVectorSubtract(b, a);
+	XMVECTOR ac = XMVectorSubtract(c, a);
+	XMVECTOR ap = XMVectorSubtract(point, a);
+	float d1 = Dot(ab, ap);
+	float d2 = Dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f)
+	{
+		return a;
+	}
+	XMVECTOR bp = XMVectorSubtract(point, b);
+	float d3 = Dot(ab, bp);
+	float d4 = Dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3)
+	{
+		return b;
+	}
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+	{
+		return XMVectorAdd(a, XMVectorScale(ab, d1 / (d1 - d3)));
+	}
+	XMVECTOR cp = XMVectorSubtract(point, c);
+	float d5 = Dot(ab, cp);
+	float d6 = Dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6)
+	{
+		return c;
+	}
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+	{
+		return XMVectorAdd(a, XMVectorScale(ac, d2 / (d2 - d6)));
+	}
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+	{
+		return XMVectorAdd(b, XMVectorScale(XMVectorSubtract(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+	}
+	float denominator = 1.0f / (va + vb + vc);
+	return XMVectorAdd(a, XMVectorAdd(XMVectorScale(ab, vb * denominator), XMVectorScale(ac, vc * denominator)));
+}
+
+// Ericson, Real-Time Collision Detection, 5.1.9.  Returns the squared distance between the segments.
+static float ClosestPointsOnSegments(FXMVECTOR start1, FXMVECTOR end1, FXMVECTOR start2, GXMVECTOR end2, XMVECTOR& closest1, XMVECTOR& closest2)
+{
+	const float epsilon = 1e-12f;
+	XMVECTOR direction1 = XMVectorSubtract(end1, start1);
+	XMVECTOR direction2 = XMVectorSubtract(end2, start2);
+	XMVECTOR offset = XMVectorSubtract(start1, start2);
+	float a = Dot(direction1, direction1);
+	float e = Dot(direction2, direction2);
+	float f = Dot(direction2, offset);
+	float s = 0.0f;
+	float t = 0.0f;
+	if (a <= epsilon && e > epsilon)
+	{
+		t = Clamp01(f / e);
+	}
+	else if (a > epsilon)
+	{
+		float c = Dot(direction1, offset);
+		if (e <= epsilon)
+		{
+			s = Clamp01(-c / a);
+		}
+		else
+		{
+			float b = Dot(direction1, direction2);
+			float denominator = a * e - b * b;
+			s = denominator != 0.0f ? Clamp01((b * f - c * e) / denominator) : 0.0f;
+			t = (b * s + f) / e;
+			if (t < 0.0f)
+			{
+				t = 0.0f;
+				s = Clamp01(-c / a);
+			}
+			else if (t > 1.0f)
+			{
+				t = 1.0f;
+				s = Clamp01((b - c) / a);
+			}
+		}
+	}
+	closest1 = XMVectorAdd(start1, XMVectorScale(direction1, s));
+	closest2 = XMVectorAdd(start2, XMVectorScale(direction2, t));
+	return XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(closest1, closest2)));
+}
+
+// Moller-Trumbore, with the segment from start to end as the ray
+static bool IntersectSegmentWithTriangle(FXMVECTOR start, FXMVECTOR end, FXMVECTOR v0, GXMVECTOR v1, HXMVECTOR v2, XMVECTOR& point)
+{
+	const float epsilon = 1e-9f;
+	XMVECTOR direction = XMVectorSubtract(end, start);
+	XMVECTOR edge1 = XMVectorSubtract(v1, v0);
+	XMVECTOR edge2 = XMVectorSubtract(v2, v0);
+	XMVECTOR p = XMVector3Cross(direction, edge2);
+	float determinant = Dot(edge1, p);
+	if (fabsf(determinant) < epsilon)
+	{
+		return false;
+	}
+	float inverseDeterminant = 1.0f / determinant;
+	XMVECTOR t = XMVectorSubtract(start, v0);
+	float u = Dot(t, p) * inverseDeterminant;
+	if (u < 0.0f || u > 1.0f)
+	{
+		return false;
+	}
+	XMVECTOR q = XMVector3Cross(t, edge1);
+	float v = Dot(direction, q) * inverseDeterminant;
+	if (v < 0.0f || u + v > 1.0f)
+	{
+		return false;
+	}
+	float fraction = Dot(edge2, q) * inverseDeterminant;
+	if (fraction < 0.0f || fraction > 1.0f)
+	{
+		return false;
+	}
+	point = XMVectorAdd(start, XMVectorScale(direction, fraction));
+	return true;
+}
+
+// The segment and triangle are closest either where they cross, or at a point involving an end of
+// the segment or an edge of the triangle.  Returns the squared distance between them.
+static float ClosestPointsOnSegmentAndTriangle(FXMVECTOR start, FXMVECTOR end, FXMVECTOR a, GXMVECTOR b, HXMVECTOR c,
+											   XMVECTOR& segmentPoint, XMVECTOR& trianglePoint)
+{
+	if (IntersectSegmentWithTriangle(start, end, a, b, c, segmentPoint))
+	{
+		trianglePoint = segmentPoint;
+		return 0.0f;
+	}
+	segmentPoint = start;
+	trianglePoint = ClosestPointOnTriangle(start, a, b, c);
+	float best = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(segmentPoint, trianglePoint)));
+	XMVECTOR closest = ClosestPointOnTriangle(end, a, b, c);
+	float distance = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(end, closest)));
+	if (distance < best)
+	{
+		best = distance;
+		segmentPoint = end;
+		trianglePoint = closest;
+	}
+	const XMVECTOR edges[3][2] = { { a, b }, { b, c }, { c, a } };
+	for (int i = 0; i < 3; i++)
+	{
+		XMVECTOR closestOnSegment;
+		XMVECTOR closestOnEdge;
+		distance = ClosestPointsOnSegments(start, end, edges[i][0], edges[i][1], closestOnSegment, closestOnEdge);
+		if (distance < best)
+		{
+			best = distance;
+			segmentPoint = closestOnSegment;
+			trianglePoint = closestOnEdge;
+		}
+	}
+	return best;
+}
+
+static inline bool IsInsideTriangle(FXMVECTOR point, FXMVECTOR a, FXMVECTOR b, GXMVECTOR c, HXMVECTOR normal)
+{
+	return Dot(XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(point, a)), normal) >= 0.0f &&
+		   Dot(XMVector3Cross(XMVectorSubtract(c, b), XMVectorSubtract(point, b)), normal) >= 0.0f &&
+		   Dot(XMVector3Cross(XMVectorSubtract(a, c), XMVectorSubtract(point, c)), normal) >= 0.0f;
+}
+
+// Sets the contact for the centre of a sphere touching point at time
+static inline void SetSweepContact(FXMVECTOR centre, FXMVECTOR point, float time, TerrainContact& contact)
+{
+	XMVECTOR offset = XMVectorSubtract(centre, point);
+	float length = XMVectorGetX(XMVector3Length(offset));
+	contact.Hit = true;
+	contact.Time = time;
+	contact.Depth = 0.0f;
+	XMStoreFloat3(&contact.Position, point);
+	XMStoreFloat3(&contact.Normal, length > TouchingDistance ? XMVectorScale(offset, 1.0f / length) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+}
+
+// Finds when a sphere moving from start by movement first comes within radius of a point.  Returns
+// false if it never does before maximumTime, or is already within it and moving away.
+static bool SweepSphereAgainstPoint(FXMVECTOR start, FXMVECTOR movement, float radius, FXMVECTOR point, float maximumTime, float& time)
+{
+	XMVECTOR offset = XMVectorSubtract(start, point);
+	float b = Dot(offset, movement);
+	float c = Dot(offset, offset) - radius * radius;
+	if (b >= 0.0f)
+	{
+		return false;
+	}
+	if (c <= 0.0f)
+	{
+		time = 0.0f;
+		return true;
+	}
+	float a = Dot(movement, movement);
+	float discriminant = b * b - a * c;
+	if (discriminant < 0.0f)
+	{
+		return false;
+	}
+	time = (-b - sqrtf(discriminant)) / a;
+	return time <= maximumTime;
+}
+
+// As SweepSphereAgainstPoint, but for the points on the edge from edgeStart to edgeEnd.  Only the
+// inside of the edge is tested.  Its ends are tested as points.
+static bool SweepSphereAgainstEdge(FXMVECTOR start, FXMVECTOR movement, float radius, FXMVECTOR edgeStart, GXMVECTOR edgeEnd, float maximumTime,
+								   float& time, XMVECTOR& edgePoint)
+{
+	// Solve for the time at which the distance from the centre to the line through the edge is the
+	// radius, with every term scaled by the squared length of the edge to avoid dividing by it
+	XMVECTOR edge = XMVectorSubtract(edgeEnd, edgeStart);
+	XMVECTOR offset = XMVectorSubtract(start, edgeStart);
+	float edgeLengthSquared = Dot(edge, edge);
+	float offsetAlongEdge = Dot(offset, edge);
+	float movementAlongEdge = Dot(movement, edge);
+	float movementLengthSquared = Dot(movement, movement);
+	float a = edgeLengthSquared * movementLengthSquared - movementAlongEdge * movementAlongEdge;
+	float b = edgeLengthSquared * Dot(offset, movement) - movementAlongEdge * offsetAlongEdge;
+	float c = edgeLengthSquared * (Dot(offset, offset) - radius * radius) - offsetAlongEdge * offsetAlongEdge;
+	if (a <= 1e-6f * edgeLengthSquared * movementLengthSquared || b >= 0.0f)
+	{
+		// Moving along the edge, or away from it
+		return false;
+	}
+	if (c <= 0.0f)
+	{
+		time = 0.0f;
+	}
+	else
+	{
+		float discriminant = b * b - a * c;
+		if (discriminant < 0.0f)
+		{
+			return false;
+		}
+		time = (-b - sqrtf(discriminant)) / a;
+		if (time > maximumTime)
+		{
+			return false;
+		}
+	}
+	float fraction = (offsetAlongEdge + time * movementAlongEdge) / edgeLengthSquared;
+	if (fraction < 0.0f || fraction > 1.0f)
+	{
+		return false;
+	}
+	edgePoint = XMVectorAdd(edgeStart, XMVectorScale(edge, fraction));
+	return true;
+}
+
+TerrainCollider::TerrainCollider()
+{
+	_heights = nullptr;
+	_heightPyramid = nullptr;
+	_numberOfXPoints = 0;
+	_numberOfZPoints = 0;
+}
+
+TerrainCollider::~TerrainCollider()
+{
+}
+
+void TerrainCollider::Initialise(const USHORT * heights, const TerrainHeightPyramid * heightPyramid, unsigned int numberOfXPoints, unsigned int numberOfZPoints,
+								 float spacing, float worldHeight, float originX, float originZ)
+{
+	_heights = heights;
+	_heightPyramid = heightPyramid;
+	_numberOfXPoints = numberOfXPoints;
+	_numberOfZPoints = numberOfZPoints;
+	_spacing = spacing;
+	_worldHeight = worldHeight;
+	_originX = originX;
+	_originZ = originZ;
+}
+
+// Finds the cells under the rectangle [minimumX, maximumX] x [minimumZ, maximumZ].  Returns false if
+// there aren't any.
+bool TerrainCollider::GetCellRange(float minimumX, float minimumZ, float maximumX, float maximumZ, CellRange& range) const
+{
+	if (_heightPyramid == nullptr || _heightPyramid->GetLevelCount() == 0)
+	{
+		return false;
+	}
+	float numberOfColumns = (float)(_numberOfXPoints - 1);
+	float numberOfRows = (float)(_numberOfZPoints - 1);
+	float firstX = (minimumX - _originX) / _spacing;
+	float endX = (maximumX - _originX) / _spacing;
+	float firstZ = (_originZ - maximumZ) / _spacing;
+	float endZ = (_originZ - minimumZ) / _spacing;
+	if (endX < 0.0f || firstX > numberOfColumns || endZ < 0.0f || firstZ > numberOfRows)
+	{
+		return false;
+	}
+	range.FirstX = firstX > 0.0f ? (unsigned int)firstX : 0;
+	range.FirstZ = firstZ > 0.0f ? (unsigned int)firstZ : 0;
+	range.EndX = (unsigned int)(endX < numberOfColumns ? endX : numberOfColumns) + 1;
+	range.EndZ = (unsigned int)(endZ < numberOfRows ? endZ : numberOfRows) + 1;
+	range.FirstX = range.FirstX < _numberOfXPoints - 2 ? range.FirstX : _numberOfXPoints - 2;
+	range.FirstZ = range.FirstZ < _numberOfZPoints - 2 ? range.FirstZ : _numberOfZPoints - 2;
+	range.EndX = range.EndX < _numberOfXPoints - 1 ? range.EndX : _numberOfXPoints - 1;
+	range.EndZ = range.EndZ < _numberOfZPoints - 1 ? range.EndZ : _numberOfZPoints - 1;
+	return true;
+}
+
+// Returns true if every cell in the range is lower than minimumY.  Small ranges are left to be checked
+// cell by cell with IsCellBelow, as that is quicker than looking them up in the pyramid.
+bool TerrainCollider::IsRangeBelow(const CellRange& range, float minimumY) const
+{
+	return (range.EndX - range.FirstX) * (range.EndZ - range.FirstZ) > 16 &&
+		   _heightPyramid->GetHeightRange(range.FirstX, range.FirstZ, range.EndX, range.EndZ).Maximum * _worldHeight < minimumY;
+}
+
+// Gets the top left, top right, bottom left and bottom right corners of a cell
+void TerrainCollider::GetCellCorners(unsigned int cellX, unsigned int cellZ, XMVECTOR corners[4]) const
+{
+	size_t topLeftIndex = (size_t)cellZ * _numberOfXPoints + cellX;
+	float heightScale = _worldHeight / 65536;
+	float left = _originX + cellX * _spacing;
+	float top = _originZ - cellZ * _spacing;
+	corners[0] = XMVectorSet(left, _heights[topLeftIndex] * heightScale, top, 0.0f);
+	corners[1] = XMVectorSet(left + _spacing, _heights[topLeftIndex + 1] * heightScale, top, 0.0f);
+	corners[2] = XMVectorSet(left, _heights[topLeftIndex + _numberOfXPoints] * heightScale, top - _spacing, 0.0f);
+	corners[3] = XMVectorSet(left + _spacing, _heights[topLeftIndex + _numberOfXPoints + 1] * heightScale, top - _spacing, 0.0f);
+}
+
+// Gets the height and normal of the surface at (x, z) in the same way as TerrainNode::GetHeightInCell.
+// Returns false if the point is outside the grid.
+bool TerrainCollider::GetSurface(float x, float z, float& height, XMVECTOR& normal) const
+{
+	float gridX = (x - _originX) / _spacing;
+	float gridZ = (_originZ - z) / _spacing;
+	unsigned int numberOfColumns = _numberOfXPoints - 1;
+	unsigned int numberOfRows = _numberOfZPoints - 1;
+	if (_heights == nullptr || gridX < 0.0f || gridZ < 0.0f || gridX > (float)numberOfColumns || gridZ > (float)numberOfRows)
+	{
+		return false;
+	}
+	unsigned int cellX = (unsigned int)gridX < numberOfColumns - 1 ? (unsigned int)gridX : numberOfColumns - 1;
+	unsigned int cellZ = (unsigned int)gridZ < numberOfRows - 1 ? (unsigned int)gridZ : numberOfRows - 1;
+	float u = gridX - cellX;
+	float v = gridZ - cellZ;
+	XMVECTOR corners[4];
+	GetCellCorners(cellX, cellZ, corners);
+	float topLeft = XMVectorGetY(corners[0]);
+	float topRight = XMVectorGetY(corners[1]);
+	float bottomLeft = XMVectorGetY(corners[2]);
+	float bottomRight = XMVectorGetY(corners[3]);
+	float slopeX;
+	float slopeZ;
+	if (u + v <= 1.0f)
+	{
+		height = topLeft + u * (topRight - topLeft) + v * (bottomLeft - topLeft);
+		slopeX = topRight - topLeft;
+		slopeZ = topLeft - bottomLeft;
+	}
+	else
+	{
+		height = bottomRight + (1.0f - u) * (bottomLeft - bottomRight) + (1.0f - v) * (topRight - bottomRight);
+		slopeX = bottomRight - bottomLeft;
+		slopeZ = topRight - bottomRight;
+	}
+	normal = XMVector3Normalize(XMVectorSet(-slopeX / _spacing, 1.0f, -slopeZ / _spacing, 0.0f));
+	return true;
+}
+
+// A point below the surface is pushed back up along the surface normal, out past the plane of the
+// surface there by radius
+bool TerrainCollider::GetPenetration(FXMVECTOR point, float radius, TerrainContact& contact) const
+{
+	float height;
+	XMVECTOR normal;
+	if (!GetSurface(XMVectorGetX(point), XMVectorGetZ(point), height, normal) || XMVectorGetY(point) >= height)
+	{
+		return false;
+	}
+	contact.Hit = true;
+	contact.Position = XMFLOAT3(XMVectorGetX(point), height, XMVectorGetZ(point));
+	XMStoreFloat3(&contact.Normal, normal);
+	contact.Depth = (height - XMVectorGetY(point)) * XMVectorGetY(normal) + radius;
+	contact.Time = 0.0f;
+	return true;
+}
+
+bool TerrainCollider::SphereOverlap(const XMFLOAT3& centre, float radius, TerrainContact& contact) const
+{
+	contact.Hit = false;
+	XMVECTOR sphereCentre = XMLoadFloat3(&centre);
+	if (GetPenetration(sphereCentre, radius, contact))
+	{
+		return true;
+	}
+	CellRange range;
+	float minimumY = centre.y - radius;
+	if (!GetCellRange(centre.x - radius, centre.z - radius, centre.x + radius, centre.z + radius, range) || IsRangeBelow(range, minimumY))
+	{
+		return false;
+	}
+
+	float best = radius * radius;
+	XMVECTOR bestPoint = XMVectorZero();
+	XMVECTOR bestNormal = XMVectorZero();
+	XMVECTOR corners[4];
+	for (unsigned int cellZ = range.FirstZ; cellZ < range.EndZ; cellZ++)
+	{
+		for (unsigned int cellX = range.FirstX; cellX < range.EndX; cellX++)
+		{
+			if (IsCellBelow(cellX, cellZ, minimumY))
+			{
+				continue;
+			}
+			GetCellCorners(cellX, cellZ, corners);
+
+			// Same triangles as the index buffer
+			const XMVECTOR triangles[2][3] = { { corners[0], corners[1], corners[2] }, { corners[2], corners[1], corners[3] } };
+			for (int i = 0; i < 2; i++)
+			{
+				XMVECTOR point = ClosestPointOnTriangle(sphereCentre, triangles[i][0], triangles[i][1], triangles[i][2]);
+				float distance = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(sphereCentre, point)));
+				if (distance < best)
+				{
+					best = distance;
+					bestPoint = point;
+					bestNormal = XMVector3Cross(XMVectorSubtract(triangles[i][1], triangles[i][0]), XMVectorSubtract(triangles[i][2], triangles[i][0]));
+					contact.Hit = true;
+				}
+			}
+		}
+	}
+	if (!contact.Hit)
+	{
+		return false;
+	}
+	float distance = sqrtf(best);
+	XMStoreFloat3(&contact.Position, bestPoint);
+	XMStoreFloat3(&contact.Normal, distance > TouchingDistance ? XMVectorScale(XMVectorSubtract(sphereCentre, bestPoint), 1.0f / distance) : XMVector3Normalize(bestNormal));
+	contact.Depth = radius - distance;
+	contact.Time = 0.0f;
+	return true;
+}
+
+bool TerrainCollider::CapsuleOverlap(const XMFLOAT3& start, const XMFLOAT3& end, float radius, TerrainContact& contact) const
+{
+	contact.Hit = false;
+	XMVECTOR segmentStart = XMLoadFloat3(&start);
+	XMVECTOR segmentEnd = XMLoadFloat3(&end);
+
+	// If both ends are below the surface, the deeper one decides how far the capsule has to move
+	TerrainContact endContact;
+	bool startBelow = GetPenetration(segmentStart, radius, contact);
+	bool endBelow = GetPenetration(segmentEnd, radius, endContact);
+	if (endBelow && (!startBelow || endContact.Depth > contact.Depth))
+	{
+		contact = endContact;
+	}
+	if (startBelow || endBelow)
+	{
+		return true;
+	}
+	CellRange range;
+	float minimumY = min(start.y, end.y) - radius;
+	if (!GetCellRange(min(start.x, end.x) - radius, min(start.z, end.z) - radius, max(start.x, end.x) + radius, max(start.z, end.z) + radius, range) ||
+		IsRangeBelow(range, minimumY))
+	{
+		return false;
+	}
+
+	float best = radius * radius;
+	XMVECTOR bestSegmentPoint = XMVectorZero();
+	XMVECTOR bestPoint = XMVectorZero();
+	XMVECTOR bestTriangle[3];
+	XMVECTOR corners[4];
+	for (unsigned int cellZ = range.FirstZ; cellZ < range.EndZ; cellZ++)
+	{
+		for (unsigned int cellX = range.FirstX; cellX < range.EndX; cellX++)
+		{
+			if (IsCellBelow(cellX, cellZ, minimumY))
+			{
+				continue;
+			}
+			GetCellCorners(cellX, cellZ, corners);
+			const XMVECTOR triangles[2][3] = { { corners[0], corners[1], corners[2] }, { corners[2], corners[1], corners[3] } };
+			for (int i = 0; i < 2; i++)
+			{
+				XMVECTOR segmentPoint;
+				XMVECTOR point;
+				float distance = ClosestPointsOnSegmentAndTriangle(segmentStart, segmentEnd, triangles[i][0], triangles[i][1], triangles[i][2], segmentPoint, point);
+				if (distance < best)
+				{
+					best = distance;
+					bestSegmentPoint = segmentPoint;
+					bestPoint = point;
+					bestTriangle[0] = triangles[i][0];
+					bestTriangle[1] = triangles[i][1];
+					bestTriangle[2] = triangles[i][2];
+					contact.Hit = true;
+				}
+			}
+		}
+	}
+	if (!contact.Hit)
+	{
+		return false;
+	}
+	float distance = sqrtf(best);
+	XMStoreFloat3(&contact.Position, bestPoint);
+	if (distance > TouchingDistance)
+	{
+		XMStoreFloat3(&contact.Normal, XMVectorScale(XMVectorSubtract(bestSegmentPoint, bestPoint), 1.0f / distance));
+		contact.Depth = radius - distance;
+	}
+	else
+	{
+		// The segment passes through the surface between its ends (over a ridge), so it has to be lifted
+		// clear of the plane of the triangle it crosses
+		XMVECTOR normal = XMVector3Normalize(XMVector3Cross(XMVectorSubtract(bestTriangle[1], bestTriangle[0]), XMVectorSubtract(bestTriangle[2], bestTriangle[0])));
+		float lowest = min(Dot(XMVectorSubtract(segmentStart, bestTriangle[0]), normal), Dot(XMVectorSubtract(segmentEnd, bestTriangle[0]), normal));
+		XMStoreFloat3(&contact.Normal, normal);
+		contact.Depth = radius - min(lowest, 0.0f);
+	}
+	contact.Time = 0.0f;
+	return true;
+}
+
+// Tests the faces, edges and corners of a cell against a moving sphere, replacing the contact if the
+// sphere touches any of them earlier
+void TerrainCollider::SweepSphereAgainstCell(FXMVECTOR start, FXMVECTOR movement, float radius, unsigned int cellX, unsigned int cellZ, TerrainContact& contact) const
+{
+	XMVECTOR corners[4];
+	GetCellCorners(cellX, cellZ, corners);
+	float best = contact.Hit ? contact.Time : 1.0f;
+	float time;
+
+	// A face is only hit from the front, by a sphere whose centre is over the triangle when it touches
+	const XMVECTOR triangles[2][3] = { { corners[0], corners[1], corners[2] }, { corners[2], corners[1], corners[3] } };
+	for (int i = 0; i < 2; i++)
+	{
+		XMVECTOR normal = XMVector3Normalize(XMVector3Cross(XMVectorSubtract(triangles[i][1], triangles[i][0]), XMVectorSubtract(triangles[i][2], triangles[i][0])));
+		float speed = Dot(movement, normal);
+		if (speed >= 0.0f)
+		{
+			continue;
+		}
+		float distance = Dot(XMVectorSubtract(start, triangles[i][0]), normal);
+		time = distance > radius ? (distance - radius) / -speed : 0.0f;
+		if (time > best)
+		{
+			continue;
+		}
+		XMVECTOR centre = XMVectorAdd(start, XMVectorScale(movement, time));
+		XMVECTOR point = XMVectorSubtract(centre, XMVectorScale(normal, distance + speed * time));
+		if (IsInsideTriangle(point, triangles[i][0], triangles[i][1], triangles[i][2], normal))
+		{
+			best = time;
+			contact.Hit = true;
+			contact.Time = time;
+			contact.Depth = 0.0f;
+			XMStoreFloat3(&contact.Position, point);
+			XMStoreFloat3(&contact.Normal, normal);
+		}
+	}
+
+	// The four edges around the cell and the diagonal between the triangles
+	const XMVECTOR edges[5][2] = { { corners[0], corners[1] }, { corners[0], corners[2] }, { corners[1], corners[2] }, { corners[1], corners[3] }, { corners[2], corners[3] } };
+	for (int i = 0; i < 5; i++)
+	{
+		XMVECTOR point;
+		if (SweepSphereAgainstEdge(start, movement, radius, edges[i][0], edges[i][1], best, time, point))
+		{
+			best = time;
+			SetSweepContact(XMVectorAdd(start, XMVectorScale(movement, time)), point, time, contact);
+		}
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		if (SweepSphereAgainstPoint(start, movement, radius, corners[i], best, time))
+		{
+			best = time;
+			SetSweepContact(XMVectorAdd(start, XMVectorScale(movement, time)), corners[i], time, contact);
+		}
+	}
+}
+
+bool TerrainCollider::SweepSphere(const XMFLOAT3& start, const XMFLOAT3& end, float radius, TerrainContact& contact) const
+{
+	contact.Hit = false;
+	XMFLOAT3 movement(end.x - start.x, end.y - start.y, end.z - start.z);
+	if (_heightPyramid == nullptr || _heightPyramid->GetLevelCount() == 0 || (movement.x == 0.0f && movement.y == 0.0f && movement.z == 0.0f))
+	{
+		return false;
+	}
+	XMFLOAT3 inverseMovement(movement.x != 0.0f ? 1.0f / movement.x : FLT_MAX,
+							 movement.y != 0.0f ? 1.0f / movement.y : FLT_MAX,
+							 movement.z != 0.0f ? 1.0f / movement.z : FLT_MAX);
+	XMVECTOR sweepStart = XMLoadFloat3(&start);
+	XMVECTOR sweepMovement = XMLoadFloat3(&movement);
+
+	// The same traversal as TerrainNode::RayCast, with the centre of the sphere as the ray and each box
+	// grown by the radius.  As the grown boxes overlap, the first hit found is not always the earliest,
+	// so the search carries on, skipping boxes the sphere only reaches after the earliest hit so far.
+	// Rather than starting from the top of the pyramid, it starts from the (at most 2 * 2) smallest
+	// entries that cover every cell the sphere can reach.
+	CellRange range;
+	if (!GetCellRange(min(start.x, end.x) - radius, min(start.z, end.z) - radius, max(start.x, end.x) + radius, max(start.z, end.z) + radius, range))
+	{
+		return false;
+	}
+	unsigned int level = 0;
+	unsigned int topLevel = _heightPyramid->GetLevelCount() - 1;
+	while (level < topLevel && (((range.EndX - 1) >> level) - (range.FirstX >> level) > 1 || ((range.EndZ - 1) >> level) - (range.FirstZ >> level) > 1))
+	{
+		level++;
+	}
+	unsigned int nearX = movement.x >= 0.0f ? 0 : 1;
+	unsigned int nearZ = movement.z <= 0.0f ? 0 : 1;
+	unsigned int numberOfColumns = _numberOfXPoints - 1;
+	unsigned int numberOfRows = _numberOfZPoints - 1;
+	RayCastNode stack[4 * 32];
+	unsigned int stackSize = 0;
+	for (int i = 3; i >= 0; i--)
+	{
+		unsigned int x = (range.FirstX >> level) + ((i & 1) ^ nearX);
+		unsigned int z = (range.FirstZ >> level) + ((i >> 1) ^ nearZ);
+		if (x <= (range.EndX - 1) >> level && z <= (range.EndZ - 1) >> level)
+		{
+			stack[stackSize++] = { level, x, z };
+		}
+	}
+	while (stackSize > 0)
+	{
+		RayCastNode node = stack[--stackSize];
+		const TerrainHeightRange& range = _heightPyramid->GetRange(node.Level, node.X, node.Z);
+		unsigned int firstCellX = node.X << node.Level;
+		unsigned int firstCellZ = node.Z << node.Level;
+		unsigned int endCellX = min((node.X + 1) << node.Level, numberOfColumns);
+		unsigned int endCellZ = min((node.Z + 1) << node.Level, numberOfRows);
+		XMFLOAT3 boxMin(_originX + firstCellX * _spacing - radius, range.Minimum * _worldHeight - radius, _originZ - endCellZ * _spacing - radius);
+		XMFLOAT3 boxMax(_originX + endCellX * _spacing + radius, range.Maximum * _worldHeight + radius, _originZ - firstCellZ * _spacing + radius);
+		float entry = 0.0f;
+		float exit = contact.Hit ? contact.Time : 1.0f;
+		if (!IntersectRayWithBox(start, inverseMovement, boxMin, boxMax, entry, exit))
+		{
+			continue;
+		}
+		if (node.Level == 0)
+		{
+			SweepSphereAgainstCell(sweepStart, sweepMovement, radius, node.X, node.Z, contact);
+			continue;
+		}
+
+		unsigned int childLevel = node.Level - 1;
+		unsigned int childWidth = _heightPyramid->GetLevelWidth(childLevel);
+		unsigned int childHeight = _heightPyramid->GetLevelHeight(childLevel);
+		for (int i = 3; i >= 0; i--)
+		{
+			unsigned int childX = node.X * 2 + ((i & 1) ^ nearX);
+			unsigned int childZ = node.Z * 2 + ((i >> 1) ^ nearZ);
+			if (childX < childWidth && childZ < childHeight)
+			{
+				stack[stackSize++] = { childLevel, childX, childZ };
+			}
+		}
+	}
+	return contact.Hit;
+}
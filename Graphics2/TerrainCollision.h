@@ -0,0 +1,116 @@
+#pragma once
+#include "DirectXCore.h"
+#include "TerrainHeightPyramid.h"
+#include <algorithm>
+
+using namespace std;
+
+// Where a sphere or capsule touches the terrain
+struct TerrainContact
+{
+	bool			Hit;
+	XMFLOAT3		Position;			// Closest point on the terrain (overlaps) or the point first touched (sweeps)
+	XMFLOAT3		Normal;				// Direction to move the shape to separate it from the terrain
+	float			Depth;				// How far the shape has to move along Normal to stop overlapping (0 for sweeps)
+	float			Time;				// Fraction of the way from start to end at which a swept sphere first touches (0 for overlaps)
+};
+
+struct TerrainSphere
+{
+	XMFLOAT3		Centre;
+	float			Radius;
+};
+
+// The points within Radius of the line from Start to End
+struct TerrainCapsule
+{
+	XMFLOAT3		Start;
+	XMFLOAT3		End;
+	float			Radius;
+};
+
+// A sphere moving from Start to End
+struct TerrainSphereSweep
+{
+	XMFLOAT3		Start;
+	XMFLOAT3		End;
+	float			Radius;
+};
+
+// Entry in the stack of pyramid entries still to be visited by a ray cast or sweep
+struct RayCastNode
+{
+	unsigned int	Level;
+	unsigned int	X;
+	unsigned int	Z;
+};
+
+// Works out where a ray enters and leaves a box, limited to the range [entry, exit) passed in.
+// Returns false if the ray misses the box within that range.
+inline bool IntersectRayWithBox(const XMFLOAT3& origin, const XMFLOAT3& inverseDirection, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax, float& entry, float& exit)
+{
+	float x0 = (boxMin.x - origin.x) * inverseDirection.x;
+	float x1 = (boxMax.x - origin.x) * inverseDirection.x;
+	float y0 = (boxMin.y - origin.y) * inverseDirection.y;
+	float y1 = (boxMax.y - origin.y) * inverseDirection.y;
+	float z0 = (boxMin.z - origin.z) * inverseDirection.z;
+	float z1 = (boxMax.z - origin.z) * inverseDirection.z;
+	entry = max(entry, max(max(min(x0, x1), min(y0, y1)), min(z0, z1)));
+	exit = min(exit, min(min(max(x0, x1), max(y0, y1)), max(z0, z1)));
+	return entry <= exit;
+}
+
+// Collision queries against the triangles of a height grid (split in the same way as the index buffer).
+// Only the cells under a shape are tested, and the height pyramid is used to rule out areas that are
+// entirely below it.  No memory is allocated by any query.  Shapes over points outside the grid don't
+// collide with anything there.
+class TerrainCollider
+{
+public:
+	TerrainCollider();
+	~TerrainCollider();
+
+	// heights are numberOfXPoints * numberOfZPoints 16-bit heights, where a value of 65536 is worldHeight.
+	// Column x, row z of the grid is at (originX + x * spacing, height, originZ - z * spacing).  The heights
+	// and pyramid are read by every query, so changes to them are seen straight away.
+	void Initialise(const USHORT * heights, const TerrainHeightPyramid * heightPyramid, unsigned int numberOfXPoints, unsigned int numberOfZPoints,
+					float spacing, float worldHeight, float originX, float originZ);
+
+	// A sphere whose centre is below the surface is pushed up along the normal of the surface there
+	bool SphereOverlap(const XMFLOAT3& centre, float radius, TerrainContact& contact) const;
+
+	// As for spheres, a capsule with an end below the surface is pushed out from under it
+	bool CapsuleOverlap(const XMFLOAT3& start, const XMFLOAT3& end, float radius, TerrainContact& contact) const;
+
+	// Finds the first point at which a sphere moving in a straight line from start to end touches the
+	// terrain.  A sphere that starts out touching the terrain only hits it if it moves further in, so a
+	// sphere resting on the surface can slide along it.
+	bool SweepSphere(const XMFLOAT3& start, const XMFLOAT3& end, float radius, TerrainContact& contact) const;
+
+private:
+	// Cells [FirstX, EndX) x [FirstZ, EndZ)
+	struct CellRange
+	{
+		unsigned int	FirstX;
+		unsigned int	FirstZ;
+		unsigned int	EndX;
+		unsigned int	EndZ;
+	};
+
+	const USHORT *					_heights;
+	const TerrainHeightPyramid *	_heightPyramid;
+	unsigned int					_numberOfXPoints;
+	unsigned int					_numberOfZPoints;
+	float							_spacing;
+	float							_worldHeight;
+	float							_originX;
+	float							_originZ;
+
+	bool GetCellRange(float minimumX, float minimumZ, float maximumX, float maximumZ, CellRange& range) const;
+	bool IsRangeBelow(const CellRange& range, float minimumY) const;
+	inline bool IsCellBelow(unsigned int cellX, unsigned int cellZ, float minimumY) const { return _heightPyramid->GetRange(0, cellX, cellZ).Maximum * _worldHeight < minimumY; }
+	void GetCellCorners(unsigned int cellX, unsigned int cellZ, XMVECTOR corners[4]) const;
+	bool GetSurface(float x, float z, float& height, XMVECTOR& normal) const;
+	bool GetPenetration(FXMVECTOR point, float radius, TerrainContact& contact) const;
+	void SweepSphereAgainstCell(FXMVECTOR start, FXMVECTOR movement, float radius, unsigned int cellX, unsigned int cellZ, TerrainContact& contact) const;
+};
@@ -0,0 +1,223 @@
+#include "TerrainHeightPyramid.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+
+TerrainHeightPyramid::TerrainHeightPyramid()
+{
+}
+
+TerrainHeightPyramid::~TerrainHeightPyramid()
+{
+}
+
+void TerrainHeightPyramid::Build(const float * heightValues, unsigned int numberOfXPoints, unsigned int numberOfZPoints)
+{
+	_levels.clear();
+	if (numberOfXPoints < 2 || numberOfZPoints < 2)
+	{
+		return;
+	}
+
+	Level cells;
+	cells.Width = numberOfXPoints - 1;
+	cells.Height = numberOfZPoints - 1;
+	cells.Ranges.resize((size_t)cells.Width * cells.Height);
+	_levels.push_back(move(cells));
+	CalculateCellRanges(heightValues, numberOfXPoints, 0, 0, _levels[0].Width, _levels[0].Height);
+
+	while (_levels.back().Width > 1 || _levels.back().Height > 1)
+	{
+		BuildLevel((unsigned int)_levels.size());
+	}
+}
+
+void TerrainHeightPyramid::Update(const float * heightValues, unsigned int numberOfXPoints, unsigned int firstCellX, unsigned int firstCellZ,
+								  unsigned int endCellX, unsigned int endCellZ)
+{
+	if (_levels.empty())
+	{
+		return;
+	}
+	endCellX = min(endCellX, _levels[0].Width);
+	endCellZ = min(endCellZ, _levels[0].Height);
+	if (firstCellX >= endCellX || firstCellZ >= endCellZ)
+	{
+		return;
+	}
+	CalculateCellRanges(heightValues, numberOfXPoints, firstCellX, firstCellZ, endCellX, endCellZ);
+
+	// Each level above only changes over the entries covering the ones that changed below it
+	for (unsigned int level = 1; level < (unsigned int)_levels.size(); level++)
+	{
+		firstCellX /= 2;
+		firstCellZ /= 2;
+		endCellX = (endCellX + 1) / 2;
+		endCellZ = (endCellZ + 1) / 2;
+		CalculateLevelRanges(level, firstCellX, firstCellZ, endCellX, endCellZ);
+	}
+}
+
+void TerrainHeightPyramid::BuildLevel(unsigned int level)
+{
+	Level next;
+	next.Width = (_levels[level - 1].Width + 1) / 2;
+	next.Height = (_levels[level - 1].Height + 1) / 2;
+	next.Ranges.resize((size_t)next.Width * next.Height);
+	_levels.push_back(move(next));
+	CalculateLevelRanges(level, 0, 0, _levels[level].Width, _levels[level].Height);
+}
+
+// Works out the range of cells [firstCellX, endCellX) x [firstCellZ, endCellZ) from their four corner samples
+void TerrainHeightPyramid::CalculateCellRanges(const float * heightValues, unsigned int numberOfXPoints, unsigned int firstCellX, unsigned int firstCellZ,
+											   unsigned int endCellX, unsigned int endCellZ)
+{
+	Level& cells = _levels[0];
+	for (unsigned int z = firstCellZ; z < endCellZ; z++)
+	{
+		const float * row = heightValues + (size_t)z * numberOfXPoints;
+		const float * nextRow = row + numberOfXPoints;
+		TerrainHeightRange * ranges = &cells.Ranges[(size_t)z * cells.Width];
+		for (unsigned int x = firstCellX; x < endCellX; x++)
+		{
+			ranges[x].Minimum = min(min(row[x], row[x + 1]), min(nextRow[x], nextRow[x + 1]));
+			ranges[x].Maximum = max(max(row[x], row[x + 1]), max(nextRow[x], nextRow[x + 1]));
+		}
+	}
+}
+
+// Works out entries [firstX, endX) x [firstZ, endZ) of a level from the 2 * 2 entries below each of them
+void TerrainHeightPyramid::CalculateLevelRanges(unsigned int level, unsigned int firstX, unsigned int firstZ, unsigned int endX, unsigned int endZ)
+{
+	const Level& below = _levels[level - 1];
+	Level& current = _levels[level];
+	for (unsigned int z = firstZ; z < endZ; z++)
+	{
+		unsigned int z0 = z * 2;
+		unsigned int z1 = min(z0 + 1, below.Height - 1);
+		for (unsigned int x = firstX; x < endX; x++)
+		{
+			unsigned int x0 = x * 2;
+			unsigned int x1 = min(x0 + 1, below.Width - 1);
+			const TerrainHeightRange& a = below.Ranges[z0 * below.Width + x0];
+			const TerrainHeightRange& b = below.Ranges[z0 * below.Width + x1];
+			const TerrainHeightRange& c = below.Ranges[z1 * below.Width + x0];
+			const TerrainHeightRange& d = below.Ranges[z1 * below.Width + x1];
+			TerrainHeightRange& range = current.Ranges[z * current.Width + x];
+			range.Minimum = min(min(a.Minimum, b.Minimum), min(c.Minimum, d.Minimum));
+			range.Maximum = max(max(a.Maximum, b.Maximum), max(c.Maximum, d.Maximum));
+		}
+	}
+}
+
+// The data is the number of levels, the width and height of each level and then the ranges of
+// every level in turn
+void TerrainHeightPyramid::Serialise(vector<unsigned char>& data) const
+{
+	vector<unsigned int> dimensions;
+	dimensions.push_back((unsigned int)_levels.size());
+	size_t rangesSize = 0;
+	for (const Level& level : _levels)
+	{
+		dimensions.push_back(level.Width);
+		dimensions.push_back(level.Height);
+		rangesSize += level.Ranges.size() * sizeof(TerrainHeightRange);
+	}
+	size_t dimensionsSize = dimensions.size() * sizeof(unsigned int);
+	data.resize(dimensionsSize + rangesSize);
+	memcpy(&data[0], &dimensions[0], dimensionsSize);
+	size_t offset = dimensionsSize;
+	for (const Level& level : _levels)
+	{
+		memcpy(&data[offset], &level.Ranges[0], level.Ranges.size() * sizeof(TerrainHeightRange));
+		offset += level.Ranges.size() * sizeof(TerrainHeightRange);
+	}
+}
+
+bool TerrainHeightPyramid::Deserialise(const unsigned char * data, size_t size)
+{
+	_levels.clear();
+	unsigned int levelCount;
+	if (size < sizeof(unsigned int))
+	{
+		return false;
+	}
+	memcpy(&levelCount, data, sizeof(unsigned int));
+	size_t offset = sizeof(unsigned int) * (1 + 2 * (size_t)levelCount);
+	if (levelCount == 0 || levelCount > 32 || size < offset)
+	{
+		return false;
+	}
+	const unsigned int * dimensions = (const unsigned int *)data + 1;
+	_levels.resize(levelCount);
+	for (unsigned int i = 0; i < levelCount; i++)
+	{
+		Level& level = _levels[i];
+		level.Width = dimensions[i * 2];
+		level.Height = dimensions[i * 2 + 1];
+		size_t rangesSize = (size_t)level.Width * level.Height * sizeof(TerrainHeightRange);
+		if (level.Width == 0 || level.Height == 0 || size - offset < rangesSize)
+		{
+			_levels.clear();
+			return false;
+		}
+		level.Ranges.resize((size_t)level.Width * level.Height);
+		memcpy(&level.Ranges[0], data + offset, rangesSize);
+		offset += rangesSize;
+	}
+	return true;
+}
+
+size_t TerrainHeightPyramid::GetMemoryUsage() const
+{
+	size_t bytes = _levels.capacity() * sizeof(Level);
+	for (const Level& level : _levels)
+	{
+		bytes += level.Ranges.capacity() * sizeof(TerrainHeightRange);
+	}
+	return bytes;
+}
+
+TerrainHeightRange TerrainHeightPyramid::GetHeightRange(unsigned int firstCellX, unsigned int firstCellZ, unsigned int endCellX, unsigned int endCellZ) const
+{
+	TerrainHeightRange range;
+	range.Minimum = FLT_MAX;
+	range.Maximum = -FLT_MAX;
+	if (!_levels.empty() && firstCellX < endCellX && firstCellZ < endCellZ)
+	{
+		unsigned int top = (unsigned int)_levels.size() - 1;
+		AddHeightRange(top, 0, 0, firstCellX, firstCellZ, endCellX, endCellZ, range);
+	}
+	return range;
+}
+
+// Adds in the range of entry (x, z) of a level if it lies entirely inside the requested cells,
+// otherwise works down through the entries below it that overlap them.
+void TerrainHeightPyramid::AddHeightRange(unsigned int level, unsigned int x, unsigned int z, unsigned int firstCellX, unsigned int firstCellZ,
+										  unsigned int endCellX, unsigned int endCellZ, TerrainHeightRange& range) const
+{
+	const Level& cells = _levels[0];
+	unsigned int startX = x << level;
+	unsigned int startZ = z << level;
+	unsigned int endX = min((x + 1) << level, cells.Width);
+	unsigned int endZ = min((z + 1) << level, cells.Height);
+	if (startX >= endCellX || startZ >= endCellZ || endX <= firstCellX || endZ <= firstCellZ)
+	{
+		return;
+	}
+	if (startX >= firstCellX && startZ >= firstCellZ && endX <= endCellX && endZ <= endCellZ)
+	{
+		const TerrainHeightRange& entry = GetRange(level, x, z);
+		range.Minimum = min(range.Minimum, entry.Minimum);
+		range.Maximum = max(range.Maximum, entry.Maximum);
+		return;
+	}
+	const Level& below = _levels[level - 1];
+	for (unsigned int childZ = z * 2; childZ < min(z * 2 + 2, below.Height); childZ++)
+	{
+		for (unsigned int childX = x * 2; childX < min(x * 2 + 2, below.Width); childX++)
+		{
+			AddHeightRange(level - 1, childX, childZ, firstCellX, firstCellZ, endCellX, endCellZ, range);
+		}
+	}
+}
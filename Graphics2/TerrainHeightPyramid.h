@@ -0,0 +1,60 @@
+#pragma once
+#include <vector>
+
+using namespace std;
+
+// The lowest and highest height values in an area of the terrain
+struct TerrainHeightRange
+{
+	float			Minimum;
+	float			Maximum;
+};
+
+// Min/max mip pyramid over a grid of height values.  Level 0 holds the range of each cell of the
+// grid (i.e. of its four corner samples), each level above holds the range of 2 * 2 entries of the
+// level below, down to a single entry covering the whole grid.  Odd sized levels are rounded up,
+// so the last row and column of a level can cover fewer cells than the rest.
+class TerrainHeightPyramid
+{
+public:
+	TerrainHeightPyramid();
+	~TerrainHeightPyramid();
+
+	void Build(const float * heightValues, unsigned int numberOfXPoints, unsigned int numberOfZPoints);
+
+	// Recalculates the ranges of cells [firstCellX, endCellX) x [firstCellZ, endCellZ), and the entries
+	// above them, after their heights have changed.  heightValues must be the grid the pyramid was built from.
+	void Update(const float * heightValues, unsigned int numberOfXPoints, unsigned int firstCellX, unsigned int firstCellZ,
+				unsigned int endCellX, unsigned int endCellZ);
+
+	// Gets the range of heights of cells [firstCellX, endCellX) x [firstCellZ, endCellZ)
+	TerrainHeightRange GetHeightRange(unsigned int firstCellX, unsigned int firstCellZ, unsigned int endCellX, unsigned int endCellZ) const;
+
+	// Copies the pyramid to and from a block of memory (used by the terrain cache).  Deserialise
+	// returns false if the data is not a valid pyramid.
+	void Serialise(vector<unsigned char>& data) const;
+	bool Deserialise(const unsigned char * data, size_t size);
+
+	size_t GetMemoryUsage() const;
+
+	inline unsigned int GetLevelCount() const { return (unsigned int)_levels.size(); }
+	inline unsigned int GetLevelWidth(unsigned int level) const { return _levels[level].Width; }
+	inline unsigned int GetLevelHeight(unsigned int level) const { return _levels[level].Height; }
+	inline const TerrainHeightRange& GetRange(unsigned int level, unsigned int x, unsigned int z) const { return _levels[level].Ranges[z * _levels[level].Width + x]; }
+
+private:
+	struct Level
+	{
+		unsigned int					Width;
+		unsigned int					Height;
+		vector<TerrainHeightRange>		Ranges;
+	};
+	vector<Level>						_levels;
+
+	void BuildLevel(unsigned int level);
+	void CalculateCellRanges(const float * heightValues, unsigned int numberOfXPoints, unsigned int firstCellX, unsigned int firstCellZ,
+							 unsigned int endCellX, unsigned int endCellZ);
+	void CalculateLevelRanges(unsigned int level, unsigned int firstX, unsigned int firstZ, unsigned int endX, unsigned int endZ);
+	void AddHeightRange(unsigned int level, unsigned int x, unsigned int z, unsigned int firstCellX, unsigned int firstCellZ,
+						unsigned int endCellX, unsigned int endCellZ, TerrainHeightRange& range) const;
+};
@@ -0,0 +1,105 @@
+#include "TerrainIndexOrder.h"
+
+// Works out the size of the power of two square that covers the grid
+static unsigned int GetCurveSize(unsigned int numberOfColumns, unsigned int numberOfRows)
+{
+	unsigned int size = 1;
+	while (size < numberOfColumns || size < numberOfRows)
+	{
+		size *= 2;
+	}
+	return size;
+}
+
+// Splits the bits of a Morton code into its x (even bits) and z (odd bits) coordinates
+static void DecodeMorton(UINT64 code, unsigned int& x, unsigned int& z)
+{
+	x = 0;
+	z = 0;
+	for (unsigned int bit = 0; bit < 32; bit++)
+	{
+		x |= (unsigned int)((code >> (2 * bit)) & 1) << bit;
+		z |= (unsigned int)((code >> (2 * bit + 1)) & 1) << bit;
+	}
+}
+
+// Converts a distance along the Hilbert curve covering a size * size square to a position
+static void DecodeHilbert(UINT64 distance, unsigned int size, unsigned int& x, unsigned int& z)
+{
+	x = 0;
+	z = 0;
+	for (unsigned int scale = 1; scale < size; scale *= 2)
+	{
+		unsigned int rx = (unsigned int)(1 & (distance / 2));
+		unsigned int rz = (unsigned int)(1 & (distance ^ rx));
+		if (rz == 0)
+		{
+			// Rotate the quadrant
+			if (rx == 1)
+			{
+				x = scale - 1 - x;
+				z = scale - 1 - z;
+			}
+			unsigned int temp = x;
+			x = z;
+			z = temp;
+		}
+		x += scale * rx;
+		z += scale * rz;
+		distance /= 4;
+	}
+}
+
+void CalculateCellOrder(TerrainIndexOrder order, unsigned int numberOfColumns, unsigned int numberOfRows, vector<UINT>& cells)
+{
+	cells.clear();
+	cells.reserve((size_t)numberOfColumns * numberOfRows);
+	switch (order)
+	{
+		case TerrainIndexOrder::RowMajor:
+			for (UINT cell = 0; cell < numberOfColumns * numberOfRows; cell++)
+			{
+				cells.push_back(cell);
+			}
+			break;
+
+		case TerrainIndexOrder::Strips:
+			for (unsigned int stripStart = 0; stripStart < numberOfColumns; stripStart += TerrainIndexStripWidth)
+			{
+				unsigned int stripEnd = min(stripStart + TerrainIndexStripWidth, numberOfColumns);
+				for (unsigned int z = 0; z < numberOfRows; z++)
+				{
+					for (unsigned int x = stripStart; x < stripEnd; x++)
+					{
+						cells.push_back(z * numberOfColumns + x);
+					}
+				}
+			}
+			break;
+
+		case TerrainIndexOrder::Morton:
+		case TerrainIndexOrder::Hilbert:
+		{
+			// Follow the curve over the square covering the grid, skipping the cells outside it
+			unsigned int size = GetCurveSize(numberOfColumns, numberOfRows);
+			for (UINT64 distance = 0; distance < (UINT64)size * size; distance++)
+			{
+				unsigned int x;
+				unsigned int z;
+				if (order == TerrainIndexOrder::Morton)
+				{
+					DecodeMorton(distance, x, z);
+				}
+				else
+				{
+					DecodeHilbert(distance, size, x, z);
+				}
+				if (x < numberOfColumns && z < numberOfRows)
+				{
+					cells.push_back(z * numberOfColumns + x);
+				}
+			}
+			break;
+		}
+	}
+}
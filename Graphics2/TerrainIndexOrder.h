@@ -0,0 +1,23 @@
+#pragma once
+#include "core.h"
+#include <vector>
+
+using namespace std;
+
+// The order the cells of the terrain grid are written to the index buffer in.  The GPU only keeps a
+// small number of recently transformed vertices, so orders that come back to a vertex soon after it
+// was last used transform fewer vertices (see VertexCacheSimulator).
+enum class TerrainIndexOrder
+{
+	RowMajor,			// Each row of cells in turn
+	Strips,				// Columns of cells TerrainIndexStripWidth wide, each taken a row at a time
+	Morton,				// Z-order curve
+	Hilbert				// Hilbert curve
+};
+
+// Width of the strips used by TerrainIndexOrder::Strips.  A strip's row of vertices plus the row
+// below it (2 * (width + 1) vertices) fits in a 32 entry cache.
+const unsigned int TerrainIndexStripWidth = 14;
+
+// Fills cells with the index (z * numberOfColumns + x) of every cell of the grid in the given order
+void CalculateCellOrder(TerrainIndexOrder order, unsigned int numberOfColumns, unsigned int numberOfRows, vector<UINT>& cells);
@@ -0,0 +1,457 @@
+#include "TerrainLightMap.h"
+#include <immintrin.h>
+#include <chrono>
+#include <cmath>
+#include <cfloat>
+
+// Directions used for the ambient occlusion and that the sun's direction is placed between
+const unsigned int HorizonDirections = 16;
+const unsigned int SunDirections = 64;
+
+// Distances (in samples) at which the horizon is looked for.  They increase by about half as much again
+// each time, as distant terrain has to be much higher to hide the sky.
+const unsigned int NumberOfSteps = 14;
+static const float StepDistances[NumberOfSteps] = { 1.0f, 1.5f, 2.0f, 3.0f, 4.0f, 6.0f, 8.0f, 11.0f, 16.0f, 23.0f, 32.0f, 45.0f, 64.0f, 90.0f };
+
+// Furthest sample that can affect a sample's horizons (the last step, plus one for the interpolation)
+const unsigned int MaximumReach = 91;
+
+// The sun fades out over this range of the sine of the horizon angle around the horizon, about three degrees
+const float SunPenumbra = 0.05f;
+
+// Rows are shared out between the threads in pieces of this size
+const unsigned int RowsPerPiece = 4;
+
+// Everything the scan needs to read heights at any point of the grid
+struct HorizonScan
+{
+	const USHORT *	Heights;
+	const int *		GatherHeights;		// The same heights, read 32 bits at a time from the start of each one
+	unsigned int	NumberOfXPoints;
+	float			MaximumX;			// Position of the last column and row
+	float			MaximumZ;
+	int				LastCellX;
+	int				LastCellZ;
+	float			HeightScale;		// World units per unit of height
+	float			InverseDistances[NumberOfSteps];
+};
+
+// The offsets of the steps in one direction, in samples
+struct HorizonDirection
+{
+	float			OffsetX[NumberOfSteps];
+	float			OffsetZ[NumberOfSteps];
+};
+
+static HorizonDirection GetHorizonDirection(float angle)
+{
+	HorizonDirection direction;
+	float directionX = cosf(angle);
+	float directionZ = sinf(angle);
+	for (unsigned int k = 0; k < NumberOfSteps; k++)
+	{
+		direction.OffsetX[k] = StepDistances[k] * directionX;
+		direction.OffsetZ[k] = StepDistances[k] * directionZ;
+	}
+	return direction;
+}
+
+static inline HorizonDirection GetAmbientDirection(unsigned int direction)
+{
+	return GetHorizonDirection(XM_2PI * (direction + 0.5f) / HorizonDirections);
+}
+
+static inline HorizonDirection GetSunDirection(int direction)
+{
+	return GetHorizonDirection(XM_2PI * direction / SunDirections);
+}
+
+// The scalar and vector versions carry out the same operations in the same order, so they give the
+// same results
+
+static inline float GetHeight(const HorizonScan& scan, int x, int z)
+{
+	return (float)scan.Heights[(size_t)z * scan.NumberOfXPoints + x] * scan.HeightScale;
+}
+
+// The sine of the angle of the horizon above level, looking from the sample at (x, z) with the given height
+static float CalculateHorizonSine(const HorizonScan& scan, const HorizonDirection& direction, float x, float z, float height)
+{
+	float maximumSlope = -FLT_MAX;
+	for (unsigned int k = 0; k < NumberOfSteps; k++)
+	{
+		// Points beyond the edge are moved back onto it
+		float pointX = fminf(fmaxf(x + direction.OffsetX[k], 0.0f), scan.MaximumX);
+		float pointZ = fminf(fmaxf(z + direction.OffsetZ[k], 0.0f), scan.MaximumZ);
+		int cellX = (int)pointX;
+		int cellZ = (int)pointZ;
+		cellX = cellX < scan.LastCellX ? cellX : scan.LastCellX;
+		cellZ = cellZ < scan.LastCellZ ? cellZ : scan.LastCellZ;
+		float u = pointX - (float)cellX;
+		float v = pointZ - (float)cellZ;
+		float topLeft = GetHeight(scan, cellX, cellZ);
+		float topRight = GetHeight(scan, cellX + 1, cellZ);
+		float bottomLeft = GetHeight(scan, cellX, cellZ + 1);
+		float bottomRight = GetHeight(scan, cellX + 1, cellZ + 1);
+		float top = topLeft + (topRight - topLeft) * u;
+		float bottom = bottomLeft + (bottomRight - bottomLeft) * u;
+		float pointHeight = top + (bottom - top) * v;
+		maximumSlope = fmaxf(maximumSlope, (pointHeight - height) * scan.InverseDistances[k]);
+	}
+	return maximumSlope / sqrtf(1.0f + maximumSlope * maximumSlope);
+}
+
+static inline BYTE ToByte(float value)
+{
+	return (BYTE)(int)(value * 255.0f + 0.5f);
+}
+
+static inline short ToHorizon(float sine)
+{
+	return (short)lrintf(sine * 32767.0f);
+}
+
+#if defined(__AVX2__)
+
+static inline __m256 GatherHeights(const HorizonScan& scan, __m256i index)
+{
+	__m256i values = _mm256_and_si256(_mm256_i32gather_epi32(scan.GatherHeights, index, 2), _mm256_set1_epi32(0xFFFF));
+	return _mm256_mul_ps(_mm256_cvtepi32_ps(values), _mm256_set1_ps(scan.HeightScale));
+}
+
+// Each 32 bits read holds a height and the one after it in the row, so a single gather gets both
+static inline void GatherHeightPairs(const HorizonScan& scan, __m256i index, __m256& left, __m256& right)
+{
+	__m256i values = _mm256_i32gather_epi32(scan.GatherHeights, index, 2);
+	left = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(values, _mm256_set1_epi32(0xFFFF))), _mm256_set1_ps(scan.HeightScale));
+	right = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(values, 16)), _mm256_set1_ps(scan.HeightScale));
+}
+
+static __m256 CalculateHorizonSine8(const HorizonScan& scan, const HorizonDirection& direction, __m256 x, __m256 z, __m256 height)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 maximumX = _mm256_set1_ps(scan.MaximumX);
+	const __m256 maximumZ = _mm256_set1_ps(scan.MaximumZ);
+	const __m256i lastCellX = _mm256_set1_epi32(scan.LastCellX);
+	const __m256i lastCellZ = _mm256_set1_epi32(scan.LastCellZ);
+	const __m256i rowLength = _mm256_set1_epi32(scan.NumberOfXPoints);
+	__m256 maximumSlope = _mm256_set1_ps(-FLT_MAX);
+	for (unsigned int k = 0; k < NumberOfSteps; k++)
+	{
+		__m256 pointX = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(x, _mm256_set1_ps(direction.OffsetX[k])), zero), maximumX);
+		__m256 pointZ = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(z, _mm256_set1_ps(direction.OffsetZ[k])), zero), maximumZ);
+		__m256i cellX = _mm256_min_epi32(_mm256_cvttps_epi32(pointX), lastCellX);
+		__m256i cellZ = _mm256_min_epi32(_mm256_cvttps_epi32(pointZ), lastCellZ);
+		__m256 u = _mm256_sub_ps(pointX, _mm256_cvtepi32_ps(cellX));
+		__m256 v = _mm256_sub_ps(pointZ, _mm256_cvtepi32_ps(cellZ));
+		__m256i topLeftIndex = _mm256_add_epi32(_mm256_mullo_epi32(cellZ, rowLength), cellX);
+		__m256 topLeft;
+		__m256 topRight;
+		__m256 bottomLeft;
+		__m256 bottomRight;
+		GatherHeightPairs(scan, topLeftIndex, topLeft, topRight);
+		GatherHeightPairs(scan, _mm256_add_epi32(topLeftIndex, rowLength), bottomLeft, bottomRight);
+		__m256 top = _mm256_add_ps(topLeft, _mm256_mul_ps(_mm256_sub_ps(topRight, topLeft), u));
+		__m256 bottom = _mm256_add_ps(bottomLeft, _mm256_mul_ps(_mm256_sub_ps(bottomRight, bottomLeft), u));
+		__m256 pointHeight = _mm256_add_ps(top, _mm256_mul_ps(_mm256_sub_ps(bottom, top), v));
+		__m256 slope = _mm256_mul_ps(_mm256_sub_ps(pointHeight, height), _mm256_set1_ps(scan.InverseDistances[k]));
+		maximumSlope = _mm256_max_ps(maximumSlope, slope);
+	}
+	return _mm256_div_ps(maximumSlope, _mm256_sqrt_ps(_mm256_add_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(maximumSlope, maximumSlope))));
+}
+
+#endif
+
+TerrainLightMap::TerrainLightMap()
+{
+	_heights = nullptr;
+	_numberOfXPoints = 0;
+	_numberOfZPoints = 0;
+	_spacing = 1.0f;
+	_worldHeight = 1.0f;
+	_scalar = false;
+	_sunHorizonDirections[0] = -1;
+	_sunHorizonDirections[1] = -1;
+	_directionToSun = XMFLOAT3(0.0f, 1.0f, 0.0f);
+	ZeroMemory(&_statistics, sizeof(_statistics));
+}
+
+TerrainLightMap::~TerrainLightMap()
+{
+}
+
+void TerrainLightMap::Initialise(const USHORT * heights, unsigned int numberOfXPoints, unsigned int numberOfZPoints, float spacing, float worldHeight)
+{
+	_heights = heights;
+	_numberOfXPoints = numberOfXPoints;
+	_numberOfZPoints = numberOfZPoints;
+	_spacing = spacing;
+	_worldHeight = worldHeight;
+	size_t numberOfSamples = (size_t)numberOfXPoints * numberOfZPoints;
+	_texels.assign(numberOfSamples, 0);
+	_sunHorizons[0].assign(numberOfSamples, 0);
+	_sunHorizons[1].assign(numberOfSamples, 0);
+	_sunHorizonDirections[0] = -1;
+	_sunHorizonDirections[1] = -1;
+}
+
+size_t TerrainLightMap::GetMemoryUsage()
+{
+	return _texels.capacity() * sizeof(USHORT) + (_sunHorizons[0].capacity() + _sunHorizons[1].capacity()) * sizeof(short);
+}
+
+static HorizonScan GetHorizonScan(const USHORT * heights, unsigned int numberOfXPoints, unsigned int numberOfZPoints, float spacing, float worldHeight)
+{
+	HorizonScan scan;
+	scan.Heights = heights;
+	scan.GatherHeights = (const int *)heights;
+	scan.NumberOfXPoints = numberOfXPoints;
+	scan.MaximumX = (float)(numberOfXPoints - 1);
+	scan.MaximumZ = (float)(numberOfZPoints - 1);
+	scan.LastCellX = (int)numberOfXPoints - 2;
+	scan.LastCellZ = (int)numberOfZPoints - 2;
+	scan.HeightScale = worldHeight / 65536.0f;
+	for (unsigned int k = 0; k < NumberOfSteps; k++)
+	{
+		scan.InverseDistances[k] = 1.0f / (StepDistances[k] * spacing);
+	}
+	return scan;
+}
+
+static void ForEachRowPiece(ThreadPool * threadPool, unsigned int firstRow, unsigned int endRow, const function<void(unsigned int, unsigned int)>& work)
+{
+	// Rows near the edges are quicker (more of their steps read the same clamped samples), so the
+	// rows are shared out dynamically rather than in fixed bands
+	auto rows = [&](unsigned int begin, unsigned int end) { work(firstRow + begin, firstRow + end); };
+	if (threadPool == nullptr)
+	{
+		rows(0, endRow - firstRow);
+	}
+	else
+	{
+		threadPool->ParallelForDynamic(endRow - firstRow, RowsPerPiece, rows);
+	}
+}
+
+void TerrainLightMap::Bake(const XMFLOAT3& directionToSun, ThreadPool * threadPool)
+{
+	auto bakeStart = std::chrono::high_resolution_clock::now();
+	int directions[2];
+	float blend;
+	float sunSine;
+	_directionToSun = directionToSun;
+	GetSunDirections(directionToSun, directions, blend, sunSine);
+	_sunHorizonDirections[0] = directions[0];
+	_sunHorizonDirections[1] = directions[1];
+	BakeArea(0, 0, _numberOfXPoints, _numberOfZPoints, directions, threadPool);
+	unsigned int firstChangedRow;
+	unsigned int endChangedRow;
+	CalculateSunVisibility(0, 0, _numberOfXPoints, _numberOfZPoints, threadPool, firstChangedRow, endChangedRow);
+	auto bakeEnd = std::chrono::high_resolution_clock::now();
+	_statistics.BakeTime = std::chrono::duration<double, std::milli>(bakeEnd - bakeStart).count();
+}
+
+// Scans the ambient occlusion directions and the two sun directions in one pass
+void TerrainLightMap::BakeArea(unsigned int firstX, unsigned int firstZ, unsigned int endX, unsigned int endZ, const int sunDirections[2], ThreadPool * threadPool)
+{
+	HorizonScan scan = GetHorizonScan(_heights, _numberOfXPoints, _numberOfZPoints, _spacing, _worldHeight);
+	HorizonDirection ambientDirections[HorizonDirections];
+	for (unsigned int i = 0; i < HorizonDirections; i++)
+	{
+		ambientDirections[i] = GetAmbientDirection(i);
+	}
+	HorizonDirection sunHorizonDirections[2] = { GetSunDirection(sunDirections[0]), GetSunDirection(sunDirections[1]) };
+	const float directionWeight = 1.0f / HorizonDirections;
+
+	ForEachRowPiece(threadPool, firstZ, endZ, [&](unsigned int firstRow, unsigned int endRow)
+	{
+		for (unsigned int z = firstRow; z < endRow; z++)
+		{
+			size_t rowStart = (size_t)z * _numberOfXPoints;
+			unsigned int x = firstX;
+#if defined(__AVX2__)
+			alignas(32) int ambient[8];
+			alignas(32) int horizons[2][8];
+			const __m256 zero = _mm256_setzero_ps();
+			const __m256 columnOffsets = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+			__m256 sampleZ = _mm256_set1_ps((float)z);
+			for (; !_scalar && x + 8 <= endX; x += 8)
+			{
+				__m256 sampleX = _mm256_add_ps(_mm256_set1_ps((float)x), columnOffsets);
+				__m256i indices = _mm256_add_epi32(_mm256_set1_epi32((int)(rowStart + x)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+				__m256 height = GatherHeights(scan, indices);
+				__m256 occlusion = zero;
+				for (unsigned int i = 0; i < HorizonDirections; i++)
+				{
+					occlusion = _mm256_add_ps(occlusion, _mm256_max_ps(CalculateHorizonSine8(scan, ambientDirections[i], sampleX, sampleZ, height), zero));
+				}
+				__m256 light = _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(occlusion, _mm256_set1_ps(directionWeight)));
+				_mm256_store_si256((__m256i *)ambient, _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(light, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f))));
+				for (unsigned int i = 0; i < 2; i++)
+				{
+					__m256 sine = CalculateHorizonSine8(scan, sunHorizonDirections[i], sampleX, sampleZ, height);
+					_mm256_store_si256((__m256i *)horizons[i], _mm256_cvtps_epi32(_mm256_mul_ps(sine, _mm256_set1_ps(32767.0f))));
+				}
+				for (unsigned int j = 0; j < 8; j++)
+				{
+					_texels[rowStart + x + j] = (USHORT)((ambient[j] << 8) | (_texels[rowStart + x + j] & 0xFF));
+					_sunHorizons[0][rowStart + x + j] = (short)horizons[0][j];
+					_sunHorizons[1][rowStart + x + j] = (short)horizons[1][j];
+				}
+			}
+#endif
+			// Anything left over (or everything without AVX2, or if scalar) one sample at a time
+			for (; x < endX; x++)
+			{
+				float height = GetHeight(scan, x, z);
+				float occlusion = 0.0f;
+				for (unsigned int i = 0; i < HorizonDirections; i++)
+				{
+					occlusion = occlusion + fmaxf(CalculateHorizonSine(scan, ambientDirections[i], (float)x, (float)z, height), 0.0f);
+				}
+				float light = 1.0f - occlusion * directionWeight;
+				_texels[rowStart + x] = (USHORT)((ToByte(light) << 8) | (_texels[rowStart + x] & 0xFF));
+				for (unsigned int i = 0; i < 2; i++)
+				{
+					_sunHorizons[i][rowStart + x] = ToHorizon(CalculateHorizonSine(scan, sunHorizonDirections[i], (float)x, (float)z, height));
+				}
+			}
+		}
+	});
+}
+
+void TerrainLightMap::ScanSunHorizons(int direction, vector<short>& horizons, unsigned int firstX, unsigned int firstZ, unsigned int endX, unsigned int endZ, ThreadPool * threadPool)
+{
+	HorizonScan scan = GetHorizonScan(_heights, _numberOfXPoints, _numberOfZPoints, _spacing, _worldHeight);
+	HorizonDirection sunDirection = GetSunDirection(direction);
+	ForEachRowPiece(threadPool, firstZ, endZ, [&](unsigned int firstRow, unsigned int endRow)
+	{
+		for (unsigned int z = firstRow; z < endRow; z++)
+		{
+			size_t rowStart = (size_t)z * _numberOfXPoints;
+			unsigned int x = firstX;
+#if defined(__AVX2__)
+			const __m256 columnOffsets = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+			__m256 sampleZ = _mm256_set1_ps((float)z);
+			alignas(32) int rowHorizons[8];
+			for (; !_scalar && x + 8 <= endX; x += 8)
+			{
+				__m256 sampleX = _mm256_add_ps(_mm256_set1_ps((float)x), columnOffsets);
+				__m256i indices = _mm256_add_epi32(_mm256_set1_epi32((int)(rowStart + x)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+				__m256 sine = CalculateHorizonSine8(scan, sunDirection, sampleX, sampleZ, GatherHeights(scan, indices));
+				_mm256_store_si256((__m256i *)rowHorizons, _mm256_cvtps_epi32(_mm256_mul_ps(sine, _mm256_set1_ps(32767.0f))));
+				for (unsigned int j = 0; j < 8; j++)
+				{
+					horizons[rowStart + x + j] = (short)rowHorizons[j];
+				}
+			}
+#endif
+			for (; x < endX; x++)
+			{
+				horizons[rowStart + x] = ToHorizon(CalculateHorizonSine(scan, sunDirection, (float)x, (float)z, GetHeight(scan, x, z)));
+			}
+		}
+	});
+}
+
+// Finds the two sun directions either side of the sun, how far the sun is from the first towards the
+// second, and the sine of the sun's height above the horizon
+void TerrainLightMap::GetSunDirections(const XMFLOAT3& directionToSun, int directions[2], float& blend, float& sunSine)
+{
+	// Rows run back along Z
+	float angle = atan2f(-directionToSun.z, directionToSun.x);
+	float position = (angle < 0.0f ? angle + XM_2PI : angle) / XM_2PI * SunDirections;
+	float first = floorf(position);
+	directions[0] = (int)first % SunDirections;
+	directions[1] = (directions[0] + 1) % SunDirections;
+	blend = position - first;
+	float length = sqrtf(directionToSun.x * directionToSun.x + directionToSun.y * directionToSun.y + directionToSun.z * directionToSun.z);
+	sunSine = length > 0.0f ? directionToSun.y / length : 1.0f;
+}
+
+bool TerrainLightMap::CalculateSunVisibility(unsigned int firstX, unsigned int firstZ, unsigned int endX, unsigned int endZ, ThreadPool * threadPool,
+											 unsigned int& firstChangedRow, unsigned int& endChangedRow)
+{
+	int directions[2];
+	float blend;
+	float sunSine;
+	GetSunDirections(_directionToSun, directions, blend, sunSine);
+	const float horizonScale = 1.0f / 32767.0f;
+	vector<BYTE> rowChanged(endZ - firstZ, 0);
+	ForEachRowPiece(threadPool, firstZ, endZ, [&](unsigned int firstRow, unsigned int endRow)
+	{
+		for (unsigned int z = firstRow; z < endRow; z++)
+		{
+			size_t rowStart = (size_t)z * _numberOfXPoints;
+			bool changed = false;
+			for (unsigned int x = firstX; x < endX; x++)
+			{
+				float first = _sunHorizons[0][rowStart + x] * horizonScale;
+				float second = _sunHorizons[1][rowStart + x] * horizonScale;
+				float horizon = first + (second - first) * blend;
+				float visibility = fminf(fmaxf((sunSine - horizon) / SunPenumbra + 0.5f, 0.0f), 1.0f);
+				USHORT texel = (USHORT)((_texels[rowStart + x] & 0xFF00) | ToByte(visibility));
+				changed = changed || texel != _texels[rowStart + x];
+				_texels[rowStart + x] = texel;
+			}
+			rowChanged[z - firstZ] = changed ? 1 : 0;
+		}
+	});
+	firstChangedRow = endZ;
+	endChangedRow = firstZ;
+	for (unsigned int z = firstZ; z < endZ; z++)
+	{
+		if (rowChanged[z - firstZ] != 0)
+		{
+			firstChangedRow = firstChangedRow < z ? firstChangedRow : z;
+			endChangedRow = z + 1;
+		}
+	}
+	return firstChangedRow < endChangedRow;
+}
+
+bool TerrainLightMap::SetSunDirection(const XMFLOAT3& directionToSun, ThreadPool * threadPool, unsigned int& firstChangedRow, unsigned int& endChangedRow)
+{
+	auto updateStart = std::chrono::high_resolution_clock::now();
+	int directions[2];
+	float blend;
+	float sunSine;
+	GetSunDirections(directionToSun, directions, blend, sunSine);
+
+	// Keep the horizons that are still needed, moving them into place, and scan any others
+	if (_sunHorizonDirections[1] == directions[0] || _sunHorizonDirections[0] == directions[1])
+	{
+		_sunHorizons[0].swap(_sunHorizons[1]);
+		swap(_sunHorizonDirections[0], _sunHorizonDirections[1]);
+	}
+	_statistics.SunDirectionsScanned = 0;
+	for (unsigned int i = 0; i < 2; i++)
+	{
+		if (_sunHorizonDirections[i] != directions[i])
+		{
+			ScanSunHorizons(directions[i], _sunHorizons[i], 0, 0, _numberOfXPoints, _numberOfZPoints, threadPool);
+			_sunHorizonDirections[i] = directions[i];
+			_statistics.SunDirectionsScanned++;
+		}
+	}
+	_directionToSun = directionToSun;
+	bool changed = CalculateSunVisibility(0, 0, _numberOfXPoints, _numberOfZPoints, threadPool, firstChangedRow, endChangedRow);
+	auto updateEnd = std::chrono::high_resolution_clock::now();
+	_statistics.SunUpdateTime = std::chrono::duration<double, std::milli>(updateEnd - updateStart).count();
+	return changed;
+}
+
+void TerrainLightMap::UpdateArea(unsigned int& firstX, unsigned int& firstZ, unsigned int& endX, unsigned int& endZ, ThreadPool * threadPool)
+{
+	auto updateStart = std::chrono::high_resolution_clock::now();
+	firstX = firstX > MaximumReach ? firstX - MaximumReach : 0;
+	firstZ = firstZ > MaximumReach ? firstZ - MaximumReach : 0;
+	endX = endX + MaximumReach < _numberOfXPoints ? endX + MaximumReach : _numberOfXPoints;
+	endZ = endZ + MaximumReach < _numberOfZPoints ? endZ + MaximumReach : _numberOfZPoints;
+	BakeArea(firstX, firstZ, endX, endZ, _sunHorizonDirections, threadPool);
+	unsigned int firstChangedRow;
+	unsigned int endChangedRow;
+	CalculateSunVisibility(firstX, firstZ, endX, endZ, threadPool, firstChangedRow, endChangedRow);
+	auto updateEnd = std::chrono::high_resolution_clock::now();
+	_statistics.AreaUpdateTime = std::chrono::duration<double, std::milli>(updateEnd - updateStart).count();
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "DirectXCore.h"
+#include "ThreadPool.h"
+#include <vector>
+
+using namespace std;
+
+struct TerrainLightMapStatistics
+{
+	double			BakeTime;				// Milliseconds spent in the last Bake
+	double			SunUpdateTime;			// Milliseconds spent in the last SetSunDirection
+	unsigned int	SunDirectionsScanned;	// Horizon directions scanned by the last SetSunDirection (0 if the stored ones were used)
+	double			AreaUpdateTime;			// Milliseconds spent in the last UpdateArea
+};
+
+// Bakes the shadowing of the terrain by itself into a texture with a texel for each height sample.
+//
+// Both terms come from the horizon around each sample: how far above level the terrain rises in a given
+// direction, found by stepping outwards from the sample at increasing distances.  Ambient occlusion is
+// the average of the sine of the horizon angle over HorizonDirections directions.  The sun is visible
+// if it is above the horizon in its direction, with a soft edge to hide the spacing of the steps.
+//
+// The horizons for the two directions either side of the sun (out of SunDirections) are kept, so a
+// change of the sun's height only has to compare the sun with them again, and a small change of
+// direction only has to scan one new direction.  Eight samples are scanned at a time using AVX2.
+class TerrainLightMap
+{
+public:
+	TerrainLightMap();
+	~TerrainLightMap();
+
+	// heights are numberOfXPoints * numberOfZPoints 16-bit heights, where a value of 65536 is worldHeight,
+	// followed by one spare value so they can be read 32 bits at a time.  Column x, row z of the grid is
+	// x * spacing along X and z * spacing back along Z from row 0.  The heights are read again by
+	// SetSunDirection and UpdateArea, so they must be kept.
+	void Initialise(const USHORT * heights, unsigned int numberOfXPoints, unsigned int numberOfZPoints, float spacing, float worldHeight);
+
+	// Calculates the ambient occlusion and sun visibility of every sample.  directionToSun points from
+	// the terrain towards the sun and does not need to be normalised.  threadPool can be nullptr.
+	void Bake(const XMFLOAT3& directionToSun, ThreadPool * threadPool);
+
+	// Recalculates the sun visibility for a new sun direction.  Rows [firstChangedRow, endChangedRow) of
+	// the texels contain every change.  Returns false if nothing changed.
+	bool SetSunDirection(const XMFLOAT3& directionToSun, ThreadPool * threadPool, unsigned int& firstChangedRow, unsigned int& endChangedRow);
+
+	// Bakes again every sample whose horizons could be affected by a change to the heights of samples
+	// [firstX, endX) x [firstZ, endZ).  The area that was baked again is returned in the same arguments.
+	void UpdateArea(unsigned int& firstX, unsigned int& firstZ, unsigned int& endX, unsigned int& endZ, ThreadPool * threadPool);
+
+	// One texel per sample, row by row, to be used as DXGI_FORMAT_R8G8_UNORM.  The low byte (red) is
+	// the sun visibility and the high byte (green) is the ambient light that isn't occluded.
+	inline const USHORT *				GetTexels() { return _texels.size() > 0 ? &_texels[0] : nullptr; }
+	inline TerrainLightMapStatistics	GetStatistics() { return _statistics; }
+	size_t								GetMemoryUsage();
+
+	// Scans one sample at a time even where AVX2 is available.  Produces exactly the same results.
+	inline void							SetScalar(bool scalar) { _scalar = scalar; }
+
+private:
+	const USHORT *						_heights;
+	unsigned int						_numberOfXPoints;
+	unsigned int						_numberOfZPoints;
+	float								_spacing;
+	float								_worldHeight;
+	bool								_scalar;
+
+	vector<USHORT>						_texels;
+
+	// Sine of the horizon angle of every sample in two of the sun directions, scaled to +/- 32767
+	vector<short>						_sunHorizons[2];
+	int									_sunHorizonDirections[2];		// -1 if not calculated
+	XMFLOAT3							_directionToSun;
+	TerrainLightMapStatistics			_statistics;
+
+	void BakeArea(unsigned int firstX, unsigned int firstZ, unsigned int endX, unsigned int endZ, const int sunDirections[2], ThreadPool * threadPool);
+	void ScanSunHorizons(int direction, vector<short>& horizons, unsigned int firstX, unsigned int firstZ, unsigned int endX, unsigned int endZ, ThreadPool * threadPool);
+	void GetSunDirections(const XMFLOAT3& directionToSun, int directions[2], float& blend, float& sunSine);
+	bool CalculateSunVisibility(unsigned int firstX, unsigned int firstZ, unsigned int endX, unsigned int endZ, ThreadPool * threadPool,
+								unsigned int& firstChangedRow, unsigned int& endChangedRow);
+};
@@ -1,5 +1,7 @@
 #include "TerrainNode.h"
 #include "DirectXFramework.h"
+#include <immintrin.h>
+#include <cfloat>
 
 struct CBUFFER
 {
@@ -14,20 +16,118 @@ struct CBUFFER
 	float		Shininess;
 	float		Opacity;
 	float		Padding[2];
+	XMFLOAT4	TerrainGrid;		// Used to decode compact vertices (see TerrainCompactVertexParameters)
+	XMFLOAT4	TerrainGridScale;
+	XMFLOAT4	LightMapTransform;	// Scale and offset from blend map to light map coordinates
+	XMFLOAT4	LightMapStrength;	// How much the sun visibility and ambient occlusion are applied (0 without a light map)
 };
 
-TerrainNode::TerrainNode(wstring name, wstring heightMapFilename, int numberOfRows, int numberOfColumns, int worldHeight, int spacing) : SceneNode(name)
+// Fraction of the detail textures covered by a single cell.  The detail texture coordinates are worked
+// out from each vertex's place in the grid, so every generation gives exactly the same vertices and
+// neighbouring cells agree on the coordinates of the corners they share.  This is roughly the average
+// span of the random coordinates the per-cell layout used to give each cell.
+const float DetailTiling = 0.35f;
+
+// Slopes (rise over run) over which the stone layer is blended in by default
+const float DefaultSlopeBlendStart = 0.6f;
+const float DefaultSlopeBlendEnd = 1.2f;
+
+// Bytes held by a texture with all of its mip levels and array slices
+static size_t GetTextureBytes(const D3D11_TEXTURE2D_DESC& description)
+{
+	// Block compressed formats hold each 4 x 4 block of texels in 8 or 16 bytes
+	UINT blockSize = 4;
+	size_t blockBytes;
+	switch (description.Format)
+	{
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+		case DXGI_FORMAT_BC4_UNORM:
+		case DXGI_FORMAT_BC4_SNORM:
+			blockBytes = 8;
+			break;
+
+		case DXGI_FORMAT_BC2_UNORM:
+		case DXGI_FORMAT_BC2_UNORM_SRGB:
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+		case DXGI_FORMAT_BC5_UNORM:
+		case DXGI_FORMAT_BC5_SNORM:
+		case DXGI_FORMAT_BC7_UNORM:
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+			blockBytes = 16;
+			break;
+
+		case DXGI_FORMAT_R8G8_UNORM:
+			blockSize = 1;
+			blockBytes = 2;
+			break;
+
+		default:
+			// Everything else the terrain uses has 32 bits a texel
+			blockSize = 1;
+			blockBytes = 4;
+			break;
+	}
+	size_t bytes = 0;
+	for (UINT level = 0; level < description.MipLevels; level++)
+	{
+		size_t width = max(description.Width >> level, 1u);
+		size_t height = max(description.Height >> level, 1u);
+		bytes += ((width + blockSize - 1) / blockSize) * ((height + blockSize - 1) / blockSize) * blockBytes;
+	}
+	return bytes * description.ArraySize;
+}
+
+TerrainNode::TerrainNode(wstring name, wstring heightMapFilename, int numberOfRows, int numberOfColumns, int worldHeight, int spacing, TerrainVertexLayout vertexLayout) : SceneNode(name)
 {
 	_heightMapFilename = heightMapFilename;
-	_numberOfRows = numberOfRows;
-	_numberOfColumns = numberOfColumns;
+	_heightMapFormat = HeightMapFormat::Unknown;
 	_worldHeight = worldHeight;
 	_spacing = spacing;
-	
-	_numberOfXPoints = _numberOfColumns + 1;
-	_numberOfZPoints = _numberOfRows + 1;
-	_numberOfPolygons = _numberOfColumns * _numberOfRows * 2;
-	_numberOfVertices = _numberOfPolygons * 2;
+	_vertexLayout = vertexLayout;
+	_normalMethod = TerrainNormalMethod::CentralDifference;
+	_indexOrder = TerrainIndexOrder::RowMajor;
+	_slopeBlend = { DefaultSlopeBlendStart, DefaultSlopeBlendEnd };
+	_vertexFormat = TerrainVertexFormat::Full;
+	_transformsPerTriangle = 0.0f;
+	SetGridSize(numberOfColumns + 1, numberOfRows + 1);
+	ZeroMemory(&_statistics, sizeof(_statistics));
+	_levelOfDetailEnabled = false;
+	_occlusionCullingEnabled = false;
+	_occluderLevel = 0;
+	_chunkSize = 0;
+	_cacheEnabled = true;
+	_heightMapHash = 0;
+	_vertexData = nullptr;
+	_indexData = nullptr;
+	_blendMapData = nullptr;
+	_numberOfBufferIndices = 0;
+	_compactMemoryEnabled = true;
+	_simplificationEnabled = false;
+	_maximumSimplificationError = 0.0f;
+	_editingEnabled = false;
+	_maximumScreenError = 0.0f;
+	_lightMapEnabled = false;
+	_detailTexturesShared = false;
+	_directionalLightVector = XMFLOAT4(1.0f, 0.0f, 0.0f, 0.0f);
+	_heightsSupplied = false;
+	_geometryLoaded = false;
+}
+
+TerrainNode::TerrainNode(wstring name, shared_ptr<ProceduralHeightMap> heightMap, int numberOfRows, int numberOfColumns, int worldHeight, int spacing, TerrainVertexLayout vertexLayout)
+	: TerrainNode(name, L"", numberOfRows, numberOfColumns, worldHeight, spacing, vertexLayout)
+{
+	_proceduralHeightMap = heightMap;
+	_cacheEnabled = false;
+}
+
+TerrainNode::TerrainNode(wstring name, vector<float>&& heightValues, unsigned int numberOfXPoints, unsigned int numberOfZPoints, int worldHeight, int spacing, TerrainVertexLayout vertexLayout)
+	: TerrainNode(name, L"", numberOfZPoints - 1, numberOfXPoints - 1, worldHeight, spacing, vertexLayout)
+{
+	_heightValues = move(heightValues);
+	_heightsSupplied = true;
+	_cacheEnabled = false;
 }
 
 TerrainNode::~TerrainNode()
@@ -38,12 +138,33 @@ bool TerrainNode::Initialise()
 {
 	_device = DirectXFramework::GetDXFramework()->GetDevice();
 	_deviceContext = DirectXFramework::GetDXFramework()->GetDeviceContext();
-	LoadHeightMap(_heightMapFilename);
-	GenerateVerticesAndIndices();
-	GenerateNormals();
-	LoadTerrainTextures();
-	GenerateBlendMap();
+	if (_threadPool == nullptr)
+	{
+		_threadPool = DirectXFramework::GetDXFramework()->GetThreadPool();
+	}
+	if (!_geometryLoaded && !LoadGeometry())
+	{
+		return false;
+	}
+	_statistics.TextureBytes = 0;
+	if (!_detailTexturesShared)
+	{
+		size_t detailTextureBytes;
+		_texturesResourceView = LoadDetailTextures(_device.Get(), _deviceContext.Get(), detailTextureBytes);
+		_statistics.TextureBytes += detailTextureBytes;
+	}
+	BuildBlendMapTexture();
+	if (_lightMapEnabled)
+	{
+		BuildLightMapTexture();
+	}
+	if (UseEditing() && UseLevelOfDetail())
+	{
+		FindSkirtVertices();
+	}
 	GenerateBuffers();
+	ReleaseUploadedData();
+
 	BuildShaders();
 	BuildVertexLayout();
 	BuildConstantBuffer();
@@ -51,6 +172,147 @@ bool TerrainNode::Initialise()
 	return true;
 }
 
+bool TerrainNode::LoadGeometry()
+{
+	auto loadStart = std::chrono::high_resolution_clock::now();
+	bool heightsLoaded = _heightsSupplied || (_proceduralHeightMap != nullptr ? GenerateHeightMap() : LoadHeightMap(_heightMapFilename));
+	if (!heightsLoaded)
+	{
+		return false;
+	}
+	CalculateTerrainExtents();
+	BuildCompactHeights();
+
+	UINT64 cacheKey = CalculateCacheKey();
+	_statistics.LoadedFromCache = _cacheEnabled && _proceduralHeightMap == nullptr && LoadFromCache(cacheKey);
+	if (!_statistics.LoadedFromCache)
+	{
+		auto generationStart = std::chrono::high_resolution_clock::now();
+		_heightPyramid.Build(&_heightValues[0], _numberOfXPoints, _numberOfZPoints);
+		GenerateVerticesAndIndices();
+		GenerateNormals();
+		if (UseLevelOfDetail())
+		{
+			BuildLevelsOfDetail();
+		}
+		else if (UseSimplification())
+		{
+			Simplify();
+		}
+		GenerateBlendMap();
+		auto generationEnd = std::chrono::high_resolution_clock::now();
+		_statistics.GenerationTime = std::chrono::duration<double, std::milli>(generationEnd - generationStart).count();
+
+		_vertexData = &_vertices[0];
+		const vector<UINT>& bufferIndices = UseLevelOfDetail() ? _levelOfDetailIndices : (UseSimplification() ? _simplifiedIndices : _indices);
+		_indexData = &bufferIndices[0];
+		_numberOfBufferIndices = (unsigned int)bufferIndices.size();
+		_blendMapData = &_blendMap[0];
+		if (_cacheEnabled && _proceduralHeightMap == nullptr)
+		{
+			WriteCache(cacheKey);
+		}
+	}
+
+	CalculateBounds();
+
+	_statistics.VertexCount = _numberOfVertices;
+	_statistics.VertexStride = GetVertexStride();
+	_statistics.VertexBytes = (size_t)GetVertexStride() * _numberOfVertices;
+	_statistics.IndexCount = _numberOfBufferIndices;
+	_statistics.IndexBytes = sizeof(UINT) * _numberOfBufferIndices;
+	_statistics.SimplifiedTriangles = UseSimplification() ? _numberOfBufferIndices / 3 : 0;
+	XMFLOAT2 gridOrigin = GetGridOrigin();
+	if (UseLevelOfDetail() && _occlusionCullingEnabled)
+	{
+		_occlusionCuller.Initialise(&_heightPyramid, (float)_spacing, (float)_worldHeight, gridOrigin.x, gridOrigin.y, _occluderLevel);
+	}
+	_collider.Initialise(&_compactHeights[0], &_heightPyramid, _numberOfXPoints, _numberOfZPoints, (float)_spacing, (float)_worldHeight,
+						 gridOrigin.x, gridOrigin.y);
+	auto loadEnd = std::chrono::high_resolution_clock::now();
+	_statistics.LoadTime = std::chrono::duration<double, std::milli>(loadEnd - loadStart).count();
+	_geometryLoaded = true;
+	return true;
+}
+
+wstring TerrainNode::GetCacheFilename()
+{
+	return _heightMapFilename + L".cache";
+}
+
+// Combines the hash of the height map file with everything else that affects the generated data
+UINT64 TerrainNode::CalculateCacheKey()
+{
+	int parameters[] = { _numberOfRows, _numberOfColumns, _worldHeight, _spacing, (int)_heightMapFormat, (int)_vertexLayout,
+						 (int)_normalMethod, UseLevelOfDetail() ? (int)_chunkSize : 0, (int)sizeof(TerrainVertex), (int)_indexOrder };
+	UINT64 key = TerrainCache::Hash(parameters, sizeof(parameters), _heightMapHash);
+	key = TerrainCache::Hash(&_slopeBlend, sizeof(_slopeBlend), key);
+	if (UseSimplification())
+	{
+		key = TerrainCache::Hash(&_maximumSimplificationError, sizeof(float), key);
+	}
+	return key;
+}
+
+bool TerrainNode::LoadFromCache(UINT64 cacheKey)
+{
+	if (!_cache.Open(GetCacheFilename(), cacheKey))
+	{
+		return false;
+	}
+	size_t vertexBytes;
+	size_t indexBytes;
+	size_t blendMapBytes;
+	size_t pyramidBytes;
+	size_t chunkBytes;
+	const BYTE * vertices = _cache.GetSection(TerrainCacheSection::Vertices, vertexBytes);
+	const BYTE * indices = _cache.GetSection(TerrainCacheSection::Indices, indexBytes);
+	const BYTE * blendMap = _cache.GetSection(TerrainCacheSection::BlendMap, blendMapBytes);
+	const BYTE * pyramid = _cache.GetSection(TerrainCacheSection::HeightPyramid, pyramidBytes);
+	const BYTE * chunks = _cache.GetSection(TerrainCacheSection::Chunks, chunkBytes);
+	bool valid = vertices != nullptr && vertexBytes > 0 && vertexBytes % sizeof(TerrainVertex) == 0 &&
+				 indices != nullptr && indexBytes > 0 && indexBytes % sizeof(UINT) == 0 &&
+				 blendMap != nullptr && blendMapBytes == sizeof(DWORD) * _numberOfRows * _numberOfColumns &&
+				 pyramid != nullptr && _heightPyramid.Deserialise(pyramid, pyramidBytes);
+	if (valid && UseLevelOfDetail())
+	{
+		valid = chunks != nullptr && chunkBytes > 0 && chunkBytes % sizeof(TerrainChunk) == 0;
+	}
+	if (!valid)
+	{
+		_cache.Close();
+		return false;
+	}
+
+	if (UseLevelOfDetail())
+	{
+		_quadTree.Restore((const TerrainChunk *)chunks, chunkBytes / sizeof(TerrainChunk), _chunkSize);
+	}
+	_vertexData = (const TerrainVertex *)vertices;
+	_numberOfVertices = (unsigned int)(vertexBytes / sizeof(TerrainVertex));
+	_indexData = (const UINT *)indices;
+	_numberOfBufferIndices = (unsigned int)(indexBytes / sizeof(UINT));
+	_blendMapData = (const DWORD *)blendMap;
+	return true;
+}
+
+// Failing to write the cache is not an error, the terrain will just be generated again next time
+bool TerrainNode::WriteCache(UINT64 cacheKey)
+{
+	vector<unsigned char> pyramid;
+	_heightPyramid.Serialise(pyramid);
+	TerrainCache cache;
+	cache.AddSection(TerrainCacheSection::Vertices, _vertexData, sizeof(TerrainVertex) * _numberOfVertices);
+	cache.AddSection(TerrainCacheSection::Indices, _indexData, sizeof(UINT) * _numberOfBufferIndices);
+	cache.AddSection(TerrainCacheSection::BlendMap, _blendMapData, sizeof(DWORD) * _blendMap.size());
+	cache.AddSection(TerrainCacheSection::HeightPyramid, &pyramid[0], pyramid.size());
+	if (UseLevelOfDetail())
+	{
+		cache.AddSection(TerrainCacheSection::Chunks, _quadTree.GetChunks(), sizeof(TerrainChunk) * _quadTree.GetChunkCount());
+	}
+	return cache.Write(GetCacheFilename(), cacheKey);
+}
+
 void TerrainNode::Render()
 {
 	XMMATRIX projectionTransformation = DirectXFramework::GetDXFramework()->GetProjectionTransformation();
@@ -62,12 +324,18 @@ void TerrainNode::Render()
 	cBuffer.CompleteTransformation = completeTransformation;
 	cBuffer.WorldTransformation = XMLoadFloat4x4(&_worldTransformation);
 	cBuffer.AmbientColour = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
-	cBuffer.LightVector = XMVector4Normalize(XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f));
+	cBuffer.LightVector = XMVector4Normalize(XMLoadFloat4(&_directionalLightVector));
 	cBuffer.LightColour = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	cBuffer.DiffuseColour = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f); // Added these extra cBuffer things
 	cBuffer.SpecularColour = XMFLOAT4(0.1f, 0.1f, 0.1f, 0.1f);
 	cBuffer.Shininess = 1.0f;
 	cBuffer.Opacity = 1.0f;
+	cBuffer.TerrainGrid = XMFLOAT4(_compactVertexParameters.StartX, _compactVertexParameters.StartZ, _compactVertexParameters.Spacing, _compactVertexParameters.DetailTiling);
+	cBuffer.TerrainGridScale = XMFLOAT4(_compactVertexParameters.MinimumHeight, _compactVertexParameters.HeightRange, _compactVertexParameters.BlendMapDu, _compactVertexParameters.BlendMapDv);
+
+	// Blend map coordinates run from 0 to 1 between the first and last samples, the light map has a texel centred on each sample
+	cBuffer.LightMapTransform = XMFLOAT4((float)_numberOfColumns / _numberOfXPoints, (float)_numberOfRows / _numberOfZPoints, 0.5f / _numberOfXPoints, 0.5f / _numberOfZPoints);
+	cBuffer.LightMapStrength = _lightMapResourceView.Get() != nullptr ? XMFLOAT4(1.0f, 1.0f, 0.0f, 0.0f) : XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
 	//XMStoreFloat4(&cBuffer.CameraPosition, DirectXFramework::GetDXFramework()->GetCamera()->GetCameraPosition());
 	//cBuffer.CameraPosition = DirectXFramework::GetDXFramework()->GetCamera()->GetCameraPosition();
 
@@ -75,7 +343,7 @@ void TerrainNode::Render()
 	_deviceContext->PSSetShader(_pixelShader.Get(), 0, 0);
 	_deviceContext->IASetInputLayout(_layout.Get());
 
-	UINT stride = sizeof(TerrainVertex);
+	UINT stride = GetVertexStride();
 	UINT offset = 0;
 	_deviceContext->IASetVertexBuffers(0, 1, _vertexBuffer.GetAddressOf(), &stride, &offset);
 	_deviceContext->IASetIndexBuffer(_indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
@@ -86,144 +354,880 @@ void TerrainNode::Render()
 	_deviceContext->PSSetConstantBuffers(0, 1, _constantBuffer.GetAddressOf());
 	_deviceContext->PSSetShaderResources(0, 1, _blendMapResourceView.GetAddressOf());
 	_deviceContext->PSSetShaderResources(1, 1, _texturesResourceView.GetAddressOf());
+	_deviceContext->PSSetShaderResources(2, 1, _lightMapResourceView.GetAddressOf());
 	_deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	_deviceContext->DrawIndexed(_numberOfIndices, 0, 0);
+	if (!UseLevelOfDetail())
+	{
+		_deviceContext->DrawIndexed(_numberOfBufferIndices, 0, 0);
+		_statistics.TrianglesDrawn = _numberOfBufferIndices / 3;
+		UpdateVertexFetchStatistics();
+		return;
+	}
+
+	// Select the chunks to draw based on where the camera is relative to the terrain
+	XMVECTOR cameraPosition = DirectXFramework::GetDXFramework()->GetCamera()->GetCameraPosition();
+	XMMATRIX inverseWorldTransformation = XMMatrixInverse(nullptr, XMLoadFloat4x4(&_worldTransformation));
+	XMFLOAT3 localCameraPosition;
+	XMStoreFloat3(&localCameraPosition, XMVector3TransformCoord(cameraPosition, inverseWorldTransformation));
+
+	// Element _22 of the projection matrix is 1 / tan(fieldOfView / 2)
+	XMFLOAT4X4 projection;
+	XMStoreFloat4x4(&projection, projectionTransformation);
+	float errorScale = DirectXFramework::GetDXFramework()->GetWindowHeight() * 0.5f * projection.m[1][1];
+
+	_quadTree.SelectChunks(localCameraPosition, errorScale, _maximumScreenError, _drawList);
+	// The chunks are in the terrain's own space, so the frustum is too
+	CullChunksOutsideFrustum(SceneFrustum(completeTransformation));
+	if (_occlusionCullingEnabled)
+	{
+		CullOccludedChunks(localCameraPosition);
+	}
+	_statistics.ChunksDrawn = (unsigned int)_drawList.size();
+	_statistics.TrianglesDrawn = 0;
+	for (size_t i = 0; i < _drawList.size(); i++)
+	{
+		_deviceContext->DrawIndexed(_drawList[i].IndexCount, _drawList[i].StartIndex, 0);
+		_statistics.TrianglesDrawn += _drawList[i].IndexCount / 3;
+	}
+	UpdateVertexFetchStatistics();
+}
+
+void TerrainNode::CullChunksOutsideFrustum(const SceneFrustum& frustum)
+{
+	unsigned int selectedCount = (unsigned int)_drawList.size();
+	_drawListBounds.Clear();
+	_drawListBounds.Reserve(selectedCount);
+	for (const TerrainChunkDraw& draw : _drawList)
+	{
+		const TerrainChunk& chunk = _quadTree.GetChunk(draw.ChunkIndex);
+		_drawListBounds.Add(XMFLOAT3(chunk.BoundsMin.x, chunk.BoundsMin.y - chunk.SkirtDepth, chunk.BoundsMin.z), chunk.BoundsMax);
+	}
+	_visibleDrawIndices.resize(selectedCount);
+	unsigned int visibleCount = selectedCount > 0 ? CullBoxes(frustum, _drawListBounds, 0, selectedCount, &_visibleDrawIndices[0]) : 0;
+
+	// The visible indices are in increasing order, so the list can be compacted in place
+	_statistics.ChunksOutsideFrustum = selectedCount - visibleCount;
+	_statistics.TrianglesOutsideFrustum = 0;
+	unsigned int next = 0;
+	for (unsigned int i = 0; i < selectedCount; i++)
+	{
+		if (next < visibleCount && _visibleDrawIndices[next] == i)
+		{
+			_drawList[next++] = _drawList[i];
+		}
+		else
+		{
+			_statistics.TrianglesOutsideFrustum += _drawList[i].IndexCount / 3;
+		}
+	}
+	_drawList.resize(visibleCount);
+}
+
+void TerrainNode::CullOccludedChunks(const XMFLOAT3& localCameraPosition)
+{
+	auto occlusionStart = std::chrono::high_resolution_clock::now();
+	unsigned int selectedTriangles = 0;
+	for (size_t i = 0; i < _drawList.size(); i++)
+	{
+		selectedTriangles += _drawList[i].IndexCount / 3;
+	}
+	_statistics.ChunksOccluded = _occlusionCuller.Cull(localCameraPosition, _quadTree.GetChunks(), _drawList);
+	_statistics.TrianglesOccluded = selectedTriangles;
+	for (size_t i = 0; i < _drawList.size(); i++)
+	{
+		_statistics.TrianglesOccluded -= _drawList[i].IndexCount / 3;
+	}
+	auto occlusionEnd = std::chrono::high_resolution_clock::now();
+	_statistics.OcclusionTime = std::chrono::duration<double, std::milli>(occlusionEnd - occlusionStart).count();
+}
+
+// Each vertex that misses the post-transform cache is read from the vertex buffer
+void TerrainNode::UpdateVertexFetchStatistics()
+{
+	size_t verticesFetched = (size_t)(_statistics.TrianglesDrawn * _transformsPerTriangle);
+	_statistics.VertexFetchBytes = verticesFetched * GetVertexStride();
+	_statistics.VertexFetchBytesSaved = verticesFetched * (sizeof(TerrainVertex) - GetVertexStride());
+}
+
+void TerrainNode::SetGridSize(unsigned int numberOfXPoints, unsigned int numberOfZPoints)
+{
+	_numberOfXPoints = numberOfXPoints;
+	_numberOfZPoints = numberOfZPoints;
+	_numberOfColumns = (int)_numberOfXPoints - 1;
+	_numberOfRows = (int)_numberOfZPoints - 1;
+	_numberOfPolygons = _numberOfColumns * _numberOfRows * 2;
+	_numberOfIndices = _numberOfPolygons * 3;
+	if (_vertexLayout == TerrainVertexLayout::SharedGrid)
+	{
+		_numberOfVertices = _numberOfXPoints * _numberOfZPoints;
+	}
+	else
+	{
+		_numberOfVertices = _numberOfPolygons * 2;
+	}
+}
+
+void TerrainNode::EnableLevelOfDetail(unsigned int chunkSize, float maximumScreenError)
+{
+	_levelOfDetailEnabled = true;
+	_chunkSize = chunkSize;
+	_maximumScreenError = maximumScreenError;
+}
+
+// Runs work over the range [0, count) in bands, spread across the thread pool if there is one
+void TerrainNode::ForEachRowBand(unsigned int count, const function<void(unsigned int, unsigned int)>& work)
+{
+	if (_threadPool == nullptr)
+	{
+		work(0, count);
+	}
+	else
+	{
+		_threadPool->ParallelFor(count, work);
+	}
+}
+
+void TerrainNode::EnableOcclusionCulling(unsigned int occluderLevel)
+{
+	_occlusionCullingEnabled = true;
+	_occluderLevel = occluderLevel;
+}
+
+bool TerrainNode::UseLevelOfDetail()
+{
+	// Chunks index into the shared grid, so level of detail is not available with the per-cell layout
+	return _levelOfDetailEnabled && _vertexLayout == TerrainVertexLayout::SharedGrid;
+}
+
+void TerrainNode::EnableSimplification(float maximumError)
+{
+	_simplificationEnabled = true;
+	_maximumSimplificationError = maximumError;
+}
+
+bool TerrainNode::UseSimplification()
+{
+	// The simplified triangles index into the shared grid, and level of detail takes priority
+	return _simplificationEnabled && _vertexLayout == TerrainVertexLayout::SharedGrid && !UseLevelOfDetail() && !UseEditing();
+}
+
+bool TerrainNode::UseEditing()
+{
+	// Edited vertices are found by their position in the grid and their normals are worked out from the heights around them
+	return _editingEnabled && _vertexLayout == TerrainVertexLayout::SharedGrid && _normalMethod == TerrainNormalMethod::CentralDifference;
+}
+
+bool TerrainNode::UseCompactVertices()
+{
+	// The compact vertices are positioned by their place in the grid
+	return _vertexFormat == TerrainVertexFormat::Compact && _vertexLayout == TerrainVertexLayout::SharedGrid;
+}
+
+unsigned int TerrainNode::GetVertexStride()
+{
+	return UseCompactVertices() ? sizeof(TerrainCompactVertex) : sizeof(TerrainVertex);
+}
+
+void TerrainNode::Simplify()
+{
+	TerrainSimplifier simplifier;
+	simplifier.Build(&_heightValues[0], _numberOfXPoints, _numberOfZPoints);
+	simplifier.GenerateIndices(_maximumSimplificationError / _worldHeight, _simplifiedIndices);
+}
+
+void TerrainNode::BuildLevelsOfDetail()
+{
+	XMFLOAT2 gridOrigin = GetGridOrigin();
+	_quadTree.Build(&_heightValues[0], &_heightPyramid, _numberOfXPoints, _numberOfZPoints, (float)_spacing, (float)_worldHeight,
+					gridOrigin.x, gridOrigin.y, _chunkSize);
+
+	vector<TerrainSkirtVertex> skirtVertices;
+	_levelOfDetailIndices.clear();
+	_quadTree.GenerateIndices(_levelOfDetailIndices, skirtVertices, (UINT)_vertices.size());
+
+	// Skirt vertices are copies of the edge vertices (including their normals) pushed downwards
+	_vertices.reserve(_vertices.size() + skirtVertices.size());
+	for (size_t i = 0; i < skirtVertices.size(); i++)
+	{
+		TerrainVertex vertex = _vertices[skirtVertices[i].SourceVertex];
+		vertex.Position.y -= skirtVertices[i].Depth;
+		_vertices.push_back(vertex);
+	}
+	_numberOfVertices = (unsigned int)_vertices.size();
+}
+
+// Returns the index of the top left vertex of the given cell
+unsigned int TerrainNode::GetCellVertexIndex(int z, int x)
+{
+	if (_vertexLayout == TerrainVertexLayout::SharedGrid)
+	{
+		return z * _numberOfXPoints + x;
+	}
+	return (z * _numberOfColumns + x) * 4;
+}
+
+// Keeps a 16-bit copy of the heights for queries once the full precision heights have been released.
+// The heights are rounded to the same precision, so the vertices, the height pyramid and the queries
+// all agree (8 and 16-bit height maps are unchanged).  One extra height is added at the end so that the
+// 32-bit gathers in GetHeightsAtPoints never read past the end.
+void TerrainNode::BuildCompactHeights()
+{
+	size_t numberOfHeights = (size_t)_numberOfXPoints * _numberOfZPoints;
+	_compactHeights.resize(numberOfHeights + 1);
+	_compactHeights[numberOfHeights] = 0;
+	ForEachRowBand(_numberOfZPoints, [&](unsigned int firstRow, unsigned int endRow)
+	{
+		for (size_t i = (size_t)firstRow * _numberOfXPoints; i < (size_t)endRow * _numberOfXPoints; i++)
+		{
+			float value = _heightValues[i] * 65536.0f + 0.5f;
+			_compactHeights[i] = (USHORT)min(max(value, 0.0f), 65535.0f);
+			_heightValues[i] = GetCompactHeight(i);
+		}
+	});
+}
+
+void TerrainNode::ReleaseUploadedData()
+{
+	// The GPU has its own copies now, so the blend map and the cache file are no longer needed.  If the
+	// terrain can be edited, the blend map and its mip levels are kept so that the mips can be updated.
+	if (!UseEditing())
+	{
+		vector<DWORD>().swap(_blendMap);
+		vector<vector<DWORD>>().swap(_blendMapMips);
+	}
+	_blendMapData = nullptr;
+	_cache.Close();
+	_statistics.ResidentBytesAfterUpload = GetMemoryUsage().Total;
+	if (_compactMemoryEnabled)
+	{
+		ReleaseGeometry();
+	}
+	_statistics.ResidentBytesAfterRelease = GetMemoryUsage().Total;
+}
+
+// Frees everything that is only needed to create the buffers
+void TerrainNode::ReleaseGeometry()
+{
+	vector<TerrainVertex>().swap(_vertices);
+	vector<UINT>().swap(_indices);
+	vector<UINT>().swap(_levelOfDetailIndices);
+	vector<UINT>().swap(_simplifiedIndices);
+	if (!UseEditing())
+	{
+		// Edits are made to the full precision heights
+		vector<float>().swap(_heightValues);
+	}
+	_vertexData = nullptr;
+	_indexData = nullptr;
+}
+
+TerrainMemoryUsage TerrainNode::GetMemoryUsage()
+{
+	TerrainMemoryUsage usage;
+	usage.HeightBytes = _heightValues.capacity() * sizeof(float);
+	usage.CompactHeightBytes = _compactHeights.capacity() * sizeof(USHORT);
+	usage.HeightPyramidBytes = _heightPyramid.GetMemoryUsage();
+	usage.VertexBytes = _vertices.capacity() * sizeof(TerrainVertex);
+	usage.IndexBytes = (_indices.capacity() + _levelOfDetailIndices.capacity() + _simplifiedIndices.capacity() + _skirtOrder.capacity()) * sizeof(UINT);
+	usage.BlendMapBytes = _blendMap.capacity() * sizeof(DWORD);
+	for (size_t i = 0; i < _blendMapMips.size(); i++)
+	{
+		usage.BlendMapBytes += _blendMapMips[i].capacity() * sizeof(DWORD);
+	}
+	usage.ChunkBytes = _quadTree.GetChunkCount() * sizeof(TerrainChunk) + _skirtVertices.capacity() * sizeof(TerrainSkirtVertex);
+	usage.LightMapBytes = _lightMap.GetMemoryUsage();
+	usage.Total = usage.HeightBytes + usage.CompactHeightBytes + usage.HeightPyramidBytes + usage.VertexBytes +
+				  usage.IndexBytes + usage.BlendMapBytes + usage.ChunkBytes + usage.LightMapBytes;
+	return usage;
+}
+
+VertexCacheStatistics TerrainNode::AnalyseVertexCache(unsigned int cacheSize, VertexCachePolicy policy)
+{
+	return SimulateVertexCache(_indexData, _indexData != nullptr ? _numberOfBufferIndices : 0, cacheSize, policy);
+}
+
+// Skirt vertices are copies of grid vertices (see BuildLevelsOfDetail), so the vertex each one hangs from
+// can be worked out from its position.  This works the same whether the vertices were generated or came
+// from the cache.
+void TerrainNode::FindSkirtVertices()
+{
+	unsigned int numberOfGridVertices = _numberOfXPoints * _numberOfZPoints;
+	_skirtVertices.resize(_numberOfVertices - numberOfGridVertices);
+	_skirtOrder.resize(_skirtVertices.size());
+	XMFLOAT2 gridOrigin = GetGridOrigin();
+	for (unsigned int i = 0; i < (unsigned int)_skirtVertices.size(); i++)
+	{
+		const TerrainVertex& vertex = _vertexData[numberOfGridVertices + i];
+		unsigned int x = (unsigned int)((vertex.Position.x - gridOrigin.x) / _spacing + 0.5f);
+		unsigned int z = (unsigned int)((gridOrigin.y - vertex.Position.z) / _spacing + 0.5f);
+		_skirtVertices[i].SourceVertex = z * _numberOfXPoints + x;
+		_skirtVertices[i].Depth = _vertexData[_skirtVertices[i].SourceVertex].Position.y - vertex.Position.y;
+		_skirtOrder[i] = i;
+	}
+	sort(_skirtOrder.begin(), _skirtOrder.end(), [&](UINT a, UINT b) { return _skirtVertices[a].SourceVertex < _skirtVertices[b].SourceVertex; });
+}
+
+bool TerrainNode::EditHeights(unsigned int firstX, unsigned int firstZ, unsigned int endX, unsigned int endZ, const function<float(unsigned int, unsigned int, float)>& edit)
+{
+	endX = min(endX, _numberOfXPoints);
+	endZ = min(endZ, _numberOfZPoints);
+	if (!UseEditing() || _heightValues.empty() || firstX >= endX || firstZ >= endZ)
+	{
+		return false;
+	}
+	auto editStart = std::chrono::high_resolution_clock::now();
+
+	// The new heights are rounded to 16 bits in the same way as BuildCompactHeights
+	float heightChange = 0.0f;
+	for (unsigned int z = firstZ; z < endZ; z++)
+	{
+		for (unsigned int x = firstX; x < endX; x++)
+		{
+			size_t i = (size_t)z * _numberOfXPoints + x;
+			float value = edit(x, z, _heightValues[i] * _worldHeight) / _worldHeight * 65536.0f + 0.5f;
+			_compactHeights[i] = (USHORT)min(max(value, 0.0f), 65535.0f);
+			float height = GetCompactHeight(i);
+			heightChange = max(heightChange, fabsf(height - _heightValues[i]));
+			_heightValues[i] = height;
+		}
+	}
+
+	// The normals of the vertices around the edge of the area also change, as they use the heights either side of them
+	unsigned int firstVertexX = firstX > 0 ? firstX - 1 : 0;
+	unsigned int firstVertexZ = firstZ > 0 ? firstZ - 1 : 0;
+	unsigned int endVertexX = min(endX + 1, _numberOfXPoints);
+	unsigned int endVertexZ = min(endZ + 1, _numberOfZPoints);
+	UpdateVertices(firstVertexX, firstVertexZ, endVertexX, endVertexZ);
+	_statistics.LastEditVertices = (endVertexX - firstVertexX) * (endVertexZ - firstVertexZ);
+	if (UseLevelOfDetail())
+	{
+		UpdateSkirtVertices(firstVertexX, firstVertexZ, endVertexX, endVertexZ);
+	}
+
+	// The cells with a changed sample at one of their corners
+	unsigned int firstCellX = firstX > 0 ? firstX - 1 : 0;
+	unsigned int firstCellZ = firstZ > 0 ? firstZ - 1 : 0;
+	unsigned int endCellX = min(endX, (unsigned int)_numberOfColumns);
+	unsigned int endCellZ = min(endZ, (unsigned int)_numberOfRows);
+	_heightPyramid.Update(&_heightValues[0], _numberOfXPoints, firstCellX, firstCellZ, endCellX, endCellZ);
+	CalculateBounds();
+	UpdateBlendMap(firstCellX, firstCellZ, endCellX, endCellZ);
+	if (UseLevelOfDetail())
+	{
+		_quadTree.UpdateHeights(_heightPyramid, (float)_worldHeight, firstX, firstZ, endX, endZ, heightChange * _worldHeight);
+	}
+	if (_lightMapTexture.Get() != nullptr)
+	{
+		// The horizons of the samples around the area can change too
+		unsigned int firstLightMapX = firstX;
+		unsigned int firstLightMapZ = firstZ;
+		unsigned int endLightMapX = endX;
+		unsigned int endLightMapZ = endZ;
+		_lightMap.UpdateArea(firstLightMapX, firstLightMapZ, endLightMapX, endLightMapZ, _threadPool.get());
+		UpdateLightMapTexture(firstLightMapX, firstLightMapZ, endLightMapX, endLightMapZ);
+	}
+
+	auto editEnd = std::chrono::high_resolution_clock::now();
+	_statistics.LastEditTime = std::chrono::duration<double, std::milli>(editEnd - editStart).count();
+	_statistics.LastEditSamples = (endX - firstX) * (endZ - firstZ);
+	return true;
+}
+
+// Calls edit for every sample within radius of the point (x, z) with its distance from the point and its
+// current height, and sets the sample to the height returned
+bool TerrainNode::EditCircle(float x, float z, float radius, const function<float(float, float)>& edit)
+{
+	XMFLOAT2 gridOrigin = GetGridOrigin();
+	float gridX = (x - gridOrigin.x) / _spacing;
+	float gridZ = (gridOrigin.y - z) / _spacing;
+	float gridRadius = radius / _spacing;
+	if (radius <= 0.0f || gridX + gridRadius < 0.0f || gridZ + gridRadius < 0.0f)
+	{
+		return false;
+	}
+	unsigned int firstX = (unsigned int)max(ceilf(gridX - gridRadius), 0.0f);
+	unsigned int firstZ = (unsigned int)max(ceilf(gridZ - gridRadius), 0.0f);
+	unsigned int endX = (unsigned int)min(floorf(gridX + gridRadius) + 1.0f, (float)_numberOfXPoints);
+	unsigned int endZ = (unsigned int)min(floorf(gridZ + gridRadius) + 1.0f, (float)_numberOfZPoints);
+	return EditHeights(firstX, firstZ, endX, endZ, [&](unsigned int sampleX, unsigned int sampleZ, float height)
+	{
+		float distance = sqrtf((sampleX - gridX) * (sampleX - gridX) + (sampleZ - gridZ) * (sampleZ - gridZ)) * _spacing;
+		return distance < radius ? edit(distance, height) : height;
+	});
+}
+
+bool TerrainNode::CreateCrater(float x, float z, float radius, float depth)
+{
+	return EditCircle(x, z, radius, [&](float distance, float height)
+	{
+		float t = distance / radius;
+		return height - depth * (1.0f - t * t);
+	});
+}
+
+bool TerrainNode::FlattenArea(float x, float z, float radius, float height)
+{
+	return EditCircle(x, z, radius, [&](float distance, float currentHeight)
+	{
+		// Fully flat out to three quarters of the radius, then a smooth blend back to the current height
+		float t = min(max((distance / radius - 0.75f) * 4.0f, 0.0f), 1.0f);
+		float weight = t * t * (3.0f - 2.0f * t);
+		return height + (currentHeight - height) * weight;
+	});
+}
+
+// Regenerates the grid vertices [firstX, endX) x [firstZ, endZ) and copies them into the vertex buffer,
+// one row of the area at a time
+void TerrainNode::UpdateVertices(unsigned int firstX, unsigned int firstZ, unsigned int endX, unsigned int endZ)
+{
+	unsigned int width = endX - firstX;
+	_editVertices.resize((size_t)width * (endZ - firstZ));
+	for (unsigned int z = firstZ; z < endZ; z++)
+	{
+		for (unsigned int x = firstX; x < endX; x++)
+		{
+			SetGridVertex(_editVertices[(size_t)(z - firstZ) * width + x - firstX], x, z);
+		}
+	}
+	CalculateHeightFieldNormalsInArea(&_heightValues[0], _numberOfXPoints, _numberOfZPoints, (float)_spacing, (float)_worldHeight,
+									  firstX, endX, firstZ, endZ, &_editVertices[0].Normal, sizeof(TerrainVertex), width * sizeof(TerrainVertex));
+
+	for (unsigned int z = firstZ; z < endZ; z++)
+	{
+		const TerrainVertex * rowVertices = &_editVertices[(size_t)(z - firstZ) * width];
+		UINT firstVertex = z * _numberOfXPoints + firstX;
+		if (!_vertices.empty())
+		{
+			// Keep the CPU copy in step if it hasn't been released
+			copy(rowVertices, rowVertices + width, _vertices.begin() + firstVertex);
+		}
+		UploadVertices(firstVertex, rowVertices, width);
+	}
+}
+
+// Moves the skirt vertices hanging from grid vertices [firstX, endX) x [firstZ, endZ) to follow them.
+// UpdateVertices must have been called for the same area first.
+void TerrainNode::UpdateSkirtVertices(unsigned int firstX, unsigned int firstZ, unsigned int endX, unsigned int endZ)
+{
+	UINT firstSkirtVertex = _numberOfXPoints * _numberOfZPoints;
+	unsigned int width = endX - firstX;
+	for (unsigned int z = firstZ; z < endZ; z++)
+	{
+		UINT rowStart = z * _numberOfXPoints;
+		auto skirt = lower_bound(_skirtOrder.begin(), _skirtOrder.end(), rowStart + firstX,
+								 [&](UINT skirtIndex, UINT source) { return _skirtVertices[skirtIndex].SourceVertex < source; });
+		for (; skirt != _skirtOrder.end() && _skirtVertices[*skirt].SourceVertex < rowStart + endX; skirt++)
+		{
+			const TerrainSkirtVertex& skirtVertex = _skirtVertices[*skirt];
+			TerrainVertex vertex = _editVertices[(size_t)(z - firstZ) * width + skirtVertex.SourceVertex - rowStart - firstX];
+			vertex.Position.y -= skirtVertex.Depth;
+			UINT vertexIndex = firstSkirtVertex + *skirt;
+			if (!_vertices.empty())
+			{
+				_vertices[vertexIndex] = vertex;
+			}
+			UploadVertices(vertexIndex, &vertex, 1);
+			_statistics.LastEditVertices++;
+		}
+	}
+}
+
+// Copies count vertices into the vertex buffer starting at firstVertex, packing them first if the buffer
+// holds compact vertices
+void TerrainNode::UploadVertices(UINT firstVertex, const TerrainVertex * vertices, UINT count)
+{
+	if (_vertexBuffer.Get() == nullptr)
+	{
+		return;
+	}
+	const void * data = vertices;
+	if (UseCompactVertices())
+	{
+		_compactVertices.resize(count);
+		EncodeTerrainVertices(vertices, count, _compactVertexParameters, &_compactVertices[0]);
+		data = &_compactVertices[0];
+	}
+	D3D11_BOX box = { firstVertex * GetVertexStride(), 0, 0, (firstVertex + count) * GetVertexStride(), 1, 1 };
+	_deviceContext->UpdateSubresource(_vertexBuffer.Get(), 0, &box, data, 0, 0);
+}
+
+void TerrainNode::UpdateBlendMap(unsigned int firstCellX, unsigned int firstCellZ, unsigned int endCellX, unsigned int endCellZ)
+{
+	unsigned int width = endCellX - firstCellX;
+	_editTexels.resize((size_t)width * (endCellZ - firstCellZ));
+	CalculateBlendMapTexels(&_heightValues[0], _numberOfXPoints, (float)_worldHeight, (float)_spacing, _slopeBlend,
+							firstCellX, endCellX, firstCellZ, endCellZ, &_editTexels[0], width);
+	if (!_blendMap.empty())
+	{
+		for (unsigned int z = firstCellZ; z < endCellZ; z++)
+		{
+			copy(_editTexels.begin() + (size_t)(z - firstCellZ) * width, _editTexels.begin() + (size_t)(z - firstCellZ + 1) * width,
+				 _blendMap.begin() + (size_t)z * _numberOfColumns + firstCellX);
+		}
+		UpdateBlendMapMips(firstCellX, firstCellZ, endCellX, endCellZ);
+	}
+	if (_blendMapTexture.Get() != nullptr)
+	{
+		D3D11_BOX box = { firstCellX, firstCellZ, 0, endCellX, endCellZ, 1 };
+		_deviceContext->UpdateSubresource(_blendMapTexture.Get(), 0, &box, &_editTexels[0], width * sizeof(DWORD), 0);
+	}
 }
 
-void TerrainNode::AddToVertexNormal(int z, int x, unsigned int vertexNumber, XMVECTOR normal)
+// Recalculates the texels of each mip level that are affected by a change to texels
+// [firstX, endX) x [firstZ, endZ) of the blend map
+void TerrainNode::UpdateBlendMapMips(unsigned int firstX, unsigned int firstZ, unsigned int endX, unsigned int endZ)
 {
-	if (z > 0 && x > 0 && z < (int)_numberOfRows && x < (int)_numberOfColumns)
+	const DWORD * source = &_blendMap[0];
+	unsigned int sourceWidth = _numberOfColumns;
+	unsigned int sourceHeight = _numberOfRows;
+	for (unsigned int level = 1; level <= (unsigned int)_blendMapMips.size(); level++)
 	{
-		unsigned int vertexIndex = (z * _numberOfColumns + x) * 4 + vertexNumber;
-		XMStoreFloat3(&_vertices[vertexIndex].Normal, XMVectorAdd(XMLoadFloat3(&_vertices[vertexIndex].Normal), normal));
+		vector<DWORD>& mip = _blendMapMips[level - 1];
+		unsigned int width = GetMipSize(_numberOfColumns, level);
+		unsigned int height = GetMipSize(_numberOfRows, level);
+		firstX /= 2;
+		firstZ /= 2;
+		endX = min((endX + 1) / 2, width);
+		endZ = min((endZ + 1) / 2, height);
+		if (firstX >= endX || firstZ >= endZ)
+		{
+			// Only texels that the next level down doesn't use were changed
+			return;
+		}
+		DownsampleTexels(source, sourceWidth, sourceHeight, &mip[0], firstX, firstZ, endX, endZ);
+		if (_blendMapTexture.Get() != nullptr)
+		{
+			D3D11_BOX box = { firstX, firstZ, 0, endX, endZ, 1 };
+			_deviceContext->UpdateSubresource(_blendMapTexture.Get(), level, &box, &mip[(size_t)firstZ * width + firstX], width * sizeof(DWORD), 0);
+		}
+		source = &mip[0];
+		sourceWidth = width;
+		sourceHeight = height;
 	}
 }
 
-void TerrainNode::GenerateVerticesAndIndices()
+// Works out where the terrain lies.  It is centred on the origin.
+void TerrainNode::CalculateTerrainExtents()
 {
-	_numberOfIndices = _numberOfPolygons * 3;
-
 	float width = (float)(_numberOfXPoints * _spacing);
 	float depth = (float)(_numberOfZPoints * _spacing);
 
-	float xOffset = width * -0.5f;
-	float zOffset = depth * 0.5f;
+	_terrainStartX = width * -0.5f;
+	_terrainStartZ = depth * 0.5f;
+	_terrainEndX = _terrainStartX + width - 1;
+	_terrainEndZ = _terrainStartZ - depth + 1;
+}
+
+// The grid from the top of the height pyramid, which has the range of the whole terrain.  Skirts hang
+// below the lowest point by no more than the height range (or a cell when the terrain is flat).
+void TerrainNode::CalculateBounds()
+{
+	if (_heightPyramid.GetLevelCount() == 0)
+	{
+		return;
+	}
+	const TerrainHeightRange& range = _heightPyramid.GetRange(_heightPyramid.GetLevelCount() - 1, 0, 0);
+	float minimumHeight = range.Minimum * _worldHeight;
+	float maximumHeight = range.Maximum * _worldHeight;
+	if (UseLevelOfDetail())
+	{
+		minimumHeight -= max(maximumHeight - minimumHeight, (float)_spacing);
+	}
+	XMFLOAT2 gridOrigin = GetGridOrigin();
+	XMFLOAT3 minimum(gridOrigin.x, minimumHeight, gridOrigin.y - (float)((_numberOfZPoints - 1) * _spacing));
+	XMFLOAT3 maximum(gridOrigin.x + (float)((_numberOfXPoints - 1) * _spacing), maximumHeight, gridOrigin.y);
+	SetLocalBounds(SceneBounds::FromBox(minimum, maximum));
+}
 
-	_terrainStartX = xOffset;
-	_terrainStartZ = zOffset;
-	_terrainEndX = xOffset + width - 1;
-	_terrainEndZ = zOffset - depth + 1;
+void TerrainNode::GenerateVerticesAndIndices()
+{
+	float xOffset = _terrainStartX;
+	float zOffset = _terrainStartZ;
 
 	float du = 1.0f / (_numberOfXPoints - 1);
 	float dv = 1.0f / (_numberOfZPoints - 1);
 
-	unsigned int vertexIndex = 0;
-
-	for (int z = 0; z < _numberOfRows; z++)
-	{
-		for (int x = 0; x < _numberOfColumns; x++)
-		{
-			float startUV = (float)(rand() % 50) / 100.0f;
-			float endUV = startUV + 0.2f + (float)(rand() % 30) / 100.0f;
-			// Top left corner vertex
-			TerrainVertex vertex;
-			vertex.Position = XMFLOAT3(x * _spacing + xOffset, _heightValues[z * _numberOfXPoints + x] * _worldHeight, (-z + 1) * _spacing + zOffset);
-			vertex.Normal = XMFLOAT3(0.0f, 0.0f, 0.0f);
-			vertex.TexCoord = XMFLOAT2(startUV, endUV);
-			vertex.BlendMapTexCoord = XMFLOAT2(du * x, dv * z);
-			_vertices.push_back(vertex);
-
-			// Top right corner vertex
-			vertex.Position = XMFLOAT3((x + 1) * _spacing + xOffset, _heightValues[z * _numberOfXPoints + (x + 1)] * _worldHeight, (-z + 1) * _spacing + zOffset);
-			vertex.Normal = XMFLOAT3(0.0f, 0.0f, 0.0f);
-			vertex.TexCoord = XMFLOAT2(endUV, endUV);
-			vertex.BlendMapTexCoord = XMFLOAT2(du * (x + 1), dv * z);
-			_vertices.push_back(vertex);
-
-			// Bottom left corner vertex
-			vertex.Position = XMFLOAT3(x * _spacing + xOffset, _heightValues[(z + 1) * _numberOfXPoints + x] * _worldHeight, -z * _spacing + zOffset);
-			vertex.Normal = XMFLOAT3(0.0f, 0.0f, 0.0f);
-			vertex.TexCoord = XMFLOAT2(startUV, startUV);
-			vertex.BlendMapTexCoord = XMFLOAT2(du * x, dv * (z + 1));
-			_vertices.push_back(vertex);
-
-			// Bottom right corner vertex
-			vertex.Position = XMFLOAT3((x + 1) * _spacing + xOffset, _heightValues[(z + 1) * _numberOfXPoints + (x + 1)] * _worldHeight, -z * _spacing + zOffset);
-			vertex.Normal = XMFLOAT3(0.0f, 0.0f, 0.0f);
-			vertex.TexCoord = XMFLOAT2(endUV, startUV);
-			vertex.BlendMapTexCoord = XMFLOAT2(du * (x + 1), dv * (z + 1));
-			_vertices.push_back(vertex);
-			
+	if (_vertexLayout == TerrainVertexLayout::SharedGrid)
+	{
+		GenerateSharedGridVerticesAndIndices(xOffset, zOffset, du, dv);
+	}
+	else
+	{
+		GeneratePerCellVerticesAndIndices(xOffset, zOffset, du, dv);
+	}
+}
+
+void TerrainNode::GeneratePerCellVerticesAndIndices(float xOffset, float zOffset, float du, float dv)
+{
+	_vertices.resize(_numberOfVertices);
+	_indices.resize(_numberOfIndices);
+
+	// Each band of rows writes only to its own cells' vertices and indices.  A cell's vertices are
+	// copies of the shared grid vertices at its corners.
+	ForEachRowBand(_numberOfRows, [&](unsigned int firstRow, unsigned int endRow)
+	{
+		for (int z = (int)firstRow; z < (int)endRow; z++)
+		{
+			for (int x = 0; x < _numberOfColumns; x++)
+			{
+				unsigned int cell = z * _numberOfColumns + x;
+				unsigned int vertexIndex = cell * 4;
+				SetGridVertex(_vertices[vertexIndex], x, z);				// Top left
+				SetGridVertex(_vertices[vertexIndex + 1], x + 1, z);		// Top right
+				SetGridVertex(_vertices[vertexIndex + 2], x, z + 1);		// Bottom left
+				SetGridVertex(_vertices[vertexIndex + 3], x + 1, z + 1);	// Bottom right
+
+				UINT* indices = &_indices[cell * 6];
+				// First triangle
+				indices[0] = vertexIndex;
+				indices[1] = vertexIndex + 1;
+				indices[2] = vertexIndex + 2;
+				// Second triangle
+				indices[3] = vertexIndex + 2;
+				indices[4] = vertexIndex + 1;
+				indices[5] = vertexIndex + 3;
+			}
+		}
+	});
+}
+
+void TerrainNode::GenerateSharedGridVerticesAndIndices(float xOffset, float zOffset, float du, float dv)
+{
+	_vertices.resize(_numberOfVertices);
+	_indices.resize(_numberOfIndices);
+
+	// One vertex per height sample
+	ForEachRowBand(_numberOfZPoints, [&](unsigned int firstRow, unsigned int endRow)
+	{
+		for (unsigned int z = firstRow; z < endRow; z++)
+		{
+			for (unsigned int x = 0; x < _numberOfXPoints; x++)
+			{
+				SetGridVertex(_vertices[z * _numberOfXPoints + x], x, z);
+			}
+		}
+	});
+
+	// Two triangles per cell using the same winding as the per-cell layout, with the cells in the chosen order
+	vector<UINT> cellOrder;
+	CalculateCellOrder(_indexOrder, _numberOfColumns, _numberOfRows, cellOrder);
+	ForEachRowBand(_numberOfRows, [&](unsigned int firstRow, unsigned int endRow)
+	{
+		for (unsigned int position = firstRow * _numberOfColumns; position < endRow * _numberOfColumns; position++)
+		{
+			unsigned int z = cellOrder[position] / _numberOfColumns;
+			unsigned int x = cellOrder[position] % _numberOfColumns;
+			unsigned int topLeft = z * _numberOfXPoints + x;
+			unsigned int topRight = topLeft + 1;
+			unsigned int bottomLeft = topLeft + _numberOfXPoints;
+			unsigned int bottomRight = bottomLeft + 1;
+
+			UINT* indices = &_indices[position * 6];
 			// First triangle
-			_indices.push_back(vertexIndex);
-			_indices.push_back(vertexIndex + 1);
-			_indices.push_back(vertexIndex + 2);
+			indices[0] = topLeft;
+			indices[1] = topRight;
+			indices[2] = bottomLeft;
 			// Second triangle
-			_indices.push_back(vertexIndex + 2);
-			_indices.push_back(vertexIndex + 1);
-			_indices.push_back(vertexIndex + 3);
-			vertexIndex = vertexIndex + 4;
+			indices[3] = bottomLeft;
+			indices[4] = topRight;
+			indices[5] = bottomRight;
 		}
-	}
+	});
+}
+
+// Sets up the vertex for column x, row z of the grid (apart from its normal)
+void TerrainNode::SetGridVertex(TerrainVertex& vertex, unsigned int x, unsigned int z)
+{
+	float du = 1.0f / (_numberOfXPoints - 1);
+	float dv = 1.0f / (_numberOfZPoints - 1);
+	vertex.Position = XMFLOAT3(x * _spacing + _terrainStartX, _heightValues[z * _numberOfXPoints + x] * _worldHeight, (-(int)z + 1) * _spacing + _terrainStartZ);
+	vertex.Normal = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	vertex.TexCoord = XMFLOAT2(x * DetailTiling, z * DetailTiling);
+	vertex.BlendMapTexCoord = XMFLOAT2(du * x, dv * z);
 }
 
 void TerrainNode::GenerateNormals()
 {
-	unsigned int vertexIndex = 0;
-
-	for (int z = 0; z < _numberOfRows; z++)
-	{
-		for (int x = 0; x < _numberOfColumns; x++)
-		{
-			int index0 = vertexIndex;
-			int index1 = vertexIndex + 1;
-			int index2 = vertexIndex + 2;
-			int index3 = vertexIndex + 3;
-			vertexIndex = vertexIndex + 4;
-
-			XMVECTOR u = XMVectorSet(_vertices[index1].Position.x - _vertices[index0].Position.x,
-									 _vertices[index1].Position.y - _vertices[index0].Position.y,
-									 _vertices[index1].Position.z - _vertices[index0].Position.z,
-									 0.0f);
-			XMVECTOR v = XMVectorSet(_vertices[index2].Position.x - _vertices[index0].Position.x,
-									 _vertices[index2].Position.y - _vertices[index0].Position.y,
-									 _vertices[index2].Position.z - _vertices[index0].Position.z,
-									 0.0f);
-			XMVECTOR normal = XMVector3Normalize(XMVector3Cross(u, v));
-
-			XMStoreFloat3(&_vertices[index0].Normal, XMVectorAdd(XMLoadFloat3(&_vertices[index0].Normal), normal));
-			XMStoreFloat3(&_vertices[index1].Normal, XMVectorAdd(XMLoadFloat3(&_vertices[index1].Normal), normal));
-			XMStoreFloat3(&_vertices[index2].Normal, XMVectorAdd(XMLoadFloat3(&_vertices[index2].Normal), normal));
-			XMStoreFloat3(&_vertices[index3].Normal, XMVectorAdd(XMLoadFloat3(&_vertices[index3].Normal), normal));
-
-			AddToVertexNormal(z - 1, x - 1, 3, normal);
-			AddToVertexNormal(z - 1, x, 2, normal);
-			AddToVertexNormal(z - 1, x, 3, normal);
-			AddToVertexNormal(z - 1, x + 1, 2, normal);
-			AddToVertexNormal(z, x - 1, 1, normal);
-			AddToVertexNormal(z, x - 1, 3, normal);
-			AddToVertexNormal(z, x + 1, 0, normal);
-			AddToVertexNormal(z, x + 1, 2, normal);
-			AddToVertexNormal(z + 1, x - 1, 1, normal);
-			AddToVertexNormal(z + 1, x, 0, normal);
-			AddToVertexNormal(z + 1, x, 1, normal);
-			AddToVertexNormal(z + 1, x + 1, 0, normal);
+	if (_normalMethod == TerrainNormalMethod::CentralDifference)
+	{
+		GenerateCentralDifferenceNormals();
+		return;
+	}
+
+	// Normals are generated in two passes so that rows can be processed in parallel.
+	// The first pass works out the normal of every cell.  The second gathers, for each
+	// vertex, the normals of the cells that share it in row-major cell order, which is the
+	// order a single threaded scatter would add them in.
+	vector<XMFLOAT3> cellNormals(_numberOfRows * _numberOfColumns);
+	ForEachRowBand(_numberOfRows, [&](unsigned int firstRow, unsigned int endRow)
+	{
+		for (unsigned int z = firstRow; z < endRow; z++)
+		{
+			for (unsigned int x = 0; x < (unsigned int)_numberOfColumns; x++)
+			{
+				unsigned int index0 = GetCellVertexIndex(z, x);
+				unsigned int index1 = index0 + 1;
+				unsigned int index2 = _vertexLayout == TerrainVertexLayout::SharedGrid ? index0 + _numberOfXPoints : index0 + 2;
+
+				XMVECTOR u = XMVectorSet(_vertices[index1].Position.x - _vertices[index0].Position.x,
+										 _vertices[index1].Position.y - _vertices[index0].Position.y,
+										 _vertices[index1].Position.z - _vertices[index0].Position.z,
+										 0.0f);
+				XMVECTOR v = XMVectorSet(_vertices[index2].Position.x - _vertices[index0].Position.x,
+										 _vertices[index2].Position.y - _vertices[index0].Position.y,
+										 _vertices[index2].Position.z - _vertices[index0].Position.z,
+										 0.0f);
+				XMStoreFloat3(&cellNormals[z * _numberOfColumns + x], XMVector3Normalize(XMVector3Cross(u, v)));
+			}
+		}
+	});
+
+	if (_vertexLayout == TerrainVertexLayout::SharedGrid)
+	{
+		ForEachRowBand(_numberOfZPoints, [&](unsigned int firstRow, unsigned int endRow)
+		{
+			for (unsigned int z = firstRow; z < endRow; z++)
+			{
+				for (unsigned int x = 0; x < _numberOfXPoints; x++)
+				{
+					_vertices[z * _numberOfXPoints + x].Normal = GatherVertexNormal(cellNormals, z, x, -1, -1);
+				}
+			}
+		});
+	}
+	else
+	{
+		ForEachRowBand(_numberOfRows, [&](unsigned int firstRow, unsigned int endRow)
+		{
+			for (unsigned int z = firstRow; z < endRow; z++)
+			{
+				for (unsigned int x = 0; x < (unsigned int)_numberOfColumns; x++)
+				{
+					unsigned int vertexIndex = (z * _numberOfColumns + x) * 4;
+					_vertices[vertexIndex].Normal = GatherVertexNormal(cellNormals, z, x, z, x);
+					_vertices[vertexIndex + 1].Normal = GatherVertexNormal(cellNormals, z, x + 1, z, x);
+					_vertices[vertexIndex + 2].Normal = GatherVertexNormal(cellNormals, z + 1, x, z, x);
+					_vertices[vertexIndex + 3].Normal = GatherVertexNormal(cellNormals, z + 1, x + 1, z, x);
+				}
+			}
+		});
+	}
+}
+
+void TerrainNode::GenerateCentralDifferenceNormals()
+{
+	if (_vertexLayout == TerrainVertexLayout::SharedGrid)
+	{
+		// Write straight into the vertices
+		ForEachRowBand(_numberOfZPoints, [&](unsigned int firstRow, unsigned int endRow)
+		{
+			CalculateHeightFieldNormals(&_heightValues[0], _numberOfXPoints, _numberOfZPoints, (float)_spacing, (float)_worldHeight,
+										firstRow, endRow, &_vertices[0].Normal, sizeof(TerrainVertex));
+		});
+		return;
+	}
+
+	// Calculate one normal per grid point, then copy it to each cell's copy of the vertex
+	vector<XMFLOAT3> gridNormals(_numberOfXPoints * _numberOfZPoints);
+	ForEachRowBand(_numberOfZPoints, [&](unsigned int firstRow, unsigned int endRow)
+	{
+		CalculateHeightFieldNormals(&_heightValues[0], _numberOfXPoints, _numberOfZPoints, (float)_spacing, (float)_worldHeight,
+									firstRow, endRow, &gridNormals[0], sizeof(XMFLOAT3));
+	});
+	ForEachRowBand(_numberOfRows, [&](unsigned int firstRow, unsigned int endRow)
+	{
+		for (unsigned int z = firstRow; z < endRow; z++)
+		{
+			for (unsigned int x = 0; x < (unsigned int)_numberOfColumns; x++)
+			{
+				unsigned int vertexIndex = (z * _numberOfColumns + x) * 4;
+				unsigned int gridIndex = z * _numberOfXPoints + x;
+				_vertices[vertexIndex].Normal = gridNormals[gridIndex];
+				_vertices[vertexIndex + 1].Normal = gridNormals[gridIndex + 1];
+				_vertices[vertexIndex + 2].Normal = gridNormals[gridIndex + _numberOfXPoints];
+				_vertices[vertexIndex + 3].Normal = gridNormals[gridIndex + _numberOfXPoints + 1];
+			}
+		}
+	});
+}
+
+// Returns the normalised sum of the normals of the cells surrounding grid point (z, x).
+// For the per-cell layout, owner is the cell that holds the copy of the vertex.  Copies in
+// the first row and column and the last row and column of cells only take their own
+// cell's normal, matching the edge handling of the original scatter.
+XMFLOAT3 TerrainNode::GatherVertexNormal(const vector<XMFLOAT3>& cellNormals, unsigned int z, unsigned int x, int ownerZ, int ownerX)
+{
+	bool sharesNormals = ownerZ == -1 || (ownerZ > 0 && ownerX > 0 && ownerZ < _numberOfRows && ownerX < _numberOfColumns);
+	XMFLOAT3 sum = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	for (int cellZ = (int)z - 1; cellZ <= (int)z; cellZ++)
+	{
+		for (int cellX = (int)x - 1; cellX <= (int)x; cellX++)
+		{
+			if (cellZ < 0 || cellX < 0 || cellZ >= _numberOfRows || cellX >= _numberOfColumns)
+			{
+				continue;
+			}
+			if (sharesNormals || (cellZ == ownerZ && cellX == ownerX))
+			{
+				XMStoreFloat3(&sum, XMVectorAdd(XMLoadFloat3(&sum), XMLoadFloat3(&cellNormals[cellZ * _numberOfColumns + cellX])));
+			}
 		}
 	}
+	XMFLOAT3 normal;
+	XMStoreFloat3(&normal, XMVector3Normalize(XMLoadFloat3(&sum)));
+	return normal;
+}
 
-	// Normalise vertex normals
+// The compact vertices hold their heights as a fraction of the range from the bottom of the lowest skirt
+// to the top of the terrain.  If the terrain can be edited, any sample could end up at height 0, so
+// the range has to reach the deepest skirt below that.
+void TerrainNode::CalculateCompactVertexParameters()
+{
+	float minimumHeight = 0.0f;
 	for (unsigned int i = 0; i < _numberOfVertices; i++)
 	{
-		XMVECTOR vertexNormal = XMLoadFloat3(&_vertices[i].Normal);
-		XMStoreFloat3(&_vertices[i].Normal, XMVector3Normalize(vertexNormal));
+		minimumHeight = min(minimumHeight, _vertexData[i].Position.y);
+	}
+	for (size_t i = 0; i < _skirtVertices.size(); i++)
+	{
+		minimumHeight = min(minimumHeight, -_skirtVertices[i].Depth);
 	}
+	XMFLOAT2 gridOrigin = GetGridOrigin();
+	_compactVertexParameters.StartX = gridOrigin.x;
+	_compactVertexParameters.StartZ = gridOrigin.y;
+	_compactVertexParameters.Spacing = (float)_spacing;
+	_compactVertexParameters.DetailTiling = DetailTiling;
+	_compactVertexParameters.MinimumHeight = minimumHeight;
+	_compactVertexParameters.HeightRange = _worldHeight - minimumHeight;
+	_compactVertexParameters.BlendMapDu = 1.0f / (_numberOfXPoints - 1);
+	_compactVertexParameters.BlendMapDv = 1.0f / (_numberOfZPoints - 1);
 }
 
 void TerrainNode::GenerateBuffers()
 {
+	const void * vertexData = _vertexData; // Either the generated vertices or the cache
+	if (UseCompactVertices())
+	{
+		CalculateCompactVertexParameters();
+		_compactVertices.resize(_numberOfVertices);
+		ForEachRowBand(_numberOfZPoints, [&](unsigned int firstRow, unsigned int endRow)
+		{
+			// The skirt vertices after the grid go with the last band
+			size_t first = (size_t)firstRow * _numberOfXPoints;
+			size_t end = endRow == _numberOfZPoints ? _numberOfVertices : (size_t)endRow * _numberOfXPoints;
+			EncodeTerrainVertices(_vertexData + first, end - first, _compactVertexParameters, &_compactVertices[first]);
+		});
+		_statistics.CompactVertexError = MeasureCompactVertexError(_vertexData, &_compactVertices[0], _numberOfVertices, _compactVertexParameters);
+		vertexData = &_compactVertices[0];
+	}
+
+	// Estimate how often a vertex has to be fetched from a sample of the triangles
+	unsigned int sampleIndices = min(_numberOfBufferIndices, (unsigned int)(3 * 65536));
+	_transformsPerTriangle = SimulateVertexCache(_indexData, sampleIndices, 32, VertexCachePolicy::Fifo).AverageCacheMissRatio;
+
 	D3D11_BUFFER_DESC vertexBufferDescriptor;
-	vertexBufferDescriptor.Usage = D3D11_USAGE_IMMUTABLE;
-	vertexBufferDescriptor.ByteWidth = sizeof(VERTEX) * _numberOfVertices; // Changed to variable
+	vertexBufferDescriptor.Usage = UseEditing() ? D3D11_USAGE_DEFAULT : D3D11_USAGE_IMMUTABLE; // Edits are copied in with UpdateSubresource
+	vertexBufferDescriptor.ByteWidth = GetVertexStride() * _numberOfVertices; // Changed to variable
 	vertexBufferDescriptor.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 	vertexBufferDescriptor.CPUAccessFlags = 0;
 	vertexBufferDescriptor.MiscFlags = 0;
@@ -232,15 +1236,16 @@ void TerrainNode::GenerateBuffers()
 	// Now set up a structure that tells DirectX where to get the
 	// data for the vertices from
 	D3D11_SUBRESOURCE_DATA vertexInitialisationData;
-	vertexInitialisationData.pSysMem = &_vertices[0]; // From vector, values set in GenerateVerticesAndIndices
+	vertexInitialisationData.pSysMem = vertexData;
 
 	// and create the vertex buffer
 	ThrowIfFailed(_device->CreateBuffer(&vertexBufferDescriptor, &vertexInitialisationData, _vertexBuffer.GetAddressOf()));
+	vector<TerrainCompactVertex>().swap(_compactVertices);
 
 	D3D11_BUFFER_DESC indexBufferDescriptor;
 	indexBufferDescriptor.Usage = D3D11_USAGE_IMMUTABLE;
-	indexBufferDescriptor.ByteWidth = sizeof(UINT) * _numberOfIndices; // Changed to variable
-	indexBufferDescriptor.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	indexBufferDescriptor.ByteWidth = sizeof(UINT) * _numberOfBufferIndices;
+	indexBufferDescriptor.BindFlags = D3D11_BIND_INDEX_BUFFER;
 	indexBufferDescriptor.CPUAccessFlags = 0;
 	indexBufferDescriptor.MiscFlags = 0;
 	indexBufferDescriptor.StructureByteStride = 0;
@@ -248,7 +1253,7 @@ void TerrainNode::GenerateBuffers()
 	// Now set up a structure that tells DirectX where to get the
 	// data for the vertices from
 	D3D11_SUBRESOURCE_DATA indexInitialisationData;
-	indexInitialisationData.pSysMem = &_indices[0]; // From vector, values set in GenerateVerticesAndIndices
+	indexInitialisationData.pSysMem = _indexData;
 
 	// and create the vertex buffer
 	ThrowIfFailed(_device->CreateBuffer(&indexBufferDescriptor, &indexInitialisationData, _indexBuffer.GetAddressOf()));
@@ -266,7 +1271,7 @@ void TerrainNode::BuildShaders() // Taken from MeshRenderer
 	//Compile vertex shader
 	HRESULT hr = D3DCompileFromFile(L"TerrainShaders.hlsl",
 									nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-									"VShader", "vs_5_0",
+									UseCompactVertices() ? "VShaderCompact" : "VShader", "vs_5_0",
 									shaderCompileFlags, 0,
 									_vertexShaderByteCode.GetAddressOf(),
 									compilationMessages.GetAddressOf());
@@ -309,6 +1314,20 @@ void TerrainNode::BuildVertexLayout() // Taken from MeshRenderer
 		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_VERTEX_DATA, 0 },
 		{ "TEXCOORD", 1, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_VERTEX_DATA, 0 }
 	};
+
+	// See TerrainCompactVertex
+	D3D11_INPUT_ELEMENT_DESC compactVertexDesc[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16_UINT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "POSITION", 1, DXGI_FORMAT_R16_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R8G8_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_VERTEX_DATA, 0 }
+	};
+	if (UseCompactVertices())
+	{
+		ThrowIfFailed(_device->CreateInputLayout(compactVertexDesc, ARRAYSIZE(compactVertexDesc), _vertexShaderByteCode->GetBufferPointer(), _vertexShaderByteCode->GetBufferSize(), _layout.GetAddressOf()));
+		return;
+	}
 	ThrowIfFailed(_device->CreateInputLayout(vertexDesc, ARRAYSIZE(vertexDesc), _vertexShaderByteCode->GetBufferPointer(), _vertexShaderByteCode->GetBufferSize(), _layout.GetAddressOf()));
 }
 
@@ -342,7 +1361,7 @@ void TerrainNode::BuildRendererStates()
 	ThrowIfFailed(_device->CreateRasterizerState(&rasteriserDesc, _wireframeRasteriserState.GetAddressOf()));
 }
 
-void TerrainNode::LoadTerrainTextures()
+ComPtr<ID3D11ShaderResourceView> TerrainNode::LoadDetailTextures(ID3D11Device * device, ID3D11DeviceContext * deviceContext, size_t& bytes)
 {
 	// Change the paths below as appropriate for your use
 	wstring terrainTextureNames[5] = { L"terrain\\grass.dds", L"terrain\\darkdirt.dds", L"terrain\\stone.dds", L"terrain\\lightdirt.dds", L"terrain\\snow.dds" };
@@ -351,8 +1370,8 @@ void TerrainNode::LoadTerrainTextures()
 	ComPtr<ID3D11Resource> terrainTextures[5];
 	for (int i = 0; i < 5; i++)
 	{
-		ThrowIfFailed(CreateDDSTextureFromFileEx(_device.Get(),
-												 _deviceContext.Get(),
+		ThrowIfFailed(CreateDDSTextureFromFileEx(device,
+												 deviceContext,
 												 terrainTextureNames[i].c_str(),
 												 0,
 												 D3D11_USAGE_IMMUTABLE,
@@ -386,7 +1405,8 @@ void TerrainNode::LoadTerrainTextures()
 	textureArrayDescription.MiscFlags = 0;
 
 	ComPtr<ID3D11Texture2D> textureArray = 0;
-	ThrowIfFailed(_device->CreateTexture2D(&textureArrayDescription, 0, textureArray.GetAddressOf()));
+	ThrowIfFailed(device->CreateTexture2D(&textureArrayDescription, 0, textureArray.GetAddressOf()));
+	bytes = GetTextureBytes(textureArrayDescription);
 
 	// Copy individual texture elements into texture array.
 
@@ -395,14 +1415,14 @@ void TerrainNode::LoadTerrainTextures()
 		// For each mipmap level...
 		for (UINT mipLevel = 0; mipLevel < textureDescription.MipLevels; mipLevel++)
 		{
-			_deviceContext->CopySubresourceRegion(textureArray.Get(),
-												  D3D11CalcSubresource(mipLevel, i, textureDescription.MipLevels),
-												  NULL,
-												  NULL,
-												  NULL,
-												  terrainTextures[i].Get(),
-												  mipLevel,
-												  nullptr
+			deviceContext->CopySubresourceRegion(textureArray.Get(),
+												 D3D11CalcSubresource(mipLevel, i, textureDescription.MipLevels),
+												 NULL,
+												 NULL,
+												 NULL,
+												 terrainTextures[i].Get(),
+												 mipLevel,
+												 nullptr
 			);
 		}
 	}
@@ -416,65 +1436,61 @@ void TerrainNode::LoadTerrainTextures()
 	viewDescription.Texture2DArray.FirstArraySlice = 0;
 	viewDescription.Texture2DArray.ArraySize = 5;
 
-	ThrowIfFailed(_device->CreateShaderResourceView(textureArray.Get(), &viewDescription, _texturesResourceView.GetAddressOf()));
+	ComPtr<ID3D11ShaderResourceView> resourceView;
+	ThrowIfFailed(device->CreateShaderResourceView(textureArray.Get(), &viewDescription, resourceView.GetAddressOf()));
+	return resourceView;
 }
 
 void TerrainNode::GenerateBlendMap()
 {
-	// Note that _numberOfRows and _numberOfColumns need to be setup
-	// to the number of rows and columns in your grid in order for this
-	// to work.
-	DWORD* blendMap = new DWORD[_numberOfRows * _numberOfColumns];
-	DWORD* blendMapPtr = blendMap;
-	BYTE r;
-	BYTE g;
-	BYTE b;
-	BYTE a;
-
-	DWORD index = 0;
-	for (DWORD i = 0; i < _numberOfColumns; i++)
-	{
-		for (DWORD j = 0; j < _numberOfRows; j++)
-		{
-			r = 0;
-			g = 0;
-			b = 0;
-			a = 0;
-			
-			// Calculates the appropriate blend colour for the current location in the blend map.
-			float y = 0.0f;
-			for (int k = 0; k < 6; k++)
-			{
-				y += _vertices[_indices[index]].Position.y;
-				index++;
-			}		
-			y = y / 6.0f;
+	_blendMap.resize(_numberOfRows * _numberOfColumns);
 
-			if (y < 200.0f)
-			{
-				b = (BYTE)200.0f - y;
-				r = 200 - b;
-			}
-			if (y >= 200.0f && y <= 400.0f)
-			{
-				r = (BYTE)(-y + 400.0f);
-			}
-			if (y >= 650.0f)
-			{
-				if (y < 900.0f)
-				{
-					g = (BYTE)(y - 650);
-				}
-			}
+	// Each texel only depends on its own cell, so bands of rows can be filled in parallel
+	ForEachRowBand(_numberOfRows, [&](unsigned int firstRow, unsigned int endRow)
+	{
+		CalculateBlendMapTexels(&_heightValues[0], _numberOfXPoints, (float)_worldHeight, (float)_spacing, _slopeBlend,
+								0, _numberOfColumns, firstRow, endRow, &_blendMap[(size_t)firstRow * _numberOfColumns], _numberOfColumns);
+	});
+}
 
-			DWORD mapValue = (a << 24) + (b << 16) + (g << 8) + r;
-			*blendMapPtr++ = mapValue;
-		}
+// Builds every mip level below the blend map by averaging 2 x 2 blocks of the level above
+void TerrainNode::BuildBlendMapMips()
+{
+	unsigned int numberOfLevels = CalculateMipLevelCount(_numberOfColumns, _numberOfRows);
+	_blendMapMips.resize(numberOfLevels - 1);
+	const DWORD * source = _blendMapData;
+	unsigned int sourceWidth = _numberOfColumns;
+	unsigned int sourceHeight = _numberOfRows;
+	for (unsigned int level = 1; level < numberOfLevels; level++)
+	{
+		vector<DWORD>& mip = _blendMapMips[level - 1];
+		unsigned int width = GetMipSize(_numberOfColumns, level);
+		unsigned int height = GetMipSize(_numberOfRows, level);
+		mip.resize((size_t)width * height);
+		ForEachRowBand(height, [&](unsigned int firstRow, unsigned int endRow)
+		{
+			DownsampleTexels(source, sourceWidth, sourceHeight, &mip[0], 0, firstRow, width, endRow);
+		});
+		source = &mip[0];
+		sourceWidth = width;
+		sourceHeight = height;
+	}
+}
+
+void TerrainNode::BuildBlendMapTexture()
+{
+	if (UseEditing() && _blendMap.empty())
+	{
+		// Edits update the mips from a copy of the blend map, so take one if it came from the cache
+		_blendMap.assign(_blendMapData, _blendMapData + (size_t)_numberOfRows * _numberOfColumns);
+		_blendMapData = &_blendMap[0];
 	}
+	BuildBlendMapMips();
+
 	D3D11_TEXTURE2D_DESC blendMapDescription;
-	blendMapDescription.Width = _numberOfRows;
-	blendMapDescription.Height = _numberOfColumns;
-	blendMapDescription.MipLevels = 1;
+	blendMapDescription.Width = _numberOfColumns;
+	blendMapDescription.Height = _numberOfRows;
+	blendMapDescription.MipLevels = (UINT)_blendMapMips.size() + 1;
 	blendMapDescription.ArraySize = 1;
 	blendMapDescription.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
 	blendMapDescription.SampleDesc.Count = 1;
@@ -484,83 +1500,466 @@ void TerrainNode::GenerateBlendMap()
 	blendMapDescription.CPUAccessFlags = 0;
 	blendMapDescription.MiscFlags = 0;
 
-	D3D11_SUBRESOURCE_DATA blendMapInitialisationData;
-	blendMapInitialisationData.pSysMem = blendMap;
-	blendMapInitialisationData.SysMemPitch = 4 * _numberOfColumns;
+	vector<D3D11_SUBRESOURCE_DATA> blendMapInitialisationData(blendMapDescription.MipLevels);
+	blendMapInitialisationData[0].pSysMem = _blendMapData;
+	blendMapInitialisationData[0].SysMemPitch = 4 * _numberOfColumns;
+	blendMapInitialisationData[0].SysMemSlicePitch = 0;
+	for (UINT level = 1; level < blendMapDescription.MipLevels; level++)
+	{
+		blendMapInitialisationData[level].pSysMem = &_blendMapMips[level - 1][0];
+		blendMapInitialisationData[level].SysMemPitch = 4 * GetMipSize(_numberOfColumns, level);
+		blendMapInitialisationData[level].SysMemSlicePitch = 0;
+	}
 
-	ComPtr<ID3D11Texture2D> blendMapTexture;
-	ThrowIfFailed(_device->CreateTexture2D(&blendMapDescription, &blendMapInitialisationData, blendMapTexture.GetAddressOf()));
+	ThrowIfFailed(_device->CreateTexture2D(&blendMapDescription, &blendMapInitialisationData[0], _blendMapTexture.GetAddressOf()));
+	_statistics.TextureBytes += GetTextureBytes(blendMapDescription);
 
 	// Create a resource view to the texture array.
 	D3D11_SHADER_RESOURCE_VIEW_DESC viewDescription;
 	viewDescription.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
 	viewDescription.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
 	viewDescription.Texture2D.MostDetailedMip = 0;
+	viewDescription.Texture2D.MipLevels = blendMapDescription.MipLevels;
+
+	ThrowIfFailed(_device->CreateShaderResourceView(_blendMapTexture.Get(), &viewDescription, _blendMapResourceView.GetAddressOf()));
+}
+
+void TerrainNode::BuildLightMapTexture()
+{
+	XMFLOAT3 directionToSun(-_directionalLightVector.x, -_directionalLightVector.y, -_directionalLightVector.z);
+	_lightMap.Initialise(&_compactHeights[0], _numberOfXPoints, _numberOfZPoints, (float)_spacing, (float)_worldHeight);
+	_lightMap.Bake(directionToSun, _threadPool.get());
+	_statistics.LightMapBakeTime = _lightMap.GetStatistics().BakeTime;
+
+	D3D11_TEXTURE2D_DESC lightMapDescription;
+	lightMapDescription.Width = _numberOfXPoints;
+	lightMapDescription.Height = _numberOfZPoints;
+	lightMapDescription.MipLevels = 1;
+	lightMapDescription.ArraySize = 1;
+	lightMapDescription.Format = DXGI_FORMAT_R8G8_UNORM;
+	lightMapDescription.SampleDesc.Count = 1;
+	lightMapDescription.SampleDesc.Quality = 0;
+	lightMapDescription.Usage = D3D11_USAGE_DEFAULT;
+	lightMapDescription.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	lightMapDescription.CPUAccessFlags = 0;
+	lightMapDescription.MiscFlags = 0;
+
+	D3D11_SUBRESOURCE_DATA lightMapInitialisationData;
+	lightMapInitialisationData.pSysMem = _lightMap.GetTexels();
+	lightMapInitialisationData.SysMemPitch = sizeof(USHORT) * _numberOfXPoints;
+	lightMapInitialisationData.SysMemSlicePitch = 0;
+	ThrowIfFailed(_device->CreateTexture2D(&lightMapDescription, &lightMapInitialisationData, _lightMapTexture.GetAddressOf()));
+	_statistics.TextureBytes += GetTextureBytes(lightMapDescription);
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC viewDescription;
+	viewDescription.Format = DXGI_FORMAT_R8G8_UNORM;
+	viewDescription.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	viewDescription.Texture2D.MostDetailedMip = 0;
 	viewDescription.Texture2D.MipLevels = 1;
+	ThrowIfFailed(_device->CreateShaderResourceView(_lightMapTexture.Get(), &viewDescription, _lightMapResourceView.GetAddressOf()));
+}
 
-	ThrowIfFailed(_device->CreateShaderResourceView(blendMapTexture.Get(), &viewDescription, _blendMapResourceView.GetAddressOf()));
-	delete[] blendMap;
+void TerrainNode::UpdateLightMapTexture(unsigned int firstX, unsigned int firstZ, unsigned int endX, unsigned int endZ)
+{
+	D3D11_BOX box = { firstX, firstZ, 0, endX, endZ, 1 };
+	const USHORT * texels = _lightMap.GetTexels() + (size_t)firstZ * _numberOfXPoints + firstX;
+	_deviceContext->UpdateSubresource(_lightMapTexture.Get(), 0, &box, texels, sizeof(USHORT) * _numberOfXPoints, 0);
 }
 
-bool TerrainNode::LoadHeightMap(wstring heightMapFilename)
+void TerrainNode::SetLightDirection(const XMFLOAT3& lightVector)
 {
-	unsigned int mapSize = _numberOfXPoints * _numberOfZPoints;
-	USHORT* rawFileValues = new USHORT[mapSize];
+	_directionalLightVector = XMFLOAT4(lightVector.x, lightVector.y, lightVector.z, 0.0f);
+	if (_lightMapTexture.Get() == nullptr)
+	{
+		// The light map is baked for the new direction in Initialise
+		return;
+	}
+	auto updateStart = std::chrono::high_resolution_clock::now();
+	unsigned int firstChangedRow;
+	unsigned int endChangedRow;
+	if (_lightMap.SetSunDirection(XMFLOAT3(-lightVector.x, -lightVector.y, -lightVector.z), _threadPool.get(), firstChangedRow, endChangedRow))
+	{
+		UpdateLightMapTexture(0, firstChangedRow, _numberOfXPoints, endChangedRow);
+	}
+	auto updateEnd = std::chrono::high_resolution_clock::now();
+	_statistics.LightMapUpdateTime = std::chrono::duration<double, std::milli>(updateEnd - updateStart).count();
+}
 
-	std::ifstream inputHeightMap;
-	inputHeightMap.open(heightMapFilename.c_str(), std::ios_base::binary);
-	if (!inputHeightMap)
+bool TerrainNode::LoadHeightMap(wstring heightMapFilename)
+{
+	// The dimensions come from the file unless they were given when the terrain was created
+	HeightMapFile heightMap;
+	if (!heightMap.Open(heightMapFilename, _heightMapFormat, _numberOfColumns > 0 ? _numberOfColumns + 1 : 0, _numberOfRows > 0 ? _numberOfRows + 1 : 0))
 	{
+		MessageBox(0, heightMap.GetErrorMessage().c_str(), 0, 0);
 		return false;
 	}
+	_heightMapFormat = heightMap.GetFormat();
+	_heightMapHash = TerrainCache::Hash(heightMap.GetData(), heightMap.GetDataSize());
+	SetGridSize(heightMap.GetWidth(), heightMap.GetHeight());
 
-	inputHeightMap.read((char*)rawFileValues, mapSize * 2);
-	inputHeightMap.close();
+	// Normalise the samples to the range 0.0f - 1.0f straight from the mapped file
+	_heightValues.resize((size_t)_numberOfXPoints * _numberOfZPoints);
+	ForEachRowBand(_numberOfZPoints, [&](unsigned int firstRow, unsigned int endRow)
+	{
+		heightMap.ConvertRows(&_heightValues[0], firstRow, endRow);
+	});
+	return true;
+}
 
-	// Normalise BYTE values to the range 0.0f - 1.0f;
-	for (unsigned int i = 0; i < mapSize; i++)
+bool TerrainNode::GenerateHeightMap()
+{
+	if (_numberOfRows <= 0 || _numberOfColumns <= 0)
 	{
-		_heightValues.push_back((float)rawFileValues[i] / 65536);
+		MessageBox(0, L"The number of rows and columns must be given for a generated terrain", 0, 0);
+		return false;
 	}
-	delete[] rawFileValues;
+	_heightMapHash = _proceduralHeightMap->GetHash();
+	_heightValues.resize((size_t)_numberOfXPoints * _numberOfZPoints);
+	_proceduralHeightMap->Generate(&_heightValues[0], _numberOfXPoints, _numberOfZPoints, _threadPool.get());
 	return true;
 }
 
+// Works out which cell a point is in and where in the cell it is.  Points outside the
+// terrain are clamped to its edge.
+void TerrainNode::GetCellPosition(float x, float z, unsigned int& cellX, unsigned int& cellZ, float& u, float& v)
+{
+	XMFLOAT2 gridOrigin = GetGridOrigin();
+	float gridX = (x - gridOrigin.x) / _spacing;
+	float gridZ = (gridOrigin.y - z) / _spacing;
+	gridX = min(max(gridX, 0.0f), (float)_numberOfColumns);
+	gridZ = min(max(gridZ, 0.0f), (float)_numberOfRows);
+	cellX = min((unsigned int)gridX, (unsigned int)_numberOfColumns - 1);
+	cellZ = min((unsigned int)gridZ, (unsigned int)_numberOfRows - 1);
+	u = gridX - cellX;
+	v = gridZ - cellZ;
+}
+
+// Interpolates the height of a point on the triangles of a cell, splitting the cell along
+// the top right to bottom left diagonal in the same way as the index buffer.
+float TerrainNode::GetHeightInCell(unsigned int cellX, unsigned int cellZ, float u, float v, XMFLOAT3 * normal)
+{
+	size_t topLeftIndex = (size_t)cellZ * _numberOfXPoints + cellX;
+	float topLeft = GetCompactHeight(topLeftIndex);
+	float topRight = GetCompactHeight(topLeftIndex + 1);
+	float bottomLeft = GetCompactHeight(topLeftIndex + _numberOfXPoints);
+	float bottomRight = GetCompactHeight(topLeftIndex + _numberOfXPoints + 1);
+
+	float height;
+	float slopeX;
+	float slopeZ;
+	if (u + v <= 1.0f)
+	{
+		height = topLeft + u * (topRight - topLeft) + v * (bottomLeft - topLeft);
+		slopeX = topRight - topLeft;
+		slopeZ = topLeft - bottomLeft;
+	}
+	else
+	{
+		height = bottomRight + (1.0f - u) * (bottomLeft - bottomRight) + (1.0f - v) * (topRight - bottomRight);
+		slopeX = bottomRight - bottomLeft;
+		slopeZ = topRight - bottomRight;
+	}
+	if (normal != nullptr)
+	{
+		// The normal of the plane y = h(x, z) is (-dh/dx, 1, -dh/dz)
+		float scale = _worldHeight / (float)_spacing;
+		XMStoreFloat3(normal, XMVector3Normalize(XMVectorSet(-slopeX * scale, 1.0f, -slopeZ * scale, 0.0f)));
+	}
+	return height * _worldHeight;
+}
+
 float TerrainNode::GetHeightAtPoint(float x, float z)
 {
-	int indexBase;
+	unsigned int cellX;
+	unsigned int cellZ;
+	float u;
+	float v;
+	GetCellPosition(x, z, cellX, cellZ, u, v);
+	return GetHeightInCell(cellX, cellZ, u, v, nullptr);
+}
 
-	int cellX = (int)((x - _terrainStartX) / _spacing);
-	int cellZ = (int)((_terrainStartZ - z) / _spacing);
+float TerrainNode::GetHeightAndNormalAtPoint(float x, float z, XMFLOAT3& normal)
+{
+	unsigned int cellX;
+	unsigned int cellZ;
+	float u;
+	float v;
+	GetCellPosition(x, z, cellX, cellZ, u, v);
+	return GetHeightInCell(cellX, cellZ, u, v, &normal);
+}
 
-	int verticesIndex = (cellZ * _numberOfColumns * 4) + (cellX * 4);
-	float dx = x - _vertices[verticesIndex].Position.x;
-	float dz = z - _vertices[verticesIndex].Position.z;
+void TerrainNode::GetHeightsAtPoints(const XMFLOAT2 * points, unsigned int count, float * heights, XMFLOAT3 * normals)
+{
+	unsigned int i = 0;
+#if defined(__AVX2__)
+	// Eight points at a time, gathering the corner heights of each point's cell
+	const __m256i pointIndices = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 spacing = _mm256_set1_ps((float)_spacing);
+	XMFLOAT2 gridOrigin = GetGridOrigin();
+	const __m256 startX = _mm256_set1_ps(gridOrigin.x);
+	const __m256 startZ = _mm256_set1_ps(gridOrigin.y);
+	const __m256 maximumX = _mm256_set1_ps((float)_numberOfColumns);
+	const __m256 maximumZ = _mm256_set1_ps((float)_numberOfRows);
+	const __m256i lastCellX = _mm256_set1_epi32(_numberOfColumns - 1);
+	const __m256i lastCellZ = _mm256_set1_epi32(_numberOfRows - 1);
+	const __m256i rowLength = _mm256_set1_epi32(_numberOfXPoints);
+	const __m256i nextRow = _mm256_set1_epi32(_numberOfXPoints + 1);
+	const __m256i nextColumn = _mm256_set1_epi32(1);
+	const __m256 worldHeight = _mm256_set1_ps((float)_worldHeight);
+	const __m256 slopeScale = _mm256_set1_ps(_worldHeight / (float)_spacing);
+	const int * heightValues = (const int *)&_compactHeights[0];
+	const __m256i heightMask = _mm256_set1_epi32(0xFFFF);
+	const __m256 heightScale = _mm256_set1_ps(1.0f / 65536);
+	alignas(32) float nx[8];
+	alignas(32) float ny[8];
+	alignas(32) float nz[8];
+	for (; i + 8 <= count; i += 8)
+	{
+		const float * coordinates = &points[i].x;
+		__m256 x = _mm256_i32gather_ps(coordinates, pointIndices, 4);
+		__m256 z = _mm256_i32gather_ps(coordinates + 1, pointIndices, 4);
+		__m256 gridX = _mm256_min_ps(_mm256_max_ps(_mm256_div_ps(_mm256_sub_ps(x, startX), spacing), zero), maximumX);
+		__m256 gridZ = _mm256_min_ps(_mm256_max_ps(_mm256_div_ps(_mm256_sub_ps(startZ, z), spacing), zero), maximumZ);
+		__m256i cellX = _mm256_min_epi32(_mm256_cvttps_epi32(gridX), lastCellX);
+		__m256i cellZ = _mm256_min_epi32(_mm256_cvttps_epi32(gridZ), lastCellZ);
+		__m256 u = _mm256_sub_ps(gridX, _mm256_cvtepi32_ps(cellX));
+		__m256 v = _mm256_sub_ps(gridZ, _mm256_cvtepi32_ps(cellZ));
+
+		__m256i topLeftIndex = _mm256_add_epi32(_mm256_mullo_epi32(cellZ, rowLength), cellX);
+		// The heights are 16-bit, so each gather reads 32 bits from the start of the height and masks off the next one
+		__m256 topLeft = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_i32gather_epi32(heightValues, topLeftIndex, 2), heightMask)), heightScale);
+		__m256 topRight = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_i32gather_epi32(heightValues, _mm256_add_epi32(topLeftIndex, nextColumn), 2), heightMask)), heightScale);
+		__m256 bottomLeft = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_i32gather_epi32(heightValues, _mm256_add_epi32(topLeftIndex, rowLength), 2), heightMask)), heightScale);
+		__m256 bottomRight = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_i32gather_epi32(heightValues, _mm256_add_epi32(topLeftIndex, nextRow), 2), heightMask)), heightScale);
+
+		// Work out both triangles and pick the one each point is in
+		__m256 firstHeight = _mm256_add_ps(_mm256_add_ps(topLeft, _mm256_mul_ps(u, _mm256_sub_ps(topRight, topLeft))), _mm256_mul_ps(v, _mm256_sub_ps(bottomLeft, topLeft)));
+		__m256 secondHeight = _mm256_add_ps(_mm256_add_ps(bottomRight, _mm256_mul_ps(_mm256_sub_ps(one, u), _mm256_sub_ps(bottomLeft, bottomRight))), _mm256_mul_ps(_mm256_sub_ps(one, v), _mm256_sub_ps(topRight, bottomRight)));
+		__m256 inSecondTriangle = _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_GT_OQ);
+		_mm256_storeu_ps(heights + i, _mm256_mul_ps(_mm256_blendv_ps(firstHeight, secondHeight, inSecondTriangle), worldHeight));
+
+		if (normals != nullptr)
+		{
+			__m256 slopeX = _mm256_blendv_ps(_mm256_sub_ps(topRight, topLeft), _mm256_sub_ps(bottomRight, bottomLeft), inSecondTriangle);
+			__m256 slopeZ = _mm256_blendv_ps(_mm256_sub_ps(topLeft, bottomLeft), _mm256_sub_ps(topRight, bottomRight), inSecondTriangle);
+			__m256 normalX = _mm256_mul_ps(slopeX, slopeScale);
+			__m256 normalZ = _mm256_mul_ps(slopeZ, slopeScale);
+			__m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(normalX, normalX), _mm256_mul_ps(normalZ, normalZ)), one));
+			_mm256_store_ps(nx, _mm256_div_ps(_mm256_sub_ps(zero, normalX), length));
+			_mm256_store_ps(ny, _mm256_div_ps(one, length));
+			_mm256_store_ps(nz, _mm256_div_ps(_mm256_sub_ps(zero, normalZ), length));
+			for (unsigned int j = 0; j < 8; j++)
+			{
+				normals[i + j] = XMFLOAT3(nx[j], ny[j], nz[j]);
+			}
+		}
+	}
+#endif
+	// Any points left over (or all of them without AVX2)
+	for (; i < count; i++)
+	{
+		unsigned int cellX;
+		unsigned int cellZ;
+		float u;
+		float v;
+		GetCellPosition(points[i].x, points[i].y, cellX, cellZ, u, v);
+		heights[i] = GetHeightInCell(cellX, cellZ, u, v, normals != nullptr ? &normals[i] : nullptr);
+	}
+}
 
-	if (dz > dx)
+// Moller-Trumbore ray/triangle intersection
+static bool IntersectRayWithTriangle(FXMVECTOR origin, FXMVECTOR direction, FXMVECTOR v0, GXMVECTOR v1, HXMVECTOR v2, float& distance)
+{
+	const float epsilon = 1e-9f;
+	XMVECTOR edge1 = XMVectorSubtract(v1, v0);
+	XMVECTOR edge2 = XMVectorSubtract(v2, v0);
+	XMVECTOR p = XMVector3Cross(direction, edge2);
+	float determinant = XMVectorGetX(XMVector3Dot(edge1, p));
+	if (fabsf(determinant) < epsilon)
 	{
-		indexBase = (cellZ * _numberOfColumns + cellX) * 6;
+		return false;
 	}
-	else
+	float inverseDeterminant = 1.0f / determinant;
+	XMVECTOR t = XMVectorSubtract(origin, v0);
+	float u = XMVectorGetX(XMVector3Dot(t, p)) * inverseDeterminant;
+	if (u < 0.0f || u > 1.0f)
+	{
+		return false;
+	}
+	XMVECTOR q = XMVector3Cross(t, edge1);
+	float v = XMVectorGetX(XMVector3Dot(direction, q)) * inverseDeterminant;
+	if (v < 0.0f || u + v > 1.0f)
+	{
+		return false;
+	}
+	distance = XMVectorGetX(XMVector3Dot(edge2, q)) * inverseDeterminant;
+	return distance >= 0.0f;
+}
+
+// Tests a ray (with a normalised direction) against the two triangles of a cell
+bool TerrainNode::RayCastCell(const XMFLOAT3& origin, const XMFLOAT3& direction, unsigned int cellX, unsigned int cellZ, float maximumDistance, TerrainRayHit& hit)
+{
+	size_t topLeftIndex = (size_t)cellZ * _numberOfXPoints + cellX;
+	XMFLOAT2 gridOrigin = GetGridOrigin();
+	float left = gridOrigin.x + cellX * _spacing;
+	float top = gridOrigin.y - cellZ * (float)_spacing;
+	XMVECTOR topLeft = XMVectorSet(left, GetCompactHeight(topLeftIndex) * _worldHeight, top, 0.0f);
+	XMVECTOR topRight = XMVectorSet(left + _spacing, GetCompactHeight(topLeftIndex + 1) * _worldHeight, top, 0.0f);
+	XMVECTOR bottomLeft = XMVectorSet(left, GetCompactHeight(topLeftIndex + _numberOfXPoints) * _worldHeight, top - _spacing, 0.0f);
+	XMVECTOR bottomRight = XMVectorSet(left + _spacing, GetCompactHeight(topLeftIndex + _numberOfXPoints + 1) * _worldHeight, top - _spacing, 0.0f);
+	XMVECTOR rayOrigin = XMLoadFloat3(&origin);
+	XMVECTOR rayDirection = XMLoadFloat3(&direction);
+
+	// Same triangles as the index buffer
+	float distance;
+	bool found = false;
+	XMVECTOR normal = XMVectorZero();
+	if (IntersectRayWithTriangle(rayOrigin, rayDirection, topLeft, topRight, bottomLeft, distance) && distance <= maximumDistance)
+	{
+		maximumDistance = distance;
+		normal = XMVector3Cross(XMVectorSubtract(topRight, topLeft), XMVectorSubtract(bottomLeft, topLeft));
+		found = true;
+	}
+	if (IntersectRayWithTriangle(rayOrigin, rayDirection, bottomLeft, topRight, bottomRight, distance) && distance <= maximumDistance)
+	{
+		maximumDistance = distance;
+		normal = XMVector3Cross(XMVectorSubtract(topRight, bottomLeft), XMVectorSubtract(bottomRight, bottomLeft));
+		found = true;
+	}
+	if (found)
+	{
+		hit.Distance = maximumDistance;
+		XMStoreFloat3(&hit.Position, XMVectorAdd(rayOrigin, XMVectorScale(rayDirection, maximumDistance)));
+		XMStoreFloat3(&hit.Normal, XMVector3Normalize(normal));
+	}
+	return found;
+}
+
+bool TerrainNode::RayCast(const XMFLOAT3& origin, const XMFLOAT3& direction, float maximumDistance, TerrainRayHit& hit)
+{
+	if (_heightPyramid.GetLevelCount() == 0)
+	{
+		return false;
+	}
+	XMFLOAT3 rayDirection;
+	XMStoreFloat3(&rayDirection, XMVector3Normalize(XMLoadFloat3(&direction)));
+	XMFLOAT3 inverseDirection(rayDirection.x != 0.0f ? 1.0f / rayDirection.x : FLT_MAX,
+							  rayDirection.y != 0.0f ? 1.0f / rayDirection.y : FLT_MAX,
+							  rayDirection.z != 0.0f ? 1.0f / rayDirection.z : FLT_MAX);
+
+	// Children are visited nearest first.  Rows run towards -z, so the nearer row is the lower one
+	// when the ray is heading towards -z.
+	unsigned int nearX = rayDirection.x >= 0.0f ? 0 : 1;
+	unsigned int nearZ = rayDirection.z <= 0.0f ? 0 : 1;
+	XMFLOAT2 gridOrigin = GetGridOrigin();
+
+	// Depth first, nearest first, so the first hit found is the closest one.  Each level adds
+	// at most three entries to the stack.
+	RayCastNode stack[4 * 32];
+	unsigned int stackSize = 0;
+	unsigned int topLevel = _heightPyramid.GetLevelCount() - 1;
+	stack[stackSize++] = { topLevel, 0, 0 };
+	while (stackSize > 0)
+	{
+		RayCastNode node = stack[--stackSize];
+		const TerrainHeightRange& range = _heightPyramid.GetRange(node.Level, node.X, node.Z);
+		unsigned int firstCellX = node.X << node.Level;
+		unsigned int firstCellZ = node.Z << node.Level;
+		unsigned int endCellX = min((node.X + 1) << node.Level, (unsigned int)_numberOfColumns);
+		unsigned int endCellZ = min((node.Z + 1) << node.Level, (unsigned int)_numberOfRows);
+		XMFLOAT3 boxMin(gridOrigin.x + firstCellX * _spacing, range.Minimum * _worldHeight, gridOrigin.y - endCellZ * (float)_spacing);
+		XMFLOAT3 boxMax(gridOrigin.x + endCellX * _spacing, range.Maximum * _worldHeight, gridOrigin.y - firstCellZ * (float)_spacing);
+		float entry = 0.0f;
+		float exit = maximumDistance;
+		if (!IntersectRayWithBox(origin, inverseDirection, boxMin, boxMax, entry, exit))
+		{
+			continue;
+		}
+		if (node.Level == 0)
+		{
+			if (RayCastCell(origin, rayDirection, node.X, node.Z, maximumDistance, hit))
+			{
+				return true;
+			}
+			continue;
+		}
+
+		unsigned int childLevel = node.Level - 1;
+		unsigned int childWidth = _heightPyramid.GetLevelWidth(childLevel);
+		unsigned int childHeight = _heightPyramid.GetLevelHeight(childLevel);
+		for (int i = 3; i >= 0; i--)
+		{
+			unsigned int childX = node.X * 2 + ((i & 1) ^ nearX);
+			unsigned int childZ = node.Z * 2 + ((i >> 1) ^ nearZ);
+			if (childX < childWidth && childZ < childHeight)
+			{
+				stack[stackSize++] = { childLevel, childX, childZ };
+			}
+		}
+	}
+	return false;
+}
+
+bool TerrainNode::SphereOverlap(const XMFLOAT3& centre, float radius, TerrainContact& contact)
+{
+	return _collider.SphereOverlap(centre, radius, contact);
+}
+
+bool TerrainNode::CapsuleOverlap(const XMFLOAT3& start, const XMFLOAT3& end, float radius, TerrainContact& contact)
+{
+	return _collider.CapsuleOverlap(start, end, radius, contact);
+}
+
+bool TerrainNode::SweepSphere(const XMFLOAT3& start, const XMFLOAT3& end, float radius, TerrainContact& contact)
+{
+	return _collider.SweepSphere(start, end, radius, contact);
+}
+
+static unsigned int CountHits(const TerrainContact * contacts, unsigned int count)
+{
+	unsigned int hits = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		hits += contacts[i].Hit ? 1 : 0;
+	}
+	return hits;
+}
+
+unsigned int TerrainNode::SphereOverlaps(const TerrainSphere * spheres, unsigned int count, TerrainContact * contacts)
+{
+	ForEachRowBand(count, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			_collider.SphereOverlap(spheres[i].Centre, spheres[i].Radius, contacts[i]);
+		}
+	});
+	return CountHits(contacts, count);
+}
+
+unsigned int TerrainNode::CapsuleOverlaps(const TerrainCapsule * capsules, unsigned int count, TerrainContact * contacts)
+{
+	ForEachRowBand(count, [&](unsigned int begin, unsigned int end)
 	{
-		indexBase = (cellZ * _numberOfColumns + cellX) * 6 + 3;
-	}
-	int index0 = _indices[indexBase];
-	int index1 = _indices[indexBase + 1];
-	int index2 = _indices[indexBase + 2];
-
-	// Taken from normals calculations method
-	XMVECTOR u = XMVectorSet(_vertices[index1].Position.x - _vertices[index0].Position.x,
-							 _vertices[index1].Position.y - _vertices[index0].Position.y,
-							 _vertices[index1].Position.z - _vertices[index0].Position.z,
-							 0.0f);
-	XMVECTOR v = XMVectorSet(_vertices[index2].Position.x - _vertices[index0].Position.x,
-							 _vertices[index2].Position.y - _vertices[index0].Position.y,
-							 _vertices[index2].Position.z - _vertices[index0].Position.z,
-							 0.0f);
-	XMFLOAT4 normal;
-	XMStoreFloat4(&normal, XMVector3Normalize(XMVector3Cross(u, v)));
-
-	float y = _vertices[verticesIndex].Position.y + (normal.x * dx + normal.y * dz) / -normal.y;
-	return y;
+		for (unsigned int i = begin; i < end; i++)
+		{
+			_collider.CapsuleOverlap(capsules[i].Start, capsules[i].End, capsules[i].Radius, contacts[i]);
+		}
+	});
+	return CountHits(contacts, count);
+}
+
+unsigned int TerrainNode::SweepSpheres(const TerrainSphereSweep * sweeps, unsigned int count, TerrainContact * contacts)
+{
+	ForEachRowBand(count, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			_collider.SweepSphere(sweeps[i].Start, sweeps[i].End, sweeps[i].Radius, contacts[i]);
+		}
+	});
+	return CountHits(contacts, count);
 }
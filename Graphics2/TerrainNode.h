@@ -2,28 +2,306 @@
 #include "SceneNode.h"
 #include "ResourceManager.h"
 #include "DDSTextureLoader.h"
+#include "TerrainQuadTree.h"
+#include "TerrainOcclusionCuller.h"
+#include "TerrainHeightPyramid.h"
+#include "ThreadPool.h"
+#include "TerrainNormals.h"
+#include "HeightMapFile.h"
+#include "TerrainCache.h"
+#include "TerrainSimplifier.h"
+#include "ProceduralHeightMap.h"
+#include "TerrainIndexOrder.h"
+#include "VertexCacheSimulator.h"
+#include "TerrainVertexFormat.h"
+#include "TerrainBlendMap.h"
+#include "TerrainLightMap.h"
+#include "TerrainCollision.h"
+#include "FrustumCulling.h"
 #include <fstream>
+#include <chrono>
 
-struct TerrainVertex
+// How the height grid is turned into vertices.  PerCell gives every cell its own
+// four vertices, SharedGrid creates one vertex per height sample and neighbouring
+// cells share it through the index buffer.  The per-cell vertices are copies of the
+// shared ones (apart from CellAverage normals along the edges of the terrain), so
+// the two layouts look the same.
+enum class TerrainVertexLayout
 {
-	XMFLOAT3 Position;
-	XMFLOAT3 Normal;
-	XMFLOAT2 TexCoord;
-	XMFLOAT2 BlendMapTexCoord;
+	PerCell,
+	SharedGrid
+};
+
+// How vertex normals are calculated.  CellAverage averages the normals of the cells that share
+// a vertex.  CentralDifference works the normals out directly from the neighbouring height values
+// (see CalculateHeightFieldNormals), which is much faster.
+enum class TerrainNormalMethod
+{
+	CellAverage,
+	CentralDifference
+};
+
+// Figures gathered while the terrain is generated so that the cost of the
+// different layouts can be compared
+struct TerrainStatistics
+{
+	unsigned int	VertexCount;
+	size_t			VertexBytes;
+	unsigned int	IndexCount;
+	size_t			IndexBytes;
+	size_t			TextureBytes;		// Memory held by the textures created in Initialise
+	double			GenerationTime;		// Milliseconds spent generating vertices, indices, normals and the blend map
+	double			LoadTime;			// Milliseconds spent in LoadGeometry, including loading the height map and cache
+	bool			LoadedFromCache;
+	size_t			ResidentBytesAfterUpload;	// CPU memory held once the buffers had been created
+	size_t			ResidentBytesAfterRelease;	// and after the geometry was released (see SetCompactMemoryEnabled)
+	unsigned int	ChunksDrawn;		// Level of detail chunks drawn in the last frame
+	unsigned int	TrianglesDrawn;		// Triangles (including skirts) drawn in the last frame
+	unsigned int	SimplifiedTriangles;	// Triangles left after simplification (0 if the terrain isn't simplified)
+	double			LastEditTime;		// Milliseconds spent in the last EditHeights, including the GPU updates
+	unsigned int	LastEditSamples;	// Height samples changed by the last edit
+	unsigned int	LastEditVertices;	// Vertices (including skirts) updated by the last edit
+	unsigned int	VertexStride;		// Size of a vertex in the vertex buffer
+	TerrainCompactVertexError CompactVertexError;	// How far the compact vertices are from the full ones (all 0 if not used)
+	size_t			VertexFetchBytes;	// Estimated vertex data read by the GPU in the last frame
+	size_t			VertexFetchBytesSaved;	// and how much less that is than it would have been with full vertices
+	unsigned int	ChunksOccluded;		// Selected chunks that were hidden behind nearer terrain in the last frame
+	unsigned int	TrianglesOccluded;	// and the triangles they would have drawn
+	double			OcclusionTime;		// Milliseconds spent finding them
+	unsigned int	ChunksOutsideFrustum;	// Selected chunks that were outside the view in the last frame
+	unsigned int	TrianglesOutsideFrustum;	// and the triangles they would have drawn
+	double			LightMapBakeTime;	// Milliseconds spent baking the light map in Initialise
+	double			LightMapUpdateTime;	// Milliseconds spent updating it after the last SetLightDirection (including the GPU update)
+};
+
+// Where a ray hit the terrain
+struct TerrainRayHit
+{
+	float			Distance;			// Distance along the ray from its origin
+	XMFLOAT3		Position;
+	XMFLOAT3		Normal;				// Normal of the triangle that was hit
+};
+
+// CPU memory held by a terrain, in bytes
+struct TerrainMemoryUsage
+{
+	size_t			HeightBytes;		// Full precision heights
+	size_t			CompactHeightBytes;	// 16-bit heights used for queries
+	size_t			HeightPyramidBytes;
+	size_t			VertexBytes;
+	size_t			IndexBytes;
+	size_t			BlendMapBytes;
+	size_t			ChunkBytes;
+	size_t			LightMapBytes;
+	size_t			Total;
 };
 
 class TerrainNode : public SceneNode
 {
 public:
-	TerrainNode(wstring name, wstring heightMapFilename, int numberOfRows, int numberOfColumns, int worldHeight, int spacing);
+	// numberOfRows and numberOfColumns are the number of cells.  If they are 0, the size is worked
+	// out from the size of the height map file.
+	TerrainNode(wstring name, wstring heightMapFilename, int numberOfRows, int numberOfColumns, int worldHeight, int spacing, TerrainVertexLayout vertexLayout = TerrainVertexLayout::PerCell);
+
+	// Creates a terrain whose heights come from heightMap instead of a file.  numberOfRows and
+	// numberOfColumns must be given.  Generated terrains are not cached, as there is no file to
+	// keep the cache next to.
+	TerrainNode(wstring name, shared_ptr<ProceduralHeightMap> heightMap, int numberOfRows, int numberOfColumns, int worldHeight, int spacing, TerrainVertexLayout vertexLayout = TerrainVertexLayout::PerCell);
+
+	// Creates a terrain from heights that are already in memory (such as a tile streamed by a
+	// TerrainWorldNode).  heightValues holds numberOfXPoints * numberOfZPoints normalised heights and is
+	// taken over by the terrain.  These terrains are not cached either.
+	TerrainNode(wstring name, vector<float>&& heightValues, unsigned int numberOfXPoints, unsigned int numberOfZPoints, int worldHeight, int spacing, TerrainVertexLayout vertexLayout = TerrainVertexLayout::PerCell);
 	~TerrainNode();
 
 	bool Initialise();
+
+	// Loads the height map and generates everything needed to create the terrain's buffers, or
+	// loads it from the cache file.  Called by Initialise if it hasn't already been called, but doesn't
+	// need a device so it can also be used (and timed) on its own, or run on another thread.
+	bool LoadGeometry();
+
+	// Frees what the GPU has its own copies of, and the geometry if compact memory is enabled (see
+	// SetCompactMemoryEnabled), and records ResidentBytesAfterUpload and ResidentBytesAfterRelease.
+	// Called by Initialise once the buffers and textures have been created.  Without a device, it can be
+	// called after LoadGeometry instead.
+	void ReleaseUploadedData();
 	void Render();
 	void Shutdown() {}
+	// Height queries are answered from the height values, so they match the triangles drawn at
+	// full resolution.  Points outside the terrain are clamped to its edge.
 	float GetHeightAtPoint(float x, float z);
+	float GetHeightAndNormalAtPoint(float x, float z, XMFLOAT3& normal);
+
+	// Gets the heights at count points (each given as x, z) and, if normals is not nullptr, the
+	// surface normals.  Points are handled eight at a time when built with AVX2.
+	void GetHeightsAtPoints(const XMFLOAT2 * points, unsigned int count, float * heights, XMFLOAT3 * normals = nullptr);
+
+	// Finds the first point where a ray hits the terrain within maximumDistance of its origin.  The
+	// direction does not need to be normalised.  Areas of the terrain that the ray passes above or
+	// below are skipped using the height pyramid, so only triangles close to the ray are tested.
+	bool RayCast(const XMFLOAT3& origin, const XMFLOAT3& direction, float maximumDistance, TerrainRayHit& hit);
+
+	// Collision of spheres, capsules and moving spheres with the triangles of the terrain (see
+	// TerrainCollider).  Shapes that are beyond the edge of the terrain don't hit it.  The batched forms
+	// fill in a contact for each shape, spreading the work across the thread pool if there is one, and
+	// return how many hit.
+	bool SphereOverlap(const XMFLOAT3& centre, float radius, TerrainContact& contact);
+	bool CapsuleOverlap(const XMFLOAT3& start, const XMFLOAT3& end, float radius, TerrainContact& contact);
+	bool SweepSphere(const XMFLOAT3& start, const XMFLOAT3& end, float radius, TerrainContact& contact);
+	unsigned int SphereOverlaps(const TerrainSphere * spheres, unsigned int count, TerrainContact * contacts);
+	unsigned int CapsuleOverlaps(const TerrainCapsule * capsules, unsigned int count, TerrainContact * contacts);
+	unsigned int SweepSpheres(const TerrainSphereSweep * sweeps, unsigned int count, TerrainContact * contacts);
+
+	// Draws the terrain as a quadtree of chunks of chunkSize * chunkSize cells, using coarser
+	// chunks further away.  Must be called before Initialise and needs the SharedGrid layout.
+	void EnableLevelOfDetail(unsigned int chunkSize, float maximumScreenError);
+
+	// Skips the selected chunks that are hidden behind nearer terrain (see TerrainOcclusionCuller).  The
+	// occluders close to the camera are blocks of 2^occluderLevel * 2^occluderLevel cells.  Only used with
+	// level of detail.  Must be called before Initialise.
+	void EnableOcclusionCulling(unsigned int occluderLevel);
+
+	// Draws the terrain with larger triangles where it is flat, keeping the drawn surface within
+	// maximumError world units of the height map (see TerrainSimplifier).  Height queries and ray casts
+	// still use the exact heights.  Must be called before Initialise, needs the SharedGrid layout and
+	// is not used if level of detail or editing is enabled.
+	void EnableSimplification(float maximumError);
+
+	// Allows the heights to be changed after Initialise with EditHeights, CreateCrater and FlattenArea.  The
+	// full precision heights are kept and the vertex buffer is created so that it can be updated.  Must be
+	// called before Initialise, needs the SharedGrid layout and CentralDifference normals and turns off
+	// simplification, as the simplified mesh would have to be rebuilt after every edit.
+	inline void EnableEditing() { _editingEnabled = true; }
+
+	// Changes the heights of samples [firstX, endX) x [firstZ, endZ) of the grid, where column x, row z is
+	// vertex z * (columns + 1) + x.  edit is given each sample's position in the grid and its current
+	// height in world units, and returns its new height.  Only the vertices, normals, blend map texels,
+	// height pyramid entries and chunks around the area are recalculated, and only those parts of the
+	// GPU resources are updated, so the cost depends on the size of the area rather than of the terrain.
+	// Returns false if editing is not enabled.
+	bool EditHeights(unsigned int firstX, unsigned int firstZ, unsigned int endX, unsigned int endZ, const function<float(unsigned int, unsigned int, float)>& edit);
+
+	// Lowers the terrain in a bowl of the given radius around the point (x, z), depth world units deep at the centre
+	bool CreateCrater(float x, float z, float radius, float depth);
+
+	// Flattens the terrain within radius of the point (x, z) to the given height, blending back into the
+	// surrounding terrain over the outer quarter of the radius
+	bool FlattenArea(float x, float z, float radius, float height);
+
+	// Must be called before Initialise.  By default the format is worked out from the size of the file.
+	inline void SetHeightMapFormat(HeightMapFormat heightMapFormat) { _heightMapFormat = heightMapFormat; }
+
+	// The generated vertices, indices, blend map and height pyramid are kept in <height map>.cache and
+	// used instead of generating them again while the height map and the terrain's parameters are
+	// unchanged.  On by default.  Must be called before Initialise.
+	inline void SetCacheEnabled(bool cacheEnabled) { _cacheEnabled = cacheEnabled; }
+
+	// Once the buffers have been created, frees the vertices, indices and full precision heights, leaving
+	// only the 16-bit heights, the height pyramid and the level of detail chunks.  On by default.  All
+	// height queries and ray casts use the 16-bit heights either way.  Must be called before Initialise.
+	inline void SetCompactMemoryEnabled(bool compactMemoryEnabled) { _compactMemoryEnabled = compactMemoryEnabled; }
+
+	// The order the cells are drawn in at full resolution.  Only affects the SharedGrid layout, as the
+	// per-cell layout doesn't share vertices.  Must be called before Initialise.
+	inline void SetIndexOrder(TerrainIndexOrder indexOrder) { _indexOrder = indexOrder; }
+
+	// Simulates drawing the index buffer through a post-transform vertex cache (see SimulateVertexCache).
+	// Only available until the geometry is released at the end of Initialise.
+	VertexCacheStatistics AnalyseVertexCache(unsigned int cacheSize, VertexCachePolicy policy);
+
+	// How the vertices are stored in the vertex buffer (see TerrainVertexFormat).  The compact format is
+	// only used with the SharedGrid layout.  The vertices are generated and cached in the full format
+	// either way and packed as the buffer is created.  Must be called before Initialise.
+	inline void SetVertexFormat(TerrainVertexFormat vertexFormat) { _vertexFormat = vertexFormat; }
+
+	// Brings in the stone layer of the blend map where the terrain is steep (see TerrainSlopeBlend).
+	// Set end to no more than start to turn it off.  Must be called before Initialise.
+	inline void SetSlopeBlend(float start, float end) { _slopeBlend = { start, end }; }
+
+	// Shades the terrain with a light map of ambient occlusion and shadows from the sun, baked from the heights in
+	// Initialise (see TerrainLightMap).  Edits bake the area around them again.  Must be called before Initialise.
+	inline void EnableLightMap() { _lightMapEnabled = true; }
+
+	// The direction the light travels in.  If there is a light map, the sun visibility is updated, which is quick
+	// for small changes of direction.
+	void SetLightDirection(const XMFLOAT3& lightVector);
+
+	// Must be called before Initialise
+	inline void SetNormalMethod(TerrainNormalMethod normalMethod) { _normalMethod = normalMethod; }
+
+	// Shades the terrain with detailTextures (as returned by LoadDetailTextures) instead of loading its own
+	// copy, so that terrains drawn together can share one.  Shared textures aren't counted in TextureBytes.
+	// Must be called before Initialise.
+	inline void SetDetailTextures(ComPtr<ID3D11ShaderResourceView> detailTextures) { _texturesResourceView = detailTextures; _detailTexturesShared = true; }
+
+	// Loads the five detail textures (grass, dark dirt, stone, light dirt and snow) into a texture array.
+	// bytes is set to the memory the array takes.
+	static ComPtr<ID3D11ShaderResourceView> LoadDetailTextures(ID3D11Device * device, ID3D11DeviceContext * deviceContext, size_t& bytes);
+
+	// Generation is split across this pool.  If none is set, the framework's pool is used.
+	inline void SetThreadPool(shared_ptr<ThreadPool> threadPool) { _threadPool = threadPool; }
+
+	inline TerrainVertexLayout GetVertexLayout() { return _vertexLayout; }
+	inline TerrainQuadTree& GetQuadTree() { return _quadTree; }
+	inline const TerrainHeightPyramid& GetHeightPyramid() { return _heightPyramid; }
+	// Where sample (0, 0) of the grid is in the terrain's own space (x, z).  Row 0 of the grid is one cell in
+	// front of the start of the terrain (see SetGridVertex), so everything that maps between positions and grid
+	// cells works from here rather than from _terrainStartZ.  Only valid after LoadGeometry.
+	inline XMFLOAT2 GetGridOrigin() { return XMFLOAT2(_terrainStartX, _terrainStartZ + _spacing); }
+	inline TerrainStatistics GetStatistics() { return _statistics; }
+	TerrainMemoryUsage GetMemoryUsage();
 
 private:
+	TerrainVertexLayout				_vertexLayout;
+	TerrainStatistics				_statistics;
+	TerrainNormalMethod				_normalMethod;
+	TerrainIndexOrder				_indexOrder;
+	TerrainVertexFormat				_vertexFormat;
+	TerrainCompactVertexParameters	_compactVertexParameters;
+	vector<TerrainCompactVertex>	_compactVertices;	// Vertices packed for the vertex buffer or an update to it
+	float							_transformsPerTriangle;	// Measured vertex cache miss ratio, used to estimate VertexFetchBytes
+
+	bool							_levelOfDetailEnabled;
+	unsigned int					_chunkSize;
+	float							_maximumScreenError;
+	TerrainQuadTree					_quadTree;
+	vector<UINT>					_levelOfDetailIndices;
+	vector<TerrainChunkDraw>		_drawList;
+	BoundingBoxArrays				_drawListBounds;	// Of the selected chunks, for frustum culling
+	vector<unsigned int>			_visibleDrawIndices;
+	bool							_occlusionCullingEnabled;
+	unsigned int					_occluderLevel;
+	TerrainOcclusionCuller			_occlusionCuller;
+
+	bool							_simplificationEnabled;
+	float							_maximumSimplificationError;
+	vector<UINT>					_simplifiedIndices;
+
+	bool							_editingEnabled;
+	vector<TerrainSkirtVertex>		_skirtVertices;
+	vector<UINT>					_skirtOrder;		// Skirt vertices sorted by the grid vertex they hang from
+	vector<TerrainVertex>			_editVertices;
+	vector<DWORD>					_editTexels;
+
+	shared_ptr<ThreadPool>			_threadPool;
+
+	bool							_cacheEnabled;
+	bool							_heightsSupplied;
+	bool							_geometryLoaded;
+	UINT64							_heightMapHash;
+	TerrainCache					_cache;
+
+	// What the buffers and blend map texture are created from.  These point either at the
+	// generated data or into the cache.
+	const TerrainVertex *			_vertexData;
+	const UINT *					_indexData;
+	unsigned int					_numberOfBufferIndices;
+	const DWORD *					_blendMapData;
+	vector<DWORD>					_blendMap;
+	vector<vector<DWORD>>			_blendMapMips;		// Mip levels 1 onwards
+	TerrainSlopeBlend				_slopeBlend;
+
 	unsigned int					_numberOfXPoints;
 	unsigned int					_numberOfZPoints;
 	unsigned int					_numberOfPolygons;
@@ -41,8 +319,14 @@ private:
 	float							_terrainEndZ;
 
 	wstring							_heightMapFilename;
+	HeightMapFormat					_heightMapFormat;
+	shared_ptr<ProceduralHeightMap>	_proceduralHeightMap;
 
 	vector<float>					_heightValues;
+	vector<USHORT>					_compactHeights;
+	bool							_compactMemoryEnabled;
+	TerrainHeightPyramid			_heightPyramid;
+	TerrainCollider					_collider;
 
 	vector<TerrainVertex>			_vertices;
 	vector<UINT>					_indices;
@@ -69,17 +353,65 @@ private:
 	ComPtr<ID3D11RasterizerState>	_wireframeRasteriserState;
 
 	ComPtr<ID3D11ShaderResourceView> _texturesResourceView;
+	bool							_detailTexturesShared;
+	ComPtr<ID3D11Texture2D>			_blendMapTexture;
 	ComPtr<ID3D11ShaderResourceView> _blendMapResourceView;
 
-	void AddToVertexNormal(int z, int x, unsigned int vertexNumber, XMVECTOR normal);
+	bool							_lightMapEnabled;
+	TerrainLightMap					_lightMap;
+	ComPtr<ID3D11Texture2D>			_lightMapTexture;
+	ComPtr<ID3D11ShaderResourceView> _lightMapResourceView;
+
+	wstring GetCacheFilename();
+	UINT64 CalculateCacheKey();
+	bool LoadFromCache(UINT64 cacheKey);
+	bool WriteCache(UINT64 cacheKey);
+	void BuildCompactHeights();
+	void ReleaseGeometry();
+	inline float GetCompactHeight(size_t index) { return (float)_compactHeights[index] / 65536; }
+	void CalculateTerrainExtents();
+	void CalculateBounds();
+	void SetGridSize(unsigned int numberOfXPoints, unsigned int numberOfZPoints);
+	unsigned int GetCellVertexIndex(int z, int x);
 	void GenerateVerticesAndIndices();
+	void GeneratePerCellVerticesAndIndices(float xOffset, float zOffset, float du, float dv);
+	void GenerateSharedGridVerticesAndIndices(float xOffset, float zOffset, float du, float dv);
+	void SetGridVertex(TerrainVertex& vertex, unsigned int x, unsigned int z);
 	void GenerateNormals();
+	void GenerateCentralDifferenceNormals();
+	XMFLOAT3 GatherVertexNormal(const vector<XMFLOAT3>& cellNormals, unsigned int z, unsigned int x, int ownerZ, int ownerX);
+	void GetCellPosition(float x, float z, unsigned int& cellX, unsigned int& cellZ, float& u, float& v);
+	float GetHeightInCell(unsigned int cellX, unsigned int cellZ, float u, float v, XMFLOAT3 * normal);
+	bool RayCastCell(const XMFLOAT3& origin, const XMFLOAT3& direction, unsigned int cellX, unsigned int cellZ, float maximumDistance, TerrainRayHit& hit);
+	void ForEachRowBand(unsigned int count, const function<void(unsigned int, unsigned int)>& work);
+	bool UseLevelOfDetail();
+	bool UseSimplification();
+	void Simplify();
+	bool UseEditing();
+	bool UseCompactVertices();
+	unsigned int GetVertexStride();
+	void CalculateCompactVertexParameters();
+	void UploadVertices(UINT firstVertex, const TerrainVertex * vertices, UINT count);
+	void UpdateVertexFetchStatistics();
+	void CullOccludedChunks(const XMFLOAT3& localCameraPosition);
+	void CullChunksOutsideFrustum(const SceneFrustum& frustum);
+	void FindSkirtVertices();
+	bool EditCircle(float x, float z, float radius, const function<float(float, float)>& edit);
+	void UpdateVertices(unsigned int firstX, unsigned int firstZ, unsigned int endX, unsigned int endZ);
+	void UpdateSkirtVertices(unsigned int firstX, unsigned int firstZ, unsigned int endX, unsigned int endZ);
+	void UpdateBlendMap(unsigned int firstCellX, unsigned int firstCellZ, unsigned int endCellX, unsigned int endCellZ);
+	void BuildLevelsOfDetail();
 	void GenerateBuffers();
 	void BuildShaders();
 	void BuildVertexLayout();
 	void BuildConstantBuffer();
 	void BuildRendererStates();
-	void LoadTerrainTextures();
 	void GenerateBlendMap();
+	void BuildBlendMapMips();
+	void UpdateBlendMapMips(unsigned int firstX, unsigned int firstZ, unsigned int endX, unsigned int endZ);
+	void BuildBlendMapTexture();
+	void BuildLightMapTexture();
+	void UpdateLightMapTexture(unsigned int firstX, unsigned int firstZ, unsigned int endX, unsigned int endZ);
 	bool LoadHeightMap(wstring heightMapFilename);
+	bool GenerateHeightMap();
 };
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include "TerrainNormals.h"
+#include <immintrin.h>
+#include <cmath>
+
+// The normal at a sample is (-dh/dx, 1, -dh/dz) normalised.  The same operations are carried
+// out in the same order in the scalar and vector versions so that they give identical results.
+
+static inline XMFLOAT3 * GetNormal(XMFLOAT3 * normals, size_t normalStride, size_t index)
+{
+	return (XMFLOAT3 *)((BYTE *)normals + index * normalStride);
+}
+
+static inline void CalculateNormal(float left, float right, float xFactor, float up, float down, float zFactor, XMFLOAT3 * normal)
+{
+	float nx = (left - right) * xFactor;
+	float nz = (down - up) * zFactor;
+	float length = sqrtf(nx * nx + nz * nz + 1.0f);
+	normal->x = nx / length;
+	normal->y = 1.0f / length;
+	normal->z = nz / length;
+}
+
+// Calculates the normals of columns [firstColumn, endColumn) of a row.  Every column in the range must
+// have a neighbour on both sides.  The normal for column x goes to entry x - outputColumn of normals.
+static void CalculateInteriorNormalsScalar(const float * row, const float * upRow, const float * downRow, unsigned int firstColumn, unsigned int endColumn,
+										   float xFactor, float zFactor, XMFLOAT3 * normals, size_t normalStride, unsigned int outputColumn)
+{
+	for (unsigned int x = firstColumn; x < endColumn; x++)
+	{
+		CalculateNormal(row[x - 1], row[x + 1], xFactor, upRow[x], downRow[x], zFactor, GetNormal(normals, normalStride, x - outputColumn));
+	}
+}
+
+// Works out the neighbouring rows and the scale factors used for one row of the grid
+static void GetRowParameters(const float * heightValues, unsigned int numberOfXPoints, unsigned int numberOfZPoints, float spacing, float heightScale, unsigned int z,
+							 const float *& upRow, const float *& downRow, float& zFactor)
+{
+	unsigned int up = z > 0 ? z - 1 : z;
+	unsigned int down = z + 1 < numberOfZPoints ? z + 1 : z;
+	upRow = heightValues + (size_t)up * numberOfXPoints;
+	downRow = heightValues + (size_t)down * numberOfXPoints;
+	zFactor = heightScale / ((down - up) * spacing);
+}
+
+// Handles the first and last columns, which only have a neighbour on one side, if they are in [firstColumn, endColumn)
+static void CalculateEdgeNormals(const float * row, const float * upRow, const float * downRow, unsigned int numberOfXPoints, float spacing, float heightScale,
+								 float zFactor, unsigned int firstColumn, unsigned int endColumn, XMFLOAT3 * normals, size_t normalStride)
+{
+	if (numberOfXPoints < 2)
+	{
+		CalculateNormal(0.0f, 0.0f, 0.0f, upRow[0], downRow[0], zFactor, GetNormal(normals, normalStride, 0));
+		return;
+	}
+	float edgeXFactor = heightScale / spacing;
+	unsigned int last = numberOfXPoints - 1;
+	if (firstColumn == 0)
+	{
+		CalculateNormal(row[0], row[1], edgeXFactor, upRow[0], downRow[0], zFactor, GetNormal(normals, normalStride, 0));
+	}
+	if (endColumn == numberOfXPoints)
+	{
+		CalculateNormal(row[last - 1], row[last], edgeXFactor, upRow[last], downRow[last], zFactor, GetNormal(normals, normalStride, last - firstColumn));
+	}
+}
+
+void CalculateHeightFieldNormalsScalar(const float * heightValues, unsigned int numberOfXPoints, unsigned int numberOfZPoints,
+									   float spacing, float heightScale, unsigned int firstRow, unsigned int endRow,
+									   XMFLOAT3 * normals, size_t normalStride)
+{
+	float xFactor = heightScale / (2.0f * spacing);
+	for (unsigned int z = firstRow; z < endRow; z++)
+	{
+		const float * row = heightValues + (size_t)z * numberOfXPoints;
+		const float * upRow;
+		const float * downRow;
+		float zFactor;
+		GetRowParameters(heightValues, numberOfXPoints, numberOfZPoints, spacing, heightScale, z, upRow, downRow, zFactor);
+		XMFLOAT3 * rowNormals = GetNormal(normals, normalStride, (size_t)z * numberOfXPoints);
+		CalculateEdgeNormals(row, upRow, downRow, numberOfXPoints, spacing, heightScale, zFactor, 0, numberOfXPoints, rowNormals, normalStride);
+		if (numberOfXPoints > 2)
+		{
+			CalculateInteriorNormalsScalar(row, upRow, downRow, 1, numberOfXPoints - 1, xFactor, zFactor, rowNormals, normalStride, 0);
+		}
+	}
+}
+
+// Writes eight normals held as separate x, y and z components
+static inline void StoreNormals(const float * nx, const float * ny, const float * nz, XMFLOAT3 * normals, size_t normalStride, size_t index)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		XMFLOAT3 * normal = GetNormal(normals, normalStride, index + i);
+		normal->x = nx[i];
+		normal->y = ny[i];
+		normal->z = nz[i];
+	}
+}
+
+#if defined(__AVX2__)
+
+static unsigned int CalculateInteriorNormals8(const float * row, const float * upRow, const float * downRow, unsigned int firstColumn, unsigned int endColumn,
+											  float xFactor, float zFactor, XMFLOAT3 * normals, size_t normalStride, unsigned int outputColumn)
+{
+	__m256 xFactors = _mm256_set1_ps(xFactor);
+	__m256 zFactors = _mm256_set1_ps(zFactor);
+	__m256 one = _mm256_set1_ps(1.0f);
+	alignas(32) float nx[8];
+	alignas(32) float ny[8];
+	alignas(32) float nz[8];
+	unsigned int x = firstColumn;
+	for (; x + 8 <= endColumn; x += 8)
+	{
+		__m256 dx = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(row + x - 1), _mm256_loadu_ps(row + x + 1)), xFactors);
+		__m256 dz = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(downRow + x), _mm256_loadu_ps(upRow + x)), zFactors);
+		__m256 lengthSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dz, dz)), one);
+		__m256 length = _mm256_sqrt_ps(lengthSquared);
+		_mm256_store_ps(nx, _mm256_div_ps(dx, length));
+		_mm256_store_ps(ny, _mm256_div_ps(one, length));
+		_mm256_store_ps(nz, _mm256_div_ps(dz, length));
+		StoreNormals(nx, ny, nz, normals, normalStride, x - outputColumn);
+	}
+	return x;
+}
+
+#else
+
+static unsigned int CalculateInteriorNormals8(const float * row, const float * upRow, const float * downRow, unsigned int firstColumn, unsigned int endColumn,
+											  float xFactor, float zFactor, XMFLOAT3 * normals, size_t normalStride, unsigned int outputColumn)
+{
+	__m128 xFactors = _mm_set1_ps(xFactor);
+	__m128 zFactors = _mm_set1_ps(zFactor);
+	__m128 one = _mm_set1_ps(1.0f);
+	alignas(16) float nx[8];
+	alignas(16) float ny[8];
+	alignas(16) float nz[8];
+	unsigned int x = firstColumn;
+	for (; x + 8 <= endColumn; x += 8)
+	{
+		// Two groups of four samples per iteration
+		for (unsigned int half = 0; half < 8; half += 4)
+		{
+			unsigned int column = x + half;
+			__m128 dx = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(row + column - 1), _mm_loadu_ps(row + column + 1)), xFactors);
+			__m128 dz = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(downRow + column), _mm_loadu_ps(upRow + column)), zFactors);
+			__m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dz, dz)), one);
+			__m128 length = _mm_sqrt_ps(lengthSquared);
+			_mm_store_ps(nx + half, _mm_div_ps(dx, length));
+			_mm_store_ps(ny + half, _mm_div_ps(one, length));
+			_mm_store_ps(nz + half, _mm_div_ps(dz, length));
+		}
+		StoreNormals(nx, ny, nz, normals, normalStride, x - outputColumn);
+	}
+	return x;
+}
+
+#endif
+
+void CalculateHeightFieldNormals(const float * heightValues, unsigned int numberOfXPoints, unsigned int numberOfZPoints,
+								 float spacing, float heightScale, unsigned int firstRow, unsigned int endRow,
+								 XMFLOAT3 * normals, size_t normalStride)
+{
+	CalculateHeightFieldNormalsInArea(heightValues, numberOfXPoints, numberOfZPoints, spacing, heightScale, 0, numberOfXPoints, firstRow, endRow,
+									  GetNormal(normals, normalStride, (size_t)firstRow * numberOfXPoints), normalStride, numberOfXPoints * normalStride);
+}
+
+void CalculateHeightFieldNormalsInArea(const float * heightValues, unsigned int numberOfXPoints, unsigned int numberOfZPoints,
+									   float spacing, float heightScale, unsigned int firstColumn, unsigned int endColumn,
+									   unsigned int firstRow, unsigned int endRow, XMFLOAT3 * normals, size_t normalStride, size_t normalRowPitch)
+{
+	float xFactor = heightScale / (2.0f * spacing);
+	unsigned int firstInterior = firstColumn > 0 ? firstColumn : 1;
+	unsigned int endInterior = endColumn < numberOfXPoints ? endColumn : numberOfXPoints - 1;
+	for (unsigned int z = firstRow; z < endRow; z++)
+	{
+		const float * row = heightValues + (size_t)z * numberOfXPoints;
+		const float * upRow;
+		const float * downRow;
+		float zFactor;
+		GetRowParameters(heightValues, numberOfXPoints, numberOfZPoints, spacing, heightScale, z, upRow, downRow, zFactor);
+		XMFLOAT3 * rowNormals = (XMFLOAT3 *)((BYTE *)normals + (z - firstRow) * normalRowPitch);
+		CalculateEdgeNormals(row, upRow, downRow, numberOfXPoints, spacing, heightScale, zFactor, firstColumn, endColumn, rowNormals, normalStride);
+		if (firstInterior < endInterior)
+		{
+			// Vector loop for most of the row, then finish off any remainder one sample at a time
+			unsigned int x = CalculateInteriorNormals8(row, upRow, downRow, firstInterior, endInterior, xFactor, zFactor, rowNormals, normalStride, firstColumn);
+			CalculateInteriorNormalsScalar(row, upRow, downRow, x, endInterior, xFactor, zFactor, rowNormals, normalStride, firstColumn);
+		}
+	}
+}
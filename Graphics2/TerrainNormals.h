@@ -0,0 +1,30 @@
+#pragma once
+#include "DirectXCore.h"
+
+// Calculates vertex normals straight from a grid of height values using central differences
+// (one-sided differences along the edges of the grid).  Column x, row z of the grid is assumed to be at
+// world position (x * spacing, height * heightScale, -z * spacing), matching the terrain vertices.
+//
+// Only rows [firstRow, endRow) are calculated, so the work can be split into bands or limited to the
+// rows touched by an edit.  The normal for column x, row z is written to
+// (BYTE *)normals + (z * numberOfXPoints + x) * normalStride, so normals can be written straight
+// into an array of vertices.
+//
+// Interior samples are processed eight at a time using AVX2 when it is enabled at compile time,
+// otherwise with SSE2.
+void CalculateHeightFieldNormals(const float * heightValues, unsigned int numberOfXPoints, unsigned int numberOfZPoints,
+								 float spacing, float heightScale, unsigned int firstRow, unsigned int endRow,
+								 XMFLOAT3 * normals, size_t normalStride);
+
+// As CalculateHeightFieldNormals, but only for columns [firstColumn, endColumn) of rows [firstRow, endRow).
+// The normal for column x, row z is written to
+// (BYTE *)normals + (z - firstRow) * normalRowPitch + (x - firstColumn) * normalStride, so the normals of
+// a small area can be written into an array of their own.
+void CalculateHeightFieldNormalsInArea(const float * heightValues, unsigned int numberOfXPoints, unsigned int numberOfZPoints,
+									   float spacing, float heightScale, unsigned int firstColumn, unsigned int endColumn,
+									   unsigned int firstRow, unsigned int endRow, XMFLOAT3 * normals, size_t normalStride, size_t normalRowPitch);
+
+// Scalar version of CalculateHeightFieldNormals.  Produces exactly the same results.
+void CalculateHeightFieldNormalsScalar(const float * heightValues, unsigned int numberOfXPoints, unsigned int numberOfZPoints,
+									   float spacing, float heightScale, unsigned int firstRow, unsigned int endRow,
+									   XMFLOAT3 * normals, size_t normalStride);
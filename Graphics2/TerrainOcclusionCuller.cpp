@@ -0,0 +1,226 @@
+#include "TerrainOcclusionCuller.h"
+#include <algorithm>
+#include <cmath>
+
+// The number of horizon sectors around the camera.  Each one covers about 0.7 degrees.
+const int NumberOfSectors = 512;
+const float SectorsPerAngle = NumberOfSectors / 4.0f;
+
+// Blocks wider than this fraction of their distance from the camera are split into smaller blocks
+const float MaximumOccluderSize = 0.25f;
+
+// Maps the direction (x, z) to [0, 4) such that the value increases with the angle of the direction
+// from the X axis, i.e. the angle measured in quarter turns along the sides of a diamond
+static inline float GetDiamondAngle(float x, float z)
+{
+	if (z >= 0.0f)
+	{
+		return x >= 0.0f ? z / (x + z) : 1.0f - x / (z - x);
+	}
+	return x < 0.0f ? 2.0f - z / (-x - z) : 3.0f + x / (x - z);
+}
+
+static inline int WrapSector(int sector)
+{
+	return sector & (NumberOfSectors - 1);
+}
+
+TerrainOcclusionCuller::TerrainOcclusionCuller()
+{
+	_heightPyramid = nullptr;
+	_occluderLevel = 0;
+}
+
+TerrainOcclusionCuller::~TerrainOcclusionCuller()
+{
+}
+
+void TerrainOcclusionCuller::Initialise(const TerrainHeightPyramid * heightPyramid, float spacing, float worldHeight, float originX, float originZ, unsigned int occluderLevel)
+{
+	_heightPyramid = heightPyramid;
+	_spacing = spacing;
+	_worldHeight = worldHeight;
+	_originX = originX;
+	_originZ = originZ;
+	_occluderLevel = occluderLevel < heightPyramid->GetLevelCount() ? occluderLevel : heightPyramid->GetLevelCount() - 1;
+	_horizons.resize(NumberOfSectors);
+}
+
+// Returns false if the rectangle contains (or touches) the camera, in which case it covers every direction
+bool TerrainOcclusionCuller::CalculateExtent(const XMFLOAT3& cameraPosition, float minimumX, float minimumZ, float maximumX, float maximumZ, Extent& extent)
+{
+	float nearX = cameraPosition.x < minimumX ? minimumX - cameraPosition.x : (cameraPosition.x > maximumX ? cameraPosition.x - maximumX : 0.0f);
+	float nearZ = cameraPosition.z < minimumZ ? minimumZ - cameraPosition.z : (cameraPosition.z > maximumZ ? cameraPosition.z - maximumZ : 0.0f);
+	if (nearX == 0.0f && nearZ == 0.0f)
+	{
+		return false;
+	}
+	float farX = fmaxf(fabsf(minimumX - cameraPosition.x), fabsf(maximumX - cameraPosition.x));
+	float farZ = fmaxf(fabsf(minimumZ - cameraPosition.z), fabsf(maximumZ - cameraPosition.z));
+	extent.NearDistance = sqrtf(nearX * nearX + nearZ * nearZ);
+	extent.FarDistance = sqrtf(farX * farX + farZ * farZ);
+
+	// The rectangle is on one side of the camera, so it covers less than half a turn and the corners are
+	// all within two of the angle of its centre (allowing for the angles wrapping round from 4 to 0)
+	float centreAngle = GetDiamondAngle((minimumX + maximumX) * 0.5f - cameraPosition.x, (minimumZ + maximumZ) * 0.5f - cameraPosition.z);
+	float corners[4][2] = { { minimumX, minimumZ }, { maximumX, minimumZ }, { minimumX, maximumZ }, { maximumX, maximumZ } };
+	float firstOffset = 0.0f;
+	float lastOffset = 0.0f;
+	for (int i = 0; i < 4; i++)
+	{
+		float offset = GetDiamondAngle(corners[i][0] - cameraPosition.x, corners[i][1] - cameraPosition.z) - centreAngle;
+		if (offset > 2.0f)
+		{
+			offset -= 4.0f;
+		}
+		else if (offset < -2.0f)
+		{
+			offset += 4.0f;
+		}
+		firstOffset = fminf(firstOffset, offset);
+		lastOffset = fmaxf(lastOffset, offset);
+	}
+	extent.FirstAngle = centreAngle + firstOffset;
+	extent.LastAngle = centreAngle + lastOffset;
+	return true;
+}
+
+void TerrainOcclusionCuller::BuildOccluders(const XMFLOAT3& cameraPosition)
+{
+	_occluders.clear();
+	AddOccluders(cameraPosition, _heightPyramid->GetLevelCount() - 1, 0, 0);
+	sort(_occluders.begin(), _occluders.end(), [](const Occluder& a, const Occluder& b) { return a.FarDistance < b.FarDistance; });
+}
+
+// Blocks that are large compared to their distance from the camera are split into the four blocks below
+// them, down to the finest occluder level, so the occluders get coarser with distance
+void TerrainOcclusionCuller::AddOccluders(const XMFLOAT3& cameraPosition, unsigned int level, unsigned int x, unsigned int z)
+{
+	if (x >= _heightPyramid->GetLevelWidth(level) || z >= _heightPyramid->GetLevelHeight(level))
+	{
+		return;
+	}
+	unsigned int numberOfColumns = _heightPyramid->GetLevelWidth(0);
+	unsigned int numberOfRows = _heightPyramid->GetLevelHeight(0);
+	unsigned int firstCellX = x << level;
+	unsigned int firstCellZ = z << level;
+	unsigned int endCellX = (x + 1) << level;
+	unsigned int endCellZ = (z + 1) << level;
+	endCellX = endCellX < numberOfColumns ? endCellX : numberOfColumns;
+	endCellZ = endCellZ < numberOfRows ? endCellZ : numberOfRows;
+	Extent extent;
+	bool outside = CalculateExtent(cameraPosition, _originX + firstCellX * _spacing, _originZ - endCellZ * _spacing,
+								   _originX + endCellX * _spacing, _originZ - firstCellZ * _spacing, extent);
+	if (level > _occluderLevel && (!outside || (float)(1 << level) * _spacing > extent.NearDistance * MaximumOccluderSize))
+	{
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			AddOccluders(cameraPosition, level - 1, 2 * x + (i & 1), 2 * z + (i >> 1));
+		}
+		return;
+	}
+	if (!outside)
+	{
+		return;
+	}
+
+	// Only the sectors that lie entirely within the block are blocked by it
+	int firstSector = (int)ceilf(extent.FirstAngle * SectorsPerAngle);
+	int endSector = (int)floorf(extent.LastAngle * SectorsPerAngle);
+	if (firstSector >= endSector)
+	{
+		return;
+	}
+
+	// A line of sight crosses the block somewhere between its near and far distances, so use
+	// whichever gives the lowest slope to the block's lowest point
+	float rise = _heightPyramid->GetRange(level, x, z).Minimum * _worldHeight - cameraPosition.y;
+	Occluder occluder;
+	occluder.FarDistance = extent.FarDistance;
+	occluder.Slope = rise / (rise > 0.0f ? extent.FarDistance : extent.NearDistance);
+	occluder.FirstSector = firstSector;
+	occluder.EndSector = endSector;
+	_occluders.push_back(occluder);
+}
+
+bool TerrainOcclusionCuller::IsHidden(const ChunkTest& chunkTest)
+{
+	for (int sector = chunkTest.FirstSector; sector < chunkTest.EndSector; sector++)
+	{
+		if (_horizons[WrapSector(sector)] <= chunkTest.Slope)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+unsigned int TerrainOcclusionCuller::Cull(const XMFLOAT3& cameraPosition, const TerrainChunk * chunks, vector<TerrainChunkDraw>& drawList)
+{
+	if (_heightPyramid == nullptr || drawList.size() == 0)
+	{
+		return 0;
+	}
+
+	// Chunks that contain the camera can't be hidden, so they aren't tested
+	_chunkTests.clear();
+	for (unsigned int i = 0; i < (unsigned int)drawList.size(); i++)
+	{
+		const TerrainChunk& chunk = chunks[drawList[i].ChunkIndex];
+		Extent extent;
+		if (!CalculateExtent(cameraPosition, chunk.BoundsMin.x, chunk.BoundsMin.z, chunk.BoundsMax.x, chunk.BoundsMax.z, extent))
+		{
+			continue;
+		}
+		float rise = chunk.BoundsMax.y - cameraPosition.y;
+		ChunkTest chunkTest;
+		chunkTest.NearDistance = extent.NearDistance;
+		chunkTest.Slope = rise / (rise > 0.0f ? extent.NearDistance : extent.FarDistance);
+		chunkTest.FirstSector = (int)floorf(extent.FirstAngle * SectorsPerAngle);
+		chunkTest.EndSector = (int)floorf(extent.LastAngle * SectorsPerAngle) + 1;
+		chunkTest.DrawIndex = i;
+		_chunkTests.push_back(chunkTest);
+	}
+	sort(_chunkTests.begin(), _chunkTests.end(), [](const ChunkTest& a, const ChunkTest& b) { return a.NearDistance < b.NearDistance; });
+
+	BuildOccluders(cameraPosition);
+	fill(_horizons.begin(), _horizons.end(), -INFINITY);
+	_hidden.assign(drawList.size(), false);
+
+	// Each chunk is tested against the horizons of the blocks that are entirely nearer than it is
+	size_t nextOccluder = 0;
+	unsigned int hiddenCount = 0;
+	for (size_t i = 0; i < _chunkTests.size(); i++)
+	{
+		const ChunkTest& chunkTest = _chunkTests[i];
+		for (; nextOccluder < _occluders.size() && _occluders[nextOccluder].FarDistance <= chunkTest.NearDistance; nextOccluder++)
+		{
+			const Occluder& occluder = _occluders[nextOccluder];
+			for (int sector = occluder.FirstSector; sector < occluder.EndSector; sector++)
+			{
+				float& horizon = _horizons[WrapSector(sector)];
+				horizon = fmaxf(horizon, occluder.Slope);
+			}
+		}
+		if (IsHidden(chunkTest))
+		{
+			_hidden[chunkTest.DrawIndex] = true;
+			hiddenCount++;
+		}
+	}
+	if (hiddenCount == 0)
+	{
+		return 0;
+	}
+
+	size_t kept = 0;
+	for (size_t i = 0; i < drawList.size(); i++)
+	{
+		if (!_hidden[i])
+		{
+			drawList[kept++] = drawList[i];
+		}
+	}
+	drawList.resize(kept);
+	return hiddenCount;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "core.h"
+#include "DirectXCore.h"
+#include "TerrainHeightPyramid.h"
+#include "TerrainQuadTree.h"
+#include <vector>
+
+using namespace std;
+
+// Finds terrain chunks that are hidden behind nearer terrain using horizons.
+//
+// The directions around the camera are split into sectors.  Each sector holds a horizon: the steepest
+// slope (height above the camera over distance) at which the terrain is known to block the view.  Blocks
+// of cells from the height pyramid are the occluders, finer near the camera and coarser further away so
+// that each one covers a similar number of sectors.  The terrain over a block is
+// never lower than the block's minimum height, so any line of sight that crosses the block below that
+// height is blocked.  Chunks and occluders are taken in order of distance, and each chunk is tested
+// against the horizons built from the occluders entirely in front of it.  A chunk is hidden if the
+// steepest slope to any point of its bounding box is below the horizon in every sector it covers.
+//
+// Everything is conservative, so a chunk is never culled if any part of it could be seen.  Sectors are
+// measured with a "diamond angle", which increases with the true angle but doesn't need atan2.
+class TerrainOcclusionCuller
+{
+public:
+	TerrainOcclusionCuller();
+	~TerrainOcclusionCuller();
+
+	// Column x, row z of the height grid is at (originX + x * spacing, height * worldHeight, originZ - z * spacing),
+	// as in TerrainQuadTree::Build.  occluderLevel is the finest pyramid level used for the occluders (level n
+	// covers 2^n * 2^n cells).  Finer levels find more occluded chunks but take longer.
+	void Initialise(const TerrainHeightPyramid * heightPyramid, float spacing, float worldHeight, float originX, float originZ, unsigned int occluderLevel);
+
+	// Removes the chunks that are hidden from cameraPosition from drawList, keeping the order of the rest.
+	// Returns the number of chunks removed.
+	unsigned int Cull(const XMFLOAT3& cameraPosition, const TerrainChunk * chunks, vector<TerrainChunkDraw>& drawList);
+
+private:
+	// The part of the view covered by a rectangle of the terrain
+	struct Extent
+	{
+		float			NearDistance;
+		float			FarDistance;
+		float			FirstAngle;			// Diamond angles, FirstAngle <= LastAngle (but they can be outside 0 - 4)
+		float			LastAngle;
+	};
+
+	struct Occluder
+	{
+		float			FarDistance;
+		float			Slope;
+		int				FirstSector;		// Sectors entirely covered by the occluder, which can be outside
+		int				EndSector;			// 0 to NumberOfSectors - 1 and are wrapped when used
+	};
+
+	struct ChunkTest
+	{
+		float			NearDistance;
+		float			Slope;
+		int				FirstSector;		// Sectors the chunk overlaps
+		int				EndSector;
+		unsigned int	DrawIndex;
+	};
+
+	const TerrainHeightPyramid *	_heightPyramid;
+	float							_spacing;
+	float							_worldHeight;
+	float							_originX;
+	float							_originZ;
+	unsigned int					_occluderLevel;
+
+	vector<float>					_horizons;
+	vector<Occluder>				_occluders;
+	vector<ChunkTest>				_chunkTests;
+	vector<bool>					_hidden;
+
+	bool CalculateExtent(const XMFLOAT3& cameraPosition, float minimumX, float minimumZ, float maximumX, float maximumZ, Extent& extent);
+	void BuildOccluders(const XMFLOAT3& cameraPosition);
+	void AddOccluders(const XMFLOAT3& cameraPosition, unsigned int level, unsigned int x, unsigned int z);
+	bool IsHidden(const ChunkTest& chunkTest);
+};
@@ -0,0 +1,420 @@
+#include "TerrainQuadTree.h"
+#include <algorithm>
+#include <cfloat>
+
+TerrainQuadTree::TerrainQuadTree()
+{
+	_heightValues = nullptr;
+	_heightPyramid = nullptr;
+	_numberOfXPoints = 0;
+	_numberOfZPoints = 0;
+	_chunkSize = 0;
+	_levelCount = 0;
+}
+
+TerrainQuadTree::~TerrainQuadTree()
+{
+}
+
+void TerrainQuadTree::Build(const float * heightValues, const TerrainHeightPyramid * heightPyramid, unsigned int numberOfXPoints, unsigned int numberOfZPoints,
+							float spacing, float worldHeight, float originX, float originZ, unsigned int chunkSize)
+{
+	_heightValues = heightValues;
+	_heightPyramid = heightPyramid;
+	_numberOfXPoints = numberOfXPoints;
+	_numberOfZPoints = numberOfZPoints;
+	_spacing = spacing;
+	_worldHeight = worldHeight;
+	_originX = originX;
+	_originZ = originZ;
+	_chunkSize = chunkSize;
+	_chunks.clear();
+
+	// Work out how many levels are needed for a single root chunk to cover the whole grid
+	unsigned int numberOfCells = max(_numberOfXPoints, _numberOfZPoints) - 1;
+	unsigned int rootSize = _chunkSize;
+	_levelCount = 1;
+	while (rootSize < numberOfCells)
+	{
+		rootSize *= 2;
+		_levelCount++;
+	}
+	BuildChunk(0, 0, _levelCount - 1);
+	FindParents();
+}
+
+void TerrainQuadTree::Restore(const TerrainChunk * chunks, size_t numberOfChunks, unsigned int chunkSize)
+{
+	_heightValues = nullptr;
+	_heightPyramid = nullptr;
+	_chunkSize = chunkSize;
+	_chunks.assign(chunks, chunks + numberOfChunks);
+
+	// The root chunk comes first
+	_levelCount = numberOfChunks > 0 ? _chunks[0].Level + 1 : 0;
+	FindParents();
+}
+
+void TerrainQuadTree::FindParents()
+{
+	_parentIndices.assign(_chunks.size(), -1);
+	for (size_t chunkIndex = 0; chunkIndex < _chunks.size(); chunkIndex++)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			if (_chunks[chunkIndex].Children[i] != -1)
+			{
+				_parentIndices[_chunks[chunkIndex].Children[i]] = (int)chunkIndex;
+			}
+		}
+	}
+}
+
+int TerrainQuadTree::BuildChunk(unsigned int startX, unsigned int startZ, unsigned int level)
+{
+	if (startX >= _numberOfXPoints - 1 || startZ >= _numberOfZPoints - 1)
+	{
+		return -1;
+	}
+	unsigned int size = _chunkSize << level;
+
+	TerrainChunk chunk;
+	chunk.StartX = startX;
+	chunk.StartZ = startZ;
+	chunk.EndX = min(startX + size, _numberOfXPoints - 1);
+	chunk.EndZ = min(startZ + size, _numberOfZPoints - 1);
+	chunk.Level = level;
+	chunk.SkirtDepth = 0.0f;
+	chunk.StartIndex = 0;
+	chunk.IndexCount = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		chunk.Children[i] = -1;
+	}
+
+	int chunkIndex = (int)_chunks.size();
+	_chunks.push_back(chunk);
+	if (level == 0)
+	{
+		CalculateBounds(_chunks[chunkIndex]);
+		_chunks[chunkIndex].GeometricError = 0.0f;
+		return chunkIndex;
+	}
+
+	// Note that _chunks can be reallocated while the children are built, so
+	// the chunk is only accessed through its index from here on
+	unsigned int halfSize = size / 2;
+	int children[4];
+	children[0] = BuildChunk(startX, startZ, level - 1);
+	children[1] = BuildChunk(startX + halfSize, startZ, level - 1);
+	children[2] = BuildChunk(startX, startZ + halfSize, level - 1);
+	children[3] = BuildChunk(startX + halfSize, startZ + halfSize, level - 1);
+
+	// The coarser surface is interpolated from the same samples, so the
+	// children's bounds also bound this chunk.  The error is made at least as large
+	// as the children's so that it never decreases towards the root.
+	XMFLOAT3 boundsMin = _chunks[children[0]].BoundsMin;
+	XMFLOAT3 boundsMax = _chunks[children[0]].BoundsMax;
+	float error = CalculateGeometricError(_chunks[chunkIndex]);
+	for (int i = 0; i < 4; i++)
+	{
+		_chunks[chunkIndex].Children[i] = children[i];
+		if (children[i] != -1)
+		{
+			const TerrainChunk& child = _chunks[children[i]];
+			boundsMin = XMFLOAT3(min(boundsMin.x, child.BoundsMin.x), min(boundsMin.y, child.BoundsMin.y), min(boundsMin.z, child.BoundsMin.z));
+			boundsMax = XMFLOAT3(max(boundsMax.x, child.BoundsMax.x), max(boundsMax.y, child.BoundsMax.y), max(boundsMax.z, child.BoundsMax.z));
+			error = max(error, child.GeometricError);
+		}
+	}
+	_chunks[chunkIndex].BoundsMin = boundsMin;
+	_chunks[chunkIndex].BoundsMax = boundsMax;
+	_chunks[chunkIndex].GeometricError = error;
+	return chunkIndex;
+}
+
+void TerrainQuadTree::CalculateBounds(TerrainChunk& chunk)
+{
+	// The chunk's samples run from StartX to EndX, so its cells run from StartX to EndX - 1
+	TerrainHeightRange range = _heightPyramid->GetHeightRange(chunk.StartX, chunk.StartZ, chunk.EndX, chunk.EndZ);
+	chunk.BoundsMin = XMFLOAT3(_originX + chunk.StartX * _spacing, range.Minimum * _worldHeight, _originZ - chunk.EndZ * _spacing);
+	chunk.BoundsMax = XMFLOAT3(_originX + chunk.EndX * _spacing, range.Maximum * _worldHeight, _originZ - chunk.StartZ * _spacing);
+}
+
+void TerrainQuadTree::UpdateHeights(const TerrainHeightPyramid& heightPyramid, float worldHeight, unsigned int firstX, unsigned int firstZ,
+								   unsigned int endX, unsigned int endZ, float heightChange)
+{
+	if (!_chunks.empty() && firstX < endX && firstZ < endZ)
+	{
+		UpdateChunkHeights(0, heightPyramid, worldHeight, firstX, firstZ, endX, endZ, heightChange);
+	}
+}
+
+void TerrainQuadTree::UpdateChunkHeights(unsigned int chunkIndex, const TerrainHeightPyramid& heightPyramid, float worldHeight, unsigned int firstX, unsigned int firstZ,
+										 unsigned int endX, unsigned int endZ, float heightChange)
+{
+	TerrainChunk& chunk = _chunks[chunkIndex];
+	if (chunk.StartX >= endX || chunk.StartZ >= endZ || chunk.EndX < firstX || chunk.EndZ < firstZ)
+	{
+		return;
+	}
+	if (chunk.Level == 0)
+	{
+		TerrainHeightRange range = heightPyramid.GetHeightRange(chunk.StartX, chunk.StartZ, chunk.EndX, chunk.EndZ);
+		chunk.BoundsMin.y = range.Minimum * worldHeight;
+		chunk.BoundsMax.y = range.Maximum * worldHeight;
+		return;
+	}
+
+	// As in BuildChunk, the children's bounds also bound this chunk
+	chunk.BoundsMin.y = FLT_MAX;
+	chunk.BoundsMax.y = -FLT_MAX;
+	chunk.GeometricError += 2.0f * heightChange;
+	for (int i = 0; i < 4; i++)
+	{
+		if (chunk.Children[i] != -1)
+		{
+			UpdateChunkHeights(chunk.Children[i], heightPyramid, worldHeight, firstX, firstZ, endX, endZ, heightChange);
+			const TerrainChunk& child = _chunks[chunk.Children[i]];
+			chunk.BoundsMin.y = min(chunk.BoundsMin.y, child.BoundsMin.y);
+			chunk.BoundsMax.y = max(chunk.BoundsMax.y, child.BoundsMax.y);
+			chunk.GeometricError = max(chunk.GeometricError, child.GeometricError);
+		}
+	}
+}
+
+// Works out the positions of the samples used along one side of a chunk.  The last
+// sample is always the end of the chunk, even if that gives a narrower final cell.
+void TerrainQuadTree::GetSamplePositions(unsigned int start, unsigned int end, unsigned int stride, vector<unsigned int>& positions)
+{
+	positions.clear();
+	for (unsigned int position = start; position < end; position += stride)
+	{
+		positions.push_back(position);
+	}
+	positions.push_back(end);
+}
+
+float TerrainQuadTree::CalculateGeometricError(const TerrainChunk& chunk)
+{
+	vector<unsigned int> xPositions;
+	vector<unsigned int> zPositions;
+	unsigned int stride = 1 << chunk.Level;
+	GetSamplePositions(chunk.StartX, chunk.EndX, stride, xPositions);
+	GetSamplePositions(chunk.StartZ, chunk.EndZ, stride, zPositions);
+
+	// Compare every full resolution sample against the coarse triangles drawn over it.
+	// The triangles are split along the top right to bottom left diagonal in the same
+	// way as the full resolution grid.
+	float error = 0.0f;
+	for (size_t j = 0; j + 1 < zPositions.size(); j++)
+	{
+		unsigned int z0 = zPositions[j];
+		unsigned int z1 = zPositions[j + 1];
+		for (size_t i = 0; i + 1 < xPositions.size(); i++)
+		{
+			unsigned int x0 = xPositions[i];
+			unsigned int x1 = xPositions[i + 1];
+			float topLeft = GetHeight(x0, z0);
+			float topRight = GetHeight(x1, z0);
+			float bottomLeft = GetHeight(x0, z1);
+			float bottomRight = GetHeight(x1, z1);
+			for (unsigned int z = z0; z <= z1; z++)
+			{
+				float v = (float)(z - z0) / (z1 - z0);
+				for (unsigned int x = x0; x <= x1; x++)
+				{
+					float u = (float)(x - x0) / (x1 - x0);
+					float height;
+					if (u + v <= 1.0f)
+					{
+						height = topLeft + u * (topRight - topLeft) + v * (bottomLeft - topLeft);
+					}
+					else
+					{
+						height = bottomRight + (1.0f - u) * (bottomLeft - bottomRight) + (1.0f - v) * (topRight - bottomRight);
+					}
+					error = max(error, fabsf(height - GetHeight(x, z)));
+				}
+			}
+		}
+	}
+	return error * _worldHeight;
+}
+
+void TerrainQuadTree::GenerateIndices(vector<UINT>& indices, vector<TerrainSkirtVertex>& skirtVertices, UINT firstSkirtVertex)
+{
+	vector<unsigned int> xPositions;
+	vector<unsigned int> zPositions;
+	vector<UINT> edge;
+	for (unsigned int chunkIndex = 0; chunkIndex < (unsigned int)_chunks.size(); chunkIndex++)
+	{
+		TerrainChunk& chunk = _chunks[chunkIndex];
+		unsigned int stride = 1 << chunk.Level;
+		GetSamplePositions(chunk.StartX, chunk.EndX, stride, xPositions);
+		GetSamplePositions(chunk.StartZ, chunk.EndZ, stride, zPositions);
+		chunk.StartIndex = (UINT)indices.size();
+
+		for (size_t j = 0; j + 1 < zPositions.size(); j++)
+		{
+			for (size_t i = 0; i + 1 < xPositions.size(); i++)
+			{
+				UINT topLeft = zPositions[j] * _numberOfXPoints + xPositions[i];
+				UINT topRight = zPositions[j] * _numberOfXPoints + xPositions[i + 1];
+				UINT bottomLeft = zPositions[j + 1] * _numberOfXPoints + xPositions[i];
+				UINT bottomRight = zPositions[j + 1] * _numberOfXPoints + xPositions[i + 1];
+
+				// First triangle
+				indices.push_back(topLeft);
+				indices.push_back(topRight);
+				indices.push_back(bottomLeft);
+				// Second triangle
+				indices.push_back(bottomLeft);
+				indices.push_back(topRight);
+				indices.push_back(bottomRight);
+			}
+		}
+
+		// Walk round the edge of the chunk anticlockwise (when viewed from above) so that
+		// the skirt triangles face outwards
+		edge.clear();
+		size_t lastX = xPositions.size() - 1;
+		size_t lastZ = zPositions.size() - 1;
+		for (size_t i = lastX; i > 0; i--)
+		{
+			edge.push_back(zPositions[0] * _numberOfXPoints + xPositions[i]);
+		}
+		for (size_t j = 0; j < lastZ; j++)
+		{
+			edge.push_back(zPositions[j] * _numberOfXPoints + xPositions[0]);
+		}
+		for (size_t i = 0; i < lastX; i++)
+		{
+			edge.push_back(zPositions[lastZ] * _numberOfXPoints + xPositions[i]);
+		}
+		for (size_t j = lastZ; j > 0; j--)
+		{
+			edge.push_back(zPositions[j] * _numberOfXPoints + xPositions[lastX]);
+		}
+
+		chunk.SkirtDepth = CalculateSkirtDepth(chunkIndex);
+		UINT firstChunkSkirtVertex = firstSkirtVertex + (UINT)skirtVertices.size();
+		for (size_t i = 0; i < edge.size(); i++)
+		{
+			TerrainSkirtVertex skirtVertex;
+			skirtVertex.SourceVertex = edge[i];
+			skirtVertex.Depth = chunk.SkirtDepth;
+			skirtVertices.push_back(skirtVertex);
+		}
+		for (size_t i = 0; i < edge.size(); i++)
+		{
+			size_t next = (i + 1) % edge.size();
+			UINT skirt = firstChunkSkirtVertex + (UINT)i;
+			UINT nextSkirt = firstChunkSkirtVertex + (UINT)next;
+			indices.push_back(edge[i]);
+			indices.push_back(edge[next]);
+			indices.push_back(skirt);
+			indices.push_back(skirt);
+			indices.push_back(edge[next]);
+			indices.push_back(nextSkirt);
+		}
+		chunk.IndexCount = (UINT)indices.size() - chunk.StartIndex;
+	}
+}
+
+// Where two chunks meet, the vertices along the finer edge are exact heights and the coarser edge is within
+// its chunk's error of them, so the gap is no more than the coarser chunk's error.  A chunk's skirt therefore
+// has to reach down by its own error (for finer neighbours below it) and by the error of the coarsest chunk
+// that can be selected across each of its edges (for coarser neighbours below it).  Selection doesn't limit
+// how many levels apart neighbours are, so the coarsest neighbour is the largest chunk across the edge that
+// doesn't also contain this one.  Errors never decrease towards the root, so that chunk's error also covers
+// any of its descendants that could be selected instead.
+float TerrainQuadTree::CalculateSkirtDepth(unsigned int chunkIndex)
+{
+	const TerrainChunk& chunk = _chunks[chunkIndex];
+	float depth = max(chunk.GeometricError, _spacing);
+
+	// A cell just across each edge (the whole of an edge is always inside the same chunk at this level and above)
+	int across[4];
+	across[0] = chunk.StartX > 0 ? FindChunkAcross(chunkIndex, chunk.StartX - 1, chunk.StartZ) : -1;
+	across[1] = chunk.StartZ > 0 ? FindChunkAcross(chunkIndex, chunk.StartX, chunk.StartZ - 1) : -1;
+	across[2] = FindChunkAcross(chunkIndex, chunk.EndX, chunk.StartZ);
+	across[3] = FindChunkAcross(chunkIndex, chunk.StartX, chunk.EndZ);
+	for (int i = 0; i < 4; i++)
+	{
+		if (across[i] != -1)
+		{
+			depth = max(depth, _chunks[across[i]].GeometricError);
+		}
+	}
+	return depth;
+}
+
+// Finds the largest chunk containing the given cell that doesn't contain the chunk itself: the child of their
+// lowest common ancestor on the cell's side.  Returns -1 if the cell is outside the terrain.
+int TerrainQuadTree::FindChunkAcross(unsigned int chunkIndex, unsigned int cellX, unsigned int cellZ)
+{
+	int parent = _parentIndices[chunkIndex];
+	while (parent != -1 && !ContainsCell(_chunks[parent], cellX, cellZ))
+	{
+		parent = _parentIndices[parent];
+	}
+	if (parent == -1)
+	{
+		return -1;
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		int child = _chunks[parent].Children[i];
+		if (child != -1 && ContainsCell(_chunks[child], cellX, cellZ))
+		{
+			return child;
+		}
+	}
+	return -1;
+}
+
+void TerrainQuadTree::SelectChunks(const XMFLOAT3& cameraPosition, float errorScale, float maximumScreenError, vector<TerrainChunkDraw>& drawList)
+{
+	drawList.clear();
+	if (_chunks.size() > 0)
+	{
+		SelectChunk(0, cameraPosition, errorScale, maximumScreenError, drawList);
+	}
+}
+
+void TerrainQuadTree::SelectChunk(unsigned int chunkIndex, const XMFLOAT3& cameraPosition, float errorScale, float maximumScreenError, vector<TerrainChunkDraw>& drawList)
+{
+	const TerrainChunk& chunk = _chunks[chunkIndex];
+	bool drawChunk = chunk.Level == 0;
+	if (!drawChunk)
+	{
+		// Refine the chunk if its error would cover too many pixels at the nearest point
+		float distance = GetDistanceToChunk(chunk, cameraPosition);
+		drawChunk = chunk.GeometricError * errorScale <= maximumScreenError * distance;
+	}
+	if (drawChunk)
+	{
+		TerrainChunkDraw draw;
+		draw.ChunkIndex = chunkIndex;
+		draw.StartIndex = chunk.StartIndex;
+		draw.IndexCount = chunk.IndexCount;
+		drawList.push_back(draw);
+		return;
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		if (chunk.Children[i] != -1)
+		{
+			SelectChunk(chunk.Children[i], cameraPosition, errorScale, maximumScreenError, drawList);
+		}
+	}
+}
+
+float TerrainQuadTree::GetDistanceToChunk(const TerrainChunk& chunk, const XMFLOAT3& position)
+{
+	float dx = max(max(chunk.BoundsMin.x - position.x, 0.0f), position.x - chunk.BoundsMax.x);
+	float dy = max(max(chunk.BoundsMin.y - position.y, 0.0f), position.y - chunk.BoundsMax.y);
+	float dz = max(max(chunk.BoundsMin.z - position.z, 0.0f), position.z - chunk.BoundsMax.z);
+	return sqrtf(dx * dx + dy * dy + dz * dz);
+}
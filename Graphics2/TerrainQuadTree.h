@@ -0,0 +1,119 @@
+#pragma once
+#include "core.h"
+#include "DirectXCore.h"
+#include "TerrainHeightPyramid.h"
+#include <vector>
+
+using namespace std;
+
+// A chunk of the terrain grid.  Leaf chunks (level 0) are drawn at full resolution,
+// each level above covers four times the area using every 2^level'th height sample.
+struct TerrainChunk
+{
+	unsigned int	StartX;				// First column of the height grid covered by the chunk
+	unsigned int	StartZ;				// First row of the height grid covered by the chunk
+	unsigned int	EndX;				// Last column (inclusive)
+	unsigned int	EndZ;				// Last row (inclusive)
+	unsigned int	Level;
+	XMFLOAT3		BoundsMin;
+	XMFLOAT3		BoundsMax;
+	float			GeometricError;		// Largest vertical distance between the chunk and the full resolution surface
+	float			SkirtDepth;			// How far the skirt hangs below the chunk's edges (see GenerateIndices)
+	int				Children[4];		// Indices of the child chunks, -1 where there is no child
+	UINT			StartIndex;			// Location of the chunk's indices in the level of detail index list
+	UINT			IndexCount;
+};
+
+// A chunk selected for drawing
+struct TerrainChunkDraw
+{
+	unsigned int	ChunkIndex;
+	UINT			StartIndex;
+	UINT			IndexCount;
+};
+
+// A vertex that is added below the edge of a chunk to hide cracks between
+// neighbouring chunks drawn at different levels.
+struct TerrainSkirtVertex
+{
+	UINT			SourceVertex;		// Grid vertex that the skirt vertex hangs from
+	float			Depth;				// Distance below the grid vertex
+};
+
+// Quadtree of terrain chunks used to select the level of detail to draw the terrain at.
+// It works on the height values and grid dimensions only, so selection can be carried
+// out (and tested) without a device.
+class TerrainQuadTree
+{
+public:
+	TerrainQuadTree();
+	~TerrainQuadTree();
+
+	// Builds the chunk hierarchy over a grid of numberOfXPoints * numberOfZPoints height values.
+	// Column x, row z of the grid is at world position (originX + x * spacing, height * worldHeight, originZ - z * spacing).
+	// The chunk bounds are taken from heightPyramid, which must have been built over the same height values.
+	void Build(const float * heightValues, const TerrainHeightPyramid * heightPyramid, unsigned int numberOfXPoints, unsigned int numberOfZPoints,
+			   float spacing, float worldHeight, float originX, float originZ, unsigned int chunkSize);
+
+	// Restores chunks (including their index ranges) that were built by an earlier Build and
+	// GenerateIndices, for example from the terrain cache.  Only selection is available afterwards.
+	void Restore(const TerrainChunk * chunks, size_t numberOfChunks, unsigned int chunkSize);
+
+	// Fills indices with the triangles (and skirts) of every chunk.  Grid vertices are numbered
+	// z * numberOfXPoints + x, skirt vertices are numbered from firstSkirtVertex upwards in the
+	// order they are added to skirtVertices.  Each skirt is deep enough to cover the gap to any
+	// neighbour that can be selected with the chunk, however many levels coarser or finer it is.
+	void GenerateIndices(vector<UINT>& indices, vector<TerrainSkirtVertex>& skirtVertices, UINT firstSkirtVertex);
+
+	// Updates the chunks covering height samples [firstX, endX) x [firstZ, endZ) after those samples have
+	// changed by no more than heightChange world units.  The bounds are taken from heightPyramid, which must
+	// already have been updated.  Measuring the geometric error again would mean going over the whole of
+	// every chunk above the edit, so instead the error of those chunks is increased by 2 * heightChange,
+	// the most the edit can have moved the coarse and full resolution surfaces apart.
+	void UpdateHeights(const TerrainHeightPyramid& heightPyramid, float worldHeight, unsigned int firstX, unsigned int firstZ,
+					   unsigned int endX, unsigned int endZ, float heightChange);
+
+	// Selects the chunks to draw from the given position.  errorScale converts a world space error
+	// at a distance of one unit into pixels, i.e. viewportHeight / (2 * tan(fieldOfView / 2)).
+	// Chunks are refined until their projected error is no more than maximumScreenError pixels.
+	void SelectChunks(const XMFLOAT3& cameraPosition, float errorScale, float maximumScreenError, vector<TerrainChunkDraw>& drawList);
+
+	inline size_t						GetChunkCount() { return _chunks.size(); }
+	inline const TerrainChunk *			GetChunks() { return _chunks.size() > 0 ? &_chunks[0] : nullptr; }
+	inline const TerrainChunk&			GetChunk(unsigned int index) { return _chunks[index]; }
+	inline int							GetParent(unsigned int index) { return _parentIndices[index]; }
+	inline unsigned int					GetLevelCount() { return _levelCount; }
+	inline unsigned int					GetChunkSize() { return _chunkSize; }
+
+private:
+	vector<TerrainChunk>				_chunks;
+	vector<int>							_parentIndices;		// -1 for the root
+
+	const float *						_heightValues;
+	const TerrainHeightPyramid *		_heightPyramid;
+	unsigned int						_numberOfXPoints;
+	unsigned int						_numberOfZPoints;
+	float								_spacing;
+	float								_worldHeight;
+	float								_originX;
+	float								_originZ;
+	unsigned int						_chunkSize;
+	unsigned int						_levelCount;
+
+	int BuildChunk(unsigned int startX, unsigned int startZ, unsigned int level);
+	void CalculateBounds(TerrainChunk& chunk);
+	void FindParents();
+	void UpdateChunkHeights(unsigned int chunkIndex, const TerrainHeightPyramid& heightPyramid, float worldHeight, unsigned int firstX, unsigned int firstZ,
+							unsigned int endX, unsigned int endZ, float heightChange);
+	float CalculateGeometricError(const TerrainChunk& chunk);
+	float CalculateSkirtDepth(unsigned int chunkIndex);
+	int FindChunkAcross(unsigned int chunkIndex, unsigned int cellX, unsigned int cellZ);
+	inline bool ContainsCell(const TerrainChunk& chunk, unsigned int cellX, unsigned int cellZ)
+	{
+		return cellX >= chunk.StartX && cellX < chunk.EndX && cellZ >= chunk.StartZ && cellZ < chunk.EndZ;
+	}
+	void GetSamplePositions(unsigned int start, unsigned int end, unsigned int stride, vector<unsigned int>& positions);
+	void SelectChunk(unsigned int chunkIndex, const XMFLOAT3& cameraPosition, float errorScale, float maximumScreenError, vector<TerrainChunkDraw>& drawList);
+	float GetDistanceToChunk(const TerrainChunk& chunk, const XMFLOAT3& position);
+	inline float GetHeight(unsigned int x, unsigned int z) { return _heightValues[z * _numberOfXPoints + x]; }
+};
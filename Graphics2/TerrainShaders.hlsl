@@ -11,10 +11,15 @@ cbuffer ConstantBuffer
 	float  shininess;			// The shininess factor
 	float  opacity;				// The opacity (transparency) of the material. 0 = fully transparent, 1 = fully opaque
 	float2 padding;
+	float4 terrainGrid;			// Start X, start Z, spacing and detail texture coordinates per sample (compact vertices only)
+	float4 terrainGridScale;	// Minimum height, height range and blend map coordinates per sample in X and Z
+	float4 lightMapTransform;	// Scale and offset from blend map to light map coordinates
+	float4 lightMapStrength;	// How much the sun visibility (x) and ambient occlusion (y) are applied
 }
 
 Texture2D BlendMap : register(t0);
 Texture2DArray TexturesArray : register(t1);
+Texture2D LightMap : register(t2);			// Sun visibility in red, ambient light that isn't occluded in green
 
 SamplerState ss
 {
@@ -32,6 +37,15 @@ struct VertexShaderInput
 	float2 BlendMapTexCoord : TEXCOORD1;
 };
 
+// See TerrainCompactVertex
+struct CompactVertexShaderInput
+{
+	uint2 Grid : POSITION0;
+	float Height : POSITION1;
+	float2 Normal : NORMAL;
+	float2 TexCoord : TEXCOORD0;
+};
+
 struct PixelShaderInput
 {
 	float4 Position : SV_POSITION;
@@ -53,6 +67,33 @@ PixelShaderInput VShader(VertexShaderInput vin)
 	return output;
 }
 
+// Must match TerrainCompactTexCoordBlock
+static const uint TexCoordBlock = 8;
+
+// Undoes the octahedral encoding done by EncodeOctahedralNormal
+float3 DecodeOctahedralNormal(float2 encoded)
+{
+	float2 e = encoded * 2.0f - 1.0f;
+	float2 p = float2(e.x + e.y, e.x - e.y) * 0.5f;
+	return normalize(float3(p.x, 1.0f - abs(p.x) - abs(p.y), p.y));
+}
+
+PixelShaderInput VShaderCompact(CompactVertexShaderInput vin)
+{
+	PixelShaderInput output;
+	float2 grid = float2(vin.Grid);
+	float3 position = float3(grid.x * terrainGrid.z + terrainGrid.x,
+							 vin.Height * terrainGridScale.y + terrainGridScale.x,
+							 terrainGrid.y - grid.y * terrainGrid.z);
+	float3 normal = DecodeOctahedralNormal(vin.Normal);
+	output.Position = mul(completeTransformation, float4(position, 1.0f));
+	output.PositionWS = mul(worldTransformation, float4(position, 1.0f));
+	output.NormalWS = float4(mul((float3x3)worldTransformation, normal), 1.0f);
+	output.TexCoord = vin.TexCoord + float2(vin.Grid & ~(TexCoordBlock - 1)) * terrainGrid.w;
+	output.BlendMapTexCoord = grid * terrainGridScale.zw;
+	return output;
+}
+
 float4 PShader(PixelShaderInput input) : SV_TARGET
 {
 	float4 directionToCamera = normalize(input.PositionWS - cameraPosition);
@@ -73,6 +114,13 @@ float4 PShader(PixelShaderInput input) : SV_TARGET
 
 	// Calculate ambient lighting
 	float4 ambientLight = ambientColor * diffuseCoefficient;
+
+	// Shadows and ambient occlusion from the light map
+	float2 light = LightMap.Sample(ss, input.BlendMapTexCoord * lightMapTransform.xy + lightMapTransform.zw).rg;
+	float sunVisibility = lerp(1.0f, light.r, lightMapStrength.x);
+	diffuse.rgb *= sunVisibility;
+	specular.rgb *= sunVisibility;
+	ambientLight.rgb *= lerp(1.0f, light.g, lightMapStrength.y);
 	float4 color;
 
 	// Sample layers in texture array.
@@ -0,0 +1,201 @@
+#include "TerrainSimplifier.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// Based on the approach used by Martini (https://github.com/mapbox/martini).  Each triangle is
+// identified by the path taken to reach it when splitting the two triangles that cover the square
+// along their long edge.  The error of a triangle is stored at the midpoint of its long edge, which
+// is the sample added when it is split.  Unlike Martini, the error is measured against every sample
+// the triangle covers rather than just the midpoint, so the result is strictly within the tolerance.
+
+TerrainSimplifier::TerrainSimplifier()
+{
+	_heightValues = nullptr;
+	_numberOfXPoints = 0;
+	_numberOfZPoints = 0;
+	_gridSize = 0;
+}
+
+TerrainSimplifier::~TerrainSimplifier()
+{
+}
+
+// Samples in the padding take the height of the nearest sample in the grid
+float TerrainSimplifier::GetHeight(unsigned int x, unsigned int z)
+{
+	x = min(x, _numberOfXPoints - 1);
+	z = min(z, _numberOfZPoints - 1);
+	return _heightValues[(size_t)z * _numberOfXPoints + x];
+}
+
+bool TerrainSimplifier::IsInGrid(unsigned int x, unsigned int z)
+{
+	return x < _numberOfXPoints && z < _numberOfZPoints;
+}
+
+void TerrainSimplifier::Build(const float * heightValues, unsigned int numberOfXPoints, unsigned int numberOfZPoints)
+{
+	_heightValues = heightValues;
+	_numberOfXPoints = numberOfXPoints;
+	_numberOfZPoints = numberOfZPoints;
+	unsigned int tileSize = 1;
+	while (tileSize + 1 < max(numberOfXPoints, numberOfZPoints))
+	{
+		tileSize *= 2;
+	}
+	_gridSize = tileSize + 1;
+	_errors.assign((size_t)_gridSize * _gridSize, 0.0f);
+
+	// Work from the smallest triangles up, so each triangle's error includes its children's.  The
+	// smallest triangles here cover two cells, and can only be split into the two halves of a cell.
+	unsigned int numberOfTriangles = tileSize * tileSize * 2 - 2;
+	unsigned int numberOfParentTriangles = numberOfTriangles - tileSize * tileSize;
+	for (int i = (int)numberOfTriangles - 1; i >= 0; i--)
+	{
+		// Follow the triangle's path down from one of the two top level triangles
+		unsigned int id = i + 2;
+		unsigned int ax = 0;
+		unsigned int az = 0;
+		unsigned int bx = 0;
+		unsigned int bz = 0;
+		unsigned int cx = 0;
+		unsigned int cz = 0;
+		if (id & 1)
+		{
+			bx = bz = cx = tileSize;
+		}
+		else
+		{
+			ax = az = cz = tileSize;
+		}
+		while ((id >>= 1) > 1)
+		{
+			unsigned int mx = (ax + bx) >> 1;
+			unsigned int mz = (az + bz) >> 1;
+			if (id & 1)
+			{
+				bx = ax;
+				bz = az;
+				ax = cx;
+				az = cz;
+			}
+			else
+			{
+				ax = bx;
+				az = bz;
+				bx = cx;
+				bz = cz;
+			}
+			cx = mx;
+			cz = mz;
+		}
+
+		unsigned int mx = (ax + bx) >> 1;
+		unsigned int mz = (az + bz) >> 1;
+		size_t middleIndex = (size_t)mz * _gridSize + mx;
+		float error;
+		if (!IsInGrid(ax, az) || !IsInGrid(bx, bz) || !IsInGrid(cx, cz))
+		{
+			// Always split triangles that reach into the padding
+			error = FLT_MAX;
+		}
+		else
+		{
+			error = CalculateTriangleError(ax, az, bx, bz, cx, cz);
+		}
+
+		// The two triangles sharing a long edge share its midpoint, so they are always split together.  Taking
+		// in the children's errors makes sure a triangle is split whenever any of its children are.
+		error = max(error, _errors[middleIndex]);
+		if ((unsigned int)i < numberOfParentTriangles)
+		{
+			size_t leftChildIndex = (size_t)((az + cz) >> 1) * _gridSize + ((ax + cx) >> 1);
+			size_t rightChildIndex = (size_t)((bz + cz) >> 1) * _gridSize + ((bx + cx) >> 1);
+			error = max(error, max(_errors[leftChildIndex], _errors[rightChildIndex]));
+		}
+		_errors[middleIndex] = error;
+	}
+}
+
+// Finds the largest vertical distance between the triangle and any sample it covers (including its edges)
+float TerrainSimplifier::CalculateTriangleError(unsigned int ax, unsigned int az, unsigned int bx, unsigned int bz, unsigned int cx, unsigned int cz)
+{
+	int x0 = (int)min(min(ax, bx), cx);
+	int x1 = (int)max(max(ax, bx), cx);
+	int z0 = (int)min(min(az, bz), cz);
+	int z1 = (int)max(max(az, bz), cz);
+	int area = ((int)bx - (int)ax) * ((int)cz - (int)az) - ((int)bz - (int)az) * ((int)cx - (int)ax);
+	float heightA = GetHeight(ax, az) / area;
+	float heightB = GetHeight(bx, bz) / area;
+	float heightC = GetHeight(cx, cz) / area;
+	float error = 0.0f;
+	for (int z = z0; z <= z1; z++)
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			// Edge functions, each scaled by area so they are all positive inside the triangle
+			int weightA = ((int)bx - x) * ((int)cz - z) - ((int)bz - z) * ((int)cx - x);
+			int weightB = ((int)cx - x) * ((int)az - z) - ((int)cz - z) * ((int)ax - x);
+			int weightC = area - weightA - weightB;
+			bool inside = area > 0 ? (weightA >= 0 && weightB >= 0 && weightC >= 0) : (weightA <= 0 && weightB <= 0 && weightC <= 0);
+			if (!inside)
+			{
+				continue;
+			}
+			float height = weightA * heightA + weightB * heightB + weightC * heightC;
+			error = max(error, fabsf(height - _heightValues[(size_t)z * _numberOfXPoints + x]));
+		}
+	}
+	return error;
+}
+
+void TerrainSimplifier::GenerateIndices(float maximumError, vector<UINT>& indices)
+{
+	indices.clear();
+	if (_gridSize < 2)
+	{
+		return;
+	}
+	unsigned int last = _gridSize - 1;
+	AddTriangle(0, 0, last, last, last, 0, maximumError, indices);
+	AddTriangle(last, last, 0, 0, 0, last, maximumError, indices);
+}
+
+// Splits the triangle (whose long edge is a-b and right angle is at c) if leaving out the midpoint
+// of its long edge would give too large an error, otherwise adds it
+void TerrainSimplifier::AddTriangle(unsigned int ax, unsigned int az, unsigned int bx, unsigned int bz, unsigned int cx, unsigned int cz,
+								   float maximumError, vector<UINT>& indices)
+{
+	unsigned int mx = (ax + bx) >> 1;
+	unsigned int mz = (az + bz) >> 1;
+	bool canSplit = (ax > cx ? ax - cx : cx - ax) + (az > cz ? az - cz : cz - az) > 1;
+	if (canSplit && _errors[(size_t)mz * _gridSize + mx] > maximumError)
+	{
+		AddTriangle(cx, cz, ax, az, mx, mz, maximumError, indices);
+		AddTriangle(bx, bz, cx, cz, mx, mz, maximumError, indices);
+		return;
+	}
+	if (!IsInGrid(ax, az) || !IsInGrid(bx, bz) || !IsInGrid(cx, cz))
+	{
+		// One of the smallest triangles, lying in the padding
+		return;
+	}
+
+	// Match the winding of the full resolution triangles, e.g. (0, 0), (1, 0), (0, 1)
+	int cross = ((int)bx - (int)ax) * ((int)cz - (int)az) - ((int)bz - (int)az) * ((int)cx - (int)ax);
+	UINT a = az * _numberOfXPoints + ax;
+	UINT b = bz * _numberOfXPoints + bx;
+	UINT c = cz * _numberOfXPoints + cx;
+	indices.push_back(a);
+	if (cross > 0)
+	{
+		indices.push_back(b);
+		indices.push_back(c);
+	}
+	else
+	{
+		indices.push_back(c);
+		indices.push_back(b);
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "core.h"
+#include <vector>
+
+using namespace std;
+
+// Simplifies a grid of height values into a right-triangulated irregular network (RTIN), using
+// larger triangles where the surface is flat enough that leaving samples out changes the height by
+// no more than a given amount.
+//
+// The network covers a square of 2^n + 1 samples, so grids of any other size are padded out.
+// Triangles that reach into the padding are always split, and the smallest triangles that lie in the
+// padding are dropped, so the result covers exactly the original grid.
+class TerrainSimplifier
+{
+public:
+	TerrainSimplifier();
+	~TerrainSimplifier();
+
+	// Works out the error of leaving out each sample of the grid
+	void Build(const float * heightValues, unsigned int numberOfXPoints, unsigned int numberOfZPoints);
+
+	// Fills indices with triangles (three per triangle, clockwise seen from above with rows running
+	// towards -z) whose surface is within maximumError of every height they leave out.  Vertices are
+	// numbered z * numberOfXPoints + x.  maximumError is in the same units as the height values.
+	void GenerateIndices(float maximumError, vector<UINT>& indices);
+
+private:
+	const float *			_heightValues;
+	unsigned int			_numberOfXPoints;
+	unsigned int			_numberOfZPoints;
+	unsigned int			_gridSize;
+	vector<float>			_errors;
+
+	float GetHeight(unsigned int x, unsigned int z);
+	bool IsInGrid(unsigned int x, unsigned int z);
+	float CalculateTriangleError(unsigned int ax, unsigned int az, unsigned int bx, unsigned int bz, unsigned int cx, unsigned int cz);
+	void AddTriangle(unsigned int ax, unsigned int az, unsigned int bx, unsigned int bz, unsigned int cx, unsigned int cz,
+					 float maximumError, vector<UINT>& indices);
+};
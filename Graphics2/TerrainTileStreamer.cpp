@@ -0,0 +1,521 @@
+#include "TerrainTileStreamer.h"
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+
+// How quickly the camera's velocity follows its movement, in seconds
+const float VelocitySmoothingTime = 0.25f;
+
+// Most points along the camera's predicted path that tiles are looked for around
+const unsigned int MaximumPrefetchSamples = 64;
+
+static wstring FormatTileFilename(const wstring& pattern, unsigned int tileX, unsigned int tileZ)
+{
+	wchar_t filename[MAX_PATH];
+	swprintf(filename, MAX_PATH, pattern.c_str(), tileX, tileZ);
+	return filename;
+}
+
+TerrainTileStreamer::TerrainTileStreamer()
+{
+	_tileSize = 0.0f;
+	_originX = 0.0f;
+	_originZ = 0.0f;
+	_residentBytes = 0;
+	_pendingBytes = 0;
+	_tileBytesEstimate = 0;
+	_lastCameraPosition = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	_velocity = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	_cameraKnown = false;
+	_bytesRead = 0;
+	_shuttingDown = false;
+	_statistics = {};
+}
+
+TerrainTileStreamer::~TerrainTileStreamer()
+{
+	Shutdown();
+}
+
+bool TerrainTileStreamer::Initialise(const TerrainTileStreamerSettings& settings, PrepareTileFunction prepareTile)
+{
+	Shutdown();
+	if (settings.FilenamePattern.empty() || settings.TilesX == 0 || settings.TilesZ == 0 || settings.TileSamples < 2 ||
+		settings.Spacing <= 0.0f || settings.LoadRadius < settings.RequiredRadius || settings.LoaderThreads == 0)
+	{
+		MessageBox(0, L"The terrain tile streaming settings are not valid", 0, 0);
+		return false;
+	}
+	_settings = settings;
+	_prepareTile = prepareTile;
+	_tileSize = (settings.TileSamples - 1) * settings.Spacing;
+	_originX = -(float)settings.TilesX * _tileSize * 0.5f;
+	_originZ = (float)settings.TilesZ * _tileSize * 0.5f;
+
+	unsigned int tileCount = settings.TilesX * settings.TilesZ;
+	_tiles.assign(tileCount, TerrainTile());
+	for (unsigned int z = 0; z < settings.TilesZ; z++)
+	{
+		for (unsigned int x = 0; x < settings.TilesX; x++)
+		{
+			TerrainTile& tile = _tiles[GetTileIndex(x, z)];
+			tile.X = x;
+			tile.Z = z;
+			tile.State = TerrainTileState::Unloaded;
+			tile.Bytes = 0;
+			tile.ReservedBytes = 0;
+			tile.Prefetched = false;
+		}
+	}
+	_wantedFlags.assign(tileCount, 0);
+	_wasQueued.assign(tileCount, 0);
+	_wantedTiles.clear();
+	_residentTileIndices.clear();
+	_loadedTiles.clear();
+	_evictedTiles.clear();
+	_residentBytes = 0;
+	_pendingBytes = 0;
+	// Until a tile has been prepared, assume it only holds its heights
+	_tileBytesEstimate = (size_t)settings.TileSamples * settings.TileSamples * sizeof(float);
+	_cameraKnown = false;
+	_velocity = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	_statistics = {};
+	_bytesRead = 0;
+	_queue.clear();
+	_completedLoads.clear();
+
+	_shuttingDown = false;
+	for (unsigned int i = 0; i < settings.LoaderThreads; i++)
+	{
+		_loaders.emplace_back(&TerrainTileStreamer::LoaderLoop, this);
+	}
+	return true;
+}
+
+void TerrainTileStreamer::Shutdown()
+{
+	{
+		lock_guard<mutex> lock(_mutex);
+		_shuttingDown = true;
+		_queue.clear();
+	}
+	_loadAvailable.notify_all();
+	for (thread& loader : _loaders)
+	{
+		loader.join();
+	}
+	_loaders.clear();
+	_completedLoads.clear();
+	_tiles.clear();
+	_residentTileIndices.clear();
+	_residentBytes = 0;
+	_pendingBytes = 0;
+}
+
+void TerrainTileStreamer::LoaderLoop()
+{
+	while (true)
+	{
+		unsigned int index;
+		{
+			unique_lock<mutex> lock(_mutex);
+			_loadAvailable.wait(lock, [this] { return _shuttingDown || !_queue.empty(); });
+			if (_shuttingDown)
+			{
+				return;
+			}
+			index = _queue.front();
+			_queue.pop_front();
+		}
+
+		TerrainTile& tile = _tiles[index];
+		UINT64 bytesRead = 0;
+		bool succeeded = ReadTile(tile, bytesRead);
+		if (succeeded)
+		{
+			tile.Bytes = _prepareTile ? _prepareTile(tile) : tile.HeightValues.size() * sizeof(float);
+		}
+		{
+			lock_guard<mutex> lock(_mutex);
+			_completedLoads.emplace_back(index, succeeded);
+			_bytesRead += bytesRead;
+		}
+		_loadCompleted.notify_all();
+	}
+}
+
+bool TerrainTileStreamer::ReadTile(TerrainTile& tile, UINT64& bytesRead)
+{
+	HeightMapFile heightMap;
+	unsigned int samples = _settings.TileSamples;
+	if (!heightMap.Open(GetTileFilename(tile.X, tile.Z), HeightMapFormat::Unknown, samples, samples))
+	{
+		return false;
+	}
+	tile.HeightValues.resize((size_t)samples * samples);
+	heightMap.ConvertRows(&tile.HeightValues[0], 0, samples);
+	bytesRead = heightMap.GetDataSize();
+	return true;
+}
+
+void TerrainTileStreamer::CollectCompletedLoads()
+{
+	{
+		lock_guard<mutex> lock(_mutex);
+		_collectedLoads.swap(_completedLoads);
+		_statistics.BytesRead = _bytesRead;
+	}
+	for (const pair<unsigned int, bool>& load : _collectedLoads)
+	{
+		TerrainTile& tile = _tiles[load.first];
+		_pendingBytes -= tile.ReservedBytes;
+		tile.ReservedBytes = 0;
+		_statistics.PendingTiles--;
+		if (load.second)
+		{
+			tile.State = TerrainTileState::Resident;
+			_residentBytes += tile.Bytes;
+			_residentTileIndices.push_back(load.first);
+			_loadedTiles.push_back(load.first);
+			_tileBytesEstimate = max(_tileBytesEstimate, tile.Bytes);
+			_statistics.TilesLoaded++;
+		}
+		else
+		{
+			tile.State = TerrainTileState::Missing;
+			tile.HeightValues.clear();
+			tile.HeightValues.shrink_to_fit();
+			_statistics.MissingTiles++;
+		}
+	}
+	_collectedLoads.clear();
+}
+
+void TerrainTileStreamer::Update(const XMFLOAT3& cameraPosition, float elapsedSeconds)
+{
+	if (_tiles.empty())
+	{
+		return;
+	}
+	auto updateStart = std::chrono::high_resolution_clock::now();
+	_loadedTiles.clear();
+	_evictedTiles.clear();
+	CollectCompletedLoads();
+
+	// Smooth the velocity so that a single jerky frame doesn't send the prefetch somewhere else
+	if (_cameraKnown && elapsedSeconds > 0.0f)
+	{
+		float blend = min(1.0f, elapsedSeconds / VelocitySmoothingTime);
+		_velocity.x += ((cameraPosition.x - _lastCameraPosition.x) / elapsedSeconds - _velocity.x) * blend;
+		_velocity.y += ((cameraPosition.y - _lastCameraPosition.y) / elapsedSeconds - _velocity.y) * blend;
+		_velocity.z += ((cameraPosition.z - _lastCameraPosition.z) / elapsedSeconds - _velocity.z) * blend;
+	}
+	_lastCameraPosition = cameraPosition;
+	_cameraKnown = true;
+	XMFLOAT3 predictedPosition(cameraPosition.x + _velocity.x * _settings.PrefetchTime,
+							   cameraPosition.y + _velocity.y * _settings.PrefetchTime,
+							   cameraPosition.z + _velocity.z * _settings.PrefetchTime);
+
+	FindWantedTiles(cameraPosition, predictedPosition);
+	QueueWantedTiles(cameraPosition);
+
+	bool canArrive;
+	unsigned int absentTiles = CountAbsentRequiredTiles(canArrive);
+	auto waitStart = std::chrono::high_resolution_clock::now();
+	bool waited = false;
+	if (_settings.WaitForRequiredTiles)
+	{
+		while (absentTiles > 0 && canArrive)
+		{
+			{
+				unique_lock<mutex> lock(_mutex);
+				_loadCompleted.wait(lock, [this] { return !_completedLoads.empty(); });
+			}
+			CollectCompletedLoads();
+			absentTiles = CountAbsentRequiredTiles(canArrive);
+			waited = true;
+		}
+	}
+	auto updateEnd = std::chrono::high_resolution_clock::now();
+	double waitTime = std::chrono::duration<double, std::milli>(updateEnd - waitStart).count();
+	_statistics.LastStallTime = waited ? waitTime : 0.0;
+	_statistics.StallTime += _statistics.LastStallTime;
+	if (waited || absentTiles > 0)
+	{
+		_statistics.StalledUpdates++;
+	}
+	_statistics.AbsentRequiredTiles = absentTiles;
+	_statistics.ResidentTiles = (unsigned int)_residentTileIndices.size();
+	_statistics.ResidentBytes = _residentBytes;
+	_statistics.UpdateTime = std::chrono::duration<double, std::milli>(waitStart - updateStart).count();
+}
+
+void TerrainTileStreamer::FindWantedTiles(const XMFLOAT3& cameraPosition, const XMFLOAT3& predictedPosition)
+{
+	for (const WantedTile& wanted : _wantedTiles)
+	{
+		_wantedFlags[wanted.Index] = 0;
+	}
+	_wantedTiles.clear();
+
+	// Look around points along the path to the predicted position, close enough together that no tile
+	// within LoadRadius of the path is missed
+	AddWantedTilesAround(cameraPosition.x, cameraPosition.z, cameraPosition);
+	float pathX = predictedPosition.x - cameraPosition.x;
+	float pathZ = predictedPosition.z - cameraPosition.z;
+	float pathLength = sqrtf(pathX * pathX + pathZ * pathZ);
+	if (pathLength > 0.0f)
+	{
+		unsigned int samples = min(MaximumPrefetchSamples, (unsigned int)ceilf(pathLength / (_tileSize * 0.5f)));
+		for (unsigned int i = 1; i <= samples; i++)
+		{
+			float t = (float)i / samples;
+			AddWantedTilesAround(cameraPosition.x + pathX * t, cameraPosition.z + pathZ * t, cameraPosition);
+		}
+	}
+
+	// Required tiles first, then nearest first
+	sort(_wantedTiles.begin(), _wantedTiles.end(), [](const WantedTile& a, const WantedTile& b)
+	{
+		return a.Required != b.Required ? a.Required : a.Distance < b.Distance;
+	});
+	_statistics.RequiredTiles = 0;
+	for (const WantedTile& wanted : _wantedTiles)
+	{
+		_statistics.RequiredTiles += wanted.Required ? 1 : 0;
+	}
+}
+
+void TerrainTileStreamer::AddWantedTilesAround(float x, float z, const XMFLOAT3& cameraPosition)
+{
+	float radius = _settings.LoadRadius;
+	int firstX = max(0, (int)floorf((x - radius - _originX) / _tileSize));
+	int endX = min((int)_settings.TilesX, (int)floorf((x + radius - _originX) / _tileSize) + 1);
+	int firstZ = max(0, (int)floorf((_originZ - (z + radius)) / _tileSize));
+	int endZ = min((int)_settings.TilesZ, (int)floorf((_originZ - (z - radius)) / _tileSize) + 1);
+	for (int tileZ = firstZ; tileZ < endZ; tileZ++)
+	{
+		for (int tileX = firstX; tileX < endX; tileX++)
+		{
+			unsigned int index = GetTileIndex(tileX, tileZ);
+			if (_wantedFlags[index] == 0 && GetDistanceToTile(index, x, z) <= radius)
+			{
+				_wantedFlags[index] = 1;
+				float distance = GetDistanceToTile(index, cameraPosition.x, cameraPosition.z);
+				_wantedTiles.push_back({ index, distance, distance <= _settings.RequiredRadius });
+			}
+		}
+	}
+}
+
+void TerrainTileStreamer::QueueWantedTiles(const XMFLOAT3& cameraPosition)
+{
+	// Take back everything that hasn't been started, so the queue can be rebuilt in the new order.
+	// Tiles that are still marked as queued after this are being read.
+	{
+		lock_guard<mutex> lock(_mutex);
+		for (unsigned int index : _queue)
+		{
+			TerrainTile& tile = _tiles[index];
+			tile.State = TerrainTileState::Unloaded;
+			_pendingBytes -= tile.ReservedBytes;
+			tile.ReservedBytes = 0;
+			_wasQueued[index] = 1;
+			_statistics.PendingTiles--;
+		}
+		_queue.clear();
+	}
+
+	// A tile's charge can grow after it is loaded (see SetTileBytes), so make room for that first
+	while (_residentBytes + _pendingBytes > _settings.MemoryBudget && EvictFurthestUnwantedTile(cameraPosition))
+	{
+	}
+
+	// Queue wanted tiles in order until the budget runs out, evicting the furthest unwanted tiles to
+	// make room.  Everything after the first tile that doesn't fit is less important, so stop there.
+	vector<unsigned int> queue;
+	for (const WantedTile& wanted : _wantedTiles)
+	{
+		TerrainTile& tile = _tiles[wanted.Index];
+		if (tile.State != TerrainTileState::Unloaded)
+		{
+			continue;
+		}
+		bool fits = true;
+		while (_residentBytes + _pendingBytes + _tileBytesEstimate > _settings.MemoryBudget)
+		{
+			if (!EvictFurthestUnwantedTile(cameraPosition))
+			{
+				fits = false;
+				break;
+			}
+		}
+		if (!fits)
+		{
+			break;
+		}
+		tile.State = TerrainTileState::Queued;
+		tile.ReservedBytes = _tileBytesEstimate;
+		_pendingBytes += _tileBytesEstimate;
+		_statistics.PendingTiles++;
+		if (_wasQueued[wanted.Index] == 0)
+		{
+			tile.Prefetched = wanted.Distance > _settings.LoadRadius;
+			_statistics.TilesPrefetched += tile.Prefetched ? 1 : 0;
+		}
+		queue.push_back(wanted.Index);
+	}
+
+	{
+		lock_guard<mutex> lock(_mutex);
+		_queue.assign(queue.begin(), queue.end());
+		for (unsigned int index = 0; index < (unsigned int)_wasQueued.size(); index++)
+		{
+			if (_wasQueued[index] != 0)
+			{
+				_statistics.TilesCancelled += _tiles[index].State == TerrainTileState::Queued ? 0 : 1;
+				_wasQueued[index] = 0;
+			}
+		}
+	}
+	if (!queue.empty())
+	{
+		_loadAvailable.notify_all();
+	}
+}
+
+bool TerrainTileStreamer::EvictFurthestUnwantedTile(const XMFLOAT3& cameraPosition)
+{
+	size_t furthest = _residentTileIndices.size();
+	float furthestDistance = -1.0f;
+	for (size_t i = 0; i < _residentTileIndices.size(); i++)
+	{
+		unsigned int index = _residentTileIndices[i];
+		if (_wantedFlags[index] == 0)
+		{
+			float distance = GetDistanceToTile(index, cameraPosition.x, cameraPosition.z);
+			if (distance > furthestDistance)
+			{
+				furthestDistance = distance;
+				furthest = i;
+			}
+		}
+	}
+	if (furthest == _residentTileIndices.size())
+	{
+		return false;
+	}
+	unsigned int index = _residentTileIndices[furthest];
+	_residentTileIndices[furthest] = _residentTileIndices.back();
+	_residentTileIndices.pop_back();
+
+	TerrainTile& tile = _tiles[index];
+	_residentBytes -= tile.Bytes;
+	tile.State = TerrainTileState::Unloaded;
+	tile.Bytes = 0;
+	tile.HeightValues.clear();
+	tile.HeightValues.shrink_to_fit();
+	_evictedTiles.push_back(index);
+	_statistics.TilesEvicted++;
+	return true;
+}
+
+float TerrainTileStreamer::GetDistanceToTile(unsigned int index, float x, float z)
+{
+	const TerrainTile& tile = _tiles[index];
+	float minimumX = _originX + tile.X * _tileSize;
+	float maximumZ = _originZ - tile.Z * _tileSize;
+	float dx = max(0.0f, max(minimumX - x, x - (minimumX + _tileSize)));
+	float dz = max(0.0f, max((maximumZ - _tileSize) - z, z - maximumZ));
+	return sqrtf(dx * dx + dz * dz);
+}
+
+unsigned int TerrainTileStreamer::CountAbsentRequiredTiles(bool& canArrive)
+{
+	// Wanted tiles are sorted with the required ones first
+	unsigned int absentTiles = 0;
+	canArrive = false;
+	for (const WantedTile& wanted : _wantedTiles)
+	{
+		if (!wanted.Required)
+		{
+			break;
+		}
+		TerrainTileState state = _tiles[wanted.Index].State;
+		if (state != TerrainTileState::Resident && state != TerrainTileState::Missing)
+		{
+			absentTiles++;
+			canArrive = canArrive || state == TerrainTileState::Queued;
+		}
+	}
+	return absentTiles;
+}
+
+void TerrainTileStreamer::SetTileBytes(unsigned int index, size_t bytes)
+{
+	TerrainTile& tile = _tiles[index];
+	if (tile.State != TerrainTileState::Resident)
+	{
+		return;
+	}
+	_residentBytes = _residentBytes - tile.Bytes + bytes;
+	tile.Bytes = bytes;
+	_tileBytesEstimate = max(_tileBytesEstimate, bytes);
+	_statistics.ResidentBytes = _residentBytes;
+}
+
+bool TerrainTileStreamer::GetTileAt(float x, float z, unsigned int& index)
+{
+	float tileX = floorf((x - _originX) / _tileSize);
+	float tileZ = floorf((_originZ - z) / _tileSize);
+	if (tileX < 0.0f || tileZ < 0.0f || tileX >= _settings.TilesX || tileZ >= _settings.TilesZ)
+	{
+		return false;
+	}
+	index = GetTileIndex((unsigned int)tileX, (unsigned int)tileZ);
+	return true;
+}
+
+XMFLOAT2 TerrainTileStreamer::GetTileOrigin(unsigned int tileX, unsigned int tileZ)
+{
+	return XMFLOAT2(_originX + tileX * _tileSize, _originZ - tileZ * _tileSize);
+}
+
+wstring TerrainTileStreamer::GetTileFilename(unsigned int tileX, unsigned int tileZ)
+{
+	return FormatTileFilename(_settings.FilenamePattern, tileX, tileZ);
+}
+
+bool TerrainTileStreamer::CreateTiles(const TerrainTileStreamerSettings& settings, ProceduralHeightMap& heightMap, ThreadPool * threadPool)
+{
+	unsigned int samples = settings.TileSamples;
+	vector<float> heightValues((size_t)samples * samples);
+	vector<USHORT> tileData(heightValues.size());
+	for (unsigned int tileZ = 0; tileZ < settings.TilesZ; tileZ++)
+	{
+		for (unsigned int tileX = 0; tileX < settings.TilesX; tileX++)
+		{
+			// Neighbouring tiles share their edge samples
+			heightMap.Generate(&heightValues[0], samples, samples, threadPool, tileX * (samples - 1), tileZ * (samples - 1));
+			for (size_t i = 0; i < heightValues.size(); i++)
+			{
+				tileData[i] = (USHORT)min(65535.0f, max(0.0f, heightValues[i] * 65536.0f + 0.5f));
+			}
+			wstring filename = FormatTileFilename(settings.FilenamePattern, tileX, tileZ);
+			HANDLE file = CreateFileW(filename.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+			DWORD size = (DWORD)(tileData.size() * sizeof(USHORT));
+			DWORD written = 0;
+			bool succeeded = file != INVALID_HANDLE_VALUE && WriteFile(file, tileData.data(), size, &written, nullptr) && written == size;
+			if (file != INVALID_HANDLE_VALUE)
+			{
+				CloseHandle(file);
+			}
+			if (!succeeded)
+			{
+				MessageBox(0, (L"Unable to write terrain tile " + filename).c_str(), 0, 0);
+				return false;
+			}
+		}
+	}
+	return true;
+}
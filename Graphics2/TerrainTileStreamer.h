@@ -0,0 +1,178 @@
+#pragma once
+#include "DirectXCore.h"
+#include "HeightMapFile.h"
+#include "ProceduralHeightMap.h"
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+using namespace std;
+
+struct TerrainTileStreamerSettings
+{
+	wstring			FilenamePattern;				// swprintf pattern given the tile's column and row, e.g. L"Tiles\\Tile_%u_%u.raw"
+	unsigned int	TilesX = 1;
+	unsigned int	TilesZ = 1;
+	unsigned int	TileSamples = 257;				// Samples along each side of a tile.  Neighbouring tiles share their edge samples.
+	float			Spacing = 10.0f;
+	float			RequiredRadius = 3000.0f;		// Tiles closer than this to the camera have to be resident to draw the view
+	float			LoadRadius = 4000.0f;			// Tiles closer than this are loaded
+	float			PrefetchTime = 2.0f;			// Tiles within LoadRadius of where the camera will be this many seconds ahead are loaded too
+	size_t			MemoryBudget = 256 << 20;		// Most bytes of tiles that can be resident or being loaded at once
+	unsigned int	LoaderThreads = 1;
+	bool			WaitForRequiredTiles = false;	// Update blocks until every required tile that fits in the budget is resident
+};
+
+enum class TerrainTileState
+{
+	Unloaded,
+	Queued,				// Waiting for or being read by a loader thread
+	Resident,
+	Missing				// The tile's file couldn't be read, so it is left as a hole
+};
+
+struct TerrainTile
+{
+	unsigned int		X;
+	unsigned int		Z;
+	TerrainTileState	State;
+	vector<float>		HeightValues;		// Normalised heights, row by row, while resident (unless taken by the prepare function)
+	size_t				Bytes;				// Memory held for the tile, counted against the budget
+	size_t				ReservedBytes;		// Estimate counted against the budget while it is queued or loading
+	bool				Prefetched;			// Loaded because it was ahead of the camera rather than near it
+};
+
+struct TerrainStreamingStatistics
+{
+	unsigned int	ResidentTiles;
+	size_t			ResidentBytes;
+	unsigned int	PendingTiles;			// Queued or being loaded
+	unsigned int	RequiredTiles;			// Tiles within RequiredRadius of the camera in the last Update
+	unsigned int	AbsentRequiredTiles;	// and how many of them weren't resident by the end of it
+	unsigned int	MissingTiles;			// Tiles whose files couldn't be read
+	unsigned int	StalledUpdates;			// Updates that had to wait for required tiles or ended without them
+	double			LastStallTime;			// Milliseconds the last Update spent waiting for required tiles
+	double			StallTime;				// and in total
+	unsigned int	TilesLoaded;			// Totals since Initialise
+	unsigned int	TilesEvicted;
+	unsigned int	TilesCancelled;			// Queued loads dropped because the tile was no longer wanted
+	unsigned int	TilesPrefetched;		// Loads queued for tiles ahead of the camera that weren't near it yet
+	UINT64			BytesRead;				// Bytes read from tile files
+	double			UpdateTime;				// Milliseconds spent in the last Update, not counting waits
+};
+
+// Pages the tiles of a terrain that is too big to hold in memory in and out around the camera.
+//
+// The world is a grid of TilesX * TilesZ raw height map files, each TileSamples square.  Each Update
+// works out which tiles are wanted: those within LoadRadius of the camera and those within LoadRadius
+// of its path over the next PrefetchTime seconds (from its smoothed velocity).  Wanted tiles are queued
+// nearest first, with the ones within RequiredRadius ahead of the rest, and read by loader threads from
+// memory-mapped files.  Tiles that are no longer wanted stay resident until their memory is needed,
+// when the furthest are evicted first, so after each Update the resident and queued tiles take no
+// more than MemoryBudget unless every resident tile is still wanted.  Nothing here needs a device, so it can be driven by a scripted camera path.
+class TerrainTileStreamer
+{
+public:
+	TerrainTileStreamer();
+	~TerrainTileStreamer();
+
+	// Called on a loader thread after a tile's heights have been read, to build whatever is needed to use
+	// the tile.  Returns the bytes held for the tile, which includes the heights if they are left in it.
+	typedef function<size_t(TerrainTile& tile)> PrepareTileFunction;
+
+	// Returns false if the settings can't be used.  prepareTile can be nullptr, in which case the
+	// heights are kept in the tile.
+	bool Initialise(const TerrainTileStreamerSettings& settings, PrepareTileFunction prepareTile = nullptr);
+
+	// Stops the loader threads once they have finished the tiles they are reading
+	void Shutdown();
+
+	// Queues, cancels and evicts tiles for the camera's new position.  elapsedSeconds is the time since
+	// the last Update, used to work out how fast the camera is moving.
+	void Update(const XMFLOAT3& cameraPosition, float elapsedSeconds);
+
+	// Indices of the tiles that became resident and that were evicted during the last Update
+	inline const vector<unsigned int>& GetLoadedTiles() { return _loadedTiles; }
+	inline const vector<unsigned int>& GetEvictedTiles() { return _evictedTiles; }
+
+	// Resident tiles can be read on the main thread until they are evicted
+	inline const TerrainTile& GetTile(unsigned int index) { return _tiles[index]; }
+	inline unsigned int GetTileIndex(unsigned int tileX, unsigned int tileZ) { return tileZ * _settings.TilesX + tileX; }
+
+	// Changes what a resident tile is charged against the budget, for when it holds a different amount
+	// once it has been put to use (such as after its buffers have been created on the main thread).
+	// Anything over the budget is evicted in the next Update.
+	void SetTileBytes(unsigned int index, size_t bytes);
+
+	// Finds the tile under (x, z).  Returns false if the point is outside the world.
+	bool GetTileAt(float x, float z, unsigned int& index);
+
+	// Where sample (0, 0) of a tile is in the world (x, z).  The world is centred on the origin with
+	// row 0 at the back (+z), in the same way as a TerrainNode.
+	XMFLOAT2 GetTileOrigin(unsigned int tileX, unsigned int tileZ);
+
+	wstring GetTileFilename(unsigned int tileX, unsigned int tileZ);
+	inline const TerrainTileStreamerSettings& GetSettings() { return _settings; }
+	inline const TerrainStreamingStatistics& GetStatistics() { return _statistics; }
+
+	// Writes the tile files for settings with 16-bit samples from heightMap, so they join up exactly
+	static bool CreateTiles(const TerrainTileStreamerSettings& settings, ProceduralHeightMap& heightMap, ThreadPool * threadPool);
+
+private:
+	// A tile wanted by the last Update, in the order they are to be loaded
+	struct WantedTile
+	{
+		unsigned int	Index;
+		float			Distance;		// From the camera
+		bool			Required;
+	};
+
+	TerrainTileStreamerSettings		_settings;
+	PrepareTileFunction				_prepareTile;
+	float							_tileSize;			// Width of a tile in the world
+	float							_originX;
+	float							_originZ;
+
+	vector<TerrainTile>				_tiles;
+	vector<BYTE>					_wantedFlags;		// 1 for tiles wanted by the last Update
+	vector<BYTE>					_wasQueued;			// 1 for tiles that were queued before this Update
+	vector<WantedTile>				_wantedTiles;
+	vector<unsigned int>			_residentTileIndices;
+	vector<unsigned int>			_loadedTiles;
+	vector<unsigned int>			_evictedTiles;
+	size_t							_residentBytes;
+	size_t							_pendingBytes;
+	size_t							_tileBytesEstimate;	// Largest charge for a tile so far, reserved for each tile that is queued
+
+	XMFLOAT3						_lastCameraPosition;
+	XMFLOAT3						_velocity;
+	bool							_cameraKnown;
+
+	TerrainStreamingStatistics		_statistics;
+
+	// Tile states are only changed on the main thread.  A loader thread takes a tile from the queue,
+	// fills in its heights and bytes and hands it back through _completedLoads, so the main thread
+	// doesn't look at those until it has collected it.
+	vector<thread>					_loaders;
+	deque<unsigned int>				_queue;
+	vector<pair<unsigned int, bool>>	_completedLoads;	// Tile index and whether it was read
+	vector<pair<unsigned int, bool>>	_collectedLoads;
+	UINT64							_bytesRead;
+	mutex							_mutex;
+	condition_variable				_loadAvailable;
+	condition_variable				_loadCompleted;
+	bool							_shuttingDown;
+
+	void LoaderLoop();
+	bool ReadTile(TerrainTile& tile, UINT64& bytesRead);
+	void CollectCompletedLoads();
+	void FindWantedTiles(const XMFLOAT3& cameraPosition, const XMFLOAT3& predictedPosition);
+	void AddWantedTilesAround(float x, float z, const XMFLOAT3& cameraPosition);
+	void QueueWantedTiles(const XMFLOAT3& cameraPosition);
+	bool EvictFurthestUnwantedTile(const XMFLOAT3& cameraPosition);
+	float GetDistanceToTile(unsigned int index, float x, float z);
+	unsigned int CountAbsentRequiredTiles(bool& canArrive);
+};
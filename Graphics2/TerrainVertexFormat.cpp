@@ -0,0 +1,109 @@
+#include "TerrainVertexFormat.h"
+#include <cmath>
+
+// Maps [-1, 1] to [0, 255], rounding down
+static inline int QuantiseUnitRangeDown(float value)
+{
+	float quantised = floorf((value * 0.5f + 0.5f) * 255.0f);
+	return (int)(quantised < 0.0f ? 0.0f : (quantised > 254.0f ? 254.0f : quantised));
+}
+
+// The normal is projected onto the upper half of an octahedron (|x| + |y| + |z| = 1, y >= 0), which is
+// then rotated by 45 degrees so that it fills the square [-1, 1] x [-1, 1].  Normals that point
+// downwards come back reflected upwards.
+void EncodeOctahedralNormal(const XMFLOAT3& normal, BYTE encoded[2])
+{
+	float sum = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+	float px = normal.x / sum;
+	float pz = normal.z / sum;
+	int ex = QuantiseUnitRangeDown(px + pz);
+	int ey = QuantiseUnitRangeDown(px - pz);
+
+	// Rounding each value to the nearest step doesn't always give the closest normal, so use
+	// whichever of the four surrounding steps is closest
+	XMVECTOR original = XMVector3Normalize(XMLoadFloat3(&normal));
+	float bestDot = -2.0f;
+	for (int i = 0; i < 4; i++)
+	{
+		BYTE candidate[2] = { (BYTE)(ex + (i & 1)), (BYTE)(ey + (i >> 1)) };
+		XMFLOAT3 decoded = DecodeOctahedralNormal(candidate);
+		float dot = XMVectorGetX(XMVector3Dot(original, XMLoadFloat3(&decoded)));
+		if (dot > bestDot)
+		{
+			bestDot = dot;
+			encoded[0] = candidate[0];
+			encoded[1] = candidate[1];
+		}
+	}
+}
+
+XMFLOAT3 DecodeOctahedralNormal(const BYTE encoded[2])
+{
+	float ex = encoded[0] / 255.0f * 2.0f - 1.0f;
+	float ey = encoded[1] / 255.0f * 2.0f - 1.0f;
+	float px = (ex + ey) * 0.5f;
+	float pz = (ex - ey) * 0.5f;
+	XMFLOAT3 normal = XMFLOAT3(px, 1.0f - fabsf(px) - fabsf(pz), pz);
+	XMStoreFloat3(&normal, XMVector3Normalize(XMLoadFloat3(&normal)));
+	return normal;
+}
+
+TerrainCompactVertex EncodeTerrainVertex(const TerrainVertex& vertex, const TerrainCompactVertexParameters& parameters)
+{
+	TerrainCompactVertex compactVertex;
+	compactVertex.X = (USHORT)floorf((vertex.Position.x - parameters.StartX) / parameters.Spacing + 0.5f);
+	compactVertex.Z = (USHORT)floorf((parameters.StartZ - vertex.Position.z) / parameters.Spacing + 0.5f);
+	float height = floorf((vertex.Position.y - parameters.MinimumHeight) / parameters.HeightRange * 65535.0f + 0.5f);
+	compactVertex.Height = (USHORT)(height < 0.0f ? 0.0f : (height > 65535.0f ? 65535.0f : height));
+	EncodeOctahedralNormal(vertex.Normal, compactVertex.Normal);
+	float blockU = (float)(compactVertex.X & ~(TerrainCompactTexCoordBlock - 1)) * parameters.DetailTiling;
+	float blockV = (float)(compactVertex.Z & ~(TerrainCompactTexCoordBlock - 1)) * parameters.DetailTiling;
+	compactVertex.TexCoord[0] = XMConvertFloatToHalf(vertex.TexCoord.x - blockU);
+	compactVertex.TexCoord[1] = XMConvertFloatToHalf(vertex.TexCoord.y - blockV);
+	return compactVertex;
+}
+
+TerrainVertex DecodeTerrainVertex(const TerrainCompactVertex& compactVertex, const TerrainCompactVertexParameters& parameters)
+{
+	TerrainVertex vertex;
+	vertex.Position.x = compactVertex.X * parameters.Spacing + parameters.StartX;
+	vertex.Position.y = compactVertex.Height / 65535.0f * parameters.HeightRange + parameters.MinimumHeight;
+	vertex.Position.z = parameters.StartZ - compactVertex.Z * parameters.Spacing;
+	vertex.Normal = DecodeOctahedralNormal(compactVertex.Normal);
+	float blockU = (float)(compactVertex.X & ~(TerrainCompactTexCoordBlock - 1)) * parameters.DetailTiling;
+	float blockV = (float)(compactVertex.Z & ~(TerrainCompactTexCoordBlock - 1)) * parameters.DetailTiling;
+	vertex.TexCoord.x = XMConvertHalfToFloat(compactVertex.TexCoord[0]) + blockU;
+	vertex.TexCoord.y = XMConvertHalfToFloat(compactVertex.TexCoord[1]) + blockV;
+	vertex.BlendMapTexCoord.x = compactVertex.X * parameters.BlendMapDu;
+	vertex.BlendMapTexCoord.y = compactVertex.Z * parameters.BlendMapDv;
+	return vertex;
+}
+
+void EncodeTerrainVertices(const TerrainVertex * vertices, size_t count, const TerrainCompactVertexParameters& parameters, TerrainCompactVertex * compactVertices)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		compactVertices[i] = EncodeTerrainVertex(vertices[i], parameters);
+	}
+}
+
+TerrainCompactVertexError MeasureCompactVertexError(const TerrainVertex * vertices, const TerrainCompactVertex * compactVertices, size_t count,
+													const TerrainCompactVertexParameters& parameters)
+{
+	TerrainCompactVertexError error = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float minimumNormalDot = 1.0f;
+	for (size_t i = 0; i < count; i++)
+	{
+		const TerrainVertex& original = vertices[i];
+		TerrainVertex decoded = DecodeTerrainVertex(compactVertices[i], parameters);
+		XMVECTOR positionError = XMVectorSubtract(XMLoadFloat3(&decoded.Position), XMLoadFloat3(&original.Position));
+		error.Position = fmaxf(error.Position, XMVectorGetX(XMVector3Length(positionError)));
+		float normalDot = XMVectorGetX(XMVector3Dot(XMVector3Normalize(XMLoadFloat3(&original.Normal)), XMLoadFloat3(&decoded.Normal)));
+		minimumNormalDot = fminf(minimumNormalDot, normalDot);
+		error.TexCoord = fmaxf(error.TexCoord, fmaxf(fabsf(decoded.TexCoord.x - original.TexCoord.x), fabsf(decoded.TexCoord.y - original.TexCoord.y)));
+		error.BlendMapTexCoord = fmaxf(error.BlendMapTexCoord, fmaxf(fabsf(decoded.BlendMapTexCoord.x - original.BlendMapTexCoord.x),
+																	 fabsf(decoded.BlendMapTexCoord.y - original.BlendMapTexCoord.y)));
+	}
+	error.NormalAngle = XMConvertToDegrees(acosf(fminf(fmaxf(minimumNormalDot, -1.0f), 1.0f)));
+	return error;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "DirectXCore.h"
+#include <DirectXPackedVector.h>
+
+using namespace DirectX::PackedVector;
+
+struct TerrainVertex
+{
+	XMFLOAT3 Position;
+	XMFLOAT3 Normal;
+	XMFLOAT2 TexCoord;
+	XMFLOAT2 BlendMapTexCoord;
+};
+
+// How the vertices are stored in the vertex buffer.  Full uses TerrainVertex as it is.  Compact uses
+// TerrainCompactVertex, which is less than a third of the size, so less memory has to be read by the
+// GPU for each vertex.  The compact format needs the SharedGrid layout.
+enum class TerrainVertexFormat
+{
+	Full,
+	Compact
+};
+
+// A shared grid vertex packed into 12 bytes:
+//
+//   X, Z		Column and row of the grid sample.  The position in X and Z and the blend map
+//				coordinates are worked out from these in the vertex shader.
+//   Height		The height as a 16-bit fraction of the terrain's height range (which extends below 0 to
+//				include the bottom of the skirts)
+//   Normal		The normal, octahedral encoded as two 8-bit values.  Terrain normals always point upwards,
+//				so only the upper half of the octahedron is used, which doubles the precision.
+//   TexCoord	Half float detail texture coordinates.  A half float only has 11 bits of precision, which
+//				is not enough for the coordinates across the whole terrain, so these are relative to the
+//				coordinates of the corner of the block of TerrainCompactTexCoordBlock * TerrainCompactTexCoordBlock
+//				samples that the vertex is in.  The shader adds the block's coordinates back on.
+struct TerrainCompactVertex
+{
+	USHORT	X;
+	USHORT	Z;
+	USHORT	Height;
+	BYTE	Normal[2];
+	HALF	TexCoord[2];
+};
+
+// Must match the block size used in VShaderCompact in TerrainShaders.hlsl
+const unsigned int TerrainCompactTexCoordBlock = 8;
+
+// Everything needed to turn a TerrainVertex into a TerrainCompactVertex and back.  The same values are
+// passed to the vertex shader.
+struct TerrainCompactVertexParameters
+{
+	float	StartX;				// Position of column 0 in X
+	float	StartZ;				// Position of row 0 in Z
+	float	Spacing;			// Distance between samples
+	float	DetailTiling;		// Detail texture coordinates per sample
+	float	MinimumHeight;		// Height of a vertex whose Height is 0
+	float	HeightRange;		// and the difference in height to one whose Height is 65535
+	float	BlendMapDu;			// Blend map coordinates per sample
+	float	BlendMapDv;
+};
+
+// Largest differences between a set of vertices and the same vertices after encoding and decoding
+struct TerrainCompactVertexError
+{
+	float	Position;			// Distance
+	float	NormalAngle;		// In degrees
+	float	TexCoord;
+	float	BlendMapTexCoord;
+};
+
+void EncodeOctahedralNormal(const XMFLOAT3& normal, BYTE encoded[2]);
+XMFLOAT3 DecodeOctahedralNormal(const BYTE encoded[2]);
+
+TerrainCompactVertex EncodeTerrainVertex(const TerrainVertex& vertex, const TerrainCompactVertexParameters& parameters);
+
+// Does the same as VShaderCompact.  The normal is normalised, so it will not match the original exactly.
+TerrainVertex DecodeTerrainVertex(const TerrainCompactVertex& compactVertex, const TerrainCompactVertexParameters& parameters);
+
+void EncodeTerrainVertices(const TerrainVertex * vertices, size_t count, const TerrainCompactVertexParameters& parameters, TerrainCompactVertex * compactVertices);
+
+// Decodes every vertex and compares it with the original
+TerrainCompactVertexError MeasureCompactVertexError(const TerrainVertex * vertices, const TerrainCompactVertex * compactVertices, size_t count,
+													const TerrainCompactVertexParameters& parameters);
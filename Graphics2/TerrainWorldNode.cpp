@@ -0,0 +1,212 @@
+#include "TerrainWorldNode.h"
+#include "DirectXFramework.h"
+#include <algorithm>
+
+TerrainWorldNode::TerrainWorldNode(wstring name, const TerrainTileStreamerSettings& settings, int worldHeight, unsigned int chunkSize, float maximumScreenError) : SceneNode(name)
+{
+	_settings = settings;
+	_worldHeight = worldHeight;
+	_chunkSize = chunkSize;
+	_maximumScreenError = maximumScreenError;
+	_updated = false;
+	_tilesCulled = false;
+	_detailTextureBytes = 0;
+	_maximumUploadsPerUpdate = 2;
+	// Tiles are streamed in Update, so it is needed every frame
+	_updatedEveryFrame = true;
+}
+
+TerrainWorldNode::~TerrainWorldNode()
+{
+	_streamer.Shutdown();
+}
+
+bool TerrainWorldNode::Initialise()
+{
+	_updated = false;
+	DirectXFramework * framework = DirectXFramework::GetDXFramework();
+	_detailTextures = TerrainNode::LoadDetailTextures(framework->GetDevice().Get(), framework->GetDeviceContext().Get(), _detailTextureBytes);
+	if (!_streamer.Initialise(_settings, [this](TerrainTile& tile) { return PrepareTile(tile); }))
+	{
+		return false;
+	}
+	// Everywhere a tile could be, with room below for the tiles' skirts
+	float spacing = _settings.Spacing;
+	XMFLOAT2 worldOrigin = _streamer.GetTileOrigin(0, 0);
+	float width = _settings.TilesX * (_settings.TileSamples - 1) * spacing;
+	float depth = _settings.TilesZ * (_settings.TileSamples - 1) * spacing;
+	SetLocalBounds(SceneBounds::FromBox(XMFLOAT3(worldOrigin.x, -max((float)_worldHeight, spacing), worldOrigin.y - depth),
+										XMFLOAT3(worldOrigin.x + width, (float)_worldHeight, worldOrigin.y)));
+	return true;
+}
+
+size_t TerrainWorldNode::PrepareTile(TerrainTile& tile)
+{
+	// Runs on a loader thread, so nothing here can touch the device
+	unsigned int samples = _settings.TileSamples;
+	wstring tileName = _name + L"_" + to_wstring(tile.X) + L"_" + to_wstring(tile.Z);
+	shared_ptr<TerrainNode> tileNode = make_shared<TerrainNode>(tileName, move(tile.HeightValues), samples, samples, _worldHeight, (int)_settings.Spacing, TerrainVertexLayout::SharedGrid);
+	tileNode->EnableLevelOfDetail(_chunkSize, _maximumScreenError);
+	tileNode->SetVertexFormat(TerrainVertexFormat::Compact);
+	if (!tileNode->LoadGeometry())
+	{
+		return 0;
+	}
+	XMFLOAT2 tileOrigin = _streamer.GetTileOrigin(tile.X, tile.Z);
+	XMFLOAT2 gridOrigin = tileNode->GetGridOrigin();
+	tileNode->SetWorldTransform(XMMatrixTranslation(tileOrigin.x - gridOrigin.x, 0.0f, tileOrigin.y - gridOrigin.y));
+	// Until Update picks it up, the node holds everything it has generated.  What it keeps after its
+	// buffers and textures have been created is charged then.
+	size_t bytes = tileNode->GetMemoryUsage().Total;
+	{
+		lock_guard<mutex> lock(_preparedTileNodesMutex);
+		_preparedTileNodes[_streamer.GetTileIndex(tile.X, tile.Z)] = tileNode;
+	}
+	return bytes;
+}
+
+void TerrainWorldNode::Update(FXMMATRIX& currentWorldTransformation)
+{
+	SceneNode::Update(currentWorldTransformation);
+	auto now = std::chrono::steady_clock::now();
+	float elapsedSeconds = _updated ? std::chrono::duration<float>(now - _lastUpdateTime).count() : 0.0f;
+	_lastUpdateTime = now;
+	_updated = true;
+
+	XMFLOAT3 cameraPosition;
+	XMStoreFloat3(&cameraPosition, DirectXFramework::GetDXFramework()->GetCamera()->GetCameraPosition());
+	_streamer.Update(cameraPosition, elapsedSeconds);
+
+	// Evictions go first, so that a tile that was loaded and evicted in the same Update is never uploaded
+	for (unsigned int index : _streamer.GetEvictedTiles())
+	{
+		_tileNodes.erase(index);
+		_pendingUploads.erase(remove(_pendingUploads.begin(), _pendingUploads.end(), index), _pendingUploads.end());
+		lock_guard<mutex> lock(_preparedTileNodesMutex);
+		_preparedTileNodes.erase(index);
+	}
+	const vector<unsigned int>& loadedTiles = _streamer.GetLoadedTiles();
+	_pendingUploads.insert(_pendingUploads.end(), loadedTiles.begin(), loadedTiles.end());
+
+	// The camera may have moved since the waiting tiles were loaded, so the nearest go first
+	float halfTileSize = 0.5f * (_settings.TileSamples - 1) * _settings.Spacing;
+	auto distanceToTile = [&](unsigned int index)
+	{
+		const TerrainTile& tile = _streamer.GetTile(index);
+		XMFLOAT2 tileOrigin = _streamer.GetTileOrigin(tile.X, tile.Z);
+		float x = tileOrigin.x + halfTileSize - cameraPosition.x;
+		float z = tileOrigin.y - halfTileSize - cameraPosition.z;
+		return x * x + z * z;
+	};
+	stable_sort(_pendingUploads.begin(), _pendingUploads.end(), [&](unsigned int a, unsigned int b) { return distanceToTile(a) < distanceToTile(b); });
+
+	unsigned int uploads = 0;
+	size_t next = 0;
+	for (; next < _pendingUploads.size() && (_maximumUploadsPerUpdate == 0 || uploads < _maximumUploadsPerUpdate); next++)
+	{
+		unsigned int index = _pendingUploads[next];
+		shared_ptr<TerrainNode> tileNode;
+		{
+			lock_guard<mutex> lock(_preparedTileNodesMutex);
+			auto prepared = _preparedTileNodes.find(index);
+			if (prepared == _preparedTileNodes.end())
+			{
+				continue;
+			}
+			tileNode = prepared->second;
+			_preparedTileNodes.erase(prepared);
+		}
+		uploads++;
+		tileNode->SetDetailTextures(_detailTextures);
+		if (tileNode->Initialise())
+		{
+			_tileNodes[index] = tileNode;
+			TerrainStatistics statistics = tileNode->GetStatistics();
+			_streamer.SetTileBytes(index, statistics.ResidentBytesAfterRelease + statistics.VertexBytes + statistics.IndexBytes + statistics.TextureBytes);
+		}
+	}
+	_pendingUploads.erase(_pendingUploads.begin(), _pendingUploads.begin() + next);
+	for (auto& tileNode : _tileNodes)
+	{
+		tileNode.second->Update(currentWorldTransformation);
+	}
+}
+
+void TerrainWorldNode::Render()
+{
+	if (_tilesCulled)
+	{
+		for (TerrainNode * tileNode : _visibleTileNodes)
+		{
+			tileNode->Render();
+		}
+		_tilesCulled = false;
+		return;
+	}
+	for (auto& tileNode : _tileNodes)
+	{
+		tileNode.second->Render();
+	}
+}
+
+void TerrainWorldNode::Cull(const SceneFrustum& frustum, SceneCullResult result, vector<SceneNode *>& visibleNodes, SceneCullStatistics& statistics)
+{
+	SceneNode::Cull(frustum, result, visibleNodes, statistics);
+	_visibleTileNodes.clear();
+	_tilesCulled = true;
+	if (result == SceneCullResult::Inside)
+	{
+		for (auto& tileNode : _tileNodes)
+		{
+			_visibleTileNodes.push_back(tileNode.second.get());
+		}
+		statistics.NodesVisible += (unsigned int)_visibleTileNodes.size();
+		return;
+	}
+	_cullTileNodes.clear();
+	_tileBounds.Clear();
+	for (auto& tileNode : _tileNodes)
+	{
+		_cullTileNodes.push_back(tileNode.second.get());
+		_tileBounds.Add(tileNode.second->GetWorldBounds());
+	}
+	unsigned int tileCount = (unsigned int)_cullTileNodes.size();
+	_visibleTileIndices.resize(tileCount);
+	unsigned int visibleCount = tileCount > 0 ? CullBoxes(frustum, _tileBounds, 0, tileCount, &_visibleTileIndices[0]) : 0;
+	for (unsigned int i = 0; i < visibleCount; i++)
+	{
+		_visibleTileNodes.push_back(_cullTileNodes[_visibleTileIndices[i]]);
+	}
+	statistics.NodesTested += tileCount;
+	statistics.NodesCulled += tileCount - visibleCount;
+	statistics.NodesVisible += visibleCount;
+}
+
+void TerrainWorldNode::Shutdown()
+{
+	_streamer.Shutdown();
+	_tileNodes.clear();
+	_preparedTileNodes.clear();
+	_pendingUploads.clear();
+	_detailTextures.Reset();
+}
+
+bool TerrainWorldNode::GetHeightAtPoint(float x, float z, float& height)
+{
+	unsigned int index;
+	if (!_streamer.GetTileAt(x, z, index))
+	{
+		return false;
+	}
+	auto tileNode = _tileNodes.find(index);
+	if (tileNode == _tileNodes.end())
+	{
+		return false;
+	}
+	// The tile's heights are relative to its own grid, which has been moved into place
+	const TerrainTile& tile = _streamer.GetTile(index);
+	XMFLOAT2 tileOrigin = _streamer.GetTileOrigin(tile.X, tile.Z);
+	XMFLOAT2 gridOrigin = tileNode->second->GetGridOrigin();
+	height = tileNode->second->GetHeightAtPoint(x - tileOrigin.x + gridOrigin.x, z - tileOrigin.y + gridOrigin.y);
+	return true;
+}
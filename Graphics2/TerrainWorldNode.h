@@ -0,0 +1,72 @@
+#pragma once
+#include "SceneNode.h"
+#include "TerrainNode.h"
+#include "TerrainTileStreamer.h"
+#include "FrustumCulling.h"
+#include <map>
+#include <chrono>
+
+// A terrain made up of many height map tiles on disk, streamed in and out around the camera.
+//
+// Each tile becomes its own TerrainNode with level of detail, built on a loader thread as soon as
+// the tile's heights have been read and placed so that its edges meet its neighbours'.  The main
+// thread only has to create the tile's buffers when it picks the node up in Update, and does that for
+// no more than a few tiles each Update.  The detail textures are loaded once and shared by every tile.
+class TerrainWorldNode : public SceneNode
+{
+public:
+	TerrainWorldNode(wstring name, const TerrainTileStreamerSettings& settings, int worldHeight, unsigned int chunkSize, float maximumScreenError);
+	~TerrainWorldNode();
+
+	bool Initialise();
+	void Update(FXMMATRIX& currentWorldTransformation);
+	void Render();
+	void Shutdown();
+
+	// Culls the tiles as well, so only those that can be seen are rendered
+	void Cull(const SceneFrustum& frustum, SceneCullResult result, vector<SceneNode *>& visibleNodes, SceneCullStatistics& statistics);
+
+	// Returns false if the tile under (x, z) isn't resident
+	bool GetHeightAtPoint(float x, float z, float& height);
+
+	inline TerrainTileStreamer& GetStreamer() { return _streamer; }
+	inline unsigned int GetTileNodeCount() { return (unsigned int)_tileNodes.size(); }
+
+	// Most tiles whose buffers and textures are created in one Update (0 for no limit).  Tiles that have
+	// been loaded wait for a later Update, nearest first, so streaming never stalls a frame for long.
+	// 2 by default.
+	inline void SetMaximumUploadsPerUpdate(unsigned int maximumUploads) { _maximumUploadsPerUpdate = maximumUploads; }
+	inline unsigned int GetPendingUploadCount() { return (unsigned int)_pendingUploads.size(); }
+
+	// Memory held by the detail textures shared by the tiles, which isn't charged to any of them
+	inline size_t GetDetailTextureBytes() { return _detailTextureBytes; }
+
+private:
+	TerrainTileStreamerSettings					_settings;
+	int											_worldHeight;
+	unsigned int								_chunkSize;
+	float										_maximumScreenError;
+	TerrainTileStreamer							_streamer;
+	map<unsigned int, shared_ptr<TerrainNode>>	_tileNodes;
+	ComPtr<ID3D11ShaderResourceView>			_detailTextures;
+	size_t										_detailTextureBytes;
+
+	// Tiles the streamer has loaded whose nodes haven't been initialised yet, in the order they were loaded
+	vector<unsigned int>						_pendingUploads;
+	unsigned int								_maximumUploadsPerUpdate;
+
+	// Nodes built by the loader threads that Update hasn't picked up yet
+	map<unsigned int, shared_ptr<TerrainNode>>	_preparedTileNodes;
+	mutex										_preparedTileNodesMutex;
+
+	vector<TerrainNode *>						_visibleTileNodes;
+	vector<TerrainNode *>						_cullTileNodes;
+	BoundingBoxArrays							_tileBounds;
+	vector<unsigned int>						_visibleTileIndices;
+	bool										_tilesCulled;		// Render only draws _visibleTileNodes
+
+	std::chrono::steady_clock::time_point		_lastUpdateTime;
+	bool										_updated;
+
+	size_t PrepareTile(TerrainTile& tile);
+};
@@ -25,6 +25,7 @@ bool TexturedCubeNode::Initialise()
 		return false;
 	}
 	BuildGeometryBuffers();
+	SetLocalBounds(SceneBounds::FromBox(XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)));
 	BuildShaders();
 	BuildVertexLayout();
 	BuildConstantBuffer();
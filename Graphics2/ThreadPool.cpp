@@ -0,0 +1,195 @@
+#include "ThreadPool.h"
+
+// Number of bands each thread gets in ParallelFor.  Using more bands than threads
+// evens out the work when some bands are more expensive than others.
+const unsigned int BandsPerThread = 4;
+
+ThreadPool::ThreadPool(unsigned int numberOfThreads)
+{
+	_shuttingDown = false;
+	if (numberOfThreads == 0)
+	{
+		numberOfThreads = thread::hardware_concurrency();
+	}
+	for (unsigned int i = 1; i < numberOfThreads; i++)
+	{
+		_workers.push_back(thread(&ThreadPool::WorkerLoop, this));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		unique_lock<mutex> lock(_mutex);
+		_shuttingDown = true;
+	}
+	_taskAvailable.notify_all();
+	for (size_t i = 0; i < _workers.size(); i++)
+	{
+		_workers[i].join();
+	}
+}
+
+void ThreadPool::ParallelFor(unsigned int count, const function<void(unsigned int, unsigned int)>& work)
+{
+	unsigned int numberOfBands = min(count, GetThreadCount() * BandsPerThread);
+	if (numberOfBands <= 1 || _workers.size() == 0)
+	{
+		if (count > 0)
+		{
+			work(0, count);
+		}
+		return;
+	}
+
+	unsigned int remaining = numberOfBands;
+	unique_lock<mutex> lock(_mutex);
+	for (unsigned int band = 0; band < numberOfBands; band++)
+	{
+		unsigned int begin = (unsigned int)((unsigned long long)count * band / numberOfBands);
+		unsigned int end = (unsigned int)((unsigned long long)count * (band + 1) / numberOfBands);
+		_tasks.push({ [&work, begin, end]() { work(begin, end); }, &remaining });
+	}
+	_taskAvailable.notify_all();
+	WaitForTasks(lock, remaining);
+}
+
+static inline unsigned long long PackRange(unsigned int begin, unsigned int end)
+{
+	return ((unsigned long long)end << 32) | begin;
+}
+
+static inline unsigned int GetRangeBegin(unsigned long long range)
+{
+	return (unsigned int)range;
+}
+
+static inline unsigned int GetRangeEnd(unsigned long long range)
+{
+	return (unsigned int)(range >> 32);
+}
+
+void ThreadPool::ParallelForDynamic(unsigned int count, unsigned int grainSize, const function<void(unsigned int, unsigned int)>& work)
+{
+	grainSize = max(grainSize, 1u);
+	unsigned int numberOfThreads = GetThreadCount();
+	if (count <= grainSize || _workers.size() == 0)
+	{
+		if (count > 0)
+		{
+			work(0, count);
+		}
+		return;
+	}
+
+	vector<StealableRange> ranges(numberOfThreads);
+	for (unsigned int i = 0; i < numberOfThreads; i++)
+	{
+		ranges[i].Range = PackRange((unsigned int)((unsigned long long)count * i / numberOfThreads),
+									(unsigned int)((unsigned long long)count * (i + 1) / numberOfThreads));
+	}
+
+	unsigned int remaining = numberOfThreads - 1;
+	unique_lock<mutex> lock(_mutex);
+	for (unsigned int i = 1; i < numberOfThreads; i++)
+	{
+		_tasks.push({ [this, &ranges, i, grainSize, &work]() { RunStealableRanges(ranges, i, grainSize, work); }, &remaining });
+	}
+	_taskAvailable.notify_all();
+	lock.unlock();
+
+	RunStealableRanges(ranges, 0, grainSize, work);
+
+	// Once the calling thread can't find anything to steal, the other threads are finishing their last pieces.
+	// A task that hasn't started yet finds nothing left and returns at once, but ranges has to outlive it.
+	lock.lock();
+	WaitForTasks(lock, remaining);
+}
+
+void ThreadPool::RunStealableRanges(vector<StealableRange>& ranges, unsigned int thread, unsigned int grainSize, const function<void(unsigned int, unsigned int)>& work)
+{
+	unsigned int numberOfThreads = (unsigned int)ranges.size();
+	atomic<unsigned long long>& ownRange = ranges[thread].Range;
+	while (true)
+	{
+		// Take pieces from the front of this thread's own range
+		unsigned long long range = ownRange.load();
+		while (GetRangeBegin(range) < GetRangeEnd(range))
+		{
+			unsigned int begin = GetRangeBegin(range);
+			unsigned int end = min(begin + grainSize, GetRangeEnd(range));
+			if (ownRange.compare_exchange_weak(range, PackRange(end, GetRangeEnd(range))))
+			{
+				work(begin, end);
+				range = ownRange.load();
+			}
+		}
+
+		// Steal the back half of another range.  Ranges of no more than grainSize are left to their owners.
+		bool stolen = false;
+		for (unsigned int i = 1; i < numberOfThreads && !stolen; i++)
+		{
+			atomic<unsigned long long>& victimRange = ranges[(thread + i) % numberOfThreads].Range;
+			range = victimRange.load();
+			while (GetRangeEnd(range) - GetRangeBegin(range) > grainSize)
+			{
+				unsigned int middle = GetRangeBegin(range) + (GetRangeEnd(range) - GetRangeBegin(range)) / 2;
+				if (victimRange.compare_exchange_weak(range, PackRange(GetRangeBegin(range), middle)))
+				{
+					ownRange.store(PackRange(middle, GetRangeEnd(range)));
+					stolen = true;
+					break;
+				}
+			}
+		}
+		if (!stolen)
+		{
+			return;
+		}
+	}
+}
+
+void ThreadPool::WorkerLoop()
+{
+	unique_lock<mutex> lock(_mutex);
+	while (!_shuttingDown)
+	{
+		if (!RunPendingTask(lock))
+		{
+			_taskAvailable.wait(lock);
+		}
+	}
+}
+
+// Runs the next queued task, if there is one.  The lock is released while the task runs.
+bool ThreadPool::RunPendingTask(unique_lock<mutex>& lock)
+{
+	if (_tasks.empty())
+	{
+		return false;
+	}
+	Task task = move(_tasks.front());
+	_tasks.pop();
+	lock.unlock();
+	task.Work();
+	lock.lock();
+	if (--*task.Remaining == 0)
+	{
+		_tasksCompleted.notify_all();
+	}
+	return true;
+}
+
+// Helps with the queued work until remaining (the count of one call's unfinished tasks) reaches 0.  Once
+// nothing is queued, the call's last tasks are running on other threads and can only finish, so waiting for
+// them can't deadlock, even if this thread is itself running a task from an outer call.
+void ThreadPool::WaitForTasks(unique_lock<mutex>& lock, unsigned int& remaining)
+{
+	while (remaining > 0)
+	{
+		if (!RunPendingTask(lock))
+		{
+			_tasksCompleted.wait(lock);
+		}
+	}
+}
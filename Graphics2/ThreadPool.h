@@ -0,0 +1,68 @@
+#pragma once
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <atomic>
+
+using namespace std;
+
+// Simple pool of worker threads used to split large loops (such as terrain
+// generation) across all of the available cores.
+
+class ThreadPool
+{
+public:
+	// A numberOfThreads of 0 creates one thread per hardware thread.  The
+	// calling thread also takes part in the work, so one fewer worker is started.
+	ThreadPool(unsigned int numberOfThreads = 0);
+	~ThreadPool();
+
+	inline unsigned int GetThreadCount() { return (unsigned int)_workers.size() + 1; }
+
+	// Splits the range [0, count) into contiguous bands and calls work(begin, end)
+	// for each band across the pool.  Returns once every band has completed.
+	//
+	// Each call waits only for its own bands, so several threads can use the pool at
+	// once, and work running on the pool can itself call ParallelFor.  While it waits,
+	// the caller runs whatever is queued, which may belong to another call.
+	void ParallelFor(unsigned int count, const function<void(unsigned int, unsigned int)>& work);
+
+	// Like ParallelFor, but for work whose cost varies a lot across the range.  Each thread starts with an
+	// equal share of [0, count) and works through it grainSize iterations at a time.  A thread that runs out
+	// steals the second half of what is left of another thread's share, so no thread sits idle while there
+	// is still more than grainSize iterations of work left anywhere.
+	void ParallelForDynamic(unsigned int count, unsigned int grainSize, const function<void(unsigned int, unsigned int)>& work);
+
+private:
+	// Remaining is the number of unfinished tasks of the call that queued this one.  It lives
+	// on that call's stack and is only changed with _mutex held.
+	struct Task
+	{
+		function<void()>			Work;
+		unsigned int *				Remaining;
+	};
+
+	vector<thread>					_workers;
+	queue<Task>						_tasks;
+	mutex							_mutex;
+	condition_variable				_taskAvailable;
+	condition_variable				_tasksCompleted;
+	bool							_shuttingDown;
+
+	// The iterations still to be done by one thread in ParallelForDynamic.  The first iteration is in the low
+	// 32 bits and the end in the high 32 bits so that the owner and thieves can change them together.
+	struct StealableRange
+	{
+		atomic<unsigned long long>	Range;
+		char						Padding[56];	// Keeps each range on its own cache line
+	};
+
+	void WorkerLoop();
+	void RunStealableRanges(vector<StealableRange>& ranges, unsigned int thread, unsigned int grainSize, const function<void(unsigned int, unsigned int)>& work);
+	bool RunPendingTask(unique_lock<mutex>& lock);
+	void WaitForTasks(unique_lock<mutex>& lock, unsigned int& remaining);
+};
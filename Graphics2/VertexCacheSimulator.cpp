@@ -0,0 +1,55 @@
+#include "VertexCacheSimulator.h"
+#include <algorithm>
+
+VertexCacheStatistics SimulateVertexCache(const UINT * indices, size_t numberOfIndices, unsigned int cacheSize, VertexCachePolicy policy)
+{
+	VertexCacheStatistics statistics;
+	statistics.Transforms = 0;
+	statistics.UniqueVertices = 0;
+	UINT numberOfVertices = numberOfIndices > 0 ? *max_element(indices, indices + numberOfIndices) + 1 : 0;
+
+	// For FIFO, a vertex is still in the cache if fewer than cacheSize vertices have been added
+	// since it was (Transforms - addedAt counts the vertex itself as well).  For LRU, the same holds
+	// for the number of different vertices used since.
+	vector<size_t> addedAt(numberOfVertices, SIZE_MAX);
+	vector<UINT> lru;
+	for (size_t i = 0; i < numberOfIndices; i++)
+	{
+		UINT vertex = indices[i];
+		if (addedAt[vertex] == SIZE_MAX)
+		{
+			statistics.UniqueVertices++;
+		}
+		if (policy == VertexCachePolicy::Fifo)
+		{
+			if (addedAt[vertex] == SIZE_MAX || statistics.Transforms - addedAt[vertex] > cacheSize)
+			{
+				addedAt[vertex] = statistics.Transforms;
+				statistics.Transforms++;
+			}
+		}
+		else
+		{
+			// The cache is small, so a list with the most recently used vertex at the front is fast enough
+			auto entry = find(lru.begin(), lru.end(), vertex);
+			if (entry == lru.end())
+			{
+				statistics.Transforms++;
+				addedAt[vertex] = i;
+				if (lru.size() == cacheSize)
+				{
+					lru.pop_back();
+				}
+				lru.insert(lru.begin(), vertex);
+			}
+			else
+			{
+				rotate(lru.begin(), entry, entry + 1);
+			}
+		}
+	}
+	size_t numberOfTriangles = numberOfIndices / 3;
+	statistics.AverageCacheMissRatio = numberOfTriangles > 0 ? (float)statistics.Transforms / numberOfTriangles : 0.0f;
+	statistics.AverageTransformToVertexRatio = statistics.UniqueVertices > 0 ? (float)statistics.Transforms / statistics.UniqueVertices : 0.0f;
+	return statistics;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "core.h"
+#include <vector>
+
+using namespace std;
+
+// How the simulated cache chooses which vertex to drop
+enum class VertexCachePolicy
+{
+	Fifo,				// The oldest vertex added (older hardware)
+	Lru					// The vertex used least recently
+};
+
+struct VertexCacheStatistics
+{
+	size_t			Transforms;							// Vertices transformed, i.e. cache misses
+	size_t			UniqueVertices;
+	float			AverageCacheMissRatio;				// ACMR: transforms per triangle (0.5 is the best possible for a large grid)
+	float			AverageTransformToVertexRatio;		// ATVR: transforms per vertex used (1.0 is the best possible)
+};
+
+// Works out how many vertices a GPU with a post-transform cache of cacheSize entries would
+// transform to draw a triangle list, so index orders can be compared without a GPU
+VertexCacheStatistics SimulateVertexCache(const UINT * indices, size_t numberOfIndices, unsigned int cacheSize, VertexCachePolicy policy);
@@ -0,0 +1,71 @@
+#include "FrustumCulling.h"
+#include "TestFramework.h"
+#include <random>
+
+// Boxes culled per nanosecond on one thread by SceneFrustum::Test over an array of SceneBounds, by
+// CullBoxesScalar and by CullBoxes (with whichever of AVX2 and SSE2 it was built with), for 1,000 to
+// 1,000,000 boxes spread around a view that sees about a third of them.
+
+int main()
+{
+#if defined(__AVX2__)
+	const char * simdName = "CullBoxes (AVX2)";
+#else
+	const char * simdName = "CullBoxes (SSE2)";
+#endif
+	SceneFrustum frustum(XMMatrixLookAtLH(XMVectorSet(0.0f, 10.0f, -500.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) *
+						 XMMatrixPerspectiveFovLH(XM_PIDIV2, 16.0f / 9.0f, 1.0f, 1000.0f));
+	const unsigned int counts[] = { 1000, 10000, 100000, 1000000 };
+
+	printf("%-10s %9s %20s %18s %18s %9s\n", "Boxes", "Visible", "SceneFrustum::Test", "CullBoxesScalar", simdName, "Speed up");
+	for (unsigned int count : counts)
+	{
+		// Trees and rocks scattered over a 2 km square, with spheres that don't reach their boxes' corners
+		mt19937 random(count);
+		uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+		uniform_real_distribution<float> size(0.5f, 10.0f);
+		vector<SceneBounds> bounds(count);
+		BoundingBoxArrays boxes;
+		boxes.Reserve(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			float x = position(random);
+			float z = position(random);
+			float width = size(random);
+			float height = 2.0f * size(random);
+			bounds[i] = SceneBounds::FromBox(XMFLOAT3(x - width, 0.0f, z - width), XMFLOAT3(x + width, height, z + width), max(width, height * 0.5f) * 1.1f);
+			boxes.Add(bounds[i]);
+		}
+
+		// Enough runs of each that the smaller counts are timed over at least a few milliseconds
+		unsigned int runs = max(5u, 2000000u / count);
+		vector<unsigned int> visibleIndices(count);
+		vector<BYTE> insideFlags(count);
+		unsigned int testVisible = 0;
+		unsigned int scalarVisible = 0;
+		unsigned int simdVisible = 0;
+		double testTime = TimeMilliseconds([&]()
+		{
+			testVisible = 0;
+			for (unsigned int i = 0; i < count; i++)
+			{
+				SceneCullResult result = frustum.Test(bounds[i]);
+				if (result != SceneCullResult::Outside)
+				{
+					visibleIndices[testVisible] = i;
+					insideFlags[testVisible] = result == SceneCullResult::Inside ? 1 : 0;
+					testVisible++;
+				}
+			}
+		}, runs);
+		double scalarTime = TimeMilliseconds([&]() { scalarVisible = CullBoxesScalar(frustum, boxes, 0, count, &visibleIndices[0], &insideFlags[0]); }, runs);
+		double simdTime = TimeMilliseconds([&]() { simdVisible = CullBoxes(frustum, boxes, 0, count, &visibleIndices[0], &insideFlags[0]); }, runs);
+
+		printf("%-10u %9u %20.3f %18.3f %18.3f %8.2fx\n", count, simdVisible, count / (testTime * 1e6), count / (scalarTime * 1e6), count / (simdTime * 1e6),
+			   scalarTime / simdTime);
+		CHECK(testVisible == scalarVisible && simdVisible == scalarVisible);
+		CHECK(simdVisible > count / 10 && simdVisible < count / 2);
+	}
+	printf("(boxes per nanosecond)\n");
+	return TestResult();
+}
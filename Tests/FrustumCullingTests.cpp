@@ -0,0 +1,160 @@
+#include "FrustumCulling.h"
+#include "TestFramework.h"
+#include <algorithm>
+#include <cfloat>
+#include <random>
+
+// Checks that CullBoxes (with whichever of AVX2 and SSE2 it was built with) gives exactly the visible
+// indices and inside flags of CullBoxesScalar and of SceneFrustum::Test, for every alignment of the range
+// and every length of the boxes left over after the last batch, including boxes that sit exactly on a
+// plane and bounds that are empty or infinite.
+
+static XMMATRIX GetViewProjection(const XMFLOAT3& eye, const XMFLOAT3& target)
+{
+	return XMMatrixLookAtLH(XMVectorSet(eye.x, eye.y, eye.z, 1.0f), XMVectorSet(target.x, target.y, target.z, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) *
+		   XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, 1.0f, 100.0f);
+}
+
+// Random bounds around the frustum, a few of them empty or infinite.  With integer positions and sizes,
+// boxes often touch the near and far planes of a frustum looking along z exactly.
+static SceneBounds GetRandomBounds(mt19937& random, bool integers)
+{
+	uniform_real_distribution<float> position(-120.0f, 120.0f);
+	uniform_real_distribution<float> size(0.0f, 20.0f);
+	uniform_int_distribution<int> kind(0, 99);
+	int boundsKind = kind(random);
+	if (boundsKind == 0)
+	{
+		return SceneBounds::Empty();
+	}
+	if (boundsKind == 1)
+	{
+		return SceneBounds::Infinite();
+	}
+	XMFLOAT3 minimum(position(random), position(random), position(random));
+	XMFLOAT3 maximum(minimum.x + size(random), minimum.y + size(random), minimum.z + size(random));
+	if (integers)
+	{
+		minimum = XMFLOAT3(floorf(minimum.x), floorf(minimum.y), floorf(minimum.z));
+		maximum = XMFLOAT3(ceilf(maximum.x), ceilf(maximum.y), ceilf(maximum.z));
+	}
+	// Some with a sphere smaller than the box, as for a tree whose branches don't reach the box's corners
+	return SceneBounds::FromBox(minimum, maximum, boundsKind < 30 ? size(random) : -1.0f);
+}
+
+static void TestMatchesScalar()
+{
+	mt19937 random(25);
+	uniform_real_distribution<float> position(-50.0f, 50.0f);
+	int mismatches = 0;
+	int results[3] = { 0, 0, 0 };
+	for (int set = 0; set < 200; set++)
+	{
+		// Every other set looks straight along z from the origin, where the integer boxes touch planes exactly
+		bool axisAligned = set % 2 == 0;
+		SceneFrustum frustum(axisAligned ? GetViewProjection(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f)) :
+							 GetViewProjection(XMFLOAT3(position(random), position(random), position(random)), XMFLOAT3(position(random), position(random), position(random))));
+		unsigned int count = 1 + (unsigned int)(random() % 600);
+		BoundingBoxArrays boxes;
+		vector<SceneBounds> bounds;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			bounds.push_back(GetRandomBounds(random, axisAligned));
+			if (set % 4 == 1)
+			{
+				// Boxes added from their corners have no sphere
+				XMFLOAT3 minimum(bounds[i].Centre.x - bounds[i].Extents.x, bounds[i].Centre.y - bounds[i].Extents.y, bounds[i].Centre.z - bounds[i].Extents.z);
+				XMFLOAT3 maximum(bounds[i].Centre.x + bounds[i].Extents.x, bounds[i].Centre.y + bounds[i].Extents.y, bounds[i].Centre.z + bounds[i].Extents.z);
+				bounds[i] = SceneBounds::FromBox(minimum, maximum);
+				bounds[i].Radius = FLT_MAX;
+				boxes.Add(minimum, maximum);
+			}
+			else
+			{
+				boxes.Add(bounds[i]);
+			}
+		}
+
+		// What SceneFrustum::Test says about each box
+		vector<unsigned int> expectedIndices;
+		vector<BYTE> expectedFlags;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			SceneCullResult result = frustum.Test(bounds[i]);
+			results[(int)result]++;
+			if (result != SceneCullResult::Outside)
+			{
+				expectedIndices.push_back(i);
+				expectedFlags.push_back(result == SceneCullResult::Inside ? 1 : 0);
+			}
+		}
+
+		// Ranges starting at every offset within a batch, of every length up to two batches and ending at
+		// every offset of the last two batches
+		for (unsigned int first = 0; first < min(count, 9u); first++)
+		{
+			for (unsigned int end = first; end <= count; end += end - first < 17 || end + 17 > count ? 1 : 17)
+			{
+				vector<unsigned int> indices(end - first + 1);
+				vector<unsigned int> scalarIndices(end - first + 1);
+				vector<unsigned int> unflaggedIndices(end - first + 1);
+				vector<BYTE> flags(end - first + 1);
+				vector<BYTE> scalarFlags(end - first + 1);
+				unsigned int visible = CullBoxes(frustum, boxes, first, end, &indices[0], &flags[0]);
+				unsigned int scalarVisible = CullBoxesScalar(frustum, boxes, first, end, &scalarIndices[0], &scalarFlags[0]);
+				unsigned int unflaggedVisible = CullBoxes(frustum, boxes, first, end, &unflaggedIndices[0]);
+
+				bool same = visible == scalarVisible && unflaggedVisible == visible;
+				size_t expected = lower_bound(expectedIndices.begin(), expectedIndices.end(), first) - expectedIndices.begin();
+				for (unsigned int i = 0; same && i < visible; i++, expected++)
+				{
+					same = indices[i] == scalarIndices[i] && indices[i] == unflaggedIndices[i] && flags[i] == scalarFlags[i] &&
+						   expected < expectedIndices.size() && indices[i] == expectedIndices[expected] && flags[i] == expectedFlags[expected];
+				}
+				same = same && (expected == expectedIndices.size() || expectedIndices[expected] >= end);
+				mismatches += same ? 0 : 1;
+			}
+		}
+	}
+	CHECK(mismatches == 0);
+
+	// All three results come up often enough for that to mean something
+	CHECK(results[(int)SceneCullResult::Outside] > 1000 && results[(int)SceneCullResult::Intersecting] > 1000 && results[(int)SceneCullResult::Inside] > 1000);
+}
+
+static void TestTouchingPlanes()
+{
+	// Boxes in front of the near plane (z = 1) with a face exactly on it are inside, boxes behind it that
+	// just reach it intersect, and boxes that stop short of it are outside
+	SceneFrustum frustum(GetViewProjection(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f)));
+	BoundingBoxArrays boxes;
+	for (unsigned int i = 0; i < 11; i++)
+	{
+		float x = ((float)i - 5.0f) * 0.05f;
+		boxes.Add(XMFLOAT3(x - 0.2f, -0.2f, 1.0f), XMFLOAT3(x + 0.2f, 0.2f, 3.0f));
+		boxes.Add(XMFLOAT3(x - 0.2f, -0.2f, -1.0f), XMFLOAT3(x + 0.2f, 0.2f, 1.0f));
+		boxes.Add(XMFLOAT3(x - 0.2f, -0.2f, -3.0f), XMFLOAT3(x + 0.2f, 0.2f, 0.5f));
+	}
+	vector<unsigned int> indices(boxes.GetCount());
+	vector<unsigned int> scalarIndices(boxes.GetCount());
+	vector<BYTE> flags(boxes.GetCount());
+	vector<BYTE> scalarFlags(boxes.GetCount());
+	unsigned int visible = CullBoxes(frustum, boxes, 0, boxes.GetCount(), &indices[0], &flags[0]);
+	unsigned int scalarVisible = CullBoxesScalar(frustum, boxes, 0, boxes.GetCount(), &scalarIndices[0], &scalarFlags[0]);
+	CHECK(visible == scalarVisible && visible == 22);
+	CHECK(memcmp(&indices[0], &scalarIndices[0], visible * sizeof(unsigned int)) == 0 && memcmp(&flags[0], &scalarFlags[0], visible) == 0);
+	unsigned int insideCount = 0;
+	for (unsigned int i = 0; i < visible; i++)
+	{
+		insideCount += flags[i];
+		CHECK(indices[i] % 3 != 2);
+	}
+	CHECK(insideCount == 11);
+}
+
+int main()
+{
+	TestMatchesScalar();
+	TestTouchingPlanes();
+	return TestResult();
+}
@@ -0,0 +1,22 @@
+#include "DirectXFramework.h"
+#include "DDSTextureLoader.h"
+
+// Stands in for the parts of the framework that need a window and a device, so that the terrain and
+// scene code can be linked into tests.  There is no framework, so anything that needs one (Initialise
+// and Render on the nodes) must not be called.
+
+DirectXFramework * DirectXFramework::GetDXFramework()
+{
+	return nullptr;
+}
+
+XMMATRIX DirectXFramework::GetProjectionTransformation()
+{
+	return XMMatrixIdentity();
+}
+
+HRESULT DirectX::CreateDDSTextureFromFileEx(ID3D11Device *, ID3D11DeviceContext *, const wchar_t *, size_t, D3D11_USAGE, unsigned int,
+											unsigned int, unsigned int, bool, ID3D11Resource **, ID3D11ShaderResourceView **, DDS_ALPHA_MODE *)
+{
+	return E_NOTIMPL;
+}
@@ -0,0 +1,159 @@
+#include "TestFramework.h"
+#include <cmath>
+
+// Writes 8, 16 and 32-bit height maps to the scratch directory and checks the format and size worked out
+// for them, the heights they convert to, and the messages given when the size doesn't fit.
+
+template<class Sample> static string WriteHeightMap(const string& name, unsigned int width, unsigned int height, Sample (*sample)(unsigned int, unsigned int))
+{
+	vector<Sample> samples((size_t)width * height);
+	for (unsigned int z = 0; z < height; z++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			samples[(size_t)z * width + x] = sample(x, z);
+		}
+	}
+	string filename = GRAPHICS2_SCRATCH_DIRECTORY + name;
+	ofstream file(filename, ios::binary);
+	file.write((const char *)samples.data(), samples.size() * sizeof(Sample));
+	return filename;
+}
+
+// Rolling hills over most of the range of each format
+static BYTE Sample8(unsigned int x, unsigned int z)
+{
+	return (BYTE)(127.5f + 127.5f * sinf(x * 0.2f) * cosf(z * 0.15f));
+}
+
+static USHORT Sample16(unsigned int x, unsigned int z)
+{
+	return (USHORT)(32767.5f + 32767.5f * sinf(x * 0.2f) * cosf(z * 0.15f));
+}
+
+static float Sample32(unsigned int x, unsigned int z)
+{
+	return 0.5f + 0.5f * sinf(x * 0.2f) * cosf(z * 0.15f);
+}
+
+// A float map of low, nearly flat ground, as near to looking like 8-bit samples as a float map gets
+static float SampleLow32(unsigned int x, unsigned int z)
+{
+	return x == 0 && z == 0 ? 0.0f : 0.01f + 0.001f * ((x + z) % 7);
+}
+
+static wstring Wide(const string& text)
+{
+	return wstring(text.begin(), text.end());
+}
+
+static bool Opens(const string& filename, HeightMapFormat expectedFormat, unsigned int expectedWidth, unsigned int expectedHeight,
+				  HeightMapFormat format = HeightMapFormat::Unknown, unsigned int width = 0, unsigned int height = 0)
+{
+	HeightMapFile file;
+	return file.Open(Wide(filename), format, width, height) && file.GetFormat() == expectedFormat && file.GetWidth() == expectedWidth &&
+		   file.GetHeight() == expectedHeight;
+}
+
+static bool Fails(const string& filename, const wstring& expectedMessage, HeightMapFormat format = HeightMapFormat::Unknown, unsigned int width = 0,
+				  unsigned int height = 0)
+{
+	HeightMapFile file;
+	return !file.Open(Wide(filename), format, width, height) && file.GetErrorMessage() == L"Height map " + Wide(filename) + L" " + expectedMessage &&
+		   file.GetFormat() == HeightMapFormat::Unknown && file.GetWidth() == 0;
+}
+
+template<class Sample> static bool ConvertsTo(const string& filename, float scale, Sample (*sample)(unsigned int, unsigned int))
+{
+	HeightMapFile file;
+	if (!file.Open(Wide(filename)))
+	{
+		return false;
+	}
+	unsigned int width = file.GetWidth();
+	unsigned int height = file.GetHeight();
+	vector<float> heightValues((size_t)width * height);
+	file.ConvertRows(&heightValues[0], 0, height / 2);
+	file.ConvertRows(&heightValues[0], height / 2, height);
+	for (unsigned int z = 0; z < height; z++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			if (heightValues[(size_t)z * width + x] != (float)sample(x, z) * scale)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static void TestSquareMaps()
+{
+	string map8 = WriteHeightMap("HeightMapFile_8_65.raw", 65, 65, Sample8);
+	string map8Even = WriteHeightMap("HeightMapFile_8_128.raw", 128, 128, Sample8);
+	string map16 = WriteHeightMap("HeightMapFile_16_100.raw", 100, 100, Sample16);
+	string map32 = WriteHeightMap("HeightMapFile_32_64.raw", 64, 64, Sample32);
+	string map32Odd = WriteHeightMap("HeightMapFile_32_33.raw", 33, 33, Sample32);
+	string map32Low = WriteHeightMap("HeightMapFile_32_Low.raw", 64, 64, SampleLow32);
+
+	CHECK(Opens(map8, HeightMapFormat::UInt8, 65, 65));
+	CHECK(Opens(map16, HeightMapFormat::UInt16, 100, 100));
+	CHECK(Opens(map32Odd, HeightMapFormat::Float32, 33, 33));
+
+	// A square float map is the same size as a square 8-bit map of twice the side, and the samples decide
+	CHECK(Opens(map32, HeightMapFormat::Float32, 64, 64));
+	CHECK(Opens(map32Low, HeightMapFormat::Float32, 64, 64));
+	CHECK(Opens(map8Even, HeightMapFormat::UInt8, 128, 128));
+
+	// Giving the format always wins
+	CHECK(Opens(map32, HeightMapFormat::UInt8, 128, 128, HeightMapFormat::UInt8));
+	CHECK(Opens(map8Even, HeightMapFormat::Float32, 64, 64, HeightMapFormat::Float32));
+
+	CHECK(ConvertsTo(map8, 1.0f / 256, Sample8));
+	CHECK(ConvertsTo(map8Even, 1.0f / 256, Sample8));
+	CHECK(ConvertsTo(map16, 1.0f / 65536, Sample16));
+	CHECK(ConvertsTo(map32, 1.0f, Sample32));
+	CHECK(ConvertsTo(map32Low, 1.0f, SampleLow32));
+
+	// The 8-bit maps that ship with the demo have an even side, so they can't be taken for float maps
+	HeightMapFile shipped;
+	CHECK(shipped.Open(GetDataFilename("Test_HeightMap3.raw")) && shipped.GetFormat() == HeightMapFormat::UInt8 && shipped.GetWidth() == 1024);
+	CHECK(shipped.Open(GetDataFilename("Example_HeightMap.raw")) && shipped.GetFormat() == HeightMapFormat::UInt16 && shipped.GetWidth() == 1024);
+
+	const string files[] = { map8, map8Even, map16, map32, map32Odd, map32Low };
+	for (const string& filename : files)
+	{
+		remove(filename.c_str());
+	}
+}
+
+static void TestSizesGiven()
+{
+	string map16 = WriteHeightMap("HeightMapFile_16_30x20.raw", 30, 20, Sample16);
+	CHECK(Opens(map16, HeightMapFormat::UInt16, 30, 20, HeightMapFormat::Unknown, 30, 20));
+
+	// With the size given, whichever sample size fits is used: 1200 bytes are 30 x 20 16-bit samples, or
+	// 40 x 30 8-bit samples, or 20 x 15 32-bit samples
+	CHECK(Opens(map16, HeightMapFormat::UInt8, 40, 30, HeightMapFormat::Unknown, 40, 30));
+	CHECK(Opens(map16, HeightMapFormat::Float32, 20, 15, HeightMapFormat::Unknown, 20, 15));
+
+	CHECK(Fails(map16, L"is 1200 bytes, which is not 31 x 20 8, 16 or 32-bit samples", HeightMapFormat::Unknown, 31, 20));
+	CHECK(Fails(map16, L"is 1200 bytes, which is not 30 x 20 8-bit samples", HeightMapFormat::UInt8, 30, 20));
+	CHECK(Fails(map16, L"is 1200 bytes, which is not 30 x 20 32-bit samples", HeightMapFormat::Float32, 30, 20));
+
+	// Without it, the map has to be square
+	CHECK(Fails(map16, L"is 1200 bytes, which is not a square grid of 8, 16 or 32-bit samples"));
+	CHECK(Fails(map16, L"is 1200 bytes, which is not a square grid of 16-bit samples", HeightMapFormat::UInt16));
+	remove(map16.c_str());
+
+	// A file that isn't there
+	CHECK(Fails(GRAPHICS2_SCRATCH_DIRECTORY + string("HeightMapFile_Missing.raw"), L"could not be opened, or is empty"));
+}
+
+int main()
+{
+	TestSquareMaps();
+	TestSizesGiven();
+	return TestResult();
+}
@@ -0,0 +1,3 @@
+#pragma once
+// Stand-in for <DirectXColors.h>.  None of the colours are used by the device-free modules.
+#include <DirectXMath.h>
@@ -0,0 +1,346 @@
+#pragma once
+// Stand-in for the parts of <DirectXMath.h> used by the device-free modules.  Plain scalar code with
+// the same row-vector conventions (v * M, translation in row 3, left-handed projections).
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace DirectX
+{
+	constexpr float XM_PI = 3.141592654f;
+	constexpr float XM_2PI = 6.283185307f;
+	constexpr float XM_PIDIV2 = 1.570796327f;
+	constexpr float XM_PIDIV4 = 0.785398163f;
+
+	struct XMFLOAT2
+	{
+		float x, y;
+		XMFLOAT2() = default;
+		constexpr XMFLOAT2(float x, float y) : x(x), y(y) {}
+	};
+
+	struct XMFLOAT3
+	{
+		float x, y, z;
+		XMFLOAT3() = default;
+		constexpr XMFLOAT3(float x, float y, float z) : x(x), y(y), z(z) {}
+	};
+
+	struct XMFLOAT4
+	{
+		float x, y, z, w;
+		XMFLOAT4() = default;
+		constexpr XMFLOAT4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+	};
+
+	struct XMFLOAT4X4
+	{
+		float m[4][4];
+	};
+
+	struct XMVECTOR
+	{
+		float v[4];
+	};
+
+	struct XMMATRIX
+	{
+		XMVECTOR r[4];
+	};
+
+	typedef const XMVECTOR FXMVECTOR;
+	typedef const XMVECTOR GXMVECTOR;
+	typedef const XMVECTOR HXMVECTOR;
+	typedef const XMVECTOR CXMVECTOR;
+	typedef const XMMATRIX FXMMATRIX;
+	typedef const XMMATRIX CXMMATRIX;
+
+	inline constexpr float XMConvertToRadians(float degrees) { return degrees * (XM_PI / 180.0f); }
+	inline constexpr float XMConvertToDegrees(float radians) { return radians * (180.0f / XM_PI); }
+	inline float XMScalarSin(float value) { return sinf(value); }
+	inline float XMScalarCos(float value) { return cosf(value); }
+
+	inline XMVECTOR XMVectorSet(float x, float y, float z, float w) { return XMVECTOR{ { x, y, z, w } }; }
+	inline XMVECTOR XMVectorZero() { return XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f); }
+	inline XMVECTOR XMVectorReplicate(float value) { return XMVectorSet(value, value, value, value); }
+	inline float XMVectorGetX(FXMVECTOR v) { return v.v[0]; }
+	inline float XMVectorGetY(FXMVECTOR v) { return v.v[1]; }
+	inline float XMVectorGetZ(FXMVECTOR v) { return v.v[2]; }
+	inline float XMVectorGetW(FXMVECTOR v) { return v.v[3]; }
+
+	inline XMVECTOR XMLoadFloat3(const XMFLOAT3 * source) { return XMVectorSet(source->x, source->y, source->z, 0.0f); }
+	inline XMVECTOR XMLoadFloat4(const XMFLOAT4 * source) { return XMVectorSet(source->x, source->y, source->z, source->w); }
+	inline void XMStoreFloat3(XMFLOAT3 * destination, FXMVECTOR v) { *destination = XMFLOAT3(v.v[0], v.v[1], v.v[2]); }
+	inline void XMStoreFloat4(XMFLOAT4 * destination, FXMVECTOR v) { *destination = XMFLOAT4(v.v[0], v.v[1], v.v[2], v.v[3]); }
+
+	template<class Operation> inline XMVECTOR XMVectorPerComponent(FXMVECTOR a, FXMVECTOR b, Operation operation)
+	{
+		return XMVectorSet(operation(a.v[0], b.v[0]), operation(a.v[1], b.v[1]), operation(a.v[2], b.v[2]), operation(a.v[3], b.v[3]));
+	}
+
+	inline XMVECTOR XMVectorAdd(FXMVECTOR a, FXMVECTOR b) { return XMVectorPerComponent(a, b, [](float x, float y) { return x + y; }); }
+	inline XMVECTOR XMVectorSubtract(FXMVECTOR a, FXMVECTOR b) { return XMVectorPerComponent(a, b, [](float x, float y) { return x - y; }); }
+	inline XMVECTOR XMVectorMultiply(FXMVECTOR a, FXMVECTOR b) { return XMVectorPerComponent(a, b, [](float x, float y) { return x * y; }); }
+	inline XMVECTOR XMVectorMin(FXMVECTOR a, FXMVECTOR b) { return XMVectorPerComponent(a, b, [](float x, float y) { return fminf(x, y); }); }
+	inline XMVECTOR XMVectorMax(FXMVECTOR a, FXMVECTOR b) { return XMVectorPerComponent(a, b, [](float x, float y) { return fmaxf(x, y); }); }
+	inline XMVECTOR XMVectorScale(FXMVECTOR v, float scale) { return XMVectorSet(v.v[0] * scale, v.v[1] * scale, v.v[2] * scale, v.v[3] * scale); }
+	inline XMVECTOR XMVectorNegate(FXMVECTOR v) { return XMVectorScale(v, -1.0f); }
+	inline XMVECTOR XMVectorAbs(FXMVECTOR v) { return XMVectorSet(fabsf(v.v[0]), fabsf(v.v[1]), fabsf(v.v[2]), fabsf(v.v[3])); }
+
+	inline XMVECTOR operator+(FXMVECTOR a, FXMVECTOR b) { return XMVectorAdd(a, b); }
+	inline XMVECTOR operator-(FXMVECTOR a, FXMVECTOR b) { return XMVectorSubtract(a, b); }
+	inline XMVECTOR operator*(FXMVECTOR v, float scale) { return XMVectorScale(v, scale); }
+	inline XMVECTOR operator*(float scale, FXMVECTOR v) { return XMVectorScale(v, scale); }
+
+	inline XMVECTOR XMVector3Dot(FXMVECTOR a, FXMVECTOR b) { return XMVectorReplicate(a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2]); }
+	inline XMVECTOR XMVector4Dot(FXMVECTOR a, FXMVECTOR b) { return XMVectorReplicate(a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2] + a.v[3] * b.v[3]); }
+	inline XMVECTOR XMVector3LengthSq(FXMVECTOR v) { return XMVector3Dot(v, v); }
+	inline XMVECTOR XMVector3Length(FXMVECTOR v) { return XMVectorReplicate(sqrtf(XMVectorGetX(XMVector3Dot(v, v)))); }
+
+	inline XMVECTOR XMVector3Cross(FXMVECTOR a, FXMVECTOR b)
+	{
+		return XMVectorSet(a.v[1] * b.v[2] - a.v[2] * b.v[1], a.v[2] * b.v[0] - a.v[0] * b.v[2], a.v[0] * b.v[1] - a.v[1] * b.v[0], 0.0f);
+	}
+
+	inline XMVECTOR XMVector3Normalize(FXMVECTOR v)
+	{
+		float length = sqrtf(XMVectorGetX(XMVector3Dot(v, v)));
+		return length > 0.0f ? XMVectorScale(v, 1.0f / length) : v;
+	}
+
+	inline XMVECTOR XMVector4Normalize(FXMVECTOR v)
+	{
+		float length = sqrtf(XMVectorGetX(XMVector4Dot(v, v)));
+		return length > 0.0f ? XMVectorScale(v, 1.0f / length) : v;
+	}
+
+	inline XMVECTOR XMPlaneNormalize(FXMVECTOR plane)
+	{
+		float length = sqrtf(XMVectorGetX(XMVector3Dot(plane, plane)));
+		return length > 0.0f ? XMVectorScale(plane, 1.0f / length) : plane;
+	}
+
+	inline XMVECTOR XMPlaneDotCoord(FXMVECTOR plane, FXMVECTOR point)
+	{
+		return XMVectorReplicate(plane.v[0] * point.v[0] + plane.v[1] * point.v[1] + plane.v[2] * point.v[2] + plane.v[3]);
+	}
+
+	inline XMMATRIX XMMatrixSet(float m00, float m01, float m02, float m03,
+								float m10, float m11, float m12, float m13,
+								float m20, float m21, float m22, float m23,
+								float m30, float m31, float m32, float m33)
+	{
+		return XMMATRIX{ { XMVectorSet(m00, m01, m02, m03), XMVectorSet(m10, m11, m12, m13), XMVectorSet(m20, m21, m22, m23), XMVectorSet(m30, m31, m32, m33) } };
+	}
+
+	inline XMMATRIX XMMatrixIdentity()
+	{
+		return XMMatrixSet(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	inline XMMATRIX XMMatrixMultiply(FXMMATRIX a, CXMMATRIX b)
+	{
+		XMMATRIX result;
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				result.r[row].v[column] = a.r[row].v[0] * b.r[0].v[column] + a.r[row].v[1] * b.r[1].v[column] +
+										  a.r[row].v[2] * b.r[2].v[column] + a.r[row].v[3] * b.r[3].v[column];
+			}
+		}
+		return result;
+	}
+
+	inline XMMATRIX operator*(FXMMATRIX a, CXMMATRIX b) { return XMMatrixMultiply(a, b); }
+
+	inline XMMATRIX XMMatrixTranspose(FXMMATRIX m)
+	{
+		XMMATRIX result;
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				result.r[row].v[column] = m.r[column].v[row];
+			}
+		}
+		return result;
+	}
+
+	// Gauss-Jordan elimination with partial pivoting.  The determinant is not returned.
+	inline XMMATRIX XMMatrixInverse(XMVECTOR *, FXMMATRIX m)
+	{
+		float augmented[4][8];
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				augmented[row][column] = m.r[row].v[column];
+				augmented[row][column + 4] = row == column ? 1.0f : 0.0f;
+			}
+		}
+		for (int column = 0; column < 4; column++)
+		{
+			int pivot = column;
+			for (int row = column + 1; row < 4; row++)
+			{
+				if (fabsf(augmented[row][column]) > fabsf(augmented[pivot][column]))
+				{
+					pivot = row;
+				}
+			}
+			for (int i = 0; i < 8; i++)
+			{
+				float swap = augmented[column][i];
+				augmented[column][i] = augmented[pivot][i];
+				augmented[pivot][i] = swap;
+			}
+			float divisor = augmented[column][column];
+			for (int i = 0; i < 8; i++)
+			{
+				augmented[column][i] /= divisor;
+			}
+			for (int row = 0; row < 4; row++)
+			{
+				if (row != column)
+				{
+					float factor = augmented[row][column];
+					for (int i = 0; i < 8; i++)
+					{
+						augmented[row][i] -= factor * augmented[column][i];
+					}
+				}
+			}
+		}
+		XMMATRIX result;
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				result.r[row].v[column] = augmented[row][column + 4];
+			}
+		}
+		return result;
+	}
+
+	inline XMMATRIX XMMatrixTranslation(float x, float y, float z)
+	{
+		XMMATRIX result = XMMatrixIdentity();
+		result.r[3] = XMVectorSet(x, y, z, 1.0f);
+		return result;
+	}
+
+	inline XMMATRIX XMMatrixScaling(float x, float y, float z)
+	{
+		return XMMatrixSet(x, 0.0f, 0.0f, 0.0f, 0.0f, y, 0.0f, 0.0f, 0.0f, 0.0f, z, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	inline XMMATRIX XMMatrixRotationX(float angle)
+	{
+		float c = cosf(angle);
+		float s = sinf(angle);
+		return XMMatrixSet(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, c, s, 0.0f, 0.0f, -s, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	inline XMMATRIX XMMatrixRotationY(float angle)
+	{
+		float c = cosf(angle);
+		float s = sinf(angle);
+		return XMMatrixSet(c, 0.0f, -s, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, s, 0.0f, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	inline XMMATRIX XMMatrixRotationZ(float angle)
+	{
+		float c = cosf(angle);
+		float s = sinf(angle);
+		return XMMatrixSet(c, s, 0.0f, 0.0f, -s, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	// Roll about z, then pitch about x, then yaw about y
+	inline XMMATRIX XMMatrixRotationRollPitchYaw(float pitch, float yaw, float roll)
+	{
+		return XMMatrixRotationZ(roll) * XMMatrixRotationX(pitch) * XMMatrixRotationY(yaw);
+	}
+
+	inline XMMATRIX XMMatrixRotationAxis(FXMVECTOR axis, float angle)
+	{
+		XMVECTOR n = XMVector3Normalize(axis);
+		float x = n.v[0];
+		float y = n.v[1];
+		float z = n.v[2];
+		float c = cosf(angle);
+		float s = sinf(angle);
+		float t = 1.0f - c;
+		return XMMatrixSet(t * x * x + c, t * x * y + s * z, t * x * z - s * y, 0.0f,
+						   t * x * y - s * z, t * y * y + c, t * y * z + s * x, 0.0f,
+						   t * x * z + s * y, t * y * z - s * x, t * z * z + c, 0.0f,
+						   0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	inline XMMATRIX XMMatrixPerspectiveFovLH(float fovAngleY, float aspectRatio, float nearZ, float farZ)
+	{
+		float height = 1.0f / tanf(fovAngleY * 0.5f);
+		float width = height / aspectRatio;
+		float range = farZ / (farZ - nearZ);
+		return XMMatrixSet(width, 0.0f, 0.0f, 0.0f, 0.0f, height, 0.0f, 0.0f, 0.0f, 0.0f, range, 1.0f, 0.0f, 0.0f, -range * nearZ, 0.0f);
+	}
+
+	inline XMMATRIX XMMatrixLookAtLH(FXMVECTOR eyePosition, FXMVECTOR focusPosition, FXMVECTOR upDirection)
+	{
+		XMVECTOR zAxis = XMVector3Normalize(focusPosition - eyePosition);
+		XMVECTOR xAxis = XMVector3Normalize(XMVector3Cross(upDirection, zAxis));
+		XMVECTOR yAxis = XMVector3Cross(zAxis, xAxis);
+		return XMMatrixSet(xAxis.v[0], yAxis.v[0], zAxis.v[0], 0.0f,
+						   xAxis.v[1], yAxis.v[1], zAxis.v[1], 0.0f,
+						   xAxis.v[2], yAxis.v[2], zAxis.v[2], 0.0f,
+						   -XMVectorGetX(XMVector3Dot(xAxis, eyePosition)), -XMVectorGetX(XMVector3Dot(yAxis, eyePosition)), -XMVectorGetX(XMVector3Dot(zAxis, eyePosition)), 1.0f);
+	}
+
+	inline XMVECTOR XMVector3Transform(FXMVECTOR v, FXMMATRIX m)
+	{
+		XMVECTOR result;
+		for (int column = 0; column < 4; column++)
+		{
+			result.v[column] = v.v[0] * m.r[0].v[column] + v.v[1] * m.r[1].v[column] + v.v[2] * m.r[2].v[column] + m.r[3].v[column];
+		}
+		return result;
+	}
+
+	inline XMVECTOR XMVector4Transform(FXMVECTOR v, FXMMATRIX m)
+	{
+		XMVECTOR result;
+		for (int column = 0; column < 4; column++)
+		{
+			result.v[column] = v.v[0] * m.r[0].v[column] + v.v[1] * m.r[1].v[column] + v.v[2] * m.r[2].v[column] + v.v[3] * m.r[3].v[column];
+		}
+		return result;
+	}
+
+	inline XMVECTOR XMVector3TransformCoord(FXMVECTOR v, FXMMATRIX m)
+	{
+		XMVECTOR result = XMVector3Transform(v, m);
+		return XMVectorScale(result, 1.0f / result.v[3]);
+	}
+
+	inline XMVECTOR XMVector3TransformNormal(FXMVECTOR v, FXMMATRIX m)
+	{
+		XMVECTOR result;
+		for (int column = 0; column < 4; column++)
+		{
+			result.v[column] = v.v[0] * m.r[0].v[column] + v.v[1] * m.r[1].v[column] + v.v[2] * m.r[2].v[column];
+		}
+		return result;
+	}
+
+	inline XMMATRIX XMLoadFloat4x4(const XMFLOAT4X4 * source)
+	{
+		XMMATRIX result;
+		memcpy(result.r, source->m, sizeof(source->m));
+		return result;
+	}
+
+	inline void XMStoreFloat4x4(XMFLOAT4X4 * destination, FXMMATRIX m)
+	{
+		memcpy(destination->m, m.r, sizeof(destination->m));
+	}
+}
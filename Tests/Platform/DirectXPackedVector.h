@@ -0,0 +1,66 @@
+#pragma once
+// Stand-in for the half precision conversions in <DirectXPackedVector.h>.  Rounds to nearest even and
+// keeps denormals, as the library does.
+#include <DirectXMath.h>
+
+namespace DirectX
+{
+	namespace PackedVector
+	{
+		typedef uint16_t HALF;
+
+		inline HALF XMConvertFloatToHalf(float value)
+		{
+			uint32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			uint32_t sign = (bits >> 16) & 0x8000;
+			uint32_t magnitude = bits & 0x7fffffff;
+			if (magnitude >= 0x47800000)
+			{
+				// Too large (or not a number) for a half
+				return (HALF)(sign | (magnitude > 0x7f800000 ? 0x7e00 : 0x7c00));
+			}
+			if (magnitude < 0x38800000)
+			{
+				// Denormal half.  Shift the mantissa (with its implicit bit) into place, rounding to nearest even.
+				if (magnitude < 0x33000000)
+				{
+					return (HALF)sign;
+				}
+				uint32_t shift = 126 - (magnitude >> 23);
+				uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+				uint32_t half = mantissa >> shift;
+				uint32_t remainder = mantissa & ((1u << shift) - 1);
+				uint32_t halfway = 1u << (shift - 1);
+				if (remainder > halfway || (remainder == halfway && (half & 1)))
+				{
+					half++;
+				}
+				return (HALF)(sign | half);
+			}
+			uint32_t half = (magnitude - 0x38000000) >> 13;
+			uint32_t remainder = magnitude & 0x1fff;
+			if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+			{
+				half++;
+			}
+			return (HALF)(sign | half);
+		}
+
+		inline float XMConvertHalfToFloat(HALF value)
+		{
+			uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+			uint32_t exponent = (value >> 10) & 0x1f;
+			uint32_t mantissa = value & 0x3ff;
+			float result;
+			if (exponent == 0)
+			{
+				result = ldexpf((float)mantissa, -24);
+				return sign != 0 ? -result : result;
+			}
+			uint32_t bits = exponent == 31 ? (sign | 0x7f800000 | (mantissa << 13)) : (sign | ((exponent + 112) << 23) | (mantissa << 13));
+			memcpy(&result, &bits, sizeof(result));
+			return result;
+		}
+	}
+}
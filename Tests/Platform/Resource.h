@@ -0,0 +1,3 @@
+#pragma once
+// Core.h includes resource.h as Resource.h, which only works on case-insensitive file systems
+#include "../../Graphics2/resource.h"
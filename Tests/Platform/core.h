@@ -0,0 +1,3 @@
+#pragma once
+// Some files include Core.h with a lower case name, which only works on case-insensitive file systems
+#include "../../Graphics2/Core.h"
@@ -0,0 +1,292 @@
+#pragma once
+// Stand-in for the parts of <d3d11.h> that the terrain and scene code is compiled against.  There is
+// no device on hosts without Direct3D, so the methods do nothing and the tests never create resources.
+#include <windows.h>
+#include <cstddef>
+
+enum DXGI_FORMAT
+{
+	DXGI_FORMAT_UNKNOWN,
+	DXGI_FORMAT_R32G32B32A32_FLOAT,
+	DXGI_FORMAT_R32G32B32A32_UINT,
+	DXGI_FORMAT_R32G32B32_FLOAT,
+	DXGI_FORMAT_R16G16B16A16_FLOAT,
+	DXGI_FORMAT_R16G16B16A16_UNORM,
+	DXGI_FORMAT_R16G16B16A16_UINT,
+	DXGI_FORMAT_R16G16B16A16_SNORM,
+	DXGI_FORMAT_R32G32_FLOAT,
+	DXGI_FORMAT_R8G8B8A8_UNORM,
+	DXGI_FORMAT_R16G16_FLOAT,
+	DXGI_FORMAT_R16G16_UNORM,
+	DXGI_FORMAT_R16G16_UINT,
+	DXGI_FORMAT_R16G16_SNORM,
+	DXGI_FORMAT_R32_FLOAT,
+	DXGI_FORMAT_R32_UINT,
+	DXGI_FORMAT_R8G8_UNORM,
+	DXGI_FORMAT_R16_UNORM,
+	DXGI_FORMAT_R16_UINT,
+	DXGI_FORMAT_R8_UNORM,
+	DXGI_FORMAT_BC1_UNORM,
+	DXGI_FORMAT_BC1_UNORM_SRGB,
+	DXGI_FORMAT_BC2_UNORM,
+	DXGI_FORMAT_BC2_UNORM_SRGB,
+	DXGI_FORMAT_BC3_UNORM,
+	DXGI_FORMAT_BC3_UNORM_SRGB,
+	DXGI_FORMAT_BC4_UNORM,
+	DXGI_FORMAT_BC4_SNORM,
+	DXGI_FORMAT_BC5_UNORM,
+	DXGI_FORMAT_BC5_SNORM,
+	DXGI_FORMAT_BC7_UNORM,
+	DXGI_FORMAT_BC7_UNORM_SRGB
+};
+
+enum D3D11_USAGE
+{
+	D3D11_USAGE_DEFAULT,
+	D3D11_USAGE_IMMUTABLE,
+	D3D11_USAGE_DYNAMIC,
+	D3D11_USAGE_STAGING
+};
+
+enum D3D11_BIND_FLAG
+{
+	D3D11_BIND_VERTEX_BUFFER = 0x1,
+	D3D11_BIND_INDEX_BUFFER = 0x2,
+	D3D11_BIND_CONSTANT_BUFFER = 0x4,
+	D3D11_BIND_SHADER_RESOURCE = 0x8,
+	D3D11_BIND_RENDER_TARGET = 0x20,
+	D3D11_BIND_DEPTH_STENCIL = 0x40
+};
+
+enum D3D11_CPU_ACCESS_FLAG
+{
+	D3D11_CPU_ACCESS_WRITE = 0x10000,
+	D3D11_CPU_ACCESS_READ = 0x20000
+};
+
+enum D3D11_RESOURCE_MISC_FLAG
+{
+	D3D11_RESOURCE_MISC_GENERATE_MIPS = 0x1
+};
+
+enum D3D11_MAP
+{
+	D3D11_MAP_READ = 1,
+	D3D11_MAP_WRITE = 2,
+	D3D11_MAP_READ_WRITE = 3,
+	D3D11_MAP_WRITE_DISCARD = 4,
+	D3D11_MAP_WRITE_NO_OVERWRITE = 5
+};
+
+enum D3D11_INPUT_CLASSIFICATION
+{
+	D3D11_INPUT_PER_VERTEX_DATA,
+	D3D11_INPUT_PER_INSTANCE_DATA
+};
+
+enum D3D11_FILL_MODE
+{
+	D3D11_FILL_WIREFRAME = 2,
+	D3D11_FILL_SOLID = 3
+};
+
+enum D3D11_CULL_MODE
+{
+	D3D11_CULL_NONE = 1,
+	D3D11_CULL_FRONT = 2,
+	D3D11_CULL_BACK = 3
+};
+
+enum D3D11_PRIMITIVE_TOPOLOGY
+{
+	D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST = 4
+};
+
+enum D3D11_SRV_DIMENSION
+{
+	D3D11_SRV_DIMENSION_TEXTURE2D = 4,
+	D3D11_SRV_DIMENSION_TEXTURE2DARRAY = 5
+};
+
+enum D3D11_CLEAR_FLAG
+{
+	D3D11_CLEAR_DEPTH = 0x1,
+	D3D11_CLEAR_STENCIL = 0x2
+};
+
+#define D3D11_APPEND_ALIGNED_ELEMENT	0xffffffff
+
+struct D3D11_BUFFER_DESC
+{
+	UINT			ByteWidth;
+	D3D11_USAGE		Usage;
+	UINT			BindFlags;
+	UINT			CPUAccessFlags;
+	UINT			MiscFlags;
+	UINT			StructureByteStride;
+};
+
+struct D3D11_SUBRESOURCE_DATA
+{
+	const void *	pSysMem;
+	UINT			SysMemPitch;
+	UINT			SysMemSlicePitch;
+};
+
+struct D3D11_MAPPED_SUBRESOURCE
+{
+	void *			pData;
+	UINT			RowPitch;
+	UINT			DepthPitch;
+};
+
+struct D3D11_BOX
+{
+	UINT			left;
+	UINT			top;
+	UINT			front;
+	UINT			right;
+	UINT			bottom;
+	UINT			back;
+};
+
+struct DXGI_SAMPLE_DESC
+{
+	UINT			Count;
+	UINT			Quality;
+};
+
+struct D3D11_TEXTURE2D_DESC
+{
+	UINT			Width;
+	UINT			Height;
+	UINT			MipLevels;
+	UINT			ArraySize;
+	DXGI_FORMAT		Format;
+	DXGI_SAMPLE_DESC SampleDesc;
+	D3D11_USAGE		Usage;
+	UINT			BindFlags;
+	UINT			CPUAccessFlags;
+	UINT			MiscFlags;
+};
+
+struct D3D11_TEX2D_SRV
+{
+	UINT			MostDetailedMip;
+	UINT			MipLevels;
+};
+
+struct D3D11_TEX2D_ARRAY_SRV
+{
+	UINT			MostDetailedMip;
+	UINT			MipLevels;
+	UINT			FirstArraySlice;
+	UINT			ArraySize;
+};
+
+struct D3D11_SHADER_RESOURCE_VIEW_DESC
+{
+	DXGI_FORMAT		Format;
+	D3D11_SRV_DIMENSION ViewDimension;
+	union
+	{
+		D3D11_TEX2D_SRV			Texture2D;
+		D3D11_TEX2D_ARRAY_SRV	Texture2DArray;
+	};
+};
+
+struct D3D11_INPUT_ELEMENT_DESC
+{
+	const char *	SemanticName;
+	UINT			SemanticIndex;
+	DXGI_FORMAT		Format;
+	UINT			InputSlot;
+	UINT			AlignedByteOffset;
+	D3D11_INPUT_CLASSIFICATION InputSlotClass;
+	UINT			InstanceDataStepRate;
+};
+
+struct D3D11_RASTERIZER_DESC
+{
+	D3D11_FILL_MODE	FillMode;
+	D3D11_CULL_MODE	CullMode;
+	BOOL			FrontCounterClockwise;
+	INT				DepthBias;
+	FLOAT			DepthBiasClamp;
+	FLOAT			SlopeScaledDepthBias;
+	BOOL			DepthClipEnable;
+	BOOL			ScissorEnable;
+	BOOL			MultisampleEnable;
+	BOOL			AntialiasedLineEnable;
+};
+
+struct D3D11_VIEWPORT
+{
+	FLOAT			TopLeftX;
+	FLOAT			TopLeftY;
+	FLOAT			Width;
+	FLOAT			Height;
+	FLOAT			MinDepth;
+	FLOAT			MaxDepth;
+};
+
+struct ID3D11Resource
+{
+	void GetDesc(D3D11_TEXTURE2D_DESC *) {}
+};
+struct ID3D11Buffer : ID3D11Resource {};
+struct ID3D11Texture2D : ID3D11Resource {};
+struct ID3D11ShaderResourceView {};
+struct ID3D11VertexShader {};
+struct ID3D11PixelShader {};
+struct ID3D11InputLayout {};
+struct ID3D11RasterizerState {};
+struct ID3D11SamplerState {};
+struct ID3D11BlendState {};
+struct ID3D11DepthStencilState {};
+struct ID3D11RenderTargetView {};
+struct ID3D11DepthStencilView {};
+struct ID3D11ClassLinkage {};
+struct ID3D11ClassInstance {};
+
+struct IDXGISwapChain
+{
+	HRESULT Present(UINT, UINT) { return E_NOTIMPL; }
+};
+
+struct ID3D11Device
+{
+	HRESULT CreateBuffer(const D3D11_BUFFER_DESC *, const D3D11_SUBRESOURCE_DATA *, ID3D11Buffer **) { return E_NOTIMPL; }
+	HRESULT CreateTexture2D(const D3D11_TEXTURE2D_DESC *, const D3D11_SUBRESOURCE_DATA *, ID3D11Texture2D **) { return E_NOTIMPL; }
+	HRESULT CreateShaderResourceView(ID3D11Resource *, const D3D11_SHADER_RESOURCE_VIEW_DESC *, ID3D11ShaderResourceView **) { return E_NOTIMPL; }
+	HRESULT CreateVertexShader(const void *, size_t, ID3D11ClassLinkage *, ID3D11VertexShader **) { return E_NOTIMPL; }
+	HRESULT CreatePixelShader(const void *, size_t, ID3D11ClassLinkage *, ID3D11PixelShader **) { return E_NOTIMPL; }
+	HRESULT CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC *, UINT, const void *, size_t, ID3D11InputLayout **) { return E_NOTIMPL; }
+	HRESULT CreateRasterizerState(const D3D11_RASTERIZER_DESC *, ID3D11RasterizerState **) { return E_NOTIMPL; }
+};
+
+struct ID3D11DeviceContext
+{
+	void VSSetShader(ID3D11VertexShader *, ID3D11ClassInstance * const *, UINT) {}
+	void PSSetShader(ID3D11PixelShader *, ID3D11ClassInstance * const *, UINT) {}
+	void IASetInputLayout(ID3D11InputLayout *) {}
+	void IASetVertexBuffers(UINT, UINT, ID3D11Buffer * const *, const UINT *, const UINT *) {}
+	void IASetIndexBuffer(ID3D11Buffer *, DXGI_FORMAT, UINT) {}
+	void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY) {}
+	void UpdateSubresource(ID3D11Resource *, UINT, const D3D11_BOX *, const void *, UINT, UINT) {}
+	void VSSetConstantBuffers(UINT, UINT, ID3D11Buffer * const *) {}
+	void PSSetConstantBuffers(UINT, UINT, ID3D11Buffer * const *) {}
+	void VSSetShaderResources(UINT, UINT, ID3D11ShaderResourceView * const *) {}
+	void PSSetShaderResources(UINT, UINT, ID3D11ShaderResourceView * const *) {}
+	void RSSetState(ID3D11RasterizerState *) {}
+	void DrawIndexed(UINT, UINT, INT) {}
+	void CopySubresourceRegion(ID3D11Resource *, UINT, UINT, UINT, UINT, ID3D11Resource *, UINT, const D3D11_BOX *) {}
+	HRESULT Map(ID3D11Resource *, UINT, D3D11_MAP, UINT, D3D11_MAPPED_SUBRESOURCE *) { return E_NOTIMPL; }
+	void Unmap(ID3D11Resource *, UINT) {}
+	void GenerateMips(ID3D11ShaderResourceView *) {}
+};
+
+inline UINT D3D11CalcSubresource(UINT mipSlice, UINT arraySlice, UINT mipLevels)
+{
+	return mipSlice + arraySlice * mipLevels;
+}
@@ -0,0 +1,3 @@
+#pragma once
+// Included by the texture loaders.  Only the Direct3D 11.0 stand-ins are needed.
+#include <d3d11.h>
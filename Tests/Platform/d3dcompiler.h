@@ -0,0 +1,18 @@
+#pragma once
+// Stand-in for <d3dcompiler.h>.  Shaders are never compiled on hosts without Direct3D.
+#include <d3d11.h>
+
+struct ID3DBlob
+{
+	void * GetBufferPointer() { return nullptr; }
+	size_t GetBufferSize() { return 0; }
+};
+
+#define D3D_COMPILE_STANDARD_FILE_INCLUDE	nullptr
+#define D3DCOMPILE_DEBUG					0x1
+#define D3DCOMPILE_SKIP_OPTIMIZATION		0x4
+
+inline HRESULT D3DCompileFromFile(LPCWSTR, const void *, void *, const char *, const char *, UINT, UINT, ID3DBlob **, ID3DBlob **)
+{
+	return E_NOTIMPL;
+}
@@ -0,0 +1,250 @@
+#pragma once
+// Stand-in for the parts of <windows.h> used by the device-free modules, so that they can be
+// built and tested on hosts without the Windows SDK.  Files are read through POSIX calls.
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cwchar>
+#include <string>
+#include <map>
+#include <mutex>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+typedef long			HRESULT;
+typedef uint32_t		DWORD;
+typedef uint8_t			BYTE;
+typedef unsigned short	USHORT;
+typedef unsigned int	UINT;
+typedef int				BOOL;
+typedef int				INT;
+typedef long			LONG;
+typedef float			FLOAT;
+typedef uint32_t		UINT32;
+typedef uint64_t		UINT64;
+typedef int64_t			LONGLONG;
+typedef void *			HANDLE;
+typedef void *			HWND;
+typedef void *			HINSTANCE;
+typedef void *			LPVOID;
+typedef const void *	LPCVOID;
+typedef const wchar_t *	LPCWSTR;
+typedef intptr_t		LRESULT;
+typedef uintptr_t		WPARAM;
+typedef intptr_t		LPARAM;
+
+typedef union
+{
+	struct
+	{
+		uint32_t	LowPart;
+		int32_t		HighPart;
+	};
+	int64_t			QuadPart;
+} LARGE_INTEGER;
+
+#define FAILED(hr)					(((HRESULT)(hr)) < 0)
+#define SUCCEEDED(hr)				(((HRESULT)(hr)) >= 0)
+#define S_OK						((HRESULT)0)
+#define E_FAIL						((HRESULT)0x80004005L)
+#define E_NOTIMPL					((HRESULT)0x80004001L)
+#define TRUE						1
+#define FALSE						0
+#define MAX_PATH					260
+#define CALLBACK
+#define WINAPI
+#define ZeroMemory(p, n)			memset((p), 0, (n))
+#define ARRAYSIZE(a)				(sizeof(a) / sizeof(a[0]))
+
+#define INVALID_HANDLE_VALUE		((HANDLE)(intptr_t)-1)
+#define GENERIC_READ				0x80000000u
+#define GENERIC_WRITE				0x40000000u
+#define FILE_SHARE_READ				1
+#define CREATE_ALWAYS				2
+#define OPEN_EXISTING				3
+#define FILE_ATTRIBUTE_NORMAL		0x80
+#define FILE_FLAG_SEQUENTIAL_SCAN	0x08000000
+#define PAGE_READONLY				2
+#define FILE_MAP_READ				4
+#define MOVEFILE_REPLACE_EXISTING	1
+#define MB_OK						0
+#define MB_ICONERROR				0x10
+#define SIZE_RESTORED				0
+#define VK_SHIFT					0x10
+#define VK_LEFT						0x25
+#define VK_UP						0x26
+#define VK_RIGHT					0x27
+#define VK_DOWN						0x28
+
+// Source annotations
+#define _In_
+#define _In_z_
+#define _In_opt_
+#define _In_reads_bytes_(size)
+#define _Out_
+#define _Out_opt_
+#define _Outptr_opt_
+
+namespace PlatformShim
+{
+	inline std::string Narrow(const wchar_t * text)
+	{
+		std::string result;
+		while (*text)
+		{
+			result += (char)*text++;
+		}
+		return result;
+	}
+
+	// File handles are descriptors, which are small numbers, and mapping handles point at a FileMapping
+	inline int Descriptor(HANDLE handle)
+	{
+		return (int)(intptr_t)handle;
+	}
+
+	inline bool IsDescriptor(HANDLE handle)
+	{
+		return (uintptr_t)handle < 0x10000;
+	}
+
+	struct FileMapping
+	{
+		int		Descriptor;
+		size_t	Size;
+	};
+
+	// Sizes of the mapped views, which munmap needs
+	struct ViewTable
+	{
+		std::mutex					Mutex;
+		std::map<LPCVOID, size_t>	Sizes;
+	};
+
+	inline ViewTable& GetViewTable()
+	{
+		static ViewTable viewTable;
+		return viewTable;
+	}
+}
+
+inline HANDLE CreateFileW(LPCWSTR filename, DWORD access, DWORD, void *, DWORD, DWORD, HANDLE)
+{
+	int descriptor = (access & GENERIC_WRITE) ? open(PlatformShim::Narrow(filename).c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644)
+											  : open(PlatformShim::Narrow(filename).c_str(), O_RDONLY);
+	return descriptor < 0 ? INVALID_HANDLE_VALUE : (HANDLE)(intptr_t)descriptor;
+}
+
+inline BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER * size)
+{
+	struct stat status;
+	if (fstat(PlatformShim::Descriptor(file), &status) != 0)
+	{
+		return FALSE;
+	}
+	size->QuadPart = status.st_size;
+	return TRUE;
+}
+
+inline HANDLE CreateFileMappingW(HANDLE file, void *, DWORD, DWORD, DWORD, LPCWSTR)
+{
+	struct stat status;
+	if (fstat(PlatformShim::Descriptor(file), &status) != 0 || status.st_size == 0)
+	{
+		return nullptr;
+	}
+	return new PlatformShim::FileMapping{ PlatformShim::Descriptor(file), (size_t)status.st_size };
+}
+
+inline LPVOID MapViewOfFile(HANDLE mapping, DWORD, DWORD, DWORD, size_t)
+{
+	PlatformShim::FileMapping * fileMapping = (PlatformShim::FileMapping *)mapping;
+	void * view = mmap(nullptr, fileMapping->Size, PROT_READ, MAP_PRIVATE, fileMapping->Descriptor, 0);
+	if (view == MAP_FAILED)
+	{
+		return nullptr;
+	}
+	PlatformShim::ViewTable& viewTable = PlatformShim::GetViewTable();
+	std::lock_guard<std::mutex> lock(viewTable.Mutex);
+	viewTable.Sizes[view] = fileMapping->Size;
+	return view;
+}
+
+inline BOOL UnmapViewOfFile(LPCVOID view)
+{
+	PlatformShim::ViewTable& viewTable = PlatformShim::GetViewTable();
+	std::lock_guard<std::mutex> lock(viewTable.Mutex);
+	auto found = viewTable.Sizes.find(view);
+	if (found == viewTable.Sizes.end())
+	{
+		return FALSE;
+	}
+	munmap((void *)view, found->second);
+	viewTable.Sizes.erase(found);
+	return TRUE;
+}
+
+inline BOOL CloseHandle(HANDLE handle)
+{
+	if (PlatformShim::IsDescriptor(handle))
+	{
+		return close(PlatformShim::Descriptor(handle)) == 0;
+	}
+	delete (PlatformShim::FileMapping *)handle;
+	return TRUE;
+}
+
+inline BOOL WriteFile(HANDLE file, LPCVOID data, DWORD size, DWORD * written, void *)
+{
+	ssize_t result = write(PlatformShim::Descriptor(file), data, size);
+	if (written != nullptr)
+	{
+		*written = result < 0 ? 0 : (DWORD)result;
+	}
+	return result == (ssize_t)size;
+}
+
+inline BOOL DeleteFileW(LPCWSTR filename)
+{
+	return unlink(PlatformShim::Narrow(filename).c_str()) == 0;
+}
+
+inline BOOL MoveFileExW(LPCWSTR existingFilename, LPCWSTR newFilename, DWORD)
+{
+	return rename(PlatformShim::Narrow(existingFilename).c_str(), PlatformShim::Narrow(newFilename).c_str()) == 0;
+}
+
+inline DWORD GetLastError()
+{
+	return 0;
+}
+
+inline int MessageBoxW(HWND, LPCWSTR text, LPCWSTR, UINT)
+{
+	fprintf(stderr, "%s\n", PlatformShim::Narrow(text).c_str());
+	return 0;
+}
+#define MessageBox MessageBoxW
+
+inline int MessageBoxA(HWND, const char * text, const char *, UINT)
+{
+	fprintf(stderr, "%s\n", text);
+	return 0;
+}
+
+inline short GetAsyncKeyState(int)
+{
+	return 0;
+}
+
+inline void OutputDebugStringA(const char * text)
+{
+	fputs(text, stderr);
+}
+
+inline void OutputDebugStringW(LPCWSTR text)
+{
+	fputs(PlatformShim::Narrow(text).c_str(), stderr);
+}
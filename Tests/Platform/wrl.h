@@ -0,0 +1,28 @@
+#pragma once
+// Stand-in for the ComPtr in <wrl.h>.  Nothing is reference counted, as the stand-in
+// Direct3D objects are never created.
+#include <cstddef>
+
+namespace Microsoft
+{
+	namespace WRL
+	{
+		template<class T> class ComPtr
+		{
+		public:
+			ComPtr() {}
+			ComPtr(std::nullptr_t) {}
+
+			T * Get() const { return _pointer; }
+			T ** GetAddressOf() { return &_pointer; }
+			T * operator->() const { return _pointer; }
+			void Reset() { _pointer = nullptr; }
+			ComPtr& operator=(std::nullptr_t) { _pointer = nullptr; return *this; }
+			explicit operator bool() const { return _pointer != nullptr; }
+			template<class U> HRESULT As(ComPtr<U> *) const { return E_NOTIMPL; }
+
+		private:
+			T * _pointer = nullptr;
+		};
+	}
+}
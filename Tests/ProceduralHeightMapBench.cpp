@@ -0,0 +1,46 @@
+#include "ProceduralHeightMap.h"
+#include "TestFramework.h"
+#include <cstring>
+
+// Samples per second generating 4k and 16k grids across all cores, and one sample at a time.  The 16k grid
+// (a gigabyte of heights) is generated as bands of rows, one after another, to keep the memory down.
+
+int main()
+{
+	ProceduralHeightMapSettings settings;
+	ProceduralHeightMap heightMap(settings);
+	ThreadPool threadPool;
+	const unsigned int sizes[] = { 4096, 16384 };
+	const unsigned int bandHeight = 1024;
+	printf("%-14s %8s %10s %12s\n", "Grid", "Threads", "ms", "Msamples/s");
+	vector<float> heightValues((size_t)sizes[1] * bandHeight);
+	for (unsigned int size : sizes)
+	{
+		double time = TimeMilliseconds([&]()
+		{
+			for (unsigned int z = 0; z < size; z += bandHeight)
+			{
+				heightMap.Generate(&heightValues[0], size, bandHeight, &threadPool, 0, z);
+			}
+		});
+		printf("%5u x %-6u %8u %10.0f %12.1f\n", size, size, threadPool.GetThreadCount(), time, (double)size * size / time / 1000.0);
+	}
+
+	// The last band generated one sample at a time, for comparison
+	const unsigned int size = sizes[1];
+	const unsigned int referenceRows = 64;
+	vector<float> expected((size_t)size * referenceRows);
+	double referenceTime = TimeMilliseconds([&]()
+	{
+		for (unsigned int z = 0; z < referenceRows; z++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				expected[(size_t)z * size + x] = heightMap.GetHeight(x, size - bandHeight + z);
+			}
+		}
+	});
+	printf("%-14s %8u %10.0f %12.1f\n", "GetHeight", 1u, referenceTime, (double)size * referenceRows / referenceTime / 1000.0);
+	CHECK(memcmp(&heightValues[0], &expected[0], expected.size() * sizeof(float)) == 0);
+	return TestResult();
+}
@@ -0,0 +1,123 @@
+#include "ProceduralHeightMap.h"
+#include "TerrainNode.h"
+#include "TestFramework.h"
+#include <cstring>
+
+// Checks that the generated heights don't depend on how the work is split up, that neighbouring grids
+// line up and that the heights stay in range.
+
+static void TestNoiseType(ProceduralNoiseType noiseType)
+{
+	ProceduralHeightMapSettings settings;
+	settings.NoiseType = noiseType;
+	settings.Seed = 42;
+	ProceduralHeightMap heightMap(settings);
+
+	// One sample at a time is the reference.  The width isn't a multiple of eight, so the vector path has a remainder.
+	const unsigned int width = 501;
+	const unsigned int height = 300;
+	vector<float> expected((size_t)width * height);
+	for (unsigned int z = 0; z < height; z++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			expected[(size_t)z * width + x] = heightMap.GetHeight(x, z);
+		}
+	}
+	float lowest = *min_element(expected.begin(), expected.end());
+	float highest = *max_element(expected.begin(), expected.end());
+	printf("%s: heights %.3f - %.3f\n", noiseType == ProceduralNoiseType::Ridged ? "Ridged" : "FractalBrownianMotion", lowest, highest);
+	CHECK(lowest >= 0.0f && highest <= 1.0f);
+	CHECK(highest - lowest > 0.2f);
+
+	vector<float> heightValues;
+	heightValues.assign(expected.size(), -1.0f);
+	heightMap.Generate(&heightValues[0], width, height, nullptr);
+	CHECK(memcmp(&heightValues[0], &expected[0], expected.size() * sizeof(float)) == 0);
+	const unsigned int threadCounts[] = { 1, 2, 3, 8 };
+	for (unsigned int threadCount : threadCounts)
+	{
+		ThreadPool threadPool(threadCount);
+		heightValues.assign(expected.size(), -1.0f);
+		heightMap.Generate(&heightValues[0], width, height, &threadPool);
+		if (!CHECK(memcmp(&heightValues[0], &expected[0], expected.size() * sizeof(float)) == 0))
+		{
+			printf("  with %u threads\n", threadCount);
+		}
+	}
+
+	// An area of the grid, leaving the rest alone
+	heightValues.assign(expected.size(), -1.0f);
+	heightMap.GenerateArea(&heightValues[0], width, 13, 7, 250, 101);
+	bool areaMatches = true;
+	for (unsigned int z = 0; z < height; z++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			bool inArea = x >= 13 && x < 250 && z >= 7 && z < 101;
+			size_t i = (size_t)z * width + x;
+			areaMatches = areaMatches && heightValues[i] == (inArea ? expected[i] : -1.0f);
+		}
+	}
+	CHECK(areaMatches);
+
+	// A grid generated further along the height map is the same part of it
+	vector<float> offsetValues(100 * 50);
+	heightMap.Generate(&offsetValues[0], 100, 50, nullptr, 400, 250);
+	bool offsetMatches = true;
+	for (unsigned int z = 0; z < 50; z++)
+	{
+		for (unsigned int x = 0; x < 100; x++)
+		{
+			offsetMatches = offsetMatches && offsetValues[(size_t)z * 100 + x] == expected[(size_t)(z + 250) * width + x + 400];
+		}
+	}
+	CHECK(offsetMatches);
+}
+
+static void TestSettings()
+{
+	ProceduralHeightMapSettings settings;
+	ProceduralHeightMap first(settings);
+	settings.Seed = 2;
+	ProceduralHeightMap second(settings);
+	settings.Seed = 1;
+	settings.WarpStrength = 0.0f;
+	ProceduralHeightMap third(settings);
+	CHECK(first.GetHash() != second.GetHash() && first.GetHash() != third.GetHash());
+	bool seedChangesHeights = false;
+	for (unsigned int x = 0; x < 100; x++)
+	{
+		seedChangesHeights = seedChangesHeights || first.GetHeight(x, 17) != second.GetHeight(x, 17);
+	}
+	CHECK(seedChangesHeights);
+}
+
+static void TestTerrain()
+{
+	ProceduralHeightMapSettings settings;
+	shared_ptr<ProceduralHeightMap> heightMap = make_shared<ProceduralHeightMap>(settings);
+	TerrainNode terrain(L"Terrain", heightMap, 255, 383, 1024, 10, TerrainVertexLayout::SharedGrid);
+	terrain.SetThreadPool(make_shared<ThreadPool>());
+	terrain.EnableLevelOfDetail(32, 2.0f);
+	if (CHECK(terrain.LoadGeometry()))
+	{
+		TerrainStatistics statistics = terrain.GetStatistics();
+		CHECK(statistics.VertexCount >= 256u * 384u);
+		CHECK(!statistics.LoadedFromCache);
+
+		// Sample (x, z) of the height map is column x, row z of the grid
+		XMFLOAT2 gridOrigin = terrain.GetGridOrigin();
+		float height = terrain.GetHeightAtPoint(gridOrigin.x + 100 * 10.0f, gridOrigin.y - 50 * 10.0f);
+		CHECK(fabsf(height - heightMap->GetHeight(100, 50) * 1024.0f) < 0.05f);
+	}
+}
+
+int main()
+{
+	TestNoiseType(ProceduralNoiseType::FractalBrownianMotion);
+	TestNoiseType(ProceduralNoiseType::Ridged);
+	TestSettings();
+	TestTerrain();
+	return TestResult();
+}
@@ -0,0 +1,358 @@
+#include "SceneTestNode.h"
+#include "TestFramework.h"
+#include <algorithm>
+#include <cfloat>
+
+// Checks scene bounds and frustum culling without a device: that transformed and merged bounds still hold
+// everything they held before, that SceneFrustum::Test agrees with testing box corners in clip space, and
+// that culling a scene graph finds exactly the leaves whose own bounds are not outside the frustum.
+
+static XMMATRIX GetViewProjection(const XMFLOAT3& eye, const XMFLOAT3& target, float farZ = 100.0f)
+{
+	return XMMatrixLookAtLH(XMVectorSet(eye.x, eye.y, eye.z, 1.0f), XMVectorSet(target.x, target.y, target.z, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) *
+		   XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, 1.0f, farZ);
+}
+
+static XMFLOAT3 GetCorner(const SceneBounds& bounds, unsigned int corner)
+{
+	return XMFLOAT3(bounds.Centre.x + (corner & 1 ? bounds.Extents.x : -bounds.Extents.x),
+					bounds.Centre.y + (corner & 2 ? bounds.Extents.y : -bounds.Extents.y),
+					bounds.Centre.z + (corner & 4 ? bounds.Extents.z : -bounds.Extents.z));
+}
+
+static XMFLOAT3 TransformPoint(const XMFLOAT3& point, FXMMATRIX transformation)
+{
+	XMFLOAT3 result;
+	XMStoreFloat3(&result, XMVector3Transform(XMLoadFloat3(&point), transformation));
+	return result;
+}
+
+// Whether point is within bounds' box and sphere, give or take tolerance
+static bool Holds(const SceneBounds& bounds, const XMFLOAT3& point, float tolerance)
+{
+	float dx = point.x - bounds.Centre.x;
+	float dy = point.y - bounds.Centre.y;
+	float dz = point.z - bounds.Centre.z;
+	return fabsf(dx) <= bounds.Extents.x + tolerance && fabsf(dy) <= bounds.Extents.y + tolerance && fabsf(dz) <= bounds.Extents.z + tolerance &&
+		   sqrtf(dx * dx + dy * dy + dz * dz) <= bounds.Radius + tolerance;
+}
+
+// A point on the surface of bounds' sphere pulled into its box, so in both of them, which is where
+// whatever the bounds hold can be.  Pulling it into the box, which holds the centre, can only bring it
+// closer to the centre.
+static XMFLOAT3 GetPointWithin(const SceneBounds& bounds, mt19937& random)
+{
+	uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	XMFLOAT3 direction(unit(random), unit(random), unit(random));
+	float length = sqrtf(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+	float reach = bounds.Radius / max(length, 1e-6f);
+	return XMFLOAT3(bounds.Centre.x + max(-bounds.Extents.x, min(bounds.Extents.x, direction.x * reach)),
+					bounds.Centre.y + max(-bounds.Extents.y, min(bounds.Extents.y, direction.y * reach)),
+					bounds.Centre.z + max(-bounds.Extents.z, min(bounds.Extents.z, direction.z * reach)));
+}
+
+// How far inside the clip volume point is, relative to w.  Less than 0 means outside.
+static float GetClipMargin(const XMFLOAT3& point, FXMMATRIX viewProjection)
+{
+	XMFLOAT4 clip;
+	XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(&point), viewProjection));
+	if (clip.w <= 0.0f)
+	{
+		return -1.0f;
+	}
+	return min(min(clip.w - fabsf(clip.x), clip.w - fabsf(clip.y)), min(clip.z, clip.w - clip.z)) / clip.w;
+}
+
+static void TestBounds()
+{
+	SceneBounds box = SceneBounds::FromBox(XMFLOAT3(-1.0f, 0.0f, 2.0f), XMFLOAT3(3.0f, 2.0f, 4.0f));
+	CHECK(box.Type == SceneBoundsType::Finite);
+	CHECK(box.Centre.x == 1.0f && box.Centre.y == 1.0f && box.Centre.z == 3.0f);
+	CHECK(box.Extents.x == 2.0f && box.Extents.y == 1.0f && box.Extents.z == 1.0f);
+	CHECK(fabsf(box.Radius - sqrtf(6.0f)) < 1e-6f);
+
+	// A sphere can be given that is smaller than the box, but never one that is bigger
+	CHECK(SceneBounds::FromBox(XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f), 1.0f).Radius == 1.0f);
+	CHECK(fabsf(SceneBounds::FromBox(XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f), 5.0f).Radius - sqrtf(3.0f)) < 1e-6f);
+
+	// A quarter turn swaps the extents, and an eighth of a turn grows them to hold the turned box
+	XMFLOAT4X4 transformation;
+	XMStoreFloat4x4(&transformation, XMMatrixRotationY(XM_PIDIV2) * XMMatrixTranslation(10.0f, 0.0f, 0.0f));
+	SceneBounds turned = box.Transform(transformation);
+	CHECK(fabsf(turned.Centre.x - 13.0f) < 1e-5f && fabsf(turned.Centre.z + 1.0f) < 1e-5f);
+	CHECK(fabsf(turned.Extents.x - 1.0f) < 1e-5f && fabsf(turned.Extents.z - 2.0f) < 1e-5f);
+	XMStoreFloat4x4(&transformation, XMMatrixRotationY(XM_PIDIV4));
+	SceneBounds cube = SceneBounds::FromBox(XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f));
+	CHECK(fabsf(cube.Transform(transformation).Extents.x - sqrtf(2.0f)) < 1e-5f);
+
+	// Neither kind of bounds that isn't finite is changed by a transformation
+	CHECK(SceneBounds::Empty().Transform(transformation).Type == SceneBoundsType::Empty);
+	CHECK(SceneBounds::Infinite().Transform(transformation).Type == SceneBoundsType::Infinite);
+
+	// Transformed bounds hold the transformed corners and sphere, whatever the rotation, scale and translation
+	mt19937 random(3);
+	uniform_real_distribution<float> position(-20.0f, 20.0f);
+	uniform_real_distribution<float> size(0.0f, 5.0f);
+	uniform_real_distribution<float> scale(0.2f, 3.0f);
+	int notHeld = 0;
+	for (int test = 0; test < 2000; test++)
+	{
+		XMFLOAT3 minimum(position(random), position(random), position(random));
+		XMFLOAT3 maximum(minimum.x + size(random), minimum.y + size(random), minimum.z + size(random));
+		SceneBounds bounds = SceneBounds::FromBox(minimum, maximum, test % 2 == 0 ? -1.0f : size(random));
+		float scaleX = scale(random);
+		float scaleY = scale(random);
+		float scaleZ = scale(random);
+		XMMATRIX matrix = XMMatrixScaling(scaleX, scaleY, scaleZ) * GetRandomSceneTransform(random);
+		XMStoreFloat4x4(&transformation, matrix);
+		SceneBounds transformed = bounds.Transform(transformation);
+		float tolerance = 1e-4f * (1.0f + fabsf(transformed.Centre.x) + fabsf(transformed.Centre.y) + fabsf(transformed.Centre.z) + transformed.Radius);
+
+		for (int sample = 0; sample < 20; sample++)
+		{
+			notHeld += Holds(transformed, TransformPoint(GetPointWithin(bounds, random), matrix), tolerance) ? 0 : 1;
+		}
+		if (test % 2 == 0)
+		{
+			// The sphere is around the box, so the corners are in both
+			for (unsigned int corner = 0; corner < 8; corner++)
+			{
+				notHeld += Holds(transformed, TransformPoint(GetCorner(bounds, corner), matrix), tolerance) ? 0 : 1;
+			}
+		}
+	}
+	CHECK(notHeld == 0);
+
+	// Merging with empty bounds changes nothing, and merging with infinite bounds makes them infinite
+	SceneBounds merged = SceneBounds::Empty();
+	merged.Merge(box);
+	CHECK(memcmp(&merged.Centre, &box.Centre, sizeof(XMFLOAT3)) == 0 && merged.Radius == box.Radius);
+	merged.Merge(SceneBounds::Empty());
+	CHECK(merged.Type == SceneBoundsType::Finite && merged.Radius == box.Radius);
+	merged.Merge(SceneBounds::Infinite());
+	CHECK(merged.Type == SceneBoundsType::Infinite);
+	merged.Merge(box);
+	CHECK(merged.Type == SceneBoundsType::Infinite);
+
+	// Merged bounds hold whatever either of the bounds could hold, which is in both its box and its sphere
+	notHeld = 0;
+	for (int test = 0; test < 2000; test++)
+	{
+		SceneBounds parts[2];
+		for (SceneBounds& part : parts)
+		{
+			XMFLOAT3 minimum(position(random), position(random), position(random));
+			XMFLOAT3 maximum(minimum.x + size(random), minimum.y + size(random), minimum.z + size(random));
+			part = SceneBounds::FromBox(minimum, maximum, test % 2 == 0 ? -1.0f : size(random));
+		}
+		merged = parts[0];
+		merged.Merge(parts[1]);
+		for (const SceneBounds& part : parts)
+		{
+			for (int sample = 0; sample < 20; sample++)
+			{
+				notHeld += Holds(merged, GetPointWithin(part, random), 1e-4f) ? 0 : 1;
+			}
+		}
+	}
+	CHECK(notHeld == 0);
+}
+
+static void TestFrustum()
+{
+	// Looking along z from the origin, with a 90 degree field of view, so x and y are inside while they
+	// are no further from the axis than z is
+	XMMATRIX viewProjection = GetViewProjection(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f));
+	SceneFrustum frustum(viewProjection);
+	for (unsigned int i = 0; i < 6; i++)
+	{
+		// The planes are normalised and face inwards
+		const XMFLOAT4& plane = frustum.GetPlane(i);
+		CHECK(fabsf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z - 1.0f) < 1e-5f);
+		CHECK(plane.z * 50.0f + plane.w > 0.0f);
+	}
+	auto test = [&](float x, float y, float z, float extent)
+	{
+		return frustum.Test(SceneBounds::FromBox(XMFLOAT3(x - extent, y - extent, z - extent), XMFLOAT3(x + extent, y + extent, z + extent)));
+	};
+	CHECK(test(0.0f, 0.0f, 50.0f, 1.0f) == SceneCullResult::Inside);
+	CHECK(test(0.0f, 0.0f, -10.0f, 1.0f) == SceneCullResult::Outside);
+	CHECK(test(0.0f, 0.0f, 1.0f, 0.5f) == SceneCullResult::Intersecting);
+	CHECK(test(0.0f, 0.0f, 100.0f, 1.0f) == SceneCullResult::Intersecting);
+	CHECK(test(0.0f, 0.0f, 102.0f, 1.0f) == SceneCullResult::Outside);
+	CHECK(test(60.0f, 0.0f, 50.0f, 1.0f) == SceneCullResult::Outside);
+	CHECK(test(0.0f, -60.0f, 50.0f, 1.0f) == SceneCullResult::Outside);
+	CHECK(test(50.0f, 0.0f, 50.0f, 2.0f) == SceneCullResult::Intersecting);
+	CHECK(test(0.0f, 0.0f, 50.0f, 500.0f) == SceneCullResult::Intersecting);
+	CHECK(frustum.Test(SceneBounds::Empty()) == SceneCullResult::Outside);
+	CHECK(frustum.Test(SceneBounds::Infinite()) == SceneCullResult::Intersecting);
+
+	// A long thin box reaching across the right hand plane, holding something known to be within a small
+	// sphere about its centre, which is beyond that plane.  Only the sphere lets it be culled.
+	SceneBounds thin = SceneBounds::FromBox(XMFLOAT3(25.0f, -1.0f, 29.0f), XMFLOAT3(45.0f, 1.0f, 31.0f));
+	CHECK(frustum.Test(thin) == SceneCullResult::Intersecting);
+	thin = SceneBounds::FromBox(XMFLOAT3(25.0f, -1.0f, 29.0f), XMFLOAT3(45.0f, 1.0f, 31.0f), 1.0f);
+	CHECK(frustum.Test(thin) == SceneCullResult::Outside);
+
+	// From random views, compared with the box's corners in clip space.  Any corner inside means the box
+	// can't be outside, and it is inside exactly when all of its corners are.
+	mt19937 random(4);
+	uniform_real_distribution<float> position(-100.0f, 100.0f);
+	uniform_real_distribution<float> size(0.0f, 20.0f);
+	int wronglyOutside = 0;
+	int wronglyInside = 0;
+	int notInside = 0;
+	int results[3] = { 0, 0, 0 };
+	for (int view = 0; view < 50; view++)
+	{
+		XMFLOAT3 eye(position(random), position(random), position(random));
+		XMFLOAT3 target(position(random), position(random), position(random));
+		viewProjection = GetViewProjection(eye, target, 150.0f);
+		frustum = SceneFrustum(viewProjection);
+		for (int test = 0; test < 1000; test++)
+		{
+			XMFLOAT3 minimum(position(random), position(random), position(random));
+			XMFLOAT3 maximum(minimum.x + size(random), minimum.y + size(random), minimum.z + size(random));
+			SceneBounds bounds = SceneBounds::FromBox(minimum, maximum);
+			SceneCullResult result = frustum.Test(bounds);
+			results[(int)result]++;
+			float mostInside = -FLT_MAX;
+			float leastInside = FLT_MAX;
+			for (unsigned int corner = 0; corner < 8; corner++)
+			{
+				float margin = GetClipMargin(GetCorner(bounds, corner), viewProjection);
+				mostInside = max(mostInside, margin);
+				leastInside = min(leastInside, margin);
+			}
+			wronglyOutside += result == SceneCullResult::Outside && mostInside > 1e-4f ? 1 : 0;
+			wronglyInside += result == SceneCullResult::Inside && leastInside < -1e-4f ? 1 : 0;
+			notInside += result != SceneCullResult::Inside && leastInside > 1e-4f ? 1 : 0;
+		}
+	}
+	CHECK(wronglyOutside == 0 && wronglyInside == 0 && notInside == 0);
+
+	// All three results come up often enough for that to mean something
+	CHECK(results[(int)SceneCullResult::Outside] > 1000 && results[(int)SceneCullResult::Intersecting] > 1000 && results[(int)SceneCullResult::Inside] > 1000);
+}
+
+static void TestGraphCulling()
+{
+	SceneTestScene scene = MakeSceneTestScene(100, 40, 40);
+	scene.Root->Update(XMMatrixIdentity());
+	unsigned int nodeCount = scene.Root->GetTransformHierarchy().GetNodeCount();
+
+	mt19937 random(8);
+	uniform_real_distribution<float> position(-100.0f, 100.0f);
+	int mismatchedViews = 0;
+	unsigned int subgraphsCulled = 0;
+	unsigned int nodesTested = 0;
+	unsigned int nodesVisible = 0;
+	for (int view = 0; view < 100; view++)
+	{
+		XMFLOAT3 eye(position(random), position(random), position(random));
+		XMFLOAT3 target(position(random), position(random), position(random));
+		SceneFrustum frustum(GetViewProjection(eye, target, 150.0f));
+		vector<SceneNode *> visibleNodes = scene.Root->CullVisibleNodes(frustum);
+		const SceneCullStatistics& statistics = scene.Root->GetCullStatistics();
+
+		// A leaf is only left out if its own bounds are outside, and a graph that is outside takes only
+		// leaves that are outside with it
+		vector<SceneNode *> expected;
+		for (shared_ptr<SceneTestNode>& leaf : scene.Leaves)
+		{
+			if (frustum.Test(leaf->GetWorldBounds()) != SceneCullResult::Outside)
+			{
+				expected.push_back(leaf.get());
+			}
+		}
+		sort(visibleNodes.begin(), visibleNodes.end());
+		sort(expected.begin(), expected.end());
+		mismatchedViews += visibleNodes == expected && statistics.NodesVisible == expected.size() ? 0 : 1;
+		subgraphsCulled += statistics.SubgraphsCulled;
+		nodesTested += statistics.NodesTested;
+		nodesVisible += statistics.NodesVisible;
+	}
+	printf("Over 100 views of %u nodes: %u visible, %u tested, %u subgraphs culled\n", nodeCount, nodesVisible, nodesTested, subgraphsCulled);
+	CHECK(mismatchedViews == 0);
+	CHECK(nodesVisible > 0 && subgraphsCulled > 0);
+}
+
+static void TestGraphStatistics()
+{
+	// A 10 x 10 grid of graphs 20 apart, each a tight cluster of 20 leaves.  Graphs that are outside
+	// aren't looked into and graphs that are inside have their leaves drawn without being tested, so only
+	// the graphs and the leaves of graphs that straddle the frustum are tested.
+	SceneGraphPointer root = make_shared<SceneGraph>(L"Root");
+	vector<SceneGraphPointer> graphs;
+	vector<shared_ptr<SceneTestNode>> leaves;
+	mt19937 random(9);
+	uniform_real_distribution<float> offset(-2.0f, 2.0f);
+	for (int z = 0; z < 10; z++)
+	{
+		for (int x = 0; x < 10; x++)
+		{
+			SceneGraphPointer graph = make_shared<SceneGraph>(L"Cluster");
+			graph->SetWorldTransform(XMMatrixTranslation(x * 20.0f - 90.0f, 0.0f, z * 20.0f - 90.0f));
+			for (int i = 0; i < 20; i++)
+			{
+				shared_ptr<SceneTestNode> leaf = make_shared<SceneTestNode>(L"Leaf");
+				leaf->SetLocalBounds(SceneBounds::FromBox(XMFLOAT3(-0.5f, 0.0f, -0.5f), XMFLOAT3(0.5f, 2.0f, 0.5f)));
+				float leafX = offset(random);
+				float leafZ = offset(random);
+				leaf->SetWorldTransform(XMMatrixTranslation(leafX, 0.0f, leafZ));
+				graph->Add(leaf);
+				leaves.push_back(leaf);
+			}
+			root->Add(graph);
+			graphs.push_back(graph);
+		}
+	}
+	root->Update(XMMatrixIdentity());
+
+	const XMFLOAT3 eyes[] = { XMFLOAT3(0.0f, 5.0f, -120.0f), XMFLOAT3(-100.0f, 30.0f, -100.0f), XMFLOAT3(0.0f, 5.0f, 0.0f) };
+	const XMFLOAT3 targets[] = { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(50.0f, 0.0f, 20.0f) };
+	bool allMatched = true;
+	unsigned int totalOutside = 0;
+	unsigned int totalInside = 0;
+	unsigned int totalIntersecting = 0;
+	for (unsigned int view = 0; view < 3; view++)
+	{
+		SceneFrustum frustum(GetViewProjection(eyes[view], targets[view], 150.0f));
+		size_t visibleCount = root->CullVisibleNodes(frustum).size();
+		const SceneCullStatistics& statistics = root->GetCullStatistics();
+		unsigned int outside = 0;
+		unsigned int inside = 0;
+		unsigned int intersecting = 0;
+		unsigned int leavesCulled = 0;
+		for (SceneGraphPointer& graph : graphs)
+		{
+			SceneCullResult result = frustum.Test(graph->GetWorldBounds());
+			outside += result == SceneCullResult::Outside ? 1 : 0;
+			inside += result == SceneCullResult::Inside ? 1 : 0;
+			intersecting += result == SceneCullResult::Intersecting ? 1 : 0;
+		}
+		for (size_t i = 0; i < leaves.size(); i++)
+		{
+			// Leaves are only tested, so only culled, in graphs that straddle the frustum
+			bool tested = frustum.Test(graphs[i / 20]->GetWorldBounds()) == SceneCullResult::Intersecting;
+			leavesCulled += tested && frustum.Test(leaves[i]->GetWorldBounds()) == SceneCullResult::Outside ? 1 : 0;
+		}
+		allMatched = allMatched && statistics.NodesTested == 100 + 20 * intersecting && statistics.SubgraphsCulled == outside &&
+					 statistics.NodesCulled == outside + leavesCulled && statistics.NodesVisible == 20 * (100 - outside) - leavesCulled &&
+					 visibleCount == statistics.NodesVisible;
+		totalOutside += outside;
+		totalInside += inside;
+		totalIntersecting += intersecting;
+	}
+	CHECK(allMatched);
+	CHECK(totalOutside > 0 && totalInside > 0 && totalIntersecting > 0);
+}
+
+int main()
+{
+	TestBounds();
+	TestFrustum();
+	TestGraphCulling();
+	TestGraphStatistics();
+	return TestResult();
+}
@@ -0,0 +1,159 @@
+#include "SceneTestNode.h"
+#include "TestFramework.h"
+
+// Checks finding and removing nodes in nested graphs, handles to nodes found by name, and that a node
+// added to a second graph is moved out of the first.
+
+static shared_ptr<SceneTestNode> MakeNode(const wstring& name)
+{
+	shared_ptr<SceneTestNode> node = make_shared<SceneTestNode>(name);
+	node->SetLocalBounds(SceneBounds::FromBox(XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)));
+	return node;
+}
+
+static void TestFindAndRemove()
+{
+	// Root
+	//   Outer
+	//     Inner
+	//       Deep, Twin
+	//     Twin (added after the one in Inner)
+	//   Top
+	SceneGraphPointer root = make_shared<SceneGraph>(L"Root");
+	SceneGraphPointer outer = make_shared<SceneGraph>(L"Outer");
+	SceneGraphPointer inner = make_shared<SceneGraph>(L"Inner");
+	shared_ptr<SceneTestNode> deep = MakeNode(L"Deep");
+	shared_ptr<SceneTestNode> innerTwin = MakeNode(L"Twin");
+	shared_ptr<SceneTestNode> outerTwin = MakeNode(L"Twin");
+	shared_ptr<SceneTestNode> top = MakeNode(L"Top");
+
+	// Built from the bottom up and the top down, so both ways of growing the index are used
+	inner->Add(deep);
+	inner->Add(innerTwin);
+	root->Add(outer);
+	outer->Add(inner);
+	outer->Add(outerTwin);
+	root->Add(top);
+
+	CHECK(root->Find(L"Root") == root);
+	CHECK(root->Find(L"Deep") == deep);
+	CHECK(root->Find(L"Inner") == inner);
+	CHECK(outer->Find(L"Deep") == deep);
+	CHECK(inner->Find(L"Deep") == deep);
+	CHECK(inner->Find(L"Top") == nullptr);
+	CHECK(root->Find(L"Nowhere") == nullptr);
+
+	// With two nodes of the same name, the one added first is found
+	CHECK(root->Find(L"Twin") == innerTwin);
+	CHECK(outer->Find(L"Twin") == innerTwin);
+
+	// Removing a node from the root takes it out of the graph that holds it and every index above
+	root->Remove(deep);
+	CHECK(deep->GetParentGraph() == nullptr);
+	CHECK(root->Find(L"Deep") == nullptr && outer->Find(L"Deep") == nullptr && inner->Find(L"Deep") == nullptr);
+
+	// Removing a graph takes everything below it out of the graphs above, but not out of its own index
+	root->Remove(inner);
+	CHECK(root->Find(L"Inner") == nullptr && outer->Find(L"Inner") == nullptr);
+	CHECK(root->Find(L"Twin") == outerTwin);
+	CHECK(inner->Find(L"Twin") == innerTwin);
+
+	// Adding it back somewhere else puts it and its nodes back in the indices above it
+	root->Add(inner);
+	CHECK(root->Find(L"Inner") == inner && outer->Find(L"Inner") == nullptr);
+	CHECK(root->Find(L"Twin") == outerTwin);
+	inner->Add(deep);
+	CHECK(root->Find(L"Deep") == deep && outer->Find(L"Deep") == nullptr);
+
+	// A node that isn't in the graph can't be removed from it
+	unsigned int version = root->GetVersion();
+	outer->Remove(deep);
+	CHECK(deep->GetParentGraph() == inner.get() && root->GetVersion() == version);
+	root->Remove(nullptr);
+	CHECK(root->GetVersion() == version);
+}
+
+static void TestMoveBetweenGraphs()
+{
+	SceneGraphPointer root = make_shared<SceneGraph>(L"Root");
+	SceneGraphPointer left = make_shared<SceneGraph>(L"Left");
+	SceneGraphPointer right = make_shared<SceneGraph>(L"Right");
+	shared_ptr<SceneTestNode> node = MakeNode(L"Node");
+	left->SetWorldTransform(XMMatrixTranslation(-10.0f, 0.0f, 0.0f));
+	right->SetWorldTransform(XMMatrixTranslation(10.0f, 0.0f, 0.0f));
+	root->Add(left);
+	root->Add(right);
+	left->Add(node);
+	root->Update(XMMatrixIdentity());
+	CHECK(root->GetTransformHierarchy().GetNodeCount() == 4);
+	CHECK(fabsf(node->GetCombinedWorldTransformation().m[3][0] + 10.0f) < 1e-5f);
+
+	// Adding the node to the other graph moves it, so it is only in the hierarchy once and follows its
+	// new parent
+	right->Add(node);
+	CHECK(node->GetParentGraph() == right.get());
+	CHECK(left->Find(L"Node") == nullptr && right->Find(L"Node") == node && root->Find(L"Node") == node);
+	root->Update(XMMatrixIdentity());
+	CHECK(root->GetTransformHierarchy().GetNodeCount() == 4);
+	CHECK(fabsf(node->GetCombinedWorldTransformation().m[3][0] - 10.0f) < 1e-5f);
+
+	// Only the graph it is in now draws it
+	SceneFrustum everything(XMMatrixMultiply(XMMatrixLookAtLH(XMVectorSet(0.0f, 0.0f, -100.0f, 1.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)), XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, 1.0f, 1000.0f)));
+	const vector<SceneNode *>& visibleNodes = root->CullVisibleNodes(everything);
+	CHECK(visibleNodes.size() == 1 && visibleNodes[0] == node.get());
+
+	// Adding it to the graph it is already in just moves it to the end of the children
+	unsigned int nodeCount = root->GetTransformHierarchy().GetNodeCount();
+	right->Add(node);
+	root->Update(XMMatrixIdentity());
+	CHECK(root->GetTransformHierarchy().GetNodeCount() == nodeCount && root->Find(L"Node") == node);
+
+	// Moving a whole graph under another takes its nodes with it
+	left->Add(right);
+	CHECK(root->Find(L"Node") == node && left->Find(L"Node") == node);
+	root->Update(XMMatrixIdentity());
+	CHECK(root->GetTransformHierarchy().GetNodeCount() == 4);
+	CHECK(fabsf(node->GetCombinedWorldTransformation().m[3][0]) < 1e-5f);
+}
+
+static void TestHandles()
+{
+	SceneGraphPointer root = make_shared<SceneGraph>(L"Root");
+	SceneGraphPointer outer = make_shared<SceneGraph>(L"Outer");
+	SceneGraphPointer inner = make_shared<SceneGraph>(L"Inner");
+	shared_ptr<SceneTestNode> target = MakeNode(L"Target");
+	root->Add(outer);
+	outer->Add(inner);
+	inner->Add(target);
+
+	SceneNodeHandle handle(root, L"Target");
+	SceneNodeHandle missing(root, L"Missing");
+	CHECK(handle.Get() == target);
+	CHECK(missing.Get() == nullptr);
+
+	// Changes deep below the root are seen by a handle on the root
+	inner->Remove(target);
+	CHECK(handle.Get() == nullptr);
+	shared_ptr<SceneTestNode> replacement = MakeNode(L"Target");
+	inner->Add(replacement);
+	CHECK(handle.Get() == replacement);
+	shared_ptr<SceneTestNode> late = MakeNode(L"Missing");
+	outer->Add(late);
+	CHECK(missing.Get() == late);
+
+	// As is a subgraph being taken away with the node in it
+	root->Remove(outer);
+	CHECK(handle.Get() == nullptr && missing.Get() == nullptr);
+
+	// A default handle finds nothing
+	SceneNodeHandle empty;
+	CHECK(empty.Get() == nullptr);
+}
+
+int main()
+{
+	TestFindAndRemove();
+	TestMoveBetweenGraphs();
+	TestHandles();
+	return TestResult();
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include "SceneGraph.h"
+#include <functional>
+#include <random>
+
+// A node that draws nothing, for the scene graph tests and benchmarks.  It can be given something to do
+// in Update, in which case it asks to be updated every frame.
+class SceneTestNode : public SceneNode
+{
+public:
+	SceneTestNode(wstring name) : SceneNode(name) { _updateCount = 0; }
+	SceneTestNode(wstring name, function<void(SceneTestNode&)> onUpdate) : SceneTestNode(name)
+	{
+		_onUpdate = onUpdate;
+		_updatedEveryFrame = true;
+	}
+
+	bool Initialise() { return true; }
+	void Render() {}
+	void Shutdown() {}
+
+	void Update(FXMMATRIX& currentWorldTransformation)
+	{
+		_updateCount++;
+		if (_onUpdate)
+		{
+			_onUpdate(*this);
+		}
+		SceneNode::Update(currentWorldTransformation);
+	}
+
+	inline const XMFLOAT4X4& GetCombinedWorldTransformation() { return _combinedWorldTransformation; }
+	inline SceneGraph * GetParentGraph() { return _parentGraph; }
+	inline unsigned int GetUpdateCount() { return _updateCount; }
+
+private:
+	function<void(SceneTestNode&)>	_onUpdate;
+	unsigned int					_updateCount;
+};
+
+// A scene large enough to be split across threads: groups of leaves under the root, some of them nested
+// in groups of their own, and a chain of graphs chainDepth deep with a few leaves at every level.  The same
+// arguments always give the same scene.
+struct SceneTestScene
+{
+	SceneGraphPointer					Root;
+	vector<SceneGraphPointer>			Graphs;
+	vector<shared_ptr<SceneTestNode>>	Leaves;
+};
+
+inline XMMATRIX GetRandomSceneTransform(mt19937& random)
+{
+	uniform_real_distribution<float> offset(-50.0f, 50.0f);
+	uniform_real_distribution<float> angle(-XM_PI, XM_PI);
+	float pitch = angle(random);
+	float yaw = angle(random);
+	float roll = angle(random);
+	float x = offset(random);
+	float y = offset(random);
+	float z = offset(random);
+	return XMMatrixRotationRollPitchYaw(pitch, yaw, roll) * XMMatrixTranslation(x, y, z);
+}
+
+inline SceneTestScene MakeSceneTestScene(unsigned int groups, unsigned int leavesPerGroup, unsigned int chainDepth)
+{
+	SceneTestScene scene;
+	mt19937 random(23);
+	scene.Root = make_shared<SceneGraph>(L"Root");
+	auto addLeaves = [&](SceneGraphPointer graph, unsigned int count)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			shared_ptr<SceneTestNode> leaf = make_shared<SceneTestNode>(L"Leaf");
+			leaf->SetLocalBounds(SceneBounds::FromBox(XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(1.0f, 2.0f, 1.0f)));
+			leaf->SetWorldTransform(GetRandomSceneTransform(random));
+			graph->Add(leaf);
+			scene.Leaves.push_back(leaf);
+		}
+	};
+	for (unsigned int group = 0; group < groups; group++)
+	{
+		SceneGraphPointer graph = make_shared<SceneGraph>(L"Group");
+		graph->SetWorldTransform(GetRandomSceneTransform(random));
+		scene.Root->Add(graph);
+		scene.Graphs.push_back(graph);
+		addLeaves(graph, leavesPerGroup / 2);
+		if (group % 4 == 0)
+		{
+			SceneGraphPointer nested = make_shared<SceneGraph>(L"Nested");
+			nested->SetWorldTransform(GetRandomSceneTransform(random));
+			graph->Add(nested);
+			scene.Graphs.push_back(nested);
+			addLeaves(nested, leavesPerGroup - leavesPerGroup / 2);
+		}
+		else
+		{
+			addLeaves(graph, leavesPerGroup - leavesPerGroup / 2);
+		}
+	}
+	SceneGraphPointer parent = scene.Root;
+	for (unsigned int level = 0; level < chainDepth; level++)
+	{
+		SceneGraphPointer graph = make_shared<SceneGraph>(L"Chain");
+		graph->SetWorldTransform(XMMatrixRotationY(0.01f) * XMMatrixTranslation(1.0f, 0.0f, 0.0f));
+		parent->Add(graph);
+		scene.Graphs.push_back(graph);
+		addLeaves(graph, 3);
+		parent = graph;
+	}
+	return scene;
+}
@@ -0,0 +1,109 @@
+#include "SceneTestNode.h"
+#include "TestFramework.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Milliseconds to update the transforms and bounds of a scene of about 100,000 nodes, on the calling
+// thread and split across pools of 1 to (at least) 8 threads, when everything has moved and when a
+// tenth of the leaves have.  Also counts the heap allocations each update makes.
+
+static atomic<size_t> allocationCount(0);
+
+void * operator new(size_t size)
+{
+	allocationCount++;
+	void * memory = malloc(size ? size : 1);
+	if (!memory)
+	{
+		throw bad_alloc();
+	}
+	return memory;
+}
+
+void operator delete(void * memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void * memory, size_t) noexcept
+{
+	free(memory);
+}
+
+int main()
+{
+	const int runs = 20;
+	SceneTestScene scene = MakeSceneTestScene(1000, 100, 150);
+	SceneTransformHierarchy& hierarchy = scene.Root->GetTransformHierarchy();
+	scene.Root->Update(XMMatrixIdentity());
+	printf("%u nodes on %u hardware threads\n", hierarchy.GetNodeCount(), thread::hardware_concurrency());
+
+	// The same leaves and transforms every time, picked before timing starts
+	mt19937 random(11);
+	vector<unsigned int> movedLeaves(scene.Leaves.size() / 10);
+	vector<XMFLOAT4X4> movedTransforms(movedLeaves.size());
+	for (size_t i = 0; i < movedLeaves.size(); i++)
+	{
+		movedLeaves[i] = (unsigned int)(random() % scene.Leaves.size());
+		XMStoreFloat4x4(&movedTransforms[i], GetRandomSceneTransform(random));
+	}
+
+	vector<unsigned int> threadCounts = { 0, 1, 2, 4, 8 };
+	for (unsigned int threads = 16; threads <= thread::hardware_concurrency(); threads *= 2)
+	{
+		threadCounts.push_back(threads);
+	}
+
+	printf("%-10s %15s %9s %12s %15s %9s %12s\n", "Threads", "Everything ms", "Speed up", "Allocations", "10% leaves ms", "Speed up", "Allocations");
+	double serialEverythingTime = 0.0;
+	double serialLeavesTime = 0.0;
+	for (unsigned int threads : threadCounts)
+	{
+		shared_ptr<ThreadPool> threadPool = threads == 0 ? nullptr : make_shared<ThreadPool>(threads);
+		scene.Root->SetThreadPool(threadPool);
+
+		// Moving the root moves everything
+		float rootY = 0.0f;
+		auto moveEverything = [&]()
+		{
+			rootY += 1.0f;
+			scene.Root->Update(XMMatrixTranslation(0.0f, rootY, 0.0f));
+		};
+		auto moveLeaves = [&]()
+		{
+			for (size_t i = 0; i < movedLeaves.size(); i++)
+			{
+				scene.Leaves[movedLeaves[i]]->SetWorldTransform(XMLoadFloat4x4(&movedTransforms[i]));
+			}
+			scene.Root->Update(XMMatrixTranslation(0.0f, rootY, 0.0f));
+		};
+		moveEverything();
+		moveLeaves();
+		size_t allocationsBefore = allocationCount;
+		double everythingTime = TimeMilliseconds(moveEverything, runs);
+		size_t everythingAllocations = allocationCount - allocationsBefore;
+		unsigned int everythingNodes = hierarchy.GetUpdatedNodeCount();
+		allocationsBefore = allocationCount;
+		double leavesTime = TimeMilliseconds(moveLeaves, runs);
+		size_t leavesAllocations = allocationCount - allocationsBefore;
+		unsigned int leavesNodes = hierarchy.GetUpdatedNodeCount();
+		if (threads == 0)
+		{
+			serialEverythingTime = everythingTime;
+			serialLeavesTime = leavesTime;
+		}
+
+		char name[16];
+		snprintf(name, sizeof(name), threads == 0 ? "Serial" : "%u", threads);
+		printf("%-10s %15.2f %8.2fx %12.1f %15.2f %8.2fx %12.1f\n", name, everythingTime, serialEverythingTime / everythingTime,
+			   everythingAllocations / (double)runs, leavesTime, serialLeavesTime / leavesTime, leavesAllocations / (double)runs);
+		CHECK(everythingNodes == hierarchy.GetNodeCount() && leavesNodes >= 4096);
+
+		// Only the thread pool's own bookkeeping allocates, not the pieces of the update
+		CHECK(threads > 1 ? everythingAllocations <= (size_t)runs * 2 * threads : everythingAllocations == 0);
+		CHECK(threads > 1 ? leavesAllocations <= (size_t)runs * 2 * threads : leavesAllocations == 0);
+	}
+	scene.Root->SetThreadPool(nullptr);
+	return TestResult();
+}
@@ -0,0 +1,185 @@
+#include "SceneTestNode.h"
+#include "TestFramework.h"
+#include <cstring>
+
+// Checks that nodes updated every frame are updated before the transform hierarchy, so that what they
+// move is drawn where it has moved to in the same frame, and that their combined transforms and bounds
+// come out the same as any other node's.  Also checks that updates split across a thread pool give
+// exactly the same results as serial ones.
+
+static bool Matches(const XMFLOAT4X4& actual, FXMMATRIX expected)
+{
+	XMFLOAT4X4 expectedValues;
+	XMStoreFloat4x4(&expectedValues, expected);
+	for (int row = 0; row < 4; row++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			if (fabsf(actual.m[row][column] - expectedValues.m[row][column]) > 1e-4f)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static bool CentredAt(const SceneBounds& bounds, float x, float y, float z)
+{
+	return bounds.Type == SceneBoundsType::Finite && fabsf(bounds.Centre.x - x) < 1e-4f && fabsf(bounds.Centre.y - y) < 1e-4f && fabsf(bounds.Centre.z - z) < 1e-4f;
+}
+
+static void TestNodesMovedInUpdate()
+{
+	// Root
+	//   Group (moved 100 along y)
+	//     Mover (moves itself along x each frame)
+	//   Carrier (moves Carried's graph along z each frame)
+	//   Carried graph
+	//     Passenger
+	SceneGraphPointer root = make_shared<SceneGraph>(L"Root");
+	SceneGraphPointer group = make_shared<SceneGraph>(L"Group");
+	SceneGraphPointer carried = make_shared<SceneGraph>(L"Carried");
+	float moverX = 0.0f;
+	float carriedZ = 0.0f;
+	shared_ptr<SceneTestNode> mover = make_shared<SceneTestNode>(L"Mover", [&](SceneTestNode& node)
+	{
+		moverX += 1.0f;
+		node.SetWorldTransform(XMMatrixTranslation(moverX, 0.0f, 0.0f));
+	});
+	shared_ptr<SceneTestNode> carrier = make_shared<SceneTestNode>(L"Carrier", [&](SceneTestNode&)
+	{
+		carriedZ += 2.0f;
+		carried->SetWorldTransform(XMMatrixTranslation(0.0f, 0.0f, carriedZ));
+	});
+	shared_ptr<SceneTestNode> passenger = make_shared<SceneTestNode>(L"Passenger");
+	SceneBounds unitBox = SceneBounds::FromBox(XMFLOAT3(-0.5f, -0.5f, -0.5f), XMFLOAT3(0.5f, 0.5f, 0.5f));
+	mover->SetLocalBounds(unitBox);
+	passenger->SetLocalBounds(unitBox);
+	carrier->SetLocalBounds(SceneBounds::Empty());
+	group->SetWorldTransform(XMMatrixTranslation(0.0f, 100.0f, 0.0f));
+	root->Add(group);
+	group->Add(mover);
+	root->Add(carrier);
+	root->Add(carried);
+	carried->Add(passenger);
+
+	bool sameFrame = true;
+	for (int frame = 1; frame <= 5; frame++)
+	{
+		root->Update(XMMatrixIdentity());
+		sameFrame = sameFrame && Matches(mover->GetCombinedWorldTransformation(), XMMatrixTranslation((float)frame, 100.0f, 0.0f));
+		sameFrame = sameFrame && CentredAt(mover->GetWorldBounds(), (float)frame, 100.0f, 0.0f);
+		sameFrame = sameFrame && Matches(passenger->GetCombinedWorldTransformation(), XMMatrixTranslation(0.0f, 0.0f, 2.0f * frame));
+		sameFrame = sameFrame && CentredAt(passenger->GetWorldBounds(), 0.0f, 0.0f, 2.0f * frame);
+		sameFrame = sameFrame && CentredAt(carried->GetWorldBounds(), 0.0f, 0.0f, 2.0f * frame);
+	}
+	CHECK(sameFrame);
+	CHECK(mover->GetUpdateCount() == 5 && carrier->GetUpdateCount() == 5);
+
+	// Nodes that aren't updated every frame aren't updated at all
+	CHECK(passenger->GetUpdateCount() == 0);
+
+	// The root's bounds hold everything, wherever it has moved to
+	const SceneBounds& rootBounds = root->GetWorldBounds();
+	CHECK(rootBounds.Type == SceneBoundsType::Finite);
+	CHECK(rootBounds.Centre.x - rootBounds.Extents.x <= -0.5f + 1e-4f && rootBounds.Centre.x + rootBounds.Extents.x >= 5.5f - 1e-4f);
+	CHECK(rootBounds.Centre.y + rootBounds.Extents.y >= 100.5f - 1e-4f);
+	CHECK(rootBounds.Centre.z + rootBounds.Extents.z >= 10.5f - 1e-4f);
+}
+
+static void TestParentMovedBeforeUpdate()
+{
+	// A node updated every frame gets its parent's transform from before the update, but ends up with
+	// the combined transform worked out from its parent's new one
+	SceneGraphPointer root = make_shared<SceneGraph>(L"Root");
+	SceneGraphPointer group = make_shared<SceneGraph>(L"Group");
+	shared_ptr<SceneTestNode> node = make_shared<SceneTestNode>(L"Node", [](SceneTestNode&) {});
+	node->SetLocalBounds(SceneBounds::FromBox(XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)));
+	node->SetWorldTransform(XMMatrixTranslation(1.0f, 2.0f, 3.0f));
+	root->Add(group);
+	group->Add(node);
+	root->Update(XMMatrixIdentity());
+	CHECK(Matches(node->GetCombinedWorldTransformation(), XMMatrixTranslation(1.0f, 2.0f, 3.0f)));
+
+	group->SetWorldTransform(XMMatrixTranslation(10.0f, 0.0f, 0.0f));
+	root->Update(XMMatrixIdentity());
+	CHECK(Matches(node->GetCombinedWorldTransformation(), XMMatrixTranslation(11.0f, 2.0f, 3.0f)));
+	CHECK(CentredAt(node->GetWorldBounds(), 11.0f, 2.0f, 3.0f));
+
+	// The same when the whole graph is moved by the transform Update is given
+	root->Update(XMMatrixTranslation(0.0f, -5.0f, 0.0f));
+	CHECK(Matches(node->GetCombinedWorldTransformation(), XMMatrixTranslation(11.0f, -3.0f, 3.0f)));
+	CHECK(CentredAt(node->GetWorldBounds(), 11.0f, -3.0f, 3.0f));
+	CHECK(node->GetUpdateCount() == 3);
+}
+
+static bool SameBounds(const SceneBounds& a, const SceneBounds& b)
+{
+	return a.Type == b.Type && memcmp(&a.Centre, &b.Centre, sizeof(XMFLOAT3)) == 0 && memcmp(&a.Extents, &b.Extents, sizeof(XMFLOAT3)) == 0 &&
+		   memcmp(&a.Radius, &b.Radius, sizeof(float)) == 0;
+}
+
+static bool SameResults(SceneTestScene& serial, SceneTestScene& parallel)
+{
+	bool same = SameBounds(serial.Root->GetWorldBounds(), parallel.Root->GetWorldBounds());
+	for (size_t i = 0; i < serial.Leaves.size(); i++)
+	{
+		same = same && memcmp(&serial.Leaves[i]->GetCombinedWorldTransformation(), &parallel.Leaves[i]->GetCombinedWorldTransformation(), sizeof(XMFLOAT4X4)) == 0;
+		same = same && SameBounds(serial.Leaves[i]->GetWorldBounds(), parallel.Leaves[i]->GetWorldBounds());
+	}
+	for (size_t i = 0; i < serial.Graphs.size(); i++)
+	{
+		same = same && SameBounds(serial.Graphs[i]->GetWorldBounds(), parallel.Graphs[i]->GetWorldBounds());
+	}
+	return same;
+}
+
+static void TestParallelMatchesSerial()
+{
+	// Two copies of a scene with a 150 deep chain of graphs, one updated on a pool of four threads.  Each
+	// frame moves the same nodes in both.
+	SceneTestScene serial = MakeSceneTestScene(200, 100, 150);
+	SceneTestScene parallel = MakeSceneTestScene(200, 100, 150);
+	parallel.Root->SetThreadPool(make_shared<ThreadPool>(4));
+	SceneTransformHierarchy& hierarchy = parallel.Root->GetTransformHierarchy();
+
+	serial.Root->Update(XMMatrixIdentity());
+	parallel.Root->Update(XMMatrixIdentity());
+	CHECK(hierarchy.GetUpdatedNodeCount() == hierarchy.GetNodeCount());
+	CHECK(SameResults(serial, parallel));
+
+	mt19937 random(5);
+	unsigned int splitFrames = 0;
+	for (int frame = 0; frame < 6; frame++)
+	{
+		XMMATRIX rootTransformation = frame % 3 == 0 ? XMMatrixTranslation(0.0f, (float)frame, 0.0f) : XMMatrixIdentity();
+		for (int moved = 0; moved < (frame % 2 == 0 ? 10 : 1); moved++)
+		{
+			size_t graph = random() % serial.Graphs.size();
+			XMMATRIX transformation = GetRandomSceneTransform(random);
+			serial.Graphs[graph]->SetWorldTransform(transformation);
+			parallel.Graphs[graph]->SetWorldTransform(transformation);
+		}
+		for (int moved = 0; moved < 5000; moved++)
+		{
+			size_t leaf = random() % serial.Leaves.size();
+			XMMATRIX transformation = GetRandomSceneTransform(random);
+			serial.Leaves[leaf]->SetWorldTransform(transformation);
+			parallel.Leaves[leaf]->SetWorldTransform(transformation);
+		}
+		serial.Root->Update(rootTransformation);
+		parallel.Root->Update(rootTransformation);
+		splitFrames += hierarchy.GetUpdatedNodeCount() >= 4096 ? 1 : 0;
+		CHECK(SameResults(serial, parallel));
+	}
+	CHECK(splitFrames == 6);
+}
+
+int main()
+{
+	TestNodesMovedInUpdate();
+	TestParentMovedBeforeUpdate();
+	TestParallelMatchesSerial();
+	return TestResult();
+}
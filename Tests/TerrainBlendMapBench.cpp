@@ -0,0 +1,74 @@
+#include "TerrainBlendMap.h"
+#include "ThreadPool.h"
+#include "TestFramework.h"
+
+// Time to calculate the example terrain's blend map, scalar and vector, with and without slope blending,
+// on one thread and across the pool, and to build its mip chain
+
+int main()
+{
+	vector<float> heightValues;
+	unsigned int numberOfXPoints;
+	unsigned int numberOfZPoints;
+	if (!CHECK(LoadHeightMap("Example_HeightMap.raw", heightValues, numberOfXPoints, numberOfZPoints)))
+	{
+		return TestResult();
+	}
+	unsigned int columns = numberOfXPoints - 1;
+	unsigned int rows = numberOfZPoints - 1;
+	const TerrainSlopeBlend slopeBlendOff = { 0.0f, 0.0f };
+	const TerrainSlopeBlend slopeBlendOn = { 0.6f, 1.2f };
+	vector<DWORD> scalarTexels((size_t)columns * rows);
+	vector<DWORD> texels((size_t)columns * rows);
+	ThreadPool threadPool;
+
+	double scalarTime = TimeMilliseconds([&]()
+	{
+		CalculateBlendMapTexelsScalar(&heightValues[0], numberOfXPoints, 1024.0f, 10.0f, slopeBlendOn, 0, columns, 0, rows, &scalarTexels[0], columns);
+	}, 5);
+	double vectorTimeNoSlope = TimeMilliseconds([&]()
+	{
+		CalculateBlendMapTexels(&heightValues[0], numberOfXPoints, 1024.0f, 10.0f, slopeBlendOff, 0, columns, 0, rows, &texels[0], columns);
+	}, 5);
+	double vectorTime = TimeMilliseconds([&]()
+	{
+		CalculateBlendMapTexels(&heightValues[0], numberOfXPoints, 1024.0f, 10.0f, slopeBlendOn, 0, columns, 0, rows, &texels[0], columns);
+	}, 5);
+	CHECK(texels == scalarTexels);
+	double parallelTime = TimeMilliseconds([&]()
+	{
+		threadPool.ParallelFor(rows, [&](unsigned int firstRow, unsigned int endRow)
+		{
+			CalculateBlendMapTexels(&heightValues[0], numberOfXPoints, 1024.0f, 10.0f, slopeBlendOn, 0, columns, firstRow, endRow,
+									&texels[(size_t)firstRow * columns], columns);
+		});
+	}, 5);
+	CHECK(texels == scalarTexels);
+
+	vector<vector<DWORD>> mips(CalculateMipLevelCount(columns, rows) - 1);
+	double mipTime = TimeMilliseconds([&]()
+	{
+		const DWORD * source = &texels[0];
+		unsigned int width = columns;
+		unsigned int height = rows;
+		for (vector<DWORD>& mip : mips)
+		{
+			mip.resize((size_t)GetMipSize(width, 1) * GetMipSize(height, 1));
+			DownsampleTexels(source, width, height, &mip[0], 0, 0, GetMipSize(width, 1), GetMipSize(height, 1));
+			source = &mip[0];
+			width = GetMipSize(width, 1);
+			height = GetMipSize(height, 1);
+		}
+	}, 5);
+	CHECK(mips.back().size() == 1);
+
+	double texelCount = (double)columns * rows;
+	printf("%u x %u blend map\n", columns, rows);
+	printf("%-26s %8s %8s %12s\n", "Version", "Threads", "ms", "Mtexels/s");
+	printf("%-26s %8u %8.2f %12.1f\n", "Scalar, slope", 1u, scalarTime, texelCount / scalarTime / 1000.0);
+	printf("%-26s %8u %8.2f %12.1f\n", "Vector, no slope", 1u, vectorTimeNoSlope, texelCount / vectorTimeNoSlope / 1000.0);
+	printf("%-26s %8u %8.2f %12.1f\n", "Vector, slope", 1u, vectorTime, texelCount / vectorTime / 1000.0);
+	printf("%-26s %8u %8.2f %12.1f\n", "Vector, slope", threadPool.GetThreadCount(), parallelTime, texelCount / parallelTime / 1000.0);
+	printf("%-26s %8u %8.2f\n", "Mip chain", 1u, mipTime);
+	return TestResult();
+}
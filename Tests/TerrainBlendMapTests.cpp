@@ -0,0 +1,184 @@
+#include "TerrainBlendMap.h"
+#include "TestFramework.h"
+
+// Golden texels for hand made cells, the texels the terrain has always used when slope blending is off,
+// the vector version against the scalar one and the mip chain against a straightforward downsample.
+
+const TerrainSlopeBlend SlopeBlendOff = { 0.0f, 0.0f };
+const TerrainSlopeBlend SlopeBlendOn = { 0.6f, 1.2f };
+
+// The blend map texel as GenerateBlendMap originally worked it out, from the six corners of the cell's triangles
+static DWORD GetOriginalTexel(const float * heightValues, unsigned int numberOfXPoints, float worldHeight, unsigned int x, unsigned int z)
+{
+	size_t topLeft = (size_t)z * numberOfXPoints + x;
+	size_t corners[6] = { topLeft, topLeft + 1, topLeft + numberOfXPoints, topLeft + numberOfXPoints, topLeft + 1, topLeft + numberOfXPoints + 1 };
+	BYTE r = 0;
+	BYTE g = 0;
+	BYTE b = 0;
+	float y = 0.0f;
+	for (size_t corner : corners)
+	{
+		y += heightValues[corner] * worldHeight;
+	}
+	y = y / 6.0f;
+	if (y < 200.0f)
+	{
+		b = (BYTE)(200.0f - y);
+		r = 200 - b;
+	}
+	if (y >= 200.0f && y <= 400.0f)
+	{
+		r = (BYTE)(-y + 400.0f);
+	}
+	if (y >= 650.0f && y < 900.0f)
+	{
+		g = (BYTE)(y - 650.0f);
+	}
+	return (b << 16) + (g << 8) + r;
+}
+
+static void TestGoldenTexels()
+{
+	// Corner heights in world units (top left, top right, bottom left, bottom right) and the texel expected
+	// with slope blending on.  r is dark dirt, g stone and b light dirt.
+	struct GoldenCell
+	{
+		float	Heights[4];
+		DWORD	Texel;
+	};
+	const GoldenCell cells[] =
+	{
+		{ { 100.0f, 100.0f, 100.0f, 100.0f }, 0x640064 },		// Low down: light and dark dirt
+		{ { 300.0f, 300.0f, 300.0f, 300.0f }, 0x000064 },		// Dark dirt fading out
+		{ { 500.0f, 500.0f, 500.0f, 500.0f }, 0x000000 },		// Grass
+		{ { 700.0f, 700.0f, 700.0f, 700.0f }, 0x003200 },		// Stone coming in
+		{ { 899.0f, 899.0f, 899.0f, 899.0f }, 0x00f900 },
+		{ { 950.0f, 950.0f, 950.0f, 950.0f }, 0x000000 },		// Snow
+		{ { 100.0f, 120.0f, 100.0f, 120.0f }, 0x00ff6e },		// Slope of 2: all stone, no light dirt
+		{ { 100.0f, 107.5f, 100.0f, 107.5f }, 0x484068 },		// Slope of 0.75: a quarter stone
+		{ { 300.0f, 300.0f, 309.0f, 309.0f }, 0x00805f },		// Slope of 0.9 along z: half stone
+		{ { 300.0f, 300.0f, 305.0f, 305.0f }, 0x000061 },		// Slope of 0.5, below the start
+	};
+	const float worldHeight = 1024.0f;
+	for (const GoldenCell& cell : cells)
+	{
+		// The cell repeated along a row of 16, so that the vector version is used as well
+		vector<float> heightValues(2 * 17);
+		for (unsigned int x = 0; x < 17; x++)
+		{
+			heightValues[x] = cell.Heights[x % 2] / worldHeight;
+			heightValues[17 + x] = cell.Heights[2 + x % 2] / worldHeight;
+		}
+		DWORD texel;
+		CalculateBlendMapTexelsScalar(&heightValues[0], 17, worldHeight, 10.0f, SlopeBlendOn, 0, 1, 0, 1, &texel, 1);
+		DWORD texels[16];
+		CalculateBlendMapTexels(&heightValues[0], 17, worldHeight, 10.0f, SlopeBlendOn, 0, 16, 0, 1, texels, 16);
+		if (!CHECK(texel == cell.Texel && texels[0] == cell.Texel))
+		{
+			printf("  heights %g %g %g %g: expected %06x, got %06x and %06x\n", cell.Heights[0], cell.Heights[1], cell.Heights[2], cell.Heights[3],
+				   cell.Texel, texel, texels[0]);
+		}
+	}
+}
+
+// Each mip texel is the rounded average of the 2 x 2 texels above it, repeating the last row or column of an odd sized level
+static vector<DWORD> Downsample(const DWORD * source, unsigned int sourceWidth, unsigned int sourceHeight)
+{
+	unsigned int width = GetMipSize(sourceWidth, 1);
+	unsigned int height = GetMipSize(sourceHeight, 1);
+	vector<DWORD> destination((size_t)width * height);
+	for (unsigned int y = 0; y < height; y++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			unsigned int xs[2] = { 2 * x, min(2 * x + 1, sourceWidth - 1) };
+			unsigned int ys[2] = { 2 * y, min(2 * y + 1, sourceHeight - 1) };
+			DWORD texel = 0;
+			for (unsigned int channel = 0; channel < 4; channel++)
+			{
+				unsigned int sum = 0;
+				for (unsigned int sourceY : ys)
+				{
+					for (unsigned int sourceX : xs)
+					{
+						sum += (source[(size_t)sourceY * sourceWidth + sourceX] >> (8 * channel)) & 255;
+					}
+				}
+				texel |= ((sum + 2) >> 2) << (8 * channel);
+			}
+			destination[(size_t)y * width + x] = texel;
+		}
+	}
+	return destination;
+}
+
+static void TestHeightMap(const char * heightMap)
+{
+	vector<float> heightValues;
+	unsigned int numberOfXPoints;
+	unsigned int numberOfZPoints;
+	if (!CHECK(LoadHeightMap(heightMap, heightValues, numberOfXPoints, numberOfZPoints)))
+	{
+		return;
+	}
+	unsigned int columns = numberOfXPoints - 1;
+	unsigned int rows = numberOfZPoints - 1;
+	vector<DWORD> texels((size_t)columns * rows);
+	CalculateBlendMapTexels(&heightValues[0], numberOfXPoints, 1024.0f, 10.0f, SlopeBlendOff, 0, columns, 0, rows, &texels[0], columns);
+	bool original = true;
+	for (unsigned int z = 0; z < rows; z++)
+	{
+		for (unsigned int x = 0; x < columns; x++)
+		{
+			original = original && texels[(size_t)z * columns + x] == GetOriginalTexel(&heightValues[0], numberOfXPoints, 1024.0f, x, z);
+		}
+	}
+	CHECK(original);
+
+	vector<DWORD> scalarTexels((size_t)columns * rows);
+	CalculateBlendMapTexelsScalar(&heightValues[0], numberOfXPoints, 1024.0f, 10.0f, SlopeBlendOn, 0, columns, 0, rows, &scalarTexels[0], columns);
+	CalculateBlendMapTexels(&heightValues[0], numberOfXPoints, 1024.0f, 10.0f, SlopeBlendOn, 0, columns, 0, rows, &texels[0], columns);
+	CHECK(texels == scalarTexels);
+
+	// An area that doesn't start or end on a multiple of eight
+	vector<DWORD> area(37 * 29);
+	CalculateBlendMapTexels(&heightValues[0], numberOfXPoints, 1024.0f, 10.0f, SlopeBlendOn, 101, 138, 333, 362, &area[0], 37);
+	bool areaMatches = true;
+	for (unsigned int z = 0; z < 29; z++)
+	{
+		for (unsigned int x = 0; x < 37; x++)
+		{
+			areaMatches = areaMatches && area[z * 37 + x] == scalarTexels[(size_t)(333 + z) * columns + 101 + x];
+		}
+	}
+	CHECK(areaMatches);
+
+	// The whole mip chain, down to 1 x 1
+	CHECK(CalculateMipLevelCount(columns, rows) == 10);
+	vector<DWORD> level = texels;
+	unsigned int width = columns;
+	unsigned int height = rows;
+	bool mipsMatch = true;
+	while (width > 1 || height > 1)
+	{
+		vector<DWORD> next((size_t)GetMipSize(width, 1) * GetMipSize(height, 1));
+		DownsampleTexels(&level[0], width, height, &next[0], 0, 0, GetMipSize(width, 1), GetMipSize(height, 1));
+		mipsMatch = mipsMatch && next == Downsample(&level[0], width, height);
+		level = next;
+		width = GetMipSize(width, 1);
+		height = GetMipSize(height, 1);
+	}
+	CHECK(mipsMatch);
+}
+
+int main()
+{
+	TestGoldenTexels();
+	const char * heightMaps[] = { "Example_HeightMap.raw", "Test_HeightMap3.raw", "Test_HeightMap6.raw" };
+	for (const char * heightMap : heightMaps)
+	{
+		TestHeightMap(heightMap);
+	}
+	CHECK(CalculateMipLevelCount(1, 1) == 1 && CalculateMipLevelCount(1024, 3) == 11);
+	return TestResult();
+}
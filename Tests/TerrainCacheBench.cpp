@@ -0,0 +1,27 @@
+#include "TerrainNode.h"
+#include "TestFramework.h"
+
+// Startup time of the example terrain with no cache file, and then with the cache written by the first run
+
+int main()
+{
+	shared_ptr<ThreadPool> threadPool = make_shared<ThreadPool>();
+	wstring filename = CopyToScratch("Example_HeightMap.raw", "TerrainCacheBench.raw");
+	const char * runNames[] = { "Cold", "Warm", "Warm" };
+	printf("%-6s %10s %14s %10s\n", "Cache", "Load ms", "Generation ms", "Cached");
+	double loadTimes[3];
+	for (int run = 0; run < 3; run++)
+	{
+		TerrainNode terrain(L"Terrain", filename, 1023, 1023, 1024, 10, TerrainVertexLayout::SharedGrid);
+		terrain.SetThreadPool(threadPool);
+		terrain.EnableLevelOfDetail(32, 2.0f);
+		CHECK(terrain.LoadGeometry());
+		TerrainStatistics statistics = terrain.GetStatistics();
+		CHECK(statistics.LoadedFromCache == (run > 0));
+		loadTimes[run] = statistics.LoadTime;
+		printf("%-6s %10.1f %14.1f %10s\n", runNames[run], statistics.LoadTime, statistics.GenerationTime, statistics.LoadedFromCache ? "yes" : "no");
+	}
+	printf("Warm start is %.0fx faster\n", loadTimes[0] / min(loadTimes[1], loadTimes[2]));
+	CHECK(min(loadTimes[1], loadTimes[2]) < loadTimes[0]);
+	return TestResult();
+}
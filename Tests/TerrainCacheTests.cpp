@@ -0,0 +1,113 @@
+#include "TerrainNode.h"
+#include "TestFramework.h"
+#include <cstring>
+
+// Checks that TerrainCache gives back what was written and refuses files it shouldn't trust, and that a
+// terrain loaded from its cache matches the one that was generated.
+
+static void TestCacheFile()
+{
+	wstring filename = GetScratchFilename("TerrainCacheTests.cache");
+	vector<UINT> first(1001);
+	for (size_t i = 0; i < first.size(); i++)
+	{
+		first[i] = (UINT)(i * 2654435761u);
+	}
+	const char second[] = "seven";
+	TerrainCache writer;
+	writer.AddSection(TerrainCacheSection::Indices, &first[0], first.size() * sizeof(UINT));
+	writer.AddSection(TerrainCacheSection::BlendMap, second, sizeof(second));
+	CHECK(writer.Write(filename, 1234));
+
+	TerrainCache reader;
+	if (CHECK(reader.Open(filename, 1234)))
+	{
+		size_t size;
+		const BYTE * data = reader.GetSection(TerrainCacheSection::Indices, size);
+		CHECK(data != nullptr && size == first.size() * sizeof(UINT) && memcmp(data, &first[0], size) == 0);
+		CHECK(((size_t)data & 15) == 0);
+		data = reader.GetSection(TerrainCacheSection::BlendMap, size);
+		CHECK(data != nullptr && size == sizeof(second) && memcmp(data, second, size) == 0);
+		CHECK(((size_t)data & 15) == 0);
+		CHECK(reader.GetSection(TerrainCacheSection::Vertices, size) == nullptr && size == 0);
+		reader.Close();
+	}
+	CHECK(!reader.Open(filename, 1235));
+	CHECK(!reader.Open(GetScratchFilename("TerrainCacheTests.missing"), 1234));
+
+	// A file cut short must not be trusted
+	string narrowFilename(filename.begin(), filename.end());
+	vector<char> contents;
+	{
+		ifstream input(narrowFilename, ios::binary);
+		contents.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+	}
+	{
+		ofstream output(narrowFilename, ios::binary | ios::trunc);
+		output.write(&contents[0], contents.size() - 100);
+	}
+	CHECK(!reader.Open(filename, 1234));
+	remove(narrowFilename.c_str());
+
+	// Hashes combine, and differ when any byte does
+	CHECK(TerrainCache::Hash("ab", 2) == TerrainCache::Hash("b", 1, TerrainCache::Hash("a", 1)));
+	CHECK(TerrainCache::Hash("ab", 2) != TerrainCache::Hash("ac", 2));
+}
+
+struct LoadedTerrain
+{
+	TerrainStatistics		Statistics;
+	vector<unsigned char>	Pyramid;
+	vector<unsigned char>	Chunks;
+	VertexCacheStatistics	VertexCache;
+	float					Height;
+};
+
+static LoadedTerrain LoadTerrain(const wstring& filename, int worldHeight, shared_ptr<ThreadPool> threadPool)
+{
+	LoadedTerrain loaded = {};
+	TerrainNode terrain(L"Terrain", filename, 1023, 1023, worldHeight, 10, TerrainVertexLayout::SharedGrid);
+	terrain.SetThreadPool(threadPool);
+	terrain.EnableLevelOfDetail(32, 2.0f);
+	CHECK(terrain.LoadGeometry());
+	loaded.Statistics = terrain.GetStatistics();
+	terrain.GetHeightPyramid().Serialise(loaded.Pyramid);
+	const BYTE * chunks = (const BYTE *)terrain.GetQuadTree().GetChunks();
+	loaded.Chunks.assign(chunks, chunks + terrain.GetQuadTree().GetChunkCount() * sizeof(TerrainChunk));
+	loaded.VertexCache = terrain.AnalyseVertexCache(32, VertexCachePolicy::Fifo);
+	loaded.Height = terrain.GetHeightAtPoint(1234.5f, -678.9f);
+	return loaded;
+}
+
+static void TestTerrainCache()
+{
+	shared_ptr<ThreadPool> threadPool = make_shared<ThreadPool>();
+	wstring filename = CopyToScratch("Example_HeightMap.raw", "TerrainCacheTests.raw");
+	LoadedTerrain generated = LoadTerrain(filename, 1024, threadPool);
+	LoadedTerrain cached = LoadTerrain(filename, 1024, threadPool);
+	CHECK(!generated.Statistics.LoadedFromCache);
+	CHECK(cached.Statistics.LoadedFromCache);
+	CHECK(cached.Statistics.VertexCount == generated.Statistics.VertexCount && cached.Statistics.IndexCount == generated.Statistics.IndexCount);
+	CHECK(cached.Pyramid == generated.Pyramid);
+	CHECK(cached.Chunks == generated.Chunks);
+	CHECK(cached.VertexCache.Transforms == generated.VertexCache.Transforms);
+	CHECK(cached.Height == generated.Height);
+
+	// A different parameter, or different heights, must not use the cache
+	CHECK(!LoadTerrain(filename, 512, threadPool).Statistics.LoadedFromCache);
+	CHECK(LoadTerrain(filename, 512, threadPool).Statistics.LoadedFromCache);
+	string narrowFilename(filename.begin(), filename.end());
+	{
+		fstream file(narrowFilename, ios::binary | ios::in | ios::out);
+		file.seekp(1000);
+		file.put(17);
+	}
+	CHECK(!LoadTerrain(filename, 512, threadPool).Statistics.LoadedFromCache);
+}
+
+int main()
+{
+	TestCacheFile();
+	TestTerrainCache();
+	return TestResult();
+}
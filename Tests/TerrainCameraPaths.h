@@ -0,0 +1,41 @@
+#pragma once
+#include "TerrainNode.h"
+#include <cmath>
+
+// The camera paths that the occlusion tests and benchmark fly over a terrain: a low circuit, a pass just
+// above the ground from one corner towards the other and a higher circuit.  t runs from 0 to 1 along the path.
+
+const unsigned int CameraPathCount = 3;
+
+inline XMFLOAT3 GetCameraPathPosition(TerrainNode& terrain, unsigned int numberOfXPoints, unsigned int numberOfZPoints, float spacing,
+									  unsigned int path, float t)
+{
+	XMFLOAT2 gridOrigin = terrain.GetGridOrigin();
+	float sizeX = (numberOfXPoints - 1) * spacing;
+	float sizeZ = (numberOfZPoints - 1) * spacing;
+	float x;
+	float z;
+	float heightAboveGround;
+	const float fullCircle = 6.2831853f;
+	switch (path)
+	{
+	case 0:
+		x = gridOrigin.x + sizeX * (0.5f + 0.35f * cosf(fullCircle * t));
+		z = gridOrigin.y - sizeZ * (0.5f + 0.35f * sinf(fullCircle * t));
+		heightAboveGround = 20.0f;
+		break;
+
+	case 1:
+		x = gridOrigin.x + sizeX * (0.05f + 0.9f * t);
+		z = gridOrigin.y - sizeZ * (0.1f + 0.8f * t);
+		heightAboveGround = 5.0f;
+		break;
+
+	default:
+		x = gridOrigin.x + sizeX * (0.5f + 0.2f * cosf(fullCircle * t));
+		z = gridOrigin.y - sizeZ * (0.5f + 0.2f * sinf(fullCircle * t));
+		heightAboveGround = 150.0f;
+		break;
+	}
+	return XMFLOAT3(x, terrain.GetHeightAtPoint(x, z) + heightAboveGround, z);
+}
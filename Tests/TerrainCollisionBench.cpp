@@ -0,0 +1,134 @@
+#include "TerrainNode.h"
+#include "TestFramework.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+
+// Milliseconds for a frame of 100,000 sphere, capsule and swept sphere queries against the height maps
+// that ship with the demo, with the movers in random order and sorted by where they are.  Also counts
+// the heap allocations made by the single queries, which should be none.
+
+static atomic<size_t> allocationCount(0);
+
+void * operator new(size_t size)
+{
+	allocationCount++;
+	void * memory = malloc(size ? size : 1);
+	if (!memory)
+	{
+		throw bad_alloc();
+	}
+	return memory;
+}
+
+void operator delete(void * memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void * memory, size_t) noexcept
+{
+	free(memory);
+}
+
+int main()
+{
+	const char * heightMaps[] = { "Example_HeightMap.raw", "Test_HeightMap3.raw", "Test_HeightMap6.raw" };
+	const int worldHeight = 1024;
+	const int spacing = 10;
+	const unsigned int count = 100000;
+	shared_ptr<ThreadPool> threadPool = make_shared<ThreadPool>();
+
+	printf("%-22s %-8s %11s %11s %11s %8s %8s %8s %12s\n", "Height map", "Order", "Spheres ms", "Capsules ms", "Sweeps ms", "Spheres", "Capsules", "Sweeps", "Allocations");
+	for (const char * heightMap : heightMaps)
+	{
+		vector<float> heightValues;
+		unsigned int numberOfXPoints;
+		unsigned int numberOfZPoints;
+		if (!CHECK(LoadHeightMap(heightMap, heightValues, numberOfXPoints, numberOfZPoints)))
+		{
+			continue;
+		}
+		TerrainNode terrain(L"Terrain", GetDataFilename(heightMap), numberOfZPoints - 1, numberOfXPoints - 1, worldHeight, spacing, TerrainVertexLayout::SharedGrid);
+		terrain.SetCacheEnabled(false);
+		terrain.SetThreadPool(threadPool);
+		if (!CHECK(terrain.LoadGeometry()))
+		{
+			continue;
+		}
+
+		// Movers on or just above the ground: players, bouncing spheres and fast moving projectiles
+		XMFLOAT2 gridOrigin = terrain.GetGridOrigin();
+		mt19937 random(19);
+		uniform_real_distribution<float> positionX(gridOrigin.x + 2.0f * spacing, gridOrigin.x + (numberOfXPoints - 3) * (float)spacing);
+		uniform_real_distribution<float> positionZ(gridOrigin.y - (numberOfZPoints - 3) * (float)spacing, gridOrigin.y - 2.0f * spacing);
+		uniform_real_distribution<float> unit(0.0f, 1.0f);
+		vector<TerrainSphere> spheres(count);
+		vector<TerrainCapsule> capsules(count);
+		vector<TerrainSphereSweep> sweeps(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			float x = positionX(random);
+			float z = positionZ(random);
+			float height = terrain.GetHeightAtPoint(x, z);
+			spheres[i] = { XMFLOAT3(x, height + 2.0f * unit(random), z), 1.0f };
+			capsules[i] = { XMFLOAT3(x, height + 0.2f + unit(random), z), XMFLOAT3(x + 1.0f, height + 2.2f, z), 0.5f };
+			float yaw = XM_2PI * unit(random);
+			sweeps[i] = { XMFLOAT3(x, height + 2.0f, z), XMFLOAT3(x + 20.0f * cosf(yaw), height - 3.0f, z + 20.0f * sinf(yaw)), 1.0f };
+		}
+
+		vector<TerrainContact> contacts(count);
+		for (int sorted = 0; sorted < 2; sorted++)
+		{
+			if (sorted)
+			{
+				// In rows of 8 by 8 cell blocks, as they would be if the caller kept its movers in spatial order
+				vector<unsigned int> order(count);
+				for (unsigned int i = 0; i < count; i++)
+				{
+					order[i] = i;
+				}
+				auto key = [&](unsigned int i)
+				{
+					return ((unsigned int)((gridOrigin.y - spheres[i].Centre.z) / (8 * spacing)) << 16) | (unsigned int)((spheres[i].Centre.x - gridOrigin.x) / (8 * spacing));
+				};
+				sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return key(a) < key(b); });
+				vector<TerrainSphere> sortedSpheres(count);
+				vector<TerrainCapsule> sortedCapsules(count);
+				vector<TerrainSphereSweep> sortedSweeps(count);
+				for (unsigned int i = 0; i < count; i++)
+				{
+					sortedSpheres[i] = spheres[order[i]];
+					sortedCapsules[i] = capsules[order[i]];
+					sortedSweeps[i] = sweeps[order[i]];
+				}
+				spheres.swap(sortedSpheres);
+				capsules.swap(sortedCapsules);
+				sweeps.swap(sortedSweeps);
+			}
+			unsigned int sphereHits = 0;
+			unsigned int capsuleHits = 0;
+			unsigned int sweepHits = 0;
+			double sphereTime = TimeMilliseconds([&]() { sphereHits = terrain.SphereOverlaps(&spheres[0], count, &contacts[0]); }, 5);
+			double capsuleTime = TimeMilliseconds([&]() { capsuleHits = terrain.CapsuleOverlaps(&capsules[0], count, &contacts[0]); }, 5);
+			double sweepTime = TimeMilliseconds([&]() { sweepHits = terrain.SweepSpheres(&sweeps[0], count, &contacts[0]); }, 5);
+
+			// The batches hand bands of movers to the thread pool, so count the single queries
+			size_t allocationsBefore = allocationCount;
+			for (unsigned int i = 0; i < count; i++)
+			{
+				terrain.SphereOverlap(spheres[i].Centre, spheres[i].Radius, contacts[i]);
+				terrain.CapsuleOverlap(capsules[i].Start, capsules[i].End, capsules[i].Radius, contacts[i]);
+				terrain.SweepSphere(sweeps[i].Start, sweeps[i].End, sweeps[i].Radius, contacts[i]);
+			}
+			size_t allocations = allocationCount - allocationsBefore;
+			printf("%-22s %-8s %11.2f %11.2f %11.2f %8u %8u %8u %12zu\n", heightMap, sorted ? "Sorted" : "Random", sphereTime, capsuleTime, sweepTime,
+				   sphereHits, capsuleHits, sweepHits, allocations);
+			CHECK(allocations == 0);
+			CHECK(sphereHits > 0 && capsuleHits > 0 && sweepHits > 0);
+		}
+	}
+	return TestResult();
+}
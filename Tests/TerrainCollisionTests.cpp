@@ -0,0 +1,411 @@
+#include "TerrainNode.h"
+#include "TerrainReference.h"
+#include "TestFramework.h"
+#include <cstring>
+#include <random>
+
+// Checks the sphere, capsule and swept sphere queries against distances to every nearby triangle of
+// the terrain, the batched queries against the single ones, and that a camera moved by sliding
+// sweeps never ends up inside the terrain however fast it goes.
+
+struct CollisionTerrain
+{
+	vector<float>				HeightValues;
+	unique_ptr<TerrainNode>		Terrain;
+	ReferenceTerrain			Reference;
+	float						MinimumX;
+	float						MaximumX;
+	float						MinimumZ;
+	float						MaximumZ;
+};
+
+// Rolling hills with steep ripples over them and a few sharp peaks
+static bool CreateTerrain(CollisionTerrain& collisionTerrain)
+{
+	const unsigned int numberOfXPoints = 161;
+	const unsigned int numberOfZPoints = 121;
+	const int worldHeight = 1024;
+	const int spacing = 10;
+	vector<float>& heightValues = collisionTerrain.HeightValues;
+	heightValues.resize((size_t)numberOfXPoints * numberOfZPoints);
+	for (unsigned int z = 0; z < numberOfZPoints; z++)
+	{
+		for (unsigned int x = 0; x < numberOfXPoints; x++)
+		{
+			float peak = (x % 40 == 17 && z % 30 == 11) ? 0.1f : 0.0f;
+			heightValues[(size_t)z * numberOfXPoints + x] = 0.3f + 0.15f * sinf(x * 0.05f) * cosf(z * 0.07f) + 0.03f * sinf(x * 0.6f + z * 0.4f) + peak;
+		}
+	}
+	QuantiseHeights(heightValues);
+	collisionTerrain.Terrain = make_unique<TerrainNode>(L"Terrain", vector<float>(heightValues), numberOfXPoints, numberOfZPoints, worldHeight, spacing, TerrainVertexLayout::SharedGrid);
+	collisionTerrain.Terrain->SetCacheEnabled(false);
+	collisionTerrain.Terrain->SetThreadPool(make_shared<ThreadPool>());
+	if (!collisionTerrain.Terrain->LoadGeometry())
+	{
+		return false;
+	}
+	collisionTerrain.Reference = { &heightValues[0], numberOfXPoints, numberOfZPoints, (float)spacing, (float)worldHeight, collisionTerrain.Terrain->GetGridOrigin() };
+
+	// Keep the shapes two cells inside the edges, so that nothing they touch is off the grid
+	XMFLOAT3 minimum = collisionTerrain.Reference.GetVertex(0, numberOfZPoints - 1);
+	XMFLOAT3 maximum = collisionTerrain.Reference.GetVertex(numberOfXPoints - 1, 0);
+	collisionTerrain.MinimumX = minimum.x + 2.0f * spacing;
+	collisionTerrain.MaximumX = maximum.x - 2.0f * spacing;
+	collisionTerrain.MinimumZ = minimum.z + 2.0f * spacing;
+	collisionTerrain.MaximumZ = maximum.z - 2.0f * spacing;
+	return true;
+}
+
+static XMFLOAT3 Lerp(const XMFLOAT3& start, const XMFLOAT3& end, double t)
+{
+	return Add(start, Scale(Subtract(end, start), (float)t));
+}
+
+static void TestSphereOverlap(CollisionTerrain& collisionTerrain, mt19937& random)
+{
+	uniform_real_distribution<float> positionX(collisionTerrain.MinimumX, collisionTerrain.MaximumX);
+	uniform_real_distribution<float> positionZ(collisionTerrain.MinimumZ, collisionTerrain.MaximumZ);
+	uniform_real_distribution<float> unit(0.0f, 1.0f);
+	int tested = 0;
+	int hits = 0;
+	int mismatches = 0;
+	double largestDifference = 0.0;
+	for (int i = 0; i < 5000; i++)
+	{
+		float x = positionX(random);
+		float z = positionZ(random);
+		float radius = 0.5f + 8.0f * unit(random);
+		XMFLOAT3 centre(x, collisionTerrain.Terrain->GetHeightAtPoint(x, z) + unit(random) * 14.0f - 4.0f, z);
+		double distance = ReferenceSurfaceDistance(collisionTerrain.Reference, centre, radius + 1.0f);
+
+		// Spheres that only just touch the surface can go either way with rounding
+		if (distance >= 0.0 && fabs(distance - radius) < 0.01)
+		{
+			continue;
+		}
+		tested++;
+		bool expected = distance < radius;
+		hits += expected ? 1 : 0;
+		TerrainContact contact;
+		bool hit = collisionTerrain.Terrain->SphereOverlap(centre, radius, contact);
+		if (hit != expected || hit != contact.Hit)
+		{
+			mismatches++;
+			continue;
+		}
+		if (hit)
+		{
+			CHECK(fabs(Length(contact.Normal) - 1.0) < 1e-4);
+			if (distance >= 0.0)
+			{
+				// Above the surface, the sphere has to move out by how far it reaches into it
+				largestDifference = max(largestDifference, fabs(contact.Depth - (radius - distance)));
+				CHECK(fabs(Length(Subtract(contact.Position, centre)) - distance) < 0.01);
+			}
+			else
+			{
+				CHECK(contact.Normal.y > 0.0f && contact.Depth > radius);
+			}
+		}
+	}
+	printf("Sphere overlaps: %d tested, %d hits, largest depth difference %g, %d mismatches\n", tested, hits, largestDifference, mismatches);
+	CHECK(hits > tested / 10 && hits < tested * 9 / 10);
+	CHECK(mismatches == 0);
+	CHECK(largestDifference < 2e-3);
+}
+
+static void TestCapsuleOverlap(CollisionTerrain& collisionTerrain, mt19937& random)
+{
+	uniform_real_distribution<float> positionX(collisionTerrain.MinimumX + 15.0f, collisionTerrain.MaximumX - 15.0f);
+	uniform_real_distribution<float> positionZ(collisionTerrain.MinimumZ + 15.0f, collisionTerrain.MaximumZ - 15.0f);
+	uniform_real_distribution<float> unit(0.0f, 1.0f);
+	const int samples = 200;
+	int tested = 0;
+	int hits = 0;
+	int mismatches = 0;
+	for (int i = 0; i < 1000; i++)
+	{
+		float x = positionX(random);
+		float z = positionZ(random);
+		float radius = 0.5f + 4.0f * unit(random);
+		XMFLOAT3 start(x, collisionTerrain.Terrain->GetHeightAtPoint(x, z) + unit(random) * 12.0f - 3.0f, z);
+		XMFLOAT3 end = Add(start, XMFLOAT3(unit(random) * 30.0f - 15.0f, unit(random) * 10.0f - 5.0f, unit(random) * 30.0f - 15.0f));
+
+		// The capsule's distance from the terrain is the least of the distances of the spheres along it,
+		// to within the gap between the samples
+		double nearest = 1e30;
+		bool below = false;
+		for (int k = 0; k <= samples; k++)
+		{
+			double distance = ReferenceSurfaceDistance(collisionTerrain.Reference, Lerp(start, end, (double)k / samples), radius + 1.0f);
+			below = below || distance < 0.0;
+			nearest = distance >= 0.0 ? min(nearest, distance) : nearest;
+		}
+		double slack = Length(Subtract(end, start)) / samples;
+		if (!below && fabs(nearest - radius) < slack + 0.01)
+		{
+			continue;
+		}
+		tested++;
+		bool expected = below || nearest < radius;
+		hits += expected ? 1 : 0;
+		TerrainContact contact;
+		bool hit = collisionTerrain.Terrain->CapsuleOverlap(start, end, radius, contact);
+		if (hit != expected || (hit && !below && fabs(contact.Depth - (radius - nearest)) > slack + 2e-3))
+		{
+			mismatches++;
+		}
+	}
+	printf("Capsule overlaps: %d tested, %d hits, %d mismatches\n", tested, hits, mismatches);
+	CHECK(hits > tested / 10 && hits < tested * 9 / 10);
+	CHECK(mismatches == 0);
+}
+
+static void TestSweepSphere(CollisionTerrain& collisionTerrain, mt19937& random)
+{
+	uniform_real_distribution<float> positionX(collisionTerrain.MinimumX + 40.0f, collisionTerrain.MaximumX - 40.0f);
+	uniform_real_distribution<float> positionZ(collisionTerrain.MinimumZ + 40.0f, collisionTerrain.MaximumZ - 40.0f);
+	uniform_real_distribution<float> unit(0.0f, 1.0f);
+	const int steps = 400;
+	int tested = 0;
+	int hits = 0;
+	int mismatches = 0;
+	double largestDifference = 0.0;
+	for (int i = 0; i < 400; i++)
+	{
+		float x = positionX(random);
+		float z = positionZ(random);
+		float radius = 0.5f + 4.0f * unit(random);
+		XMFLOAT3 start(x, collisionTerrain.Terrain->GetHeightAtPoint(x, z) + radius + 0.5f + 10.0f * unit(random), z);
+		if (ReferenceSurfaceDistance(collisionTerrain.Reference, start, radius + 1.0f) < radius + 0.05)
+		{
+			continue;
+		}
+		XMFLOAT3 direction(unit(random) * 2.0f - 1.0f, 0.3f - unit(random) * 1.5f, unit(random) * 2.0f - 1.0f);
+		XMStoreFloat3(&direction, XMVector3Normalize(XMLoadFloat3(&direction)));
+		float length = 40.0f * unit(random);
+		XMFLOAT3 end = Add(start, Scale(direction, length));
+
+		// March along the sweep to the first step that touches, then narrow it down by bisection
+		double first = -1.0;
+		double nearest = 1e30;
+		for (int k = 1; k <= steps && first < 0.0; k++)
+		{
+			double distance = ReferenceSurfaceDistance(collisionTerrain.Reference, Lerp(start, end, (double)k / steps), radius + 1.0f);
+			nearest = distance >= 0.0 ? min(nearest, distance) : nearest;
+			if (distance < radius)
+			{
+				double low = (double)(k - 1) / steps;
+				double high = (double)k / steps;
+				for (int b = 0; b < 30; b++)
+				{
+					double middle = (low + high) * 0.5;
+					(ReferenceSurfaceDistance(collisionTerrain.Reference, Lerp(start, end, middle), radius + 1.0f) < radius ? high : low) = middle;
+				}
+				first = high;
+			}
+		}
+		if (first < 0.0 && nearest - radius < 0.01)
+		{
+			continue;
+		}
+		tested++;
+		hits += first >= 0.0 ? 1 : 0;
+		TerrainContact contact;
+		bool hit = collisionTerrain.Terrain->SweepSphere(start, end, radius, contact);
+		if (hit != (first >= 0.0))
+		{
+			mismatches++;
+			continue;
+		}
+		if (hit)
+		{
+			largestDifference = max(largestDifference, fabs(contact.Time - first) * length);
+
+			// The point first touched is on the surface, a radius from the centre at that time
+			XMFLOAT3 centre = Lerp(start, end, contact.Time);
+			CHECK(fabs(Length(Subtract(centre, contact.Position)) - radius) < 0.01);
+			CHECK(fabs(contact.Position.y - ReferenceHeight(collisionTerrain.Reference, contact.Position.x, contact.Position.z)) < 0.01);
+			CHECK(fabs(Length(contact.Normal) - 1.0) < 1e-4 && Dot(contact.Normal, direction) < 0.0);
+		}
+	}
+	printf("Sphere sweeps: %d tested, %d hits, largest distance difference %g, %d mismatches\n", tested, hits, largestDifference, mismatches);
+	CHECK(hits > tested / 10 && hits < tested * 9 / 10);
+	CHECK(mismatches == 0);
+	CHECK(largestDifference < 0.02);
+}
+
+static void TestOffGrid(CollisionTerrain& collisionTerrain)
+{
+	// Nothing collides beyond the edges of the grid, however low the shape is
+	XMFLOAT3 outside(collisionTerrain.MaximumX + 500.0f, -100.0f, collisionTerrain.MaximumZ + 500.0f);
+	TerrainContact contact;
+	CHECK(!collisionTerrain.Terrain->SphereOverlap(outside, 5.0f, contact));
+	CHECK(!collisionTerrain.Terrain->CapsuleOverlap(outside, Add(outside, XMFLOAT3(50.0f, 0.0f, 0.0f)), 5.0f, contact));
+	CHECK(!collisionTerrain.Terrain->SweepSphere(outside, Add(outside, XMFLOAT3(50.0f, -50.0f, 0.0f)), 5.0f, contact));
+
+	// High above, or moving away from the surface, misses too
+	float x = (collisionTerrain.MinimumX + collisionTerrain.MaximumX) * 0.5f;
+	float z = (collisionTerrain.MinimumZ + collisionTerrain.MaximumZ) * 0.5f;
+	XMFLOAT3 above(x, collisionTerrain.Terrain->GetHeightAtPoint(x, z) + 100.0f, z);
+	CHECK(!collisionTerrain.Terrain->SphereOverlap(above, 5.0f, contact));
+	CHECK(!collisionTerrain.Terrain->SweepSphere(above, Add(above, XMFLOAT3(0.0f, 100.0f, 0.0f)), 5.0f, contact));
+
+	// A sphere resting on the surface doesn't hit it when it moves away
+	XMFLOAT3 normal;
+	float height = collisionTerrain.Terrain->GetHeightAndNormalAtPoint(x, z, normal);
+	XMFLOAT3 resting = Add(XMFLOAT3(x, height, z), Scale(normal, 2.0f));
+	CHECK(!collisionTerrain.Terrain->SweepSphere(resting, Add(resting, Scale(normal, 10.0f)), 2.0f, contact));
+}
+
+static void TestBatches(CollisionTerrain& collisionTerrain, mt19937& random)
+{
+	uniform_real_distribution<float> positionX(collisionTerrain.MinimumX + 20.0f, collisionTerrain.MaximumX - 20.0f);
+	uniform_real_distribution<float> positionZ(collisionTerrain.MinimumZ + 20.0f, collisionTerrain.MaximumZ - 20.0f);
+	uniform_real_distribution<float> unit(0.0f, 1.0f);
+	const unsigned int count = 3000;
+	vector<TerrainSphere> spheres(count);
+	vector<TerrainCapsule> capsules(count);
+	vector<TerrainSphereSweep> sweeps(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		float x = positionX(random);
+		float z = positionZ(random);
+		float height = collisionTerrain.Terrain->GetHeightAtPoint(x, z);
+		spheres[i] = { XMFLOAT3(x, height + 2.0f * unit(random), z), 1.0f };
+		capsules[i] = { XMFLOAT3(x, height + 0.2f + unit(random), z), XMFLOAT3(x + 1.0f, height + 2.2f, z), 0.5f };
+		float yaw = XM_2PI * unit(random);
+		sweeps[i] = { XMFLOAT3(x, height + 2.0f, z), XMFLOAT3(x + 20.0f * cosf(yaw), height - 3.0f, z + 20.0f * sinf(yaw)), 1.0f };
+	}
+
+	// Each batch gives the same contacts as asking one shape at a time
+	vector<TerrainContact> contacts(count);
+	auto same = [&](unsigned int i, bool hit, const TerrainContact& contact)
+	{
+		const TerrainContact& batched = contacts[i];
+		return hit == batched.Hit && (!hit || (memcmp(&contact.Position, &batched.Position, sizeof(XMFLOAT3)) == 0 &&
+											   memcmp(&contact.Normal, &batched.Normal, sizeof(XMFLOAT3)) == 0 &&
+											   contact.Depth == batched.Depth && contact.Time == batched.Time));
+	};
+	unsigned int hits = collisionTerrain.Terrain->SphereOverlaps(&spheres[0], count, &contacts[0]);
+	unsigned int expectedHits = 0;
+	bool match = true;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		TerrainContact contact;
+		bool hit = collisionTerrain.Terrain->SphereOverlap(spheres[i].Centre, spheres[i].Radius, contact);
+		expectedHits += hit ? 1 : 0;
+		match = match && same(i, hit, contact);
+	}
+	CHECK(match && hits == expectedHits && hits > 0);
+
+	hits = collisionTerrain.Terrain->CapsuleOverlaps(&capsules[0], count, &contacts[0]);
+	expectedHits = 0;
+	match = true;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		TerrainContact contact;
+		bool hit = collisionTerrain.Terrain->CapsuleOverlap(capsules[i].Start, capsules[i].End, capsules[i].Radius, contact);
+		expectedHits += hit ? 1 : 0;
+		match = match && same(i, hit, contact);
+	}
+	CHECK(match && hits == expectedHits && hits > 0);
+
+	hits = collisionTerrain.Terrain->SweepSpheres(&sweeps[0], count, &contacts[0]);
+	expectedHits = 0;
+	match = true;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		TerrainContact contact;
+		bool hit = collisionTerrain.Terrain->SweepSphere(sweeps[i].Start, sweeps[i].End, sweeps[i].Radius, contact);
+		expectedHits += hit ? 1 : 0;
+		match = match && same(i, hit, contact);
+	}
+	CHECK(match && hits == expectedHits && hits > 0);
+	printf("Batches: %u shapes of each kind match the single queries\n", count);
+}
+
+// Moves a sphere the way a camera would: pushed out if it starts inside, then swept towards where it wants
+// to go, sliding along the surface for what is left of the movement after each contact
+static XMFLOAT3 MoveCamera(TerrainNode& terrain, const XMFLOAT3& from, const XMFLOAT3& to, float radius)
+{
+	const float separation = 0.01f;
+	const int maximumSlides = 3;
+	XMVECTOR position = XMLoadFloat3(&from);
+	TerrainContact contact;
+	if (terrain.SphereOverlap(from, radius, contact))
+	{
+		position = XMVectorAdd(position, XMVectorScale(XMLoadFloat3(&contact.Normal), contact.Depth + separation));
+	}
+	XMVECTOR movement = XMVectorSubtract(XMLoadFloat3(&to), XMLoadFloat3(&from));
+	for (int slide = 0; slide < maximumSlides && XMVectorGetX(XMVector3LengthSq(movement)) > 0.0f; slide++)
+	{
+		XMFLOAT3 start;
+		XMFLOAT3 end;
+		XMStoreFloat3(&start, position);
+		XMStoreFloat3(&end, XMVectorAdd(position, movement));
+		if (!terrain.SweepSphere(start, end, radius, contact))
+		{
+			position = XMVectorAdd(position, movement);
+			break;
+		}
+		XMVECTOR normal = XMLoadFloat3(&contact.Normal);
+		position = XMVectorAdd(XMVectorAdd(position, XMVectorScale(movement, contact.Time)), XMVectorScale(normal, separation));
+		XMVECTOR remaining = XMVectorScale(movement, 1.0f - contact.Time);
+		movement = XMVectorSubtract(remaining, XMVectorScale(normal, XMVectorGetX(XMVector3Dot(remaining, normal))));
+	}
+	XMFLOAT3 result;
+	XMStoreFloat3(&result, position);
+	return result;
+}
+
+static void TestCamera(CollisionTerrain& collisionTerrain, mt19937& random)
+{
+	// Dive at 20 units a frame, the demo's fastest camera speed, and turn every so often
+	uniform_real_distribution<float> angle(0.0f, XM_2PI);
+	uniform_real_distribution<float> unit(0.0f, 1.0f);
+	const float radius = 1.0f;
+	XMFLOAT3 camera((collisionTerrain.MinimumX + collisionTerrain.MaximumX) * 0.5f, 800.0f, (collisionTerrain.MinimumZ + collisionTerrain.MaximumZ) * 0.5f);
+	float yaw = 0.0f;
+	int inside = 0;
+	const int frames = 3000;
+	for (int frame = 0; frame < frames; frame++)
+	{
+		if (frame % 50 == 0)
+		{
+			yaw = angle(random);
+		}
+		XMFLOAT3 to(camera.x + 20.0f * cosf(yaw), camera.y - 20.0f * unit(random), camera.z + 20.0f * sinf(yaw));
+		if (to.x < collisionTerrain.MinimumX || to.x > collisionTerrain.MaximumX || to.z < collisionTerrain.MinimumZ || to.z > collisionTerrain.MaximumZ)
+		{
+			yaw += XM_PI;
+			continue;
+		}
+		camera = MoveCamera(*collisionTerrain.Terrain, camera, to, radius);
+		if (ReferenceSurfaceDistance(collisionTerrain.Reference, camera, radius + 1.0f) < radius - 0.01)
+		{
+			inside++;
+		}
+	}
+	float ground = collisionTerrain.Terrain->GetHeightAtPoint(camera.x, camera.z);
+	printf("Camera: %d of %d frames inside the terrain, ends %.2f above the ground\n", inside, frames, camera.y - ground);
+	CHECK(inside == 0);
+	CHECK(camera.y - ground < 10.0f);
+}
+
+int main()
+{
+	CollisionTerrain collisionTerrain;
+	if (!CHECK(CreateTerrain(collisionTerrain)))
+	{
+		return TestResult();
+	}
+	mt19937 random(19);
+	TestSphereOverlap(collisionTerrain, random);
+	TestCapsuleOverlap(collisionTerrain, random);
+	TestSweepSphere(collisionTerrain, random);
+	TestOffGrid(collisionTerrain);
+	TestBatches(collisionTerrain, random);
+	TestCamera(collisionTerrain, random);
+	return TestResult();
+}
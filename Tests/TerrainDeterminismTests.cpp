@@ -0,0 +1,59 @@
+#include "TerrainNode.h"
+#include "TestFramework.h"
+#include <cstdlib>
+
+// Generates the example terrain on the calling thread and then across pools of 1, 3 and 8 threads, each
+// time with a different rand() seed, and checks that every generation is byte for byte the same as the
+// one on the calling thread.  The cache file holds everything generated (vertices, indices, blend map,
+// height pyramid and chunks), so the cache files are compared.
+
+// numberOfThreads is 0 to generate without a pool
+static vector<char> GenerateCache(const string& scratchFilename, TerrainVertexLayout vertexLayout, TerrainNormalMethod normalMethod,
+								  unsigned int numberOfThreads, unsigned int seed)
+{
+	wstring filename = CopyToScratch("Example_HeightMap.raw", scratchFilename);
+	srand(seed);
+	{
+		TerrainNode terrain(L"Terrain", filename, 0, 0, 1024, 10, vertexLayout);
+		terrain.SetThreadPool(numberOfThreads == 0 ? nullptr : make_shared<ThreadPool>(numberOfThreads));
+		terrain.SetNormalMethod(normalMethod);
+		if (vertexLayout == TerrainVertexLayout::SharedGrid)
+		{
+			terrain.EnableLevelOfDetail(32, 2.0f);
+		}
+		CHECK(terrain.LoadGeometry());
+		CHECK(!terrain.GetStatistics().LoadedFromCache);
+	}
+	// The cache files are large, so don't leave them behind
+	string cacheFilename = GRAPHICS2_SCRATCH_DIRECTORY + scratchFilename + ".cache";
+	vector<char> contents;
+	{
+		ifstream input(cacheFilename, ios::binary);
+		contents.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+	}
+	remove(cacheFilename.c_str());
+	return contents;
+}
+
+int main()
+{
+	const TerrainVertexLayout layouts[] = { TerrainVertexLayout::PerCell, TerrainVertexLayout::SharedGrid };
+	const TerrainNormalMethod normalMethods[] = { TerrainNormalMethod::CellAverage, TerrainNormalMethod::CentralDifference };
+	for (TerrainVertexLayout layout : layouts)
+	{
+		for (TerrainNormalMethod normalMethod : normalMethods)
+		{
+			vector<char> serial = GenerateCache("TerrainDeterminismTests.raw", layout, normalMethod, 0, 7);
+			CHECK(!serial.empty());
+			const unsigned int threadCounts[] = { 1, 3, 8 };
+			for (unsigned int threads : threadCounts)
+			{
+				vector<char> pooled = GenerateCache("TerrainDeterminismTests.raw", layout, normalMethod, threads, 1241 * threads);
+				printf("Layout %d, normals %d, %u threads: %zu bytes, %s\n", (int)layout, (int)normalMethod, threads, pooled.size(),
+					   pooled == serial ? "identical" : "different");
+				CHECK(pooled == serial);
+			}
+		}
+	}
+	return TestResult();
+}
@@ -0,0 +1,49 @@
+#include "TerrainNode.h"
+#include "TestFramework.h"
+#include <random>
+
+// Time per edit for craters of increasing size on the example terrain, against regenerating the whole terrain
+
+int main()
+{
+	shared_ptr<ThreadPool> threadPool = make_shared<ThreadPool>();
+	TerrainNode terrain(L"Terrain", GetDataFilename("Example_HeightMap.raw"), 0, 0, 1024, 10, TerrainVertexLayout::SharedGrid);
+	terrain.SetCacheEnabled(false);
+	terrain.SetThreadPool(threadPool);
+	terrain.SetNormalMethod(TerrainNormalMethod::CentralDifference);
+	terrain.EnableLevelOfDetail(32, 2.0f);
+	terrain.EnableEditing();
+	if (!CHECK(terrain.LoadGeometry()))
+	{
+		return TestResult();
+	}
+	double regenerationTime = terrain.GetStatistics().GenerationTime;
+
+	const float radii[] = { 20.0f, 50.0f, 100.0f, 250.0f, 500.0f, 1000.0f, 2500.0f };
+	const int editCount = 50;
+	mt19937 random(11);
+	uniform_real_distribution<float> position(-3000.0f, 3000.0f);
+	printf("%-8s %10s %10s %10s %12s\n", "Radius", "Samples", "Vertices", "ms/edit", "ns/sample");
+	double largestBrushTime = 0.0;
+	for (float radius : radii)
+	{
+		double totalTime = 0.0;
+		size_t samples = 0;
+		size_t vertices = 0;
+		for (int i = 0; i < editCount; i++)
+		{
+			CHECK(terrain.CreateCrater(position(random), position(random), radius, 5.0f));
+			TerrainStatistics statistics = terrain.GetStatistics();
+			totalTime += statistics.LastEditTime;
+			samples += statistics.LastEditSamples;
+			vertices += statistics.LastEditVertices;
+		}
+		printf("%-8.0f %10zu %10zu %10.3f %12.1f\n", radius, samples / editCount, vertices / editCount, totalTime / editCount, totalTime * 1e6 / samples);
+		largestBrushTime = totalTime / editCount;
+	}
+	printf("Regenerating the whole terrain: %.1f ms\n", regenerationTime);
+
+	// Even the largest brush covers less than the whole terrain, so should cost less than regenerating it
+	CHECK(largestBrushTime < regenerationTime);
+	return TestResult();
+}
@@ -0,0 +1,127 @@
+#include "TerrainNode.h"
+#include "TestFramework.h"
+#include <cstring>
+#include <functional>
+#include <random>
+
+// Edits a terrain and checks that what the edit recalculated matches a terrain built from scratch from
+// the edited heights.
+
+typedef function<float(unsigned int, unsigned int, float)> HeightEdit;
+
+// Applies an edit to a copy of the heights, rounding to 16 bits as the terrain does
+static void ApplyEdit(vector<float>& heightValues, unsigned int numberOfXPoints, float worldHeight, unsigned int firstX, unsigned int firstZ,
+					  unsigned int endX, unsigned int endZ, const HeightEdit& edit)
+{
+	for (unsigned int z = firstZ; z < endZ; z++)
+	{
+		for (unsigned int x = firstX; x < endX; x++)
+		{
+			float& heightValue = heightValues[(size_t)z * numberOfXPoints + x];
+			float value = edit(x, z, heightValue * worldHeight) / worldHeight * 65536.0f + 0.5f;
+			heightValue = (float)(unsigned short)min(max(value, 0.0f), 65535.0f) / 65536.0f;
+		}
+	}
+}
+
+static shared_ptr<TerrainNode> CreateTerrain(vector<float> heightValues, unsigned int numberOfXPoints, unsigned int numberOfZPoints, bool editing,
+											 shared_ptr<ThreadPool> threadPool)
+{
+	shared_ptr<TerrainNode> terrain = make_shared<TerrainNode>(L"Terrain", move(heightValues), numberOfXPoints, numberOfZPoints, 1024, 10, TerrainVertexLayout::SharedGrid);
+	terrain->SetThreadPool(threadPool);
+	terrain->SetNormalMethod(TerrainNormalMethod::CentralDifference);
+	terrain->EnableLevelOfDetail(32, 2.0f);
+	if (editing)
+	{
+		terrain->EnableEditing();
+	}
+	CHECK(terrain->LoadGeometry());
+	return terrain;
+}
+
+int main()
+{
+	vector<float> heightValues;
+	unsigned int numberOfXPoints;
+	unsigned int numberOfZPoints;
+	if (!CHECK(LoadHeightMap("Example_HeightMap.raw", heightValues, numberOfXPoints, numberOfZPoints)))
+	{
+		return TestResult();
+	}
+	for (float& heightValue : heightValues)
+	{
+		heightValue = (float)(unsigned short)min(max(heightValue * 65536.0f + 0.5f, 0.0f), 65535.0f) / 65536.0f;
+	}
+	shared_ptr<ThreadPool> threadPool = make_shared<ThreadPool>();
+	shared_ptr<TerrainNode> edited = CreateTerrain(heightValues, numberOfXPoints, numberOfZPoints, true, threadPool);
+	CHECK(!CreateTerrain(heightValues, numberOfXPoints, numberOfZPoints, false, threadPool)->EditHeights(0, 0, 4, 4, [](unsigned int, unsigned int, float height) { return height; }));
+
+	// Random raises and cuts, and the corners of the grid
+	mt19937 random(11);
+	const float worldHeight = 1024.0f;
+	for (int i = 0; i < 30; i++)
+	{
+		unsigned int firstX = random() % numberOfXPoints;
+		unsigned int firstZ = random() % numberOfZPoints;
+		unsigned int endX = min(firstX + 1 + (unsigned int)(random() % 150), numberOfXPoints);
+		unsigned int endZ = min(firstZ + 1 + (unsigned int)(random() % 150), numberOfZPoints);
+		float change = i % 2 == 0 ? 40.0f : -25.0f;
+		HeightEdit edit = [=](unsigned int x, unsigned int z, float height) { return height + change * (1.0f + 0.01f * ((x + z) % 7)); };
+		CHECK(edited->EditHeights(firstX, firstZ, endX, endZ, edit));
+		CHECK(edited->GetStatistics().LastEditSamples == (endX - firstX) * (endZ - firstZ));
+		ApplyEdit(heightValues, numberOfXPoints, worldHeight, firstX, firstZ, endX, endZ, edit);
+	}
+	HeightEdit raise = [](unsigned int, unsigned int, float height) { return height + 100.0f; };
+	CHECK(edited->EditHeights(0, 0, 5, 5, raise));
+	ApplyEdit(heightValues, numberOfXPoints, worldHeight, 0, 0, 5, 5, raise);
+	CHECK(edited->EditHeights(numberOfXPoints - 5, numberOfZPoints - 5, numberOfXPoints + 10, numberOfZPoints + 10, raise));
+	ApplyEdit(heightValues, numberOfXPoints, worldHeight, numberOfXPoints - 5, numberOfZPoints - 5, numberOfXPoints, numberOfZPoints, raise);
+
+	shared_ptr<TerrainNode> rebuilt = CreateTerrain(heightValues, numberOfXPoints, numberOfZPoints, false, threadPool);
+	vector<unsigned char> editedPyramid;
+	vector<unsigned char> rebuiltPyramid;
+	edited->GetHeightPyramid().Serialise(editedPyramid);
+	rebuilt->GetHeightPyramid().Serialise(rebuiltPyramid);
+	CHECK(editedPyramid == rebuiltPyramid);
+
+	// Chunk bounds are exact, but errors are only allowed to be overestimated
+	TerrainQuadTree& editedTree = edited->GetQuadTree();
+	TerrainQuadTree& rebuiltTree = rebuilt->GetQuadTree();
+	bool boundsMatch = editedTree.GetChunkCount() == rebuiltTree.GetChunkCount();
+	bool errorsCovered = boundsMatch;
+	for (unsigned int i = 0; boundsMatch && i < editedTree.GetChunkCount(); i++)
+	{
+		const TerrainChunk& editedChunk = editedTree.GetChunk(i);
+		const TerrainChunk& rebuiltChunk = rebuiltTree.GetChunk(i);
+		boundsMatch = memcmp(&editedChunk.BoundsMin, &rebuiltChunk.BoundsMin, sizeof(XMFLOAT3)) == 0 && memcmp(&editedChunk.BoundsMax, &rebuiltChunk.BoundsMax, sizeof(XMFLOAT3)) == 0;
+		errorsCovered = errorsCovered && editedChunk.GeometricError >= rebuiltChunk.GeometricError - 1e-3f;
+	}
+	CHECK(boundsMatch);
+	CHECK(errorsCovered);
+
+	// Height and normal queries everywhere, including between samples
+	bool heightsMatch = true;
+	uniform_real_distribution<float> position(-5200.0f, 5200.0f);
+	for (int i = 0; i < 20000; i++)
+	{
+		float x = position(random);
+		float z = position(random);
+		XMFLOAT3 editedNormal;
+		XMFLOAT3 rebuiltNormal;
+		heightsMatch = heightsMatch && edited->GetHeightAndNormalAtPoint(x, z, editedNormal) == rebuilt->GetHeightAndNormalAtPoint(x, z, rebuiltNormal) &&
+					   memcmp(&editedNormal, &rebuiltNormal, sizeof(XMFLOAT3)) == 0;
+	}
+	CHECK(heightsMatch);
+
+	// A crater is depth deep at its centre and leaves everything beyond its radius alone
+	float before = edited->GetHeightAtPoint(1000.0f, 1000.0f);
+	float outside = edited->GetHeightAtPoint(1000.0f, 1300.0f);
+	CHECK(edited->CreateCrater(1000.0f, 1000.0f, 200.0f, 50.0f));
+	CHECK(fabsf(edited->GetHeightAtPoint(1000.0f, 1000.0f) - (before - 50.0f)) < 0.05f);
+	CHECK(edited->GetHeightAtPoint(1000.0f, 1300.0f) == outside);
+	CHECK(edited->FlattenArea(-2000.0f, 500.0f, 300.0f, 321.0f));
+	CHECK(fabsf(edited->GetHeightAtPoint(-2000.0f, 500.0f) - 321.0f) < 0.05f);
+	CHECK(fabsf(edited->GetHeightAtPoint(-1900.0f, 430.0f) - 321.0f) < 0.05f);
+	CHECK(!edited->CreateCrater(-1e6f, -1e6f, 100.0f, 10.0f));
+	return TestResult();
+}
@@ -0,0 +1,156 @@
+#include "TerrainNode.h"
+#include "TerrainReference.h"
+#include "TestFramework.h"
+#include <random>
+
+// Checks that GetHeightsAtPoints (eight points at a time with AVX2) gives exactly the heights of
+// GetHeightAndNormalAtPoint, and the same normals, for random points on and off the terrain, for points
+// on the cells' edges and diagonals, and for counts and starting points that leave some over after the
+// last batch.  Points off the terrain get the height of the nearest point on its edge.
+
+const unsigned int NumberOfXPoints = 201;
+const unsigned int NumberOfZPoints = 161;
+const int WorldHeight = 1024;
+const int Spacing = 10;
+
+// The normals are normalised in a different order, so they can differ in the last bit or two
+const float NormalTolerance = 1e-6f;
+
+static bool SameNormal(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+	return fabsf(a.x - b.x) <= NormalTolerance && fabsf(a.y - b.y) <= NormalTolerance && fabsf(a.z - b.z) <= NormalTolerance;
+}
+
+// Compares the batched queries of points [first, first + count) against the single ones, with and without normals
+static unsigned int CountMismatches(TerrainNode& terrain, const vector<XMFLOAT2>& points, unsigned int first, unsigned int count)
+{
+	vector<float> heights(count);
+	vector<float> heightsOnly(count);
+	vector<XMFLOAT3> normals(count);
+	terrain.GetHeightsAtPoints(&points[first], count, &heights[0], &normals[0]);
+	terrain.GetHeightsAtPoints(&points[first], count, &heightsOnly[0]);
+	unsigned int mismatches = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		XMFLOAT3 expectedNormal;
+		float expected = terrain.GetHeightAndNormalAtPoint(points[first + i].x, points[first + i].y, expectedNormal);
+		bool same = heights[i] == expected && heightsOnly[i] == expected && terrain.GetHeightAtPoint(points[first + i].x, points[first + i].y) == expected &&
+					SameNormal(normals[i], expectedNormal);
+		mismatches += same ? 0 : 1;
+	}
+	return mismatches;
+}
+
+int main()
+{
+	vector<float> heightValues((size_t)NumberOfXPoints * NumberOfZPoints);
+	for (unsigned int z = 0; z < NumberOfZPoints; z++)
+	{
+		for (unsigned int x = 0; x < NumberOfXPoints; x++)
+		{
+			float peak = (x % 40 == 17 && z % 30 == 11) ? 0.4f : 0.0f;
+			heightValues[(size_t)z * NumberOfXPoints + x] = 0.3f + 0.15f * sinf(x * 0.05f) * cosf(z * 0.07f) + peak;
+		}
+	}
+	QuantiseHeights(heightValues);
+	TerrainNode terrain(L"Terrain", vector<float>(heightValues), NumberOfXPoints, NumberOfZPoints, WorldHeight, Spacing, TerrainVertexLayout::SharedGrid);
+	terrain.SetCacheEnabled(false);
+	if (!CHECK(terrain.LoadGeometry()))
+	{
+		return TestResult();
+	}
+	ReferenceTerrain reference = { &heightValues[0], NumberOfXPoints, NumberOfZPoints, (float)Spacing, (float)WorldHeight, terrain.GetGridOrigin() };
+	XMFLOAT3 minimum = reference.GetVertex(0, NumberOfZPoints - 1);
+	XMFLOAT3 maximum = reference.GetVertex(NumberOfXPoints - 1, 0);
+
+	// 100,005 points, about two fifths of them off the terrain.  One in eight is on a cell's edge, corner or
+	// diagonal, where rounding could put it in either triangle.
+	mt19937 random(5);
+	uniform_real_distribution<float> positionX(minimum.x - 300.0f, maximum.x + 300.0f);
+	uniform_real_distribution<float> positionZ(minimum.z - 300.0f, maximum.z + 300.0f);
+	uniform_int_distribution<int> sampleX(-10, NumberOfXPoints + 10);
+	uniform_int_distribution<int> sampleZ(-10, NumberOfZPoints + 10);
+	const unsigned int count = 100005;
+	vector<XMFLOAT2> points(count);
+	unsigned int outside = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (i % 8 == 3)
+		{
+			float x = (float)sampleX(random);
+			float z = (float)sampleZ(random);
+			switch (random() % 4)
+			{
+				case 0:
+					break;
+				case 1:
+					x += 0.5f;
+					break;
+				case 2:
+					z += 0.25f;
+					break;
+				default:
+					x += 0.25f;
+					z += 0.75f;
+					break;
+			}
+			points[i] = XMFLOAT2(minimum.x + x * Spacing, maximum.z - z * Spacing);
+		}
+		else
+		{
+			points[i] = XMFLOAT2(positionX(random), positionZ(random));
+		}
+		bool inside = points[i].x >= minimum.x && points[i].x <= maximum.x && points[i].y >= minimum.z && points[i].y <= maximum.z;
+		outside += inside ? 0 : 1;
+	}
+	CHECK(outside > count / 4 && outside < count / 2);
+
+	CHECK(CountMismatches(terrain, points, 0, count) == 0);
+
+	// Every count up to three batches, starting at every point of a batch
+	unsigned int mismatches = 0;
+	for (unsigned int first = 0; first < 8; first++)
+	{
+		for (unsigned int length = 1; length <= 24; length++)
+		{
+			mismatches += CountMismatches(terrain, points, first, length);
+		}
+	}
+	CHECK(mismatches == 0);
+
+	// Off the terrain, the height is the height at the nearest point on its edge, and beyond a corner it
+	// is the corner's height
+	vector<XMFLOAT2> edgePoints;
+	vector<float> expectedHeights;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		XMFLOAT2 clamped(min(max(points[i].x, minimum.x), maximum.x), min(max(points[i].y, minimum.z), maximum.z));
+		if (clamped.x != points[i].x || clamped.y != points[i].y)
+		{
+			edgePoints.push_back(points[i]);
+			expectedHeights.push_back((float)ReferenceHeight(reference, clamped.x, clamped.y));
+		}
+	}
+	const XMFLOAT2 corners[4] = { XMFLOAT2(minimum.x - 1000.0f, maximum.z + 1000.0f), XMFLOAT2(maximum.x + 1.0f, maximum.z + 1000.0f),
+								  XMFLOAT2(minimum.x - 0.5f, minimum.z - 0.5f), XMFLOAT2(maximum.x + 20.0f, minimum.z - 1e6f) };
+	const float cornerHeights[4] = { heightValues[0], heightValues[NumberOfXPoints - 1], heightValues[(size_t)(NumberOfZPoints - 1) * NumberOfXPoints],
+									 heightValues[(size_t)NumberOfXPoints * NumberOfZPoints - 1] };
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		edgePoints.push_back(corners[i]);
+		expectedHeights.push_back(cornerHeights[i] * WorldHeight);
+	}
+	vector<float> edgeHeights(edgePoints.size());
+	terrain.GetHeightsAtPoints(&edgePoints[0], (unsigned int)edgePoints.size(), &edgeHeights[0]);
+	unsigned int edgeMismatches = 0;
+	for (size_t i = 0; i < edgePoints.size(); i++)
+	{
+		edgeMismatches += fabsf(edgeHeights[i] - expectedHeights[i]) <= 1e-3f ? 0 : 1;
+	}
+	CHECK(edgeMismatches == 0);
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		CHECK(edgeHeights[edgePoints.size() - 4 + i] == expectedHeights[edgePoints.size() - 4 + i]);
+	}
+	return TestResult();
+}
@@ -0,0 +1,65 @@
+#include "TerrainNode.h"
+#include "TestFramework.h"
+
+// ACMR and ATVR of the terrain's index buffer in each order for the height maps that ship with the demo,
+// through FIFO and LRU caches of 16 and 32 entries, along with the level of detail chunks for comparison
+
+int main()
+{
+	const char * heightMaps[] = { "Example_HeightMap.raw", "Test_HeightMap.raw", "Test_HeightMap2.raw", "Test_HeightMap3.raw",
+								  "Test_HeightMap4.raw", "Test_HeightMap5.raw", "Test_HeightMap6.raw", "Test_HeightMap7.raw" };
+	const TerrainIndexOrder orders[] = { TerrainIndexOrder::RowMajor, TerrainIndexOrder::Strips, TerrainIndexOrder::Morton, TerrainIndexOrder::Hilbert };
+	const char * orderNames[] = { "RowMajor", "Strips", "Morton", "Hilbert" };
+	const VertexCachePolicy policies[] = { VertexCachePolicy::Fifo, VertexCachePolicy::Lru };
+	const char * policyNames[] = { "FIFO", "LRU" };
+	const unsigned int cacheSizes[] = { 16, 32 };
+	shared_ptr<ThreadPool> threadPool = make_shared<ThreadPool>();
+
+	printf("%-22s %-10s", "Height map", "Order");
+	for (const char * policyName : policyNames)
+	{
+		for (unsigned int cacheSize : cacheSizes)
+		{
+			printf("  %4s%-2u ACMR  ATVR", policyName, cacheSize);
+		}
+	}
+	printf("\n");
+	auto printStatistics = [&](TerrainNode& terrain, const char * heightMap, const char * orderName)
+	{
+		printf("%-22s %-10s", heightMap, orderName);
+		for (VertexCachePolicy policy : policies)
+		{
+			for (unsigned int cacheSize : cacheSizes)
+			{
+				VertexCacheStatistics statistics = terrain.AnalyseVertexCache(cacheSize, policy);
+				CHECK(statistics.AverageCacheMissRatio >= 0.5f && statistics.AverageTransformToVertexRatio >= 1.0f);
+				printf("  %10.3f %5.3f", statistics.AverageCacheMissRatio, statistics.AverageTransformToVertexRatio);
+			}
+		}
+		printf("\n");
+	};
+	for (const char * heightMap : heightMaps)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			TerrainNode terrain(L"Terrain", GetDataFilename(heightMap), 0, 0, 1024, 10, TerrainVertexLayout::SharedGrid);
+			terrain.SetCacheEnabled(false);
+			terrain.SetThreadPool(threadPool);
+			terrain.SetIndexOrder(orders[i]);
+			if (CHECK(terrain.LoadGeometry()))
+			{
+				printStatistics(terrain, heightMap, orderNames[i]);
+			}
+		}
+	}
+
+	TerrainNode terrain(L"Terrain", GetDataFilename(heightMaps[0]), 0, 0, 1024, 10, TerrainVertexLayout::SharedGrid);
+	terrain.SetCacheEnabled(false);
+	terrain.SetThreadPool(threadPool);
+	terrain.EnableLevelOfDetail(32, 2.0f);
+	if (CHECK(terrain.LoadGeometry()))
+	{
+		printStatistics(terrain, heightMaps[0], "Chunks");
+	}
+	return TestResult();
+}
@@ -0,0 +1,102 @@
+#include "TerrainIndexOrder.h"
+#include "TerrainNode.h"
+#include "VertexCacheSimulator.h"
+#include "TestFramework.h"
+#include <cstdlib>
+
+// Checks that every index order covers each cell exactly once, that the curves step between neighbouring
+// cells, that the vertex cache simulator counts correctly and that the orders beat row major on a terrain.
+
+static void TestCellOrders()
+{
+	const unsigned int sizes[][2] = { { 1, 1 }, { 7, 3 }, { 14, 14 }, { 16, 16 }, { 29, 64 }, { 100, 37 } };
+	const TerrainIndexOrder orders[] = { TerrainIndexOrder::RowMajor, TerrainIndexOrder::Strips, TerrainIndexOrder::Morton, TerrainIndexOrder::Hilbert };
+	for (const auto& size : sizes)
+	{
+		unsigned int numberOfColumns = size[0];
+		unsigned int numberOfRows = size[1];
+		for (TerrainIndexOrder order : orders)
+		{
+			vector<UINT> cells;
+			CalculateCellOrder(order, numberOfColumns, numberOfRows, cells);
+			vector<unsigned int> seen(numberOfColumns * numberOfRows, 0);
+			bool valid = cells.size() == seen.size();
+			for (UINT cell : cells)
+			{
+				valid = valid && cell < seen.size() && seen[cell]++ == 0;
+			}
+			if (!CHECK(valid))
+			{
+				printf("  order %d on %u x %u cells\n", (int)order, numberOfColumns, numberOfRows);
+			}
+		}
+	}
+
+	// On a power of two square the Hilbert curve only ever steps to a neighbouring cell
+	vector<UINT> cells;
+	CalculateCellOrder(TerrainIndexOrder::Hilbert, 64, 64, cells);
+	bool neighbours = true;
+	for (size_t i = 1; i < cells.size(); i++)
+	{
+		int dx = abs((int)(cells[i] % 64) - (int)(cells[i - 1] % 64));
+		int dz = abs((int)(cells[i] / 64) - (int)(cells[i - 1] / 64));
+		neighbours = neighbours && dx + dz == 1;
+	}
+	CHECK(neighbours);
+}
+
+static void TestSimulator()
+{
+	// Two triangles sharing an edge transform four vertices with any cache
+	UINT quad[] = { 0, 1, 2, 2, 1, 3 };
+	VertexCacheStatistics statistics = SimulateVertexCache(quad, 6, 16, VertexCachePolicy::Lru);
+	CHECK(statistics.Transforms == 4 && statistics.UniqueVertices == 4);
+	CHECK(statistics.AverageCacheMissRatio == 2.0f && statistics.AverageTransformToVertexRatio == 1.0f);
+
+	// With a cache of three, FIFO pushes out vertex 0 even though it was just used, LRU keeps it
+	UINT triangles[] = { 0, 1, 2, 0, 3, 4, 0, 1, 2 };
+	VertexCacheStatistics fifo = SimulateVertexCache(triangles, 9, 3, VertexCachePolicy::Fifo);
+	VertexCacheStatistics lru = SimulateVertexCache(triangles, 9, 3, VertexCachePolicy::Lru);
+	CHECK(fifo.UniqueVertices == 5 && lru.UniqueVertices == 5);
+	CHECK(fifo.Transforms == 8);
+	CHECK(lru.Transforms == 7);
+	CHECK(SimulateVertexCache(nullptr, 0, 32, VertexCachePolicy::Fifo).Transforms == 0);
+}
+
+static void TestTerrainOrders()
+{
+	shared_ptr<ThreadPool> threadPool = make_shared<ThreadPool>();
+	const TerrainIndexOrder orders[] = { TerrainIndexOrder::RowMajor, TerrainIndexOrder::Strips, TerrainIndexOrder::Morton, TerrainIndexOrder::Hilbert };
+	float rowMajorRatio = 0.0f;
+	for (TerrainIndexOrder order : orders)
+	{
+		TerrainNode terrain(L"Terrain", GetDataFilename("Test_HeightMap3.raw"), 0, 0, 1024, 10, TerrainVertexLayout::SharedGrid);
+		terrain.SetCacheEnabled(false);
+		terrain.SetThreadPool(threadPool);
+		terrain.SetIndexOrder(order);
+		if (!CHECK(terrain.LoadGeometry()))
+		{
+			continue;
+		}
+		VertexCacheStatistics statistics = terrain.AnalyseVertexCache(32, VertexCachePolicy::Fifo);
+		TerrainStatistics terrainStatistics = terrain.GetStatistics();
+		CHECK(statistics.UniqueVertices == terrainStatistics.VertexCount);
+		CHECK(statistics.Transforms >= statistics.UniqueVertices);
+		if (order == TerrainIndexOrder::RowMajor)
+		{
+			rowMajorRatio = statistics.AverageCacheMissRatio;
+		}
+		else
+		{
+			CHECK(statistics.AverageCacheMissRatio < rowMajorRatio);
+		}
+	}
+}
+
+int main()
+{
+	TestCellOrders();
+	TestSimulator();
+	TestTerrainOrders();
+	return TestResult();
+}
@@ -0,0 +1,47 @@
+#include "TerrainNode.h"
+#include "TestFramework.h"
+#include <random>
+
+// Builds the example terrain with both vertex layouts and compares their size and build time.  Both
+// layouts must describe the same surface.
+
+int main()
+{
+	const int cells = 1023;
+	shared_ptr<ThreadPool> threadPool = make_shared<ThreadPool>();
+	TerrainVertexLayout layouts[] = { TerrainVertexLayout::PerCell, TerrainVertexLayout::SharedGrid };
+	const char * layoutNames[] = { "PerCell", "SharedGrid" };
+	shared_ptr<TerrainNode> terrains[2];
+
+	printf("%-12s %10s %10s %12s %12s %10s\n", "Layout", "Vertices", "Indices", "VertexBytes", "IndexBytes", "Build ms");
+	for (int i = 0; i < 2; i++)
+	{
+		terrains[i] = make_shared<TerrainNode>(L"Terrain", GetDataFilename("Example_HeightMap.raw"), cells, cells, 1024, 10, layouts[i]);
+		terrains[i]->SetCacheEnabled(false);
+		terrains[i]->SetThreadPool(threadPool);
+		if (!CHECK(terrains[i]->LoadGeometry()))
+		{
+			return TestResult();
+		}
+		TerrainStatistics statistics = terrains[i]->GetStatistics();
+		printf("%-12s %10u %10u %12zu %12zu %10.1f\n", layoutNames[i], statistics.VertexCount, statistics.IndexCount,
+			   statistics.VertexBytes, statistics.IndexBytes, statistics.GenerationTime);
+		CHECK(statistics.IndexCount == (unsigned int)(cells * cells * 6));
+	}
+	CHECK(terrains[0]->GetStatistics().VertexCount == (unsigned int)(cells * cells * 4));
+	CHECK(terrains[1]->GetStatistics().VertexCount == (unsigned int)((cells + 1) * (cells + 1)));
+
+	// The heights are answered from the same height values either way, but the grids must line up
+	mt19937 random(1);
+	uniform_real_distribution<float> position(-5200.0f, 5200.0f);
+	float largestDifference = 0.0f;
+	for (int i = 0; i < 10000; i++)
+	{
+		float x = position(random);
+		float z = position(random);
+		largestDifference = max(largestDifference, fabsf(terrains[0]->GetHeightAtPoint(x, z) - terrains[1]->GetHeightAtPoint(x, z)));
+	}
+	printf("Largest height difference between layouts: %g\n", largestDifference);
+	CHECK(largestDifference == 0.0f);
+	return TestResult();
+}
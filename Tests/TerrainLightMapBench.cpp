@@ -0,0 +1,107 @@
+#include "ProceduralHeightMap.h"
+#include "TerrainLightMap.h"
+#include "TestFramework.h"
+
+// Milliseconds to bake the light map of the 1k example terrain and of a 4k procedural one, on the calling
+// thread and across the pool, and then to move the sun a little (no new horizons), across one of the
+// stored directions (one new one) and a long way (two new ones), and to bake again the area round a
+// 16 x 16 edit.  The example terrain is also baked one sample at a time, for comparison.
+
+static void Bench(const char * name, const vector<USHORT>& heights, unsigned int size, ThreadPool& threadPool, unsigned int runs)
+{
+	const XMFLOAT3 sun(1.0f, 0.3f, 0.05f);
+	const XMFLOAT3 risenSun(1.0f, 0.4f, 0.05f);
+	const XMFLOAT3 turnedSun(1.0f, 0.3f, -0.05f);
+	const XMFLOAT3 movedSun(-0.3f, 0.5f, 1.0f);
+	vector<USHORT> serialTexels;
+	double serialBakeTime = 0.0;
+	for (unsigned int threads = 0; threads < 2; threads++)
+	{
+		ThreadPool * pool = threads == 0 ? nullptr : &threadPool;
+		TerrainLightMap lightMap;
+		lightMap.Initialise(&heights[0], size, size, 10.0f, 1024.0f);
+		double bakeTime = TimeMilliseconds([&]() { lightMap.Bake(sun, pool); }, runs);
+		unsigned int firstChangedRow;
+		unsigned int endChangedRow;
+		double sunTimes[3];
+		unsigned int scanned[3];
+		const XMFLOAT3 suns[3] = { risenSun, turnedSun, movedSun };
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			// Each move starts from the sun the light map was baked with, and the time is the light map's own
+			sunTimes[i] = 0.0;
+			for (unsigned int run = 0; run < runs; run++)
+			{
+				lightMap.SetSunDirection(sun, pool, firstChangedRow, endChangedRow);
+				lightMap.SetSunDirection(suns[i], pool, firstChangedRow, endChangedRow);
+				double time = lightMap.GetStatistics().SunUpdateTime;
+				sunTimes[i] = run == 0 || time < sunTimes[i] ? time : sunTimes[i];
+			}
+			scanned[i] = lightMap.GetStatistics().SunDirectionsScanned;
+		}
+		lightMap.SetSunDirection(sun, pool, firstChangedRow, endChangedRow);
+		double areaTime = TimeMilliseconds([&]()
+		{
+			unsigned int firstX = size / 2;
+			unsigned int firstZ = size / 2;
+			unsigned int endX = firstX + 16;
+			unsigned int endZ = firstZ + 16;
+			lightMap.UpdateArea(firstX, firstZ, endX, endZ, pool);
+		}, runs * 4);
+		if (threads == 0)
+		{
+			serialTexels.assign(lightMap.GetTexels(), lightMap.GetTexels() + (size_t)size * size);
+			serialBakeTime = bakeTime;
+		}
+		else
+		{
+			CHECK(memcmp(lightMap.GetTexels(), &serialTexels[0], serialTexels.size() * sizeof(USHORT)) == 0);
+		}
+
+		char threadsName[16];
+		snprintf(threadsName, sizeof(threadsName), threads == 0 ? "Serial" : "%u", threadPool.GetThreadCount());
+		printf("%-24s %8s %10.1f %8.2fx %10.2f %10.2f %10.2f %10.2f\n", name, threadsName, bakeTime, serialBakeTime / bakeTime, sunTimes[0], sunTimes[1], sunTimes[2],
+			   areaTime);
+		CHECK(scanned[0] == 0 && scanned[1] == 1 && scanned[2] == 2);
+	}
+}
+
+static vector<USHORT> ToHeights(const vector<float>& heightValues)
+{
+	vector<USHORT> heights(heightValues.size() + 1, 0);
+	for (size_t i = 0; i < heightValues.size(); i++)
+	{
+		heights[i] = (USHORT)min(max(heightValues[i] * 65536.0f + 0.5f, 0.0f), 65535.0f);
+	}
+	return heights;
+}
+
+int main()
+{
+	ThreadPool threadPool;
+	vector<float> heightValues;
+	unsigned int numberOfXPoints;
+	unsigned int numberOfZPoints;
+	if (!CHECK(LoadHeightMap("Example_HeightMap.raw", heightValues, numberOfXPoints, numberOfZPoints)))
+	{
+		return TestResult();
+	}
+	vector<USHORT> exampleHeights = ToHeights(heightValues);
+
+	printf("%-24s %8s %10s %9s %10s %10s %10s %10s\n", "Terrain", "Threads", "Bake ms", "Speed up", "Rise ms", "Turn ms", "Move ms", "Edit ms");
+	Bench("Example 1024 x 1024", exampleHeights, numberOfXPoints, threadPool, 3);
+
+	const unsigned int proceduralSize = 4096;
+	ProceduralHeightMapSettings settings;
+	ProceduralHeightMap proceduralHeightMap(settings);
+	heightValues.resize((size_t)proceduralSize * proceduralSize);
+	proceduralHeightMap.Generate(&heightValues[0], proceduralSize, proceduralSize, &threadPool);
+	Bench("Procedural 4096 x 4096", ToHeights(heightValues), proceduralSize, threadPool, 1);
+
+	TerrainLightMap lightMap;
+	lightMap.SetScalar(true);
+	lightMap.Initialise(&exampleHeights[0], numberOfXPoints, numberOfZPoints, 10.0f, 1024.0f);
+	double scalarTime = TimeMilliseconds([&]() { lightMap.Bake(XMFLOAT3(1.0f, 0.3f, 0.05f), nullptr); });
+	printf("Example 1024 x 1024 baked one sample at a time: %.1f ms\n", scalarTime);
+	return TestResult();
+}
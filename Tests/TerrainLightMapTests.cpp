@@ -0,0 +1,207 @@
+#include "TerrainLightMap.h"
+#include "TestFramework.h"
+
+// Checks that the light map's scalar path gives exactly the texels of the AVX2 one (for any start column
+// and length of row), and that moving the sun or editing the heights and then updating gives exactly
+// the texels of a light map baked from scratch with the new sun or heights.
+
+const unsigned int MapWidth = 203;
+const unsigned int MapHeight = 187;
+const float Spacing = 10.0f;
+const float WorldHeight = 1024.0f;
+
+// A corner of the example terrain that is neither a whole number of batches wide nor square, as 16-bit
+// heights with the spare one at the end that the light map reads past the last
+static vector<USHORT> GetHeights()
+{
+	vector<float> heightValues;
+	unsigned int numberOfXPoints;
+	unsigned int numberOfZPoints;
+	vector<USHORT> heights((size_t)MapWidth * MapHeight + 1, 0);
+	if (!CHECK(LoadHeightMap("Example_HeightMap.raw", heightValues, numberOfXPoints, numberOfZPoints)))
+	{
+		return heights;
+	}
+	for (unsigned int z = 0; z < MapHeight; z++)
+	{
+		for (unsigned int x = 0; x < MapWidth; x++)
+		{
+			float value = heightValues[(size_t)(z + 300) * numberOfXPoints + x + 400] * 65536.0f + 0.5f;
+			heights[(size_t)z * MapWidth + x] = (USHORT)min(max(value, 0.0f), 65535.0f);
+		}
+	}
+	return heights;
+}
+
+static vector<USHORT> Bake(const vector<USHORT>& heights, const XMFLOAT3& directionToSun, bool scalar, ThreadPool * threadPool)
+{
+	TerrainLightMap lightMap;
+	lightMap.SetScalar(scalar);
+	lightMap.Initialise(&heights[0], MapWidth, MapHeight, Spacing, WorldHeight);
+	lightMap.Bake(directionToSun, threadPool);
+	return vector<USHORT>(lightMap.GetTexels(), lightMap.GetTexels() + (size_t)MapWidth * MapHeight);
+}
+
+static bool SameTexels(TerrainLightMap& lightMap, const vector<USHORT>& expected)
+{
+	return memcmp(lightMap.GetTexels(), &expected[0], expected.size() * sizeof(USHORT)) == 0;
+}
+
+// Both the sun and the ambient light are partly hidden in some places and not others
+static bool Varied(const vector<USHORT>& texels)
+{
+	unsigned int shadowed = 0;
+	unsigned int lit = 0;
+	unsigned int occluded = 0;
+	for (USHORT texel : texels)
+	{
+		shadowed += (texel & 0xFF) < 128 ? 1 : 0;
+		lit += (texel & 0xFF) == 255 ? 1 : 0;
+		occluded += (texel >> 8) < 250 ? 1 : 0;
+	}
+	return shadowed > texels.size() / 50 && lit > texels.size() / 50 && occluded > texels.size() / 50;
+}
+
+static void TestScalarMatchesVector()
+{
+	vector<USHORT> heights = GetHeights();
+	ThreadPool threadPool(3);
+	const XMFLOAT3 suns[] = { XMFLOAT3(1.0f, 0.08f, 0.2f), XMFLOAT3(-0.4f, 0.15f, -1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) };
+	for (const XMFLOAT3& sun : suns)
+	{
+		vector<USHORT> scalar = Bake(heights, sun, true, nullptr);
+		CHECK(Bake(heights, sun, false, nullptr) == scalar);
+		CHECK(Bake(heights, sun, false, &threadPool) == scalar);
+	}
+	CHECK(Varied(Bake(heights, suns[0], false, nullptr)));
+
+	// Updates of areas starting at every column of a batch put every column at every place in a batch,
+	// and in the samples left over at the end of a row
+	TerrainLightMap lightMap;
+	lightMap.Initialise(&heights[0], MapWidth, MapHeight, Spacing, WorldHeight);
+	lightMap.SetScalar(true);
+	lightMap.Bake(suns[0], nullptr);
+	vector<USHORT> expected(lightMap.GetTexels(), lightMap.GetTexels() + (size_t)MapWidth * MapHeight);
+	lightMap.SetScalar(false);
+	for (unsigned int start = 0; start < 8; start++)
+	{
+		unsigned int firstX = 91 + start;
+		unsigned int firstZ = 100;
+		unsigned int endX = MapWidth;
+		unsigned int endZ = 101;
+		lightMap.UpdateArea(firstX, firstZ, endX, endZ, nullptr);
+		CHECK(firstX == start && endX == MapWidth && firstZ == 9 && endZ == MapHeight);
+		CHECK(SameTexels(lightMap, expected));
+	}
+
+	// A sun direction that has to be scanned, scalar and vector
+	const XMFLOAT3 newSun(0.3f, 0.25f, 1.0f);
+	unsigned int firstChangedRow;
+	unsigned int endChangedRow;
+	lightMap.SetSunDirection(newSun, nullptr, firstChangedRow, endChangedRow);
+	CHECK(lightMap.GetStatistics().SunDirectionsScanned == 2);
+	CHECK(SameTexels(lightMap, Bake(heights, newSun, true, nullptr)));
+}
+
+static void TestSunChangesMatchBake()
+{
+	vector<USHORT> heights = GetHeights();
+	ThreadPool threadPool(3);
+	TerrainLightMap lightMap;
+	lightMap.Initialise(&heights[0], MapWidth, MapHeight, Spacing, WorldHeight);
+	const XMFLOAT3 firstSun(1.0f, 0.3f, 0.0f);
+	lightMap.Bake(firstSun, nullptr);
+
+	// Each sun is 64ths of a turn round (at y = 0) and a height, so how many directions have to be scanned
+	// is known: none when the sun only rises or stays between the same two, one when it moves across one
+	// (either way, and across direction 0), and two when it jumps
+	struct SunMove
+	{
+		float			Turn;
+		float			Height;
+		unsigned int	Scanned;
+	};
+	const SunMove moves[] = { { 0.5f, 0.1f, 0 }, { 0.5f, -0.05f, 0 }, { 0.9f, 0.2f, 0 }, { 1.5f, 0.2f, 1 }, { 0.5f, 0.35f, 1 },
+							  { -0.5f, 0.2f, 1 }, { 20.25f, 0.1f, 2 }, { 20.75f, 1.5f, 0 }, { 44.5f, 0.05f, 2 } };
+	vector<USHORT> before((size_t)MapWidth * MapHeight);
+	for (const SunMove& move : moves)
+	{
+		float angle = XM_2PI * move.Turn / 64.0f;
+		XMFLOAT3 sun(cosf(angle), move.Height, -sinf(angle));
+		before.assign(lightMap.GetTexels(), lightMap.GetTexels() + before.size());
+		unsigned int firstChangedRow;
+		unsigned int endChangedRow;
+		bool changed = lightMap.SetSunDirection(sun, move.Turn > 20.0f ? &threadPool : nullptr, firstChangedRow, endChangedRow);
+		vector<USHORT> expected = Bake(heights, sun, false, nullptr);
+		CHECK(lightMap.GetStatistics().SunDirectionsScanned == move.Scanned);
+		CHECK(SameTexels(lightMap, expected));
+
+		// Every row that changed is within the range given
+		CHECK(changed == (expected != before));
+		for (unsigned int z = 0; z < MapHeight; z++)
+		{
+			if (z < firstChangedRow || z >= endChangedRow)
+			{
+				CHECK(memcmp(&expected[(size_t)z * MapWidth], &before[(size_t)z * MapWidth], MapWidth * sizeof(USHORT)) == 0);
+			}
+		}
+	}
+}
+
+static void TestAreaUpdatesMatchBake()
+{
+	vector<USHORT> heights = GetHeights();
+	ThreadPool threadPool(3);
+	TerrainLightMap lightMap;
+	lightMap.Initialise(&heights[0], MapWidth, MapHeight, Spacing, WorldHeight);
+	const XMFLOAT3 sun(0.8f, 0.2f, -0.5f);
+	lightMap.Bake(sun, nullptr);
+
+	// A hill raised in the middle, a pit dug at a corner and a ridge across the whole map, so the area
+	// baked again is clipped at every edge
+	struct Edit
+	{
+		unsigned int	FirstX;
+		unsigned int	FirstZ;
+		unsigned int	EndX;
+		unsigned int	EndZ;
+		int				Change;
+	};
+	const Edit edits[] = { { 95, 90, 110, 101, 9000 }, { 0, 170, 12, MapHeight, -6000 }, { 0, 40, MapWidth, 43, 12000 } };
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		const Edit& edit = edits[i];
+		for (unsigned int z = edit.FirstZ; z < edit.EndZ; z++)
+		{
+			for (unsigned int x = edit.FirstX; x < edit.EndX; x++)
+			{
+				USHORT& height = heights[(size_t)z * MapWidth + x];
+				height = (USHORT)min(max((int)height + edit.Change, 0), 65535);
+			}
+		}
+		unsigned int firstX = edit.FirstX;
+		unsigned int firstZ = edit.FirstZ;
+		unsigned int endX = edit.EndX;
+		unsigned int endZ = edit.EndZ;
+		lightMap.UpdateArea(firstX, firstZ, endX, endZ, i == 1 ? &threadPool : nullptr);
+		CHECK(firstX == (edit.FirstX > 91 ? edit.FirstX - 91 : 0) && firstZ == (edit.FirstZ > 91 ? edit.FirstZ - 91 : 0));
+		CHECK(endX == min(edit.EndX + 91, MapWidth) && endZ == min(edit.EndZ + 91, MapHeight));
+		vector<USHORT> expected = Bake(heights, sun, false, nullptr);
+		CHECK(SameTexels(lightMap, expected));
+	}
+
+	// And the sun can still be moved afterwards
+	unsigned int firstChangedRow;
+	unsigned int endChangedRow;
+	const XMFLOAT3 newSun(-1.0f, 0.4f, 0.1f);
+	lightMap.SetSunDirection(newSun, nullptr, firstChangedRow, endChangedRow);
+	CHECK(SameTexels(lightMap, Bake(heights, newSun, false, nullptr)));
+}
+
+int main()
+{
+	TestScalarMatchesVector();
+	TestSunChangesMatchBake();
+	TestAreaUpdatesMatchBake();
+	return TestResult();
+}
@@ -0,0 +1,111 @@
+#include "TerrainNode.h"
+#include "TestFramework.h"
+#include <random>
+
+// Loads the example terrain with and without compact memory and releases what Initialise would once the
+// buffers had been created.  With compact memory, the vertices, indices and full precision heights must
+// all be freed, and either way the height queries and ray casts must give exactly the same answers.
+
+static void PrintUsage(const char * name, const TerrainMemoryUsage& usage)
+{
+	printf("%-26s %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f %9.2f\n", name, usage.HeightBytes / 1048576.0, usage.CompactHeightBytes / 1048576.0,
+		   usage.HeightPyramidBytes / 1048576.0, usage.VertexBytes / 1048576.0, usage.IndexBytes / 1048576.0, usage.BlendMapBytes / 1048576.0,
+		   usage.ChunkBytes / 1048576.0, usage.Total / 1048576.0);
+}
+
+static void TestLayout(TerrainVertexLayout layout, const char * layoutName)
+{
+	shared_ptr<TerrainNode> terrains[2];
+	for (unsigned int compact = 0; compact < 2; compact++)
+	{
+		terrains[compact] = make_shared<TerrainNode>(L"Terrain", GetDataFilename("Example_HeightMap.raw"), 0, 0, 1024, 10, layout);
+		TerrainNode& terrain = *terrains[compact];
+		terrain.SetCacheEnabled(false);
+		terrain.SetCompactMemoryEnabled(compact == 1);
+		if (layout == TerrainVertexLayout::SharedGrid)
+		{
+			terrain.EnableLevelOfDetail(32, 2.0f);
+		}
+		if (!CHECK(terrain.LoadGeometry()))
+		{
+			return;
+		}
+		TerrainMemoryUsage before = terrain.GetMemoryUsage();
+		terrain.ReleaseUploadedData();
+		TerrainMemoryUsage after = terrain.GetMemoryUsage();
+		TerrainStatistics statistics = terrain.GetStatistics();
+
+		string name = string(layoutName) + (compact == 1 ? " compact" : "");
+		PrintUsage((name + " loaded").c_str(), before);
+		PrintUsage((name + " released").c_str(), after);
+		CHECK(before.VertexBytes > 0 && before.IndexBytes > 0 && before.HeightBytes > 0 && before.BlendMapBytes > 0);
+		CHECK(statistics.ResidentBytesAfterRelease == after.Total && statistics.ResidentBytesAfterUpload == before.Total - before.BlendMapBytes);
+
+		// The blend map is on the GPU either way.  Only compact memory frees the geometry, and nothing
+		// that the queries use is freed.
+		CHECK(after.BlendMapBytes == 0);
+		if (compact == 1)
+		{
+			CHECK(after.VertexBytes == 0 && after.IndexBytes == 0 && after.HeightBytes == 0);
+			CHECK(after.Total < before.Total / 4);
+		}
+		else
+		{
+			CHECK(after.VertexBytes == before.VertexBytes && after.IndexBytes == before.IndexBytes && after.HeightBytes == before.HeightBytes);
+		}
+		CHECK(after.CompactHeightBytes == before.CompactHeightBytes && after.HeightPyramidBytes == before.HeightPyramidBytes &&
+			  after.ChunkBytes == before.ChunkBytes);
+	}
+
+	// Random points, some of them off the terrain, and rays down onto them from random directions
+	mt19937 random(9);
+	uniform_real_distribution<float> position(-5500.0f, 5500.0f);
+	uniform_real_distribution<float> direction(-1.0f, 1.0f);
+	const unsigned int count = 10000;
+	vector<XMFLOAT2> points(count);
+	for (XMFLOAT2& point : points)
+	{
+		point = XMFLOAT2(position(random), position(random));
+	}
+	vector<float> heights[2] = { vector<float>(count), vector<float>(count) };
+	vector<XMFLOAT3> normals[2] = { vector<XMFLOAT3>(count), vector<XMFLOAT3>(count) };
+	for (unsigned int compact = 0; compact < 2; compact++)
+	{
+		terrains[compact]->GetHeightsAtPoints(&points[0], count, &heights[compact][0], &normals[compact][0]);
+	}
+	unsigned int mismatches = 0;
+	unsigned int hits = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		XMFLOAT3 normal[2];
+		float height[2];
+		for (unsigned int compact = 0; compact < 2; compact++)
+		{
+			height[compact] = terrains[compact]->GetHeightAndNormalAtPoint(points[i].x, points[i].y, normal[compact]);
+		}
+		bool same = height[0] == height[1] && heights[0][i] == heights[1][i] && heights[0][i] == height[0] &&
+					memcmp(&normal[0], &normal[1], sizeof(XMFLOAT3)) == 0 && memcmp(&normals[0][i], &normals[1][i], sizeof(XMFLOAT3)) == 0;
+
+		XMFLOAT3 origin(points[i].x, 1500.0f, points[i].y);
+		XMFLOAT3 rayDirection(direction(random), -1.0f, direction(random));
+		TerrainRayHit hit[2];
+		bool found[2];
+		for (unsigned int compact = 0; compact < 2; compact++)
+		{
+			found[compact] = terrains[compact]->RayCast(origin, rayDirection, 5000.0f, hit[compact]);
+		}
+		same = same && found[0] == found[1] && (!found[0] || (hit[0].Distance == hit[1].Distance && memcmp(&hit[0].Normal, &hit[1].Normal, sizeof(XMFLOAT3)) == 0));
+		hits += found[0] ? 1 : 0;
+		mismatches += same ? 0 : 1;
+	}
+	CHECK(hits > count / 4);
+	CHECK(mismatches == 0);
+}
+
+int main()
+{
+	printf("%-26s %8s %8s %8s %8s %8s %8s %8s %9s\n", "MiB", "Heights", "Compact", "Pyramid", "Vertices", "Indices", "Blend", "Chunks", "Total");
+	TestLayout(TerrainVertexLayout::PerCell, "PerCell");
+	TestLayout(TerrainVertexLayout::SharedGrid, "SharedGrid");
+	return TestResult();
+}
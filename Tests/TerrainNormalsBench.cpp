@@ -0,0 +1,51 @@
+#include "TerrainNode.h"
+#include "TerrainNormals.h"
+#include "TestFramework.h"
+#include <cstring>
+
+// Measures how fast normals are calculated from the example height map, scalar against vector, and how
+// long the terrain takes to generate with each normal method.
+
+int main()
+{
+	vector<float> heightValues;
+	unsigned int numberOfXPoints;
+	unsigned int numberOfZPoints;
+	if (!CHECK(LoadHeightMap("Example_HeightMap.raw", heightValues, numberOfXPoints, numberOfZPoints)))
+	{
+		return TestResult();
+	}
+	size_t samples = heightValues.size();
+	vector<XMFLOAT3> scalarNormals(samples);
+	vector<XMFLOAT3> normals(samples);
+	double scalarTime = TimeMilliseconds([&]()
+	{
+		CalculateHeightFieldNormalsScalar(&heightValues[0], numberOfXPoints, numberOfZPoints, 10.0f, 1024.0f, 0, numberOfZPoints, &scalarNormals[0], sizeof(XMFLOAT3));
+	}, 20);
+	double vectorTime = TimeMilliseconds([&]()
+	{
+		CalculateHeightFieldNormals(&heightValues[0], numberOfXPoints, numberOfZPoints, 10.0f, 1024.0f, 0, numberOfZPoints, &normals[0], sizeof(XMFLOAT3));
+	}, 20);
+	CHECK(memcmp(&scalarNormals[0], &normals[0], samples * sizeof(XMFLOAT3)) == 0);
+	printf("%-12s %10s %14s\n", "Version", "ms", "Msamples/s");
+	printf("%-12s %10.2f %14.1f\n", "Scalar", scalarTime, samples / scalarTime / 1000.0);
+	printf("%-12s %10.2f %14.1f\n", "Vector", vectorTime, samples / vectorTime / 1000.0);
+
+	// The whole of the terrain's generation with each method
+	shared_ptr<ThreadPool> threadPool = make_shared<ThreadPool>();
+	TerrainNormalMethod methods[] = { TerrainNormalMethod::CellAverage, TerrainNormalMethod::CentralDifference };
+	const char * methodNames[] = { "CellAverage", "CentralDifference" };
+	printf("\n%-18s %14s\n", "Normal method", "Generation ms");
+	for (int i = 0; i < 2; i++)
+	{
+		TerrainNode terrain(L"Terrain", GetDataFilename("Example_HeightMap.raw"), numberOfXPoints - 1, numberOfZPoints - 1, 1024, 10, TerrainVertexLayout::SharedGrid);
+		terrain.SetCacheEnabled(false);
+		terrain.SetThreadPool(threadPool);
+		terrain.SetNormalMethod(methods[i]);
+		if (CHECK(terrain.LoadGeometry()))
+		{
+			printf("%-18s %14.1f\n", methodNames[i], terrain.GetStatistics().GenerationTime);
+		}
+	}
+	return TestResult();
+}
@@ -0,0 +1,116 @@
+#include "TerrainNormals.h"
+#include "TestFramework.h"
+#include <cmath>
+#include <cstring>
+#include <random>
+
+// Checks CalculateHeightFieldNormals against the scalar version (which it must match bit for bit) on grids
+// whose widths are and aren't a multiple of the vector width, and against the exact normal of a plane.
+
+static bool NormalsMatch(const vector<XMFLOAT3>& first, const vector<XMFLOAT3>& second)
+{
+	return first.size() == second.size() && memcmp(&first[0], &second[0], first.size() * sizeof(XMFLOAT3)) == 0;
+}
+
+static void TestMatchesScalar(unsigned int numberOfXPoints, unsigned int numberOfZPoints)
+{
+	mt19937 random(numberOfXPoints * 1000 + numberOfZPoints);
+	uniform_real_distribution<float> height(0.0f, 1.0f);
+	vector<float> heightValues((size_t)numberOfXPoints * numberOfZPoints);
+	for (float& heightValue : heightValues)
+	{
+		heightValue = height(random);
+	}
+	size_t count = heightValues.size();
+	vector<XMFLOAT3> scalarNormals(count);
+	vector<XMFLOAT3> normals(count);
+	CalculateHeightFieldNormalsScalar(&heightValues[0], numberOfXPoints, numberOfZPoints, 10.0f, 1024.0f, 0, numberOfZPoints, &scalarNormals[0], sizeof(XMFLOAT3));
+	CalculateHeightFieldNormals(&heightValues[0], numberOfXPoints, numberOfZPoints, 10.0f, 1024.0f, 0, numberOfZPoints, &normals[0], sizeof(XMFLOAT3));
+	if (!CHECK(NormalsMatch(scalarNormals, normals)))
+	{
+		printf("  %u x %u grid\n", numberOfXPoints, numberOfZPoints);
+	}
+
+	// A band of rows written into vertices, leaving everything else alone
+	struct Vertex
+	{
+		XMFLOAT3 Position;
+		XMFLOAT3 Normal;
+		XMFLOAT2 TexCoord;
+	};
+	unsigned int firstRow = numberOfZPoints / 3;
+	unsigned int endRow = min(firstRow + 5, numberOfZPoints);
+	vector<Vertex> vertices(count);
+	memset(&vertices[0], 0, count * sizeof(Vertex));
+	CalculateHeightFieldNormals(&heightValues[0], numberOfXPoints, numberOfZPoints, 10.0f, 1024.0f, firstRow, endRow, &vertices[0].Normal, sizeof(Vertex));
+	bool bandMatches = true;
+	for (size_t i = 0; i < count; i++)
+	{
+		bool inBand = i >= (size_t)firstRow * numberOfXPoints && i < (size_t)endRow * numberOfXPoints;
+		XMFLOAT3 expected = inBand ? scalarNormals[i] : XMFLOAT3(0.0f, 0.0f, 0.0f);
+		bandMatches = bandMatches && memcmp(&vertices[i].Normal, &expected, sizeof(XMFLOAT3)) == 0 && vertices[i].Position.x == 0.0f && vertices[i].TexCoord.x == 0.0f;
+	}
+	CHECK(bandMatches);
+
+	// An area in the middle, including the left edge when the grid is narrow
+	unsigned int firstColumn = numberOfXPoints > 20 ? 7 : 0;
+	unsigned int endColumn = min(firstColumn + 13, numberOfXPoints);
+	unsigned int columns = endColumn - firstColumn;
+	vector<XMFLOAT3> areaNormals((size_t)columns * (endRow - firstRow));
+	CalculateHeightFieldNormalsInArea(&heightValues[0], numberOfXPoints, numberOfZPoints, 10.0f, 1024.0f, firstColumn, endColumn, firstRow, endRow,
+									  &areaNormals[0], sizeof(XMFLOAT3), columns * sizeof(XMFLOAT3));
+	bool areaMatches = true;
+	for (unsigned int z = firstRow; z < endRow; z++)
+	{
+		for (unsigned int x = firstColumn; x < endColumn; x++)
+		{
+			areaMatches = areaMatches && memcmp(&areaNormals[(size_t)(z - firstRow) * columns + x - firstColumn], &scalarNormals[(size_t)z * numberOfXPoints + x], sizeof(XMFLOAT3)) == 0;
+		}
+	}
+	CHECK(areaMatches);
+}
+
+// Central and one-sided differences are both exact for a plane, so every normal (edges included) should be the plane's
+static void TestPlane()
+{
+	const unsigned int numberOfXPoints = 37;
+	const unsigned int numberOfZPoints = 29;
+	const float spacing = 10.0f;
+	const float heightScale = 1024.0f;
+	const float xSlope = 0.003f;
+	const float zSlope = -0.002f;
+	vector<float> heightValues((size_t)numberOfXPoints * numberOfZPoints);
+	for (unsigned int z = 0; z < numberOfZPoints; z++)
+	{
+		for (unsigned int x = 0; x < numberOfXPoints; x++)
+		{
+			heightValues[(size_t)z * numberOfXPoints + x] = 0.5f + xSlope * x + zSlope * z;
+		}
+	}
+	vector<XMFLOAT3> normals(heightValues.size());
+	CalculateHeightFieldNormals(&heightValues[0], numberOfXPoints, numberOfZPoints, spacing, heightScale, 0, numberOfZPoints, &normals[0], sizeof(XMFLOAT3));
+
+	// Row z is at -z * spacing, so the height rises along -z by zSlope per row
+	float nx = -xSlope * heightScale / spacing;
+	float nz = zSlope * heightScale / spacing;
+	float length = sqrtf(nx * nx + 1.0f + nz * nz);
+	float largestError = 0.0f;
+	for (const XMFLOAT3& normal : normals)
+	{
+		largestError = max(largestError, fabsf(normal.x - nx / length));
+		largestError = max(largestError, fabsf(normal.y - 1.0f / length));
+		largestError = max(largestError, fabsf(normal.z - nz / length));
+	}
+	CHECK(largestError < 1e-5f);
+}
+
+int main()
+{
+	const unsigned int sizes[][2] = { { 1, 1 }, { 2, 2 }, { 3, 5 }, { 8, 4 }, { 9, 9 }, { 10, 3 }, { 17, 16 }, { 33, 7 }, { 129, 65 }, { 1024, 12 } };
+	for (const auto& size : sizes)
+	{
+		TestMatchesScalar(size[0], size[1]);
+	}
+	TestPlane();
+	return TestResult();
+}
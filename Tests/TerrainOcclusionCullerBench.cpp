@@ -0,0 +1,72 @@
+#include "TerrainOcclusionCuller.h"
+#include "TerrainCameraPaths.h"
+#include "TestFramework.h"
+#include <chrono>
+
+// Share of the selected chunks and triangles the occlusion culler removes, and what it costs per frame, along
+// the camera paths over every height map that ships with the demo
+
+int main()
+{
+	const char * heightMaps[] = { "Example_HeightMap.raw", "Test_HeightMap.raw", "Test_HeightMap2.raw", "Test_HeightMap3.raw",
+								  "Test_HeightMap4.raw", "Test_HeightMap5.raw", "Test_HeightMap6.raw", "Test_HeightMap7.raw" };
+	const unsigned int occluderLevels[] = { 2, 3, 4 };
+	const unsigned int framesPerPath = 200;
+	const float spacing = 10.0f;
+	const float errorScale = 600.0f * 0.5f * 2.4142f;
+	shared_ptr<ThreadPool> threadPool = make_shared<ThreadPool>();
+
+	printf("%-22s %6s %10s %12s %10s\n", "Height map", "Level", "Chunks %", "Triangles %", "ms/frame");
+	for (const char * heightMap : heightMaps)
+	{
+		TerrainNode terrain(L"Terrain", GetDataFilename(heightMap), 0, 0, 1024, (int)spacing, TerrainVertexLayout::SharedGrid);
+		terrain.SetCacheEnabled(false);
+		terrain.SetThreadPool(threadPool);
+		terrain.EnableLevelOfDetail(32, 2.0f);
+		if (!CHECK(terrain.LoadGeometry()))
+		{
+			continue;
+		}
+		TerrainQuadTree& quadTree = terrain.GetQuadTree();
+		const TerrainHeightPyramid& heightPyramid = terrain.GetHeightPyramid();
+		unsigned int numberOfXPoints = heightPyramid.GetLevelWidth(0) + 1;
+		unsigned int numberOfZPoints = heightPyramid.GetLevelHeight(0) + 1;
+		XMFLOAT2 gridOrigin = terrain.GetGridOrigin();
+		for (unsigned int occluderLevel : occluderLevels)
+		{
+			TerrainOcclusionCuller culler;
+			culler.Initialise(&heightPyramid, spacing, 1024.0f, gridOrigin.x, gridOrigin.y, occluderLevel);
+			size_t selectedChunks = 0;
+			size_t culledChunks = 0;
+			size_t selectedTriangles = 0;
+			size_t drawnTriangles = 0;
+			double time = 0.0;
+			vector<TerrainChunkDraw> drawList;
+			for (unsigned int path = 0; path < CameraPathCount; path++)
+			{
+				for (unsigned int frame = 0; frame < framesPerPath; frame++)
+				{
+					XMFLOAT3 camera = GetCameraPathPosition(terrain, numberOfXPoints, numberOfZPoints, spacing, path, (float)frame / framesPerPath);
+					quadTree.SelectChunks(camera, errorScale, 2.0f, drawList);
+					selectedChunks += drawList.size();
+					for (const TerrainChunkDraw& draw : drawList)
+					{
+						selectedTriangles += draw.IndexCount / 3;
+					}
+					auto start = chrono::high_resolution_clock::now();
+					culledChunks += culler.Cull(camera, quadTree.GetChunks(), drawList);
+					time += chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+					for (const TerrainChunkDraw& draw : drawList)
+					{
+						drawnTriangles += draw.IndexCount / 3;
+					}
+				}
+			}
+			unsigned int frames = CameraPathCount * framesPerPath;
+			printf("%-22s %6u %10.1f %12.1f %10.3f\n", heightMap, occluderLevel, 100.0 * culledChunks / selectedChunks,
+				   100.0 * (selectedTriangles - drawnTriangles) / selectedTriangles, time / frames);
+			CHECK(culledChunks <= selectedChunks);
+		}
+	}
+	return TestResult();
+}
@@ -0,0 +1,123 @@
+#include "TerrainOcclusionCuller.h"
+#include "TerrainCameraPaths.h"
+#include "TestFramework.h"
+
+// Flies the camera paths over the two most mountainous height maps and checks that every chunk the occlusion culler
+// removes really is hidden: the line of sight from the camera to each of its vertices must pass below the
+// terrain somewhere.
+
+const float ErrorScale = 600.0f * 0.5f * 2.4142f;
+
+// Marches along the line from the camera to point and returns true if the terrain is above it anywhere
+static bool IsLineBlocked(TerrainNode& terrain, const XMFLOAT3& camera, const XMFLOAT3& point)
+{
+	float dx = point.x - camera.x;
+	float dz = point.z - camera.z;
+	float distance = sqrtf(dx * dx + dz * dz);
+	for (float step = 1.0f; step < distance - 15.0f; step += 2.5f)
+	{
+		float u = step / distance;
+		if (camera.y + (point.y - camera.y) * u < terrain.GetHeightAtPoint(camera.x + dx * u, camera.z + dz * u))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static void TestHeightMap(const char * heightMap)
+{
+	vector<float> heightValues;
+	unsigned int numberOfXPoints;
+	unsigned int numberOfZPoints;
+	if (!CHECK(LoadHeightMap(heightMap, heightValues, numberOfXPoints, numberOfZPoints)))
+	{
+		return;
+	}
+	const float spacing = 10.0f;
+	TerrainNode terrain(L"Terrain", GetDataFilename(heightMap), 0, 0, 1024, (int)spacing, TerrainVertexLayout::SharedGrid);
+	terrain.SetCacheEnabled(false);
+	terrain.SetThreadPool(make_shared<ThreadPool>());
+	terrain.EnableLevelOfDetail(32, 2.0f);
+	if (!CHECK(terrain.LoadGeometry()))
+	{
+		return;
+	}
+	TerrainQuadTree& quadTree = terrain.GetQuadTree();
+	XMFLOAT2 gridOrigin = terrain.GetGridOrigin();
+	TerrainOcclusionCuller culler;
+	culler.Initialise(&terrain.GetHeightPyramid(), spacing, 1024.0f, gridOrigin.x, gridOrigin.y, 3);
+
+	unsigned int selectedChunks = 0;
+	unsigned int culledChunks = 0;
+	unsigned int visibleChunks = 0;
+	bool orderKept = true;
+	for (unsigned int path = 0; path < CameraPathCount; path++)
+	{
+		for (unsigned int frame = 0; frame < 200; frame += 25)
+		{
+			XMFLOAT3 camera = GetCameraPathPosition(terrain, numberOfXPoints, numberOfZPoints, spacing, path, frame / 200.0f);
+			vector<TerrainChunkDraw> selected;
+			quadTree.SelectChunks(camera, ErrorScale, 2.0f, selected);
+			vector<TerrainChunkDraw> drawList = selected;
+			unsigned int removed = culler.Cull(camera, quadTree.GetChunks(), drawList);
+			CHECK(removed + drawList.size() == selected.size());
+			selectedChunks += (unsigned int)selected.size();
+			culledChunks += removed;
+
+			// What is left is in the order it was selected in
+			size_t next = 0;
+			vector<bool> kept(quadTree.GetChunkCount(), false);
+			for (const TerrainChunkDraw& draw : selected)
+			{
+				if (next < drawList.size() && drawList[next].ChunkIndex == draw.ChunkIndex)
+				{
+					kept[draw.ChunkIndex] = true;
+					next++;
+				}
+			}
+			orderKept = orderKept && next == drawList.size();
+
+			// Each culled chunk's corners, the middles of its edges and its centre
+			for (const TerrainChunkDraw& draw : selected)
+			{
+				if (kept[draw.ChunkIndex])
+				{
+					continue;
+				}
+				const TerrainChunk& chunk = quadTree.GetChunk(draw.ChunkIndex);
+				unsigned int stride = max((chunk.EndX - chunk.StartX) / 2, 1u);
+				bool hidden = true;
+				for (unsigned int z = chunk.StartZ; z <= chunk.EndZ && hidden; z += stride)
+				{
+					for (unsigned int x = chunk.StartX; x <= chunk.EndX && hidden; x += stride)
+					{
+						XMFLOAT3 point(gridOrigin.x + x * spacing, heightValues[(size_t)z * numberOfXPoints + x] * 1024.0f, gridOrigin.y - z * spacing);
+						hidden = IsLineBlocked(terrain, camera, point);
+					}
+				}
+				visibleChunks += hidden ? 0 : 1;
+			}
+		}
+	}
+	printf("%-20s %u of %u selected chunks culled, %u of them visible\n", heightMap, culledChunks, selectedChunks, visibleChunks);
+	CHECK(orderKept);
+	CHECK(culledChunks > 0);
+	CHECK(visibleChunks == 0);
+
+	// From high above nothing is hidden
+	XMFLOAT3 camera(gridOrigin.x + numberOfXPoints * spacing * 0.5f, 50000.0f, gridOrigin.y - numberOfZPoints * spacing * 0.5f);
+	vector<TerrainChunkDraw> drawList;
+	quadTree.SelectChunks(camera, ErrorScale, 2.0f, drawList);
+	CHECK(culler.Cull(camera, quadTree.GetChunks(), drawList) == 0);
+}
+
+int main()
+{
+	const char * heightMaps[] = { "Test_HeightMap5.raw", "Test_HeightMap6.raw" };
+	for (const char * heightMap : heightMaps)
+	{
+		TestHeightMap(heightMap);
+	}
+	return TestResult();
+}
@@ -0,0 +1,74 @@
+#include "TerrainQuadTree.h"
+#include "TestFramework.h"
+#include <algorithm>
+
+// Times building the chunk hierarchy, generating its indices and skirts and selecting chunks for the
+// test height maps, and reports how much the selection saves over drawing every cell.
+
+int main()
+{
+	const char * heightMaps[] = { "Test_HeightMap.raw", "Test_HeightMap2.raw", "Test_HeightMap3.raw", "Test_HeightMap4.raw",
+								  "Test_HeightMap5.raw", "Test_HeightMap6.raw", "Test_HeightMap7.raw" };
+	const float spacing = 10.0f;
+	const float worldHeight = 1024.0f;
+	const float errorScale = 600.0f * 0.5f * 2.4142f;
+	const XMFLOAT3 cameras[] = { XMFLOAT3(0.0f, 1100.0f, -1000.0f), XMFLOAT3(-4000.0f, 1500.0f, 4000.0f), XMFLOAT3(0.0f, 20000.0f, 0.0f) };
+
+	printf("%-20s %7s %9s %8s %9s %9s %9s %11s %10s\n", "Height map", "Chunks", "Indices", "Skirts", "Mean skirt", "Build ms", "Index ms", "Select us", "Triangles");
+	for (const char * heightMap : heightMaps)
+	{
+		vector<float> heightValues;
+		unsigned int numberOfXPoints;
+		unsigned int numberOfZPoints;
+		if (!CHECK(LoadHeightMap(heightMap, heightValues, numberOfXPoints, numberOfZPoints)))
+		{
+			continue;
+		}
+		float originX = -0.5f * spacing * (numberOfXPoints - 1);
+		float originZ = 0.5f * spacing * (numberOfZPoints - 1);
+
+		TerrainHeightPyramid heightPyramid;
+		TerrainQuadTree quadTree;
+		double buildTime = TimeMilliseconds([&]()
+		{
+			heightPyramid.Build(&heightValues[0], numberOfXPoints, numberOfZPoints);
+			quadTree.Build(&heightValues[0], &heightPyramid, numberOfXPoints, numberOfZPoints, spacing, worldHeight, originX, originZ, 32);
+		});
+		vector<UINT> indices;
+		vector<TerrainSkirtVertex> skirtVertices;
+		UINT numberOfGridVertices = numberOfXPoints * numberOfZPoints;
+		double indexTime = TimeMilliseconds([&]()
+		{
+			indices.clear();
+			skirtVertices.clear();
+			quadTree.GenerateIndices(indices, skirtVertices, numberOfGridVertices);
+		});
+		UINT numberOfVertices = numberOfGridVertices + (UINT)skirtVertices.size();
+		CHECK(all_of(indices.begin(), indices.end(), [&](UINT index) { return index < numberOfVertices; }));
+		double skirtDepth = 0.0;
+		for (const TerrainSkirtVertex& skirtVertex : skirtVertices)
+		{
+			skirtDepth += skirtVertex.Depth;
+		}
+
+		// Selection from each camera, with the triangle count averaged over the cameras
+		vector<TerrainChunkDraw> drawList;
+		size_t trianglesDrawn = 0;
+		double selectionTime = 0.0;
+		for (const XMFLOAT3& camera : cameras)
+		{
+			selectionTime += TimeMilliseconds([&]() { quadTree.SelectChunks(camera, errorScale, 2.0f, drawList); }, 20);
+			for (const TerrainChunkDraw& draw : drawList)
+			{
+				trianglesDrawn += draw.IndexCount / 3;
+			}
+		}
+		size_t cameraCount = sizeof(cameras) / sizeof(cameras[0]);
+		size_t fullTriangles = (size_t)(numberOfXPoints - 1) * (numberOfZPoints - 1) * 2;
+		CHECK(trianglesDrawn > 0);
+		printf("%-20s %7zu %9zu %8zu %10.1f %9.1f %9.1f %11.2f %9.1f%%\n", heightMap, quadTree.GetChunkCount(), indices.size(), skirtVertices.size(),
+			   skirtDepth / max<size_t>(skirtVertices.size(), 1), buildTime, indexTime, selectionTime * 1000.0 / cameraCount,
+			   100.0 * trianglesDrawn / cameraCount / fullTriangles);
+	}
+	return TestResult();
+}
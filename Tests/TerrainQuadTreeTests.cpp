@@ -0,0 +1,327 @@
+#include "TerrainQuadTree.h"
+#include "TestFramework.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+
+// Checks the chunk errors and bounds against brute force, that selection meets the screen error, and
+// that the index lists and skirts generated for the chunks are complete and close every crack.
+
+const float Spacing = 10.0f;
+const float WorldHeight = 1024.0f;
+const unsigned int ChunkSize = 32;
+
+struct TestTerrain
+{
+	const char *			Name;
+	vector<float>			HeightValues;
+	unsigned int			NumberOfXPoints;
+	unsigned int			NumberOfZPoints;
+	TerrainHeightPyramid	HeightPyramid;
+	TerrainQuadTree			QuadTree;
+	vector<UINT>			Indices;
+	vector<TerrainSkirtVertex> SkirtVertices;
+
+	inline float GetHeight(unsigned int x, unsigned int z) const { return HeightValues[(size_t)z * NumberOfXPoints + x] * WorldHeight; }
+	inline float GetOriginX() const { return -0.5f * Spacing * (NumberOfXPoints - 1); }
+	inline float GetOriginZ() const { return 0.5f * Spacing * (NumberOfZPoints - 1); }
+
+	void Build()
+	{
+		HeightPyramid.Build(&HeightValues[0], NumberOfXPoints, NumberOfZPoints);
+		QuadTree.Build(&HeightValues[0], &HeightPyramid, NumberOfXPoints, NumberOfZPoints, Spacing, WorldHeight, GetOriginX(), GetOriginZ(), ChunkSize);
+		QuadTree.GenerateIndices(Indices, SkirtVertices, NumberOfXPoints * NumberOfZPoints);
+	}
+};
+
+// Samples of a chunk at its level, the last one always being the end of the chunk
+static unsigned int GetStride(const TerrainChunk& chunk)
+{
+	return 1u << chunk.Level;
+}
+
+static unsigned int GetCellCount(unsigned int start, unsigned int end, unsigned int stride)
+{
+	return (end - start + stride - 1) / stride;
+}
+
+// Height of the chunk's coarse surface at a full resolution sample along one of its edges
+static float GetEdgeHeight(const TestTerrain& terrain, const TerrainChunk& chunk, unsigned int x, unsigned int z)
+{
+	unsigned int stride = GetStride(chunk);
+	if (z == chunk.StartZ || z == chunk.EndZ)
+	{
+		unsigned int x0 = chunk.StartX + (x - chunk.StartX) / stride * stride;
+		unsigned int x1 = min(x0 + stride, chunk.EndX);
+		float u = x1 == x0 ? 0.0f : (float)(x - x0) / (x1 - x0);
+		return terrain.GetHeight(x0, z) + u * (terrain.GetHeight(x1, z) - terrain.GetHeight(x0, z));
+	}
+	unsigned int z0 = chunk.StartZ + (z - chunk.StartZ) / stride * stride;
+	unsigned int z1 = min(z0 + stride, chunk.EndZ);
+	float v = z1 == z0 ? 0.0f : (float)(z - z0) / (z1 - z0);
+	return terrain.GetHeight(x, z0) + v * (terrain.GetHeight(x, z1) - terrain.GetHeight(x, z0));
+}
+
+// The largest distance between the chunk's coarse triangles and the full resolution samples under them,
+// worked out independently of TerrainQuadTree::CalculateGeometricError
+static float MeasureChunkError(const TestTerrain& terrain, const TerrainChunk& chunk)
+{
+	unsigned int stride = GetStride(chunk);
+	float error = 0.0f;
+	for (unsigned int z = chunk.StartZ; z <= chunk.EndZ; z++)
+	{
+		unsigned int z0 = chunk.StartZ + min(z - chunk.StartZ, chunk.EndZ - chunk.StartZ - 1) / stride * stride;
+		unsigned int z1 = min(z0 + stride, chunk.EndZ);
+		float v = (float)(z - z0) / (z1 - z0);
+		for (unsigned int x = chunk.StartX; x <= chunk.EndX; x++)
+		{
+			unsigned int x0 = chunk.StartX + min(x - chunk.StartX, chunk.EndX - chunk.StartX - 1) / stride * stride;
+			unsigned int x1 = min(x0 + stride, chunk.EndX);
+			float u = (float)(x - x0) / (x1 - x0);
+			float topLeft = terrain.GetHeight(x0, z0);
+			float topRight = terrain.GetHeight(x1, z0);
+			float bottomLeft = terrain.GetHeight(x0, z1);
+			float bottomRight = terrain.GetHeight(x1, z1);
+			float height = u + v <= 1.0f ? topLeft + u * (topRight - topLeft) + v * (bottomLeft - topLeft)
+										 : bottomRight + (1.0f - u) * (bottomLeft - bottomRight) + (1.0f - v) * (topRight - bottomRight);
+			error = max(error, fabsf(height - terrain.GetHeight(x, z)));
+		}
+	}
+	return error;
+}
+
+static void TestChunkErrors(TestTerrain& terrain)
+{
+	TerrainQuadTree& quadTree = terrain.QuadTree;
+	int wrongErrors = 0;
+	int wrongBounds = 0;
+	int decreasingErrors = 0;
+	for (unsigned int chunkIndex = 0; chunkIndex < quadTree.GetChunkCount(); chunkIndex++)
+	{
+		const TerrainChunk& chunk = quadTree.GetChunk(chunkIndex);
+		float measuredError = MeasureChunkError(terrain, chunk);
+		if (chunk.Level == 0 ? chunk.GeometricError != 0.0f : chunk.GeometricError < measuredError * (1.0f - 1e-5f))
+		{
+			wrongErrors++;
+		}
+		float minimum = FLT_MAX;
+		float maximum = -FLT_MAX;
+		for (unsigned int z = chunk.StartZ; z <= chunk.EndZ; z++)
+		{
+			for (unsigned int x = chunk.StartX; x <= chunk.EndX; x++)
+			{
+				minimum = min(minimum, terrain.GetHeight(x, z));
+				maximum = max(maximum, terrain.GetHeight(x, z));
+			}
+		}
+		if (chunk.BoundsMin.y != minimum || chunk.BoundsMax.y != maximum ||
+			chunk.BoundsMin.x != terrain.GetOriginX() + chunk.StartX * Spacing || chunk.BoundsMax.z != terrain.GetOriginZ() - chunk.StartZ * Spacing)
+		{
+			wrongBounds++;
+		}
+		int parent = quadTree.GetParent(chunkIndex);
+		if (parent != -1 && quadTree.GetChunk(parent).GeometricError < chunk.GeometricError)
+		{
+			decreasingErrors++;
+		}
+	}
+	printf("%s: %zu chunks, %u levels, root error %.1f\n", terrain.Name, quadTree.GetChunkCount(), quadTree.GetLevelCount(), quadTree.GetChunk(0).GeometricError);
+	CHECK(wrongErrors == 0);
+	CHECK(wrongBounds == 0);
+	CHECK(decreasingErrors == 0);
+}
+
+static void TestIndexAndSkirtCounts(TestTerrain& terrain)
+{
+	TerrainQuadTree& quadTree = terrain.QuadTree;
+	size_t expectedIndices = 0;
+	size_t expectedSkirtVertices = 0;
+	int wrongCounts = 0;
+	for (unsigned int chunkIndex = 0; chunkIndex < quadTree.GetChunkCount(); chunkIndex++)
+	{
+		const TerrainChunk& chunk = quadTree.GetChunk(chunkIndex);
+		unsigned int cellsX = GetCellCount(chunk.StartX, chunk.EndX, GetStride(chunk));
+		unsigned int cellsZ = GetCellCount(chunk.StartZ, chunk.EndZ, GetStride(chunk));
+		unsigned int edgeVertices = 2 * (cellsX + cellsZ);
+		if (chunk.StartIndex != expectedIndices || chunk.IndexCount != 6 * (cellsX * cellsZ + edgeVertices))
+		{
+			wrongCounts++;
+		}
+		expectedIndices += 6 * (cellsX * cellsZ + edgeVertices);
+		expectedSkirtVertices += edgeVertices;
+	}
+	CHECK(wrongCounts == 0);
+	CHECK(terrain.Indices.size() == expectedIndices);
+	CHECK(terrain.SkirtVertices.size() == expectedSkirtVertices);
+
+	UINT numberOfVertices = terrain.NumberOfXPoints * terrain.NumberOfZPoints + (UINT)terrain.SkirtVertices.size();
+	CHECK(all_of(terrain.Indices.begin(), terrain.Indices.end(), [&](UINT index) { return index < numberOfVertices; }));
+	int shallowSkirts = 0;
+	for (const TerrainSkirtVertex& skirtVertex : terrain.SkirtVertices)
+	{
+		shallowSkirts += skirtVertex.Depth < Spacing ? 1 : 0;
+	}
+	CHECK(shallowSkirts == 0);
+}
+
+static float GetDistanceToChunk(const TerrainChunk& chunk, const XMFLOAT3& position)
+{
+	float dx = max(max(chunk.BoundsMin.x - position.x, 0.0f), position.x - chunk.BoundsMax.x);
+	float dy = max(max(chunk.BoundsMin.y - position.y, 0.0f), position.y - chunk.BoundsMax.y);
+	float dz = max(max(chunk.BoundsMin.z - position.z, 0.0f), position.z - chunk.BoundsMax.z);
+	return sqrtf(dx * dx + dy * dy + dz * dz);
+}
+
+// Checks that the selected chunks cover every cell once, meet the error and weren't refined needlessly, then
+// walks every edge between selected chunks checking that the skirt of the higher side reaches the lower one
+static void TestSelection(TestTerrain& terrain, const XMFLOAT3& cameraPosition, float errorScale, float maximumScreenError,
+						  unsigned int& largestLevelGap, unsigned int& gapsOnlyNewSkirtsCover)
+{
+	TerrainQuadTree& quadTree = terrain.QuadTree;
+	vector<TerrainChunkDraw> drawList;
+	quadTree.SelectChunks(cameraPosition, errorScale, maximumScreenError, drawList);
+
+	unsigned int cellsX = terrain.NumberOfXPoints - 1;
+	unsigned int cellsZ = terrain.NumberOfZPoints - 1;
+	vector<int> cellOwners((size_t)cellsX * cellsZ, -1);
+	int overlaps = 0;
+	int errorsTooLarge = 0;
+	int needlessRefinements = 0;
+	for (const TerrainChunkDraw& draw : drawList)
+	{
+		const TerrainChunk& chunk = quadTree.GetChunk(draw.ChunkIndex);
+		if (draw.StartIndex != chunk.StartIndex || draw.IndexCount != chunk.IndexCount)
+		{
+			errorsTooLarge++;
+		}
+		if (chunk.Level > 0 && chunk.GeometricError * errorScale > maximumScreenError * GetDistanceToChunk(chunk, cameraPosition))
+		{
+			errorsTooLarge++;
+		}
+		int parent = quadTree.GetParent(draw.ChunkIndex);
+		if (parent != -1 && quadTree.GetChunk(parent).GeometricError * errorScale <= maximumScreenError * GetDistanceToChunk(quadTree.GetChunk(parent), cameraPosition))
+		{
+			needlessRefinements++;
+		}
+		for (unsigned int z = chunk.StartZ; z < chunk.EndZ; z++)
+		{
+			for (unsigned int x = chunk.StartX; x < chunk.EndX; x++)
+			{
+				int& owner = cellOwners[(size_t)z * cellsX + x];
+				overlaps += owner != -1 ? 1 : 0;
+				owner = (int)draw.ChunkIndex;
+			}
+		}
+	}
+	CHECK(overlaps == 0);
+	CHECK(count(cellOwners.begin(), cellOwners.end(), -1) == 0);
+	CHECK(errorsTooLarge == 0);
+	CHECK(needlessRefinements == 0);
+
+	int uncoveredGaps = 0;
+	for (const TerrainChunkDraw& draw : drawList)
+	{
+		const TerrainChunk& chunk = quadTree.GetChunk(draw.ChunkIndex);
+		int parent = quadTree.GetParent(draw.ChunkIndex);
+		float previousSkirtDepth = max(max(parent != -1 ? quadTree.GetChunk(parent).GeometricError : 0.0f, chunk.GeometricError), Spacing);
+
+		// Each edge as the samples along it and the cell across from each sample
+		auto checkSample = [&](unsigned int x, unsigned int z, unsigned int acrossX, unsigned int acrossZ)
+		{
+			const TerrainChunk& neighbour = quadTree.GetChunk(cellOwners[(size_t)acrossZ * cellsX + acrossX]);
+			float gap = GetEdgeHeight(terrain, chunk, x, z) - GetEdgeHeight(terrain, neighbour, x, z);
+			if (gap > chunk.SkirtDepth + 1e-3f)
+			{
+				uncoveredGaps++;
+			}
+			if (gap > previousSkirtDepth + 1e-3f)
+			{
+				gapsOnlyNewSkirtsCover++;
+			}
+			if (neighbour.Level > chunk.Level)
+			{
+				largestLevelGap = max(largestLevelGap, neighbour.Level - chunk.Level);
+			}
+		};
+		for (unsigned int x = chunk.StartX; x <= chunk.EndX; x++)
+		{
+			unsigned int acrossX = min(x, cellsX - 1);
+			if (chunk.StartZ > 0)
+			{
+				checkSample(x, chunk.StartZ, acrossX, chunk.StartZ - 1);
+			}
+			if (chunk.EndZ < cellsZ)
+			{
+				checkSample(x, chunk.EndZ, acrossX, chunk.EndZ);
+			}
+		}
+		for (unsigned int z = chunk.StartZ; z <= chunk.EndZ; z++)
+		{
+			unsigned int acrossZ = min(z, cellsZ - 1);
+			if (chunk.StartX > 0)
+			{
+				checkSample(chunk.StartX, z, chunk.StartX - 1, acrossZ);
+			}
+			if (chunk.EndX < cellsX)
+			{
+				checkSample(chunk.EndX, z, chunk.EndX, acrossZ);
+			}
+		}
+	}
+	CHECK(uncoveredGaps == 0);
+}
+
+static void TestTerrainQuadTree(TestTerrain& terrain)
+{
+	terrain.Build();
+	TestChunkErrors(terrain);
+	TestIndexAndSkirtCounts(terrain);
+
+	// Cameras close to the ground see the widest spread of levels
+	const float errorScale = 600.0f * 0.5f * 2.4142f;
+	mt19937 random(7);
+	uniform_real_distribution<float> positionX(terrain.GetOriginX(), -terrain.GetOriginX());
+	uniform_real_distribution<float> positionZ(-terrain.GetOriginZ(), terrain.GetOriginZ());
+	uniform_real_distribution<float> height(0.0f, 300.0f);
+	unsigned int largestLevelGap = 0;
+	unsigned int gapsOnlyNewSkirtsCover = 0;
+	for (int i = 0; i < 40; i++)
+	{
+		float x = positionX(random);
+		float z = positionZ(random);
+		float maximumScreenError = i % 2 == 0 ? 1.0f : 4.0f;
+		TestSelection(terrain, XMFLOAT3(x, WorldHeight + height(random), z), errorScale, maximumScreenError, largestLevelGap, gapsOnlyNewSkirtsCover);
+	}
+	printf("%s: neighbours up to %u levels apart, %u edge samples that a skirt sized from the parent's error would leave open\n",
+		   terrain.Name, largestLevelGap, gapsOnlyNewSkirtsCover);
+}
+
+int main()
+{
+	TestTerrain example;
+	example.Name = "Example_HeightMap.raw";
+	if (CHECK(LoadHeightMap(example.Name, example.HeightValues, example.NumberOfXPoints, example.NumberOfZPoints)))
+	{
+		TestTerrainQuadTree(example);
+	}
+
+	// Smooth hills with two sharp ridges, so that fine chunks are selected along the ridges right next
+	// to much coarser ones
+	TestTerrain ridges;
+	ridges.Name = "Ridges";
+	ridges.NumberOfXPoints = 513;
+	ridges.NumberOfZPoints = 385;
+	ridges.HeightValues.resize((size_t)ridges.NumberOfXPoints * ridges.NumberOfZPoints);
+	for (unsigned int z = 0; z < ridges.NumberOfZPoints; z++)
+	{
+		for (unsigned int x = 0; x < ridges.NumberOfXPoints; x++)
+		{
+			float hills = 0.25f + 0.1f * sinf(x * 0.013f) * cosf(z * 0.017f);
+			float ridge = (x == 100 && z < 200) || (z == 300 && x > 250) ? 0.3f : 0.0f;
+			ridges.HeightValues[(size_t)z * ridges.NumberOfXPoints + x] = hills + ridge;
+		}
+	}
+	TestTerrainQuadTree(ridges);
+	return TestResult();
+}
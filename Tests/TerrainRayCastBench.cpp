@@ -0,0 +1,88 @@
+#include "TerrainNode.h"
+#include "TerrainReference.h"
+#include "TestFramework.h"
+#include <random>
+
+// Rays per second from TerrainNode::RayCast, which walks the height pyramid, against testing every
+// triangle of the terrain, on the height maps that ship with the demo.
+
+int main()
+{
+	const char * heightMaps[] = { "Example_HeightMap.raw", "Test_HeightMap.raw", "Test_HeightMap3.raw", "Test_HeightMap6.raw" };
+	const int worldHeight = 1024;
+	const int spacing = 10;
+	const float maximumDistance = 20000.0f;
+	const int rayCount = 2000;
+	const int referenceRayCount = 10;
+	shared_ptr<ThreadPool> threadPool = make_shared<ThreadPool>();
+
+	printf("%-22s %8s %14s %16s %9s %8s\n", "Height map", "Hits", "Pyramid rays/s", "Reference rays/s", "Speed up", "Agree");
+	for (const char * heightMap : heightMaps)
+	{
+		vector<float> heightValues;
+		unsigned int numberOfXPoints;
+		unsigned int numberOfZPoints;
+		if (!CHECK(LoadHeightMap(heightMap, heightValues, numberOfXPoints, numberOfZPoints)))
+		{
+			continue;
+		}
+		QuantiseHeights(heightValues);
+		TerrainNode terrain(L"Terrain", GetDataFilename(heightMap), numberOfZPoints - 1, numberOfXPoints - 1, worldHeight, spacing, TerrainVertexLayout::SharedGrid);
+		terrain.SetCacheEnabled(false);
+		terrain.SetThreadPool(threadPool);
+		if (!CHECK(terrain.LoadGeometry()))
+		{
+			continue;
+		}
+		ReferenceTerrain reference = { &heightValues[0], numberOfXPoints, numberOfZPoints, (float)spacing, (float)worldHeight, terrain.GetGridOrigin() };
+		XMFLOAT3 minimum = reference.GetVertex(0, numberOfZPoints - 1);
+		XMFLOAT3 maximum = reference.GetVertex(numberOfXPoints - 1, 0);
+
+		// Rays from above the terrain heading downwards, a quarter of them almost level
+		mt19937 random(6);
+		uniform_real_distribution<float> positionX(minimum.x, maximum.x);
+		uniform_real_distribution<float> positionZ(minimum.z, maximum.z);
+		uniform_real_distribution<float> positionY(600.0f, 2100.0f);
+		uniform_real_distribution<float> direction(-1.0f, 1.0f);
+		vector<XMFLOAT3> origins(rayCount);
+		vector<XMFLOAT3> directions(rayCount);
+		for (int i = 0; i < rayCount; i++)
+		{
+			origins[i] = XMFLOAT3(positionX(random), positionY(random), positionZ(random));
+			directions[i] = XMFLOAT3(direction(random), -fabsf(direction(random)) * (i % 4 == 0 ? 0.05f : 1.0f), direction(random));
+			XMStoreFloat3(&directions[i], XMVector3Normalize(XMLoadFloat3(&directions[i])));
+		}
+
+		vector<TerrainRayHit> hits(rayCount);
+		vector<bool> found(rayCount);
+		double pyramidTime = TimeMilliseconds([&]()
+		{
+			for (int i = 0; i < rayCount; i++)
+			{
+				found[i] = terrain.RayCast(origins[i], directions[i], maximumDistance, hits[i]);
+			}
+		}, 5);
+		int hitCount = 0;
+		for (int i = 0; i < rayCount; i++)
+		{
+			hitCount += found[i] ? 1 : 0;
+		}
+
+		int agree = 0;
+		double referenceTime = TimeMilliseconds([&]()
+		{
+			agree = 0;
+			for (int i = 0; i < referenceRayCount; i++)
+			{
+				double distance = ReferenceRayCast(reference, origins[i], directions[i], maximumDistance);
+				bool same = found[i] ? distance >= 0.0 && fabs(distance - hits[i].Distance) < 0.05 : distance < 0.0;
+				agree += same ? 1 : 0;
+			}
+		});
+		double pyramidRate = rayCount / pyramidTime * 1000.0;
+		double referenceRate = referenceRayCount / referenceTime * 1000.0;
+		printf("%-22s %8d %14.0f %16.1f %8.0fx %5d/%d\n", heightMap, hitCount, pyramidRate, referenceRate, pyramidRate / referenceRate, agree, referenceRayCount);
+		CHECK(agree == referenceRayCount);
+	}
+	return TestResult();
+}
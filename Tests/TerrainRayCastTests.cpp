@@ -0,0 +1,175 @@
+#include "TerrainNode.h"
+#include "TerrainReference.h"
+#include "TestFramework.h"
+#include <random>
+
+// Checks the height pyramid against the heights it was built from, and TerrainNode::RayCast against
+// a ray cast that tests every triangle of the terrain.
+
+static TerrainHeightRange GetReferenceRange(const vector<float>& heightValues, unsigned int numberOfXPoints, unsigned int firstCellX, unsigned int firstCellZ,
+											unsigned int endCellX, unsigned int endCellZ)
+{
+	TerrainHeightRange range = { heightValues[(size_t)firstCellZ * numberOfXPoints + firstCellX], heightValues[(size_t)firstCellZ * numberOfXPoints + firstCellX] };
+	for (unsigned int z = firstCellZ; z <= endCellZ; z++)
+	{
+		for (unsigned int x = firstCellX; x <= endCellX; x++)
+		{
+			range.Minimum = min(range.Minimum, heightValues[(size_t)z * numberOfXPoints + x]);
+			range.Maximum = max(range.Maximum, heightValues[(size_t)z * numberOfXPoints + x]);
+		}
+	}
+	return range;
+}
+
+static bool RangesMatch(const TerrainHeightPyramid& pyramid, const vector<float>& heightValues, unsigned int numberOfXPoints, unsigned int numberOfZPoints, mt19937& random)
+{
+	bool match = true;
+	for (int i = 0; i < 500; i++)
+	{
+		unsigned int firstCellX = random() % (numberOfXPoints - 1);
+		unsigned int firstCellZ = random() % (numberOfZPoints - 1);
+		unsigned int endCellX = firstCellX + 1 + random() % (numberOfXPoints - 1 - firstCellX);
+		unsigned int endCellZ = firstCellZ + 1 + random() % (numberOfZPoints - 1 - firstCellZ);
+		TerrainHeightRange range = pyramid.GetHeightRange(firstCellX, firstCellZ, endCellX, endCellZ);
+		TerrainHeightRange expected = GetReferenceRange(heightValues, numberOfXPoints, firstCellX, firstCellZ, endCellX, endCellZ);
+		match = match && range.Minimum == expected.Minimum && range.Maximum == expected.Maximum;
+	}
+	return match;
+}
+
+static void TestHeightPyramid()
+{
+	// Odd sizes, so that the last row and column of most levels are partly empty
+	const unsigned int numberOfXPoints = 77;
+	const unsigned int numberOfZPoints = 53;
+	mt19937 random(6);
+	uniform_real_distribution<float> height(0.0f, 1.0f);
+	vector<float> heightValues((size_t)numberOfXPoints * numberOfZPoints);
+	for (float& heightValue : heightValues)
+	{
+		heightValue = height(random);
+	}
+	TerrainHeightPyramid pyramid;
+	pyramid.Build(&heightValues[0], numberOfXPoints, numberOfZPoints);
+	CHECK(pyramid.GetLevelCount() == 8);
+	CHECK(pyramid.GetLevelWidth(0) == numberOfXPoints - 1 && pyramid.GetLevelHeight(0) == numberOfZPoints - 1);
+	CHECK(pyramid.GetLevelWidth(pyramid.GetLevelCount() - 1) == 1 && pyramid.GetLevelHeight(pyramid.GetLevelCount() - 1) == 1);
+	TerrainHeightRange whole = GetReferenceRange(heightValues, numberOfXPoints, 0, 0, numberOfXPoints - 1, numberOfZPoints - 1);
+	const TerrainHeightRange& top = pyramid.GetRange(pyramid.GetLevelCount() - 1, 0, 0);
+	CHECK(top.Minimum == whole.Minimum && top.Maximum == whole.Maximum);
+	CHECK(RangesMatch(pyramid, heightValues, numberOfXPoints, numberOfZPoints, random));
+
+	// Raise and lower an area, including the global extremes, and update just the cells that touch it
+	for (unsigned int z = 20; z <= 30; z++)
+	{
+		for (unsigned int x = 60; x <= 76; x++)
+		{
+			heightValues[(size_t)z * numberOfXPoints + x] = z == 25 ? 1.5f : -0.5f + 0.01f * x;
+		}
+	}
+	pyramid.Update(&heightValues[0], numberOfXPoints, 59, 19, 76, 31);
+	CHECK(pyramid.GetRange(pyramid.GetLevelCount() - 1, 0, 0).Maximum == 1.5f);
+	CHECK(RangesMatch(pyramid, heightValues, numberOfXPoints, numberOfZPoints, random));
+
+	vector<unsigned char> data;
+	pyramid.Serialise(data);
+	TerrainHeightPyramid copy;
+	CHECK(copy.Deserialise(&data[0], data.size()));
+	CHECK(RangesMatch(copy, heightValues, numberOfXPoints, numberOfZPoints, random));
+	CHECK(!copy.Deserialise(&data[0], data.size() / 2));
+}
+
+static void TestRayCast()
+{
+	// Rolling hills with a few sharp peaks to be grazed
+	const unsigned int numberOfXPoints = 201;
+	const unsigned int numberOfZPoints = 161;
+	const int worldHeight = 1024;
+	const int spacing = 10;
+	vector<float> heightValues((size_t)numberOfXPoints * numberOfZPoints);
+	for (unsigned int z = 0; z < numberOfZPoints; z++)
+	{
+		for (unsigned int x = 0; x < numberOfXPoints; x++)
+		{
+			float peak = (x % 40 == 17 && z % 30 == 11) ? 0.4f : 0.0f;
+			heightValues[(size_t)z * numberOfXPoints + x] = 0.3f + 0.15f * sinf(x * 0.05f) * cosf(z * 0.07f) + peak;
+		}
+	}
+	QuantiseHeights(heightValues);
+	TerrainNode terrain(L"Terrain", vector<float>(heightValues), numberOfXPoints, numberOfZPoints, worldHeight, spacing, TerrainVertexLayout::SharedGrid);
+	terrain.SetCacheEnabled(false);
+	terrain.SetThreadPool(make_shared<ThreadPool>());
+	if (!CHECK(terrain.LoadGeometry()))
+	{
+		return;
+	}
+	ReferenceTerrain reference = { &heightValues[0], numberOfXPoints, numberOfZPoints, (float)spacing, (float)worldHeight, terrain.GetGridOrigin() };
+	XMFLOAT3 minimum = reference.GetVertex(0, numberOfZPoints - 1);
+	XMFLOAT3 maximum = reference.GetVertex(numberOfXPoints - 1, 0);
+
+	mt19937 random(7);
+	uniform_real_distribution<float> positionX(minimum.x - 200.0f, maximum.x + 200.0f);
+	uniform_real_distribution<float> positionZ(minimum.z - 200.0f, maximum.z + 200.0f);
+	uniform_real_distribution<float> positionY(0.0f, 1200.0f);
+	uniform_real_distribution<float> direction(-1.0f, 1.0f);
+	const float maximumDistance = 5000.0f;
+	int hits = 0;
+	int mismatches = 0;
+	double largestDifference = 0.0;
+	for (int i = 0; i < 300; i++)
+	{
+		// A quarter of the rays are almost level, so they skim the hills and peaks
+		XMFLOAT3 origin(positionX(random), positionY(random), positionZ(random));
+		XMFLOAT3 rayDirection(direction(random), direction(random) * (i % 4 == 0 ? 0.05f : 1.0f), direction(random));
+		XMStoreFloat3(&rayDirection, XMVector3Normalize(XMLoadFloat3(&rayDirection)));
+		TerrainRayHit hit;
+		bool found = terrain.RayCast(origin, rayDirection, maximumDistance, hit);
+		double expected = ReferenceRayCast(reference, origin, rayDirection, maximumDistance);
+
+		// Rays that only just touch or miss the surface can go either way with rounding
+		if (found != (expected >= 0.0))
+		{
+			double distance = found ? hit.Distance : expected;
+			XMFLOAT3 point(origin.x + rayDirection.x * (float)distance, origin.y + rayDirection.y * (float)distance, origin.z + rayDirection.z * (float)distance);
+			bool onSurface = fabsf(point.y - terrain.GetHeightAtPoint(point.x, point.z)) < 0.05f;
+			bool atLimit = fabs(distance - maximumDistance) < 0.05;
+			if (!onSurface && !atLimit)
+			{
+				mismatches++;
+			}
+			continue;
+		}
+		if (found)
+		{
+			hits++;
+			largestDifference = max(largestDifference, fabs(hit.Distance - expected));
+			CHECK(fabsf(hit.Position.y - terrain.GetHeightAtPoint(hit.Position.x, hit.Position.z)) < 0.05f);
+			CHECK(fabsf(sqrtf((float)Dot(hit.Normal, hit.Normal)) - 1.0f) < 1e-4f && hit.Normal.y > 0.0f);
+		}
+	}
+	printf("Ray casts: %d hits, largest distance difference %g, %d mismatches\n", hits, largestDifference, mismatches);
+	CHECK(hits > 50);
+	CHECK(mismatches == 0);
+	CHECK(largestDifference < 0.05);
+
+	// Straight down, the hit is the height at the point and the normal matches the height query's
+	TerrainRayHit hit;
+	if (CHECK(terrain.RayCast(XMFLOAT3(123.0f, 5000.0f, 45.0f), XMFLOAT3(0.0f, -1.0f, 0.0f), 10000.0f, hit)))
+	{
+		XMFLOAT3 normal;
+		float height = terrain.GetHeightAndNormalAtPoint(123.0f, 45.0f, normal);
+		CHECK(fabsf(hit.Position.y - height) < 0.01f);
+		CHECK(Dot(hit.Normal, normal) > 0.9999);
+	}
+
+	// Pointing away from the terrain, or stopping short of it
+	CHECK(!terrain.RayCast(XMFLOAT3(0.0f, 2000.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), 10000.0f, hit));
+	CHECK(!terrain.RayCast(XMFLOAT3(0.0f, 2000.0f, 0.0f), XMFLOAT3(0.0f, -1.0f, 0.0f), 100.0f, hit));
+}
+
+int main()
+{
+	TestHeightPyramid();
+	TestRayCast();
+	return TestResult();
+}
@@ -0,0 +1,208 @@
+#pragma once
+#include "DirectXCore.h"
+#include <cmath>
+#include <vector>
+
+using namespace std;
+
+// Straightforward versions of the terrain's queries for the tests and benchmarks to check the real
+// ones against.  Heights are normalised, column x, row z of the grid is at
+// (originX + x * spacing, height * worldHeight, originZ - z * spacing) and each cell is split into
+// the same two triangles as the index buffer.
+
+struct ReferenceTerrain
+{
+	const float *	HeightValues;
+	unsigned int	NumberOfXPoints;
+	unsigned int	NumberOfZPoints;
+	float			Spacing;
+	float			WorldHeight;
+	XMFLOAT2		GridOrigin;
+
+	inline XMFLOAT3 GetVertex(unsigned int x, unsigned int z) const
+	{
+		return XMFLOAT3(GridOrigin.x + x * Spacing, HeightValues[(size_t)z * NumberOfXPoints + x] * WorldHeight, GridOrigin.y - z * Spacing);
+	}
+};
+
+// Rounds heights to the 16-bit precision the terrain keeps them at
+inline void QuantiseHeights(vector<float>& heightValues)
+{
+	for (float& heightValue : heightValues)
+	{
+		float value = min(max(heightValue * 65536.0f + 0.5f, 0.0f), 65535.0f);
+		heightValue = (float)(unsigned short)value / 65536.0f;
+	}
+}
+
+inline XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b) { return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b) { return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+inline double Dot(const XMFLOAT3& a, const XMFLOAT3& b) { return (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z; }
+
+// Distance along a ray with a normalised direction to a triangle, or -1 if it misses
+inline double ReferenceRayTriangle(const XMFLOAT3& origin, const XMFLOAT3& direction, const XMFLOAT3& v0, const XMFLOAT3& v1, const XMFLOAT3& v2)
+{
+	XMFLOAT3 edge1 = Subtract(v1, v0);
+	XMFLOAT3 edge2 = Subtract(v2, v0);
+	XMFLOAT3 p = Cross(direction, edge2);
+	double determinant = Dot(edge1, p);
+	if (fabs(determinant) < 1e-12)
+	{
+		return -1.0;
+	}
+	XMFLOAT3 t = Subtract(origin, v0);
+	double u = Dot(t, p) / determinant;
+	XMFLOAT3 q = Cross(t, edge1);
+	double v = Dot(direction, q) / determinant;
+	if (u < 0.0 || v < 0.0 || u + v > 1.0)
+	{
+		return -1.0;
+	}
+	double distance = Dot(edge2, q) / determinant;
+	return distance >= 0.0 ? distance : -1.0;
+}
+
+// Tests the ray against every triangle of the terrain and returns the distance to the nearest hit
+// within maximumDistance, or -1 if there isn't one
+inline double ReferenceRayCast(const ReferenceTerrain& terrain, const XMFLOAT3& origin, const XMFLOAT3& direction, float maximumDistance)
+{
+	double nearest = -1.0;
+	for (unsigned int z = 0; z + 1 < terrain.NumberOfZPoints; z++)
+	{
+		for (unsigned int x = 0; x + 1 < terrain.NumberOfXPoints; x++)
+		{
+			XMFLOAT3 topLeft = terrain.GetVertex(x, z);
+			XMFLOAT3 topRight = terrain.GetVertex(x + 1, z);
+			XMFLOAT3 bottomLeft = terrain.GetVertex(x, z + 1);
+			XMFLOAT3 bottomRight = terrain.GetVertex(x + 1, z + 1);
+			double distances[2] = { ReferenceRayTriangle(origin, direction, topLeft, topRight, bottomLeft),
+									ReferenceRayTriangle(origin, direction, bottomLeft, topRight, bottomRight) };
+			for (double distance : distances)
+			{
+				if (distance >= 0.0 && distance <= maximumDistance && (nearest < 0.0 || distance < nearest))
+				{
+					nearest = distance;
+				}
+			}
+		}
+	}
+	return nearest;
+}
+
+inline XMFLOAT3 Add(const XMFLOAT3& a, const XMFLOAT3& b) { return XMFLOAT3(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline XMFLOAT3 Scale(const XMFLOAT3& a, float scale) { return XMFLOAT3(a.x * scale, a.y * scale, a.z * scale); }
+inline double Length(const XMFLOAT3& a) { return sqrt(Dot(a, a)); }
+
+// Distance from a point to the nearest point on the line from a to b
+inline double ReferenceSegmentDistance(const XMFLOAT3& point, const XMFLOAT3& a, const XMFLOAT3& b)
+{
+	XMFLOAT3 ab = Subtract(b, a);
+	double t = min(max(Dot(Subtract(point, a), ab) / Dot(ab, ab), 0.0), 1.0);
+	XMFLOAT3 closest = Add(a, Scale(ab, (float)t));
+	return Length(Subtract(point, closest));
+}
+
+// Distance from a point to the nearest point on a triangle
+inline double ReferenceTriangleDistance(const XMFLOAT3& point, const XMFLOAT3& v0, const XMFLOAT3& v1, const XMFLOAT3& v2)
+{
+	XMFLOAT3 normal = Cross(Subtract(v1, v0), Subtract(v2, v0));
+	double length = Length(normal);
+	double distance = Dot(Subtract(point, v0), normal) / length;
+	XMFLOAT3 projected = Subtract(point, Scale(normal, (float)(distance / length)));
+	if (Dot(Cross(Subtract(v1, v0), Subtract(projected, v0)), normal) >= 0.0 &&
+		Dot(Cross(Subtract(v2, v1), Subtract(projected, v1)), normal) >= 0.0 &&
+		Dot(Cross(Subtract(v0, v2), Subtract(projected, v2)), normal) >= 0.0)
+	{
+		return fabs(distance);
+	}
+	return min(ReferenceSegmentDistance(point, v0, v1), min(ReferenceSegmentDistance(point, v1, v2), ReferenceSegmentDistance(point, v2, v0)));
+}
+
+// Height of the triangles at (x, z), which must be over the grid
+inline double ReferenceHeight(const ReferenceTerrain& terrain, float x, float z)
+{
+	double gridX = (x - terrain.GridOrigin.x) / terrain.Spacing;
+	double gridZ = (terrain.GridOrigin.y - z) / terrain.Spacing;
+	unsigned int cellX = min((unsigned int)gridX, terrain.NumberOfXPoints - 2);
+	unsigned int cellZ = min((unsigned int)gridZ, terrain.NumberOfZPoints - 2);
+	double u = gridX - cellX;
+	double v = gridZ - cellZ;
+	double topLeft = terrain.GetVertex(cellX, cellZ).y;
+	double topRight = terrain.GetVertex(cellX + 1, cellZ).y;
+	double bottomLeft = terrain.GetVertex(cellX, cellZ + 1).y;
+	double bottomRight = terrain.GetVertex(cellX + 1, cellZ + 1).y;
+	if (u + v <= 1.0)
+	{
+		return topLeft + u * (topRight - topLeft) + v * (bottomLeft - topLeft);
+	}
+	return bottomRight + (1.0 - u) * (bottomLeft - bottomRight) + (1.0 - v) * (topRight - bottomRight);
+}
+
+// Distance from a point over the grid to the nearest triangle within window of it, or -1 if the point is
+// below the surface
+inline double ReferenceSurfaceDistance(const ReferenceTerrain& terrain, const XMFLOAT3& point, float window)
+{
+	if (point.y < ReferenceHeight(terrain, point.x, point.z))
+	{
+		return -1.0;
+	}
+	double gridX = (point.x - terrain.GridOrigin.x) / terrain.Spacing;
+	double gridZ = (terrain.GridOrigin.y - point.z) / terrain.Spacing;
+	int cells = (int)ceil(window / terrain.Spacing) + 1;
+	int firstX = max((int)gridX - cells, 0);
+	int firstZ = max((int)gridZ - cells, 0);
+	int lastX = min((int)gridX + cells, (int)terrain.NumberOfXPoints - 2);
+	int lastZ = min((int)gridZ + cells, (int)terrain.NumberOfZPoints - 2);
+	double nearest = 1e30;
+	for (int z = firstZ; z <= lastZ; z++)
+	{
+		for (int x = firstX; x <= lastX; x++)
+		{
+			XMFLOAT3 topLeft = terrain.GetVertex(x, z);
+			XMFLOAT3 topRight = terrain.GetVertex(x + 1, z);
+			XMFLOAT3 bottomLeft = terrain.GetVertex(x, z + 1);
+			XMFLOAT3 bottomRight = terrain.GetVertex(x + 1, z + 1);
+			nearest = min(nearest, min(ReferenceTriangleDistance(point, topLeft, topRight, bottomLeft), ReferenceTriangleDistance(point, bottomLeft, topRight, bottomRight)));
+		}
+	}
+	return nearest;
+}
+
+// Largest vertical distance between a triangle list indexing the grid (vertex z * numberOfXPoints + x) and
+// any height sample that one of its triangles covers (including their edges), in normalised heights
+inline double ReferenceMeshError(const float * heightValues, unsigned int numberOfXPoints, const vector<UINT>& indices)
+{
+	double maximumError = 0.0;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		int ax = (int)(indices[i] % numberOfXPoints);
+		int az = (int)(indices[i] / numberOfXPoints);
+		int bx = (int)(indices[i + 1] % numberOfXPoints);
+		int bz = (int)(indices[i + 1] / numberOfXPoints);
+		int cx = (int)(indices[i + 2] % numberOfXPoints);
+		int cz = (int)(indices[i + 2] / numberOfXPoints);
+		int area = (bx - ax) * (cz - az) - (bz - az) * (cx - ax);
+		if (area == 0)
+		{
+			continue;
+		}
+		for (int z = min(min(az, bz), cz); z <= max(max(az, bz), cz); z++)
+		{
+			for (int x = min(min(ax, bx), cx); x <= max(max(ax, bx), cx); x++)
+			{
+				// Edge functions, all with the sign of area inside the triangle
+				int weightA = (bx - x) * (cz - z) - (bz - z) * (cx - x);
+				int weightB = (cx - x) * (az - z) - (cz - z) * (ax - x);
+				int weightC = area - weightA - weightB;
+				if (area > 0 ? (weightA < 0 || weightB < 0 || weightC < 0) : (weightA > 0 || weightB > 0 || weightC > 0))
+				{
+					continue;
+				}
+				double height = ((double)weightA * heightValues[indices[i]] + (double)weightB * heightValues[indices[i + 1]] +
+								 (double)weightC * heightValues[indices[i + 2]]) / area;
+				maximumError = max(maximumError, fabs(height - heightValues[(size_t)z * numberOfXPoints + x]));
+			}
+		}
+	}
+	return maximumError;
+}
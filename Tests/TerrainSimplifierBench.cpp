@@ -0,0 +1,52 @@
+#include "TerrainSimplifier.h"
+#include "TerrainReference.h"
+#include "TestFramework.h"
+#include <algorithm>
+#include <filesystem>
+
+// Triangles left after simplifying each height map that ships with the demo, at tolerances of 0.5, 2 and
+// 8 world units (with the demo's world height of 1024), against the full grid, with the time to build the
+// errors and to generate the triangles and the largest error actually left.
+
+int main()
+{
+	const float worldHeight = 1024.0f;
+	const float tolerances[] = { 0.5f, 2.0f, 8.0f };
+	vector<string> filenames;
+	for (const filesystem::directory_entry& entry : filesystem::directory_iterator(GRAPHICS2_DATA_DIRECTORY))
+	{
+		if (entry.path().extension() == ".raw")
+		{
+			filenames.push_back(entry.path().filename().string());
+		}
+	}
+	sort(filenames.begin(), filenames.end());
+	CHECK(filenames.size() > 0);
+
+	printf("%-22s %11s %9s %10s %11s %8s %11s %9s\n", "Height map", "Full", "Build ms", "Tolerance", "Triangles", "Share", "Generate ms", "Error");
+	for (const string& filename : filenames)
+	{
+		vector<float> heightValues;
+		unsigned int numberOfXPoints;
+		unsigned int numberOfZPoints;
+		if (!CHECK(LoadHeightMap(filename, heightValues, numberOfXPoints, numberOfZPoints)))
+		{
+			continue;
+		}
+		size_t fullTriangles = (size_t)(numberOfXPoints - 1) * (numberOfZPoints - 1) * 2;
+		TerrainSimplifier simplifier;
+		double buildTime = TimeMilliseconds([&]() { simplifier.Build(&heightValues[0], numberOfXPoints, numberOfZPoints); });
+		vector<UINT> indices;
+		for (float tolerance : tolerances)
+		{
+			double generateTime = TimeMilliseconds([&]() { simplifier.GenerateIndices(tolerance / worldHeight, indices); }, 3);
+			double error = ReferenceMeshError(&heightValues[0], numberOfXPoints, indices) * worldHeight;
+			size_t triangles = indices.size() / 3;
+			printf("%-22s %11zu %9.1f %10.1f %11zu %7.1f%% %11.2f %9.3f\n", filename.c_str(), fullTriangles, buildTime, tolerance, triangles,
+				   100.0 * triangles / fullTriangles, generateTime, error);
+			CHECK(triangles > 0 && triangles <= fullTriangles);
+			CHECK(error <= tolerance + 1e-3);
+		}
+	}
+	return TestResult();
+}
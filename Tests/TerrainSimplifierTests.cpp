@@ -0,0 +1,150 @@
+#include "TerrainSimplifier.h"
+#include "TerrainReference.h"
+#include "TestFramework.h"
+
+// Checks that the simplified triangles cover the whole grid exactly once, stay within the tolerance of
+// every sample they cover and are wound the same way as the full resolution triangles, for grids that
+// are and aren't 2^n + 1 samples across (and aren't square).
+
+const float WorldHeight = 1024.0f;
+
+// The simplifier works its errors out in single precision, so allow for rounding
+const double ErrorSlack = 1e-6;
+
+// Each cell is cut into four by both its diagonals.  Every triangle the simplifier can produce is made of
+// whole quarters, so counting how many triangles hold the middle of each quarter checks the coverage
+// exactly.  Positions are in sixths of a cell so the middles are whole numbers.
+static bool CoversGridOnce(const vector<UINT>& indices, unsigned int numberOfXPoints, unsigned int numberOfZPoints)
+{
+	const int quarterX[4] = { 3, 5, 3, 1 };
+	const int quarterZ[4] = { 1, 3, 5, 3 };
+	unsigned int columns = numberOfXPoints - 1;
+	vector<unsigned int> coverage((size_t)columns * (numberOfZPoints - 1) * 4, 0);
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		int x[3];
+		int z[3];
+		for (unsigned int j = 0; j < 3; j++)
+		{
+			if (indices[i + j] >= numberOfXPoints * numberOfZPoints)
+			{
+				return false;
+			}
+			x[j] = (int)(indices[i + j] % numberOfXPoints) * 6;
+			z[j] = (int)(indices[i + j] / numberOfXPoints) * 6;
+		}
+		for (int cellZ = min(min(z[0], z[1]), z[2]) / 6; cellZ < max(max(z[0], z[1]), z[2]) / 6; cellZ++)
+		{
+			for (int cellX = min(min(x[0], x[1]), x[2]) / 6; cellX < max(max(x[0], x[1]), x[2]) / 6; cellX++)
+			{
+				for (unsigned int quarter = 0; quarter < 4; quarter++)
+				{
+					int pointX = cellX * 6 + quarterX[quarter];
+					int pointZ = cellZ * 6 + quarterZ[quarter];
+					bool inside = true;
+					for (unsigned int j = 0; j < 3; j++)
+					{
+						unsigned int k = (j + 1) % 3;
+						inside = inside && (x[k] - x[j]) * (pointZ - z[j]) - (z[k] - z[j]) * (pointX - x[j]) > 0;
+					}
+					coverage[((size_t)cellZ * columns + cellX) * 4 + quarter] += inside ? 1 : 0;
+				}
+			}
+		}
+	}
+	for (unsigned int count : coverage)
+	{
+		if (count != 1)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// The full resolution triangles, e.g. (0, 0), (1, 0), (0, 1), turn positively in grid coordinates
+static bool WoundLikeGrid(const vector<UINT>& indices, unsigned int numberOfXPoints)
+{
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		int ax = (int)(indices[i] % numberOfXPoints);
+		int az = (int)(indices[i] / numberOfXPoints);
+		int bx = (int)(indices[i + 1] % numberOfXPoints);
+		int bz = (int)(indices[i + 1] / numberOfXPoints);
+		int cx = (int)(indices[i + 2] % numberOfXPoints);
+		int cz = (int)(indices[i + 2] / numberOfXPoints);
+		if ((bx - ax) * (cz - az) - (bz - az) * (cx - ax) <= 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void TestGrids()
+{
+	vector<float> exampleHeights;
+	unsigned int exampleWidth;
+	unsigned int exampleHeight;
+	if (!CHECK(LoadHeightMap("Example_HeightMap.raw", exampleHeights, exampleWidth, exampleHeight)))
+	{
+		return;
+	}
+	const unsigned int sizes[][2] = { { 17, 17 }, { 30, 30 }, { 65, 65 }, { 100, 100 }, { 100, 37 }, { 30, 65 }, { 2, 2 } };
+	const float tolerances[] = { 0.0f, 0.5f, 2.0f, 8.0f, 64.0f, WorldHeight };
+	for (const auto& size : sizes)
+	{
+		unsigned int numberOfXPoints = size[0];
+		unsigned int numberOfZPoints = size[1];
+		unsigned int fullTriangles = (numberOfXPoints - 1) * (numberOfZPoints - 1) * 2;
+
+		// A rough corner of the example terrain, and the same with a flat plateau and a tilted plane in it
+		// that simplify away completely
+		for (unsigned int variant = 0; variant < 2; variant++)
+		{
+			vector<float> heightValues((size_t)numberOfXPoints * numberOfZPoints);
+			for (unsigned int z = 0; z < numberOfZPoints; z++)
+			{
+				for (unsigned int x = 0; x < numberOfXPoints; x++)
+				{
+					float height = exampleHeights[(size_t)(z + 500) * exampleWidth + x + 600];
+					if (variant == 1 && x < numberOfXPoints / 2)
+					{
+						height = z < numberOfZPoints / 2 ? 0.25f : 0.125f + x / 256.0f + z / 512.0f;
+					}
+					heightValues[(size_t)z * numberOfXPoints + x] = height;
+				}
+			}
+
+			TerrainSimplifier simplifier;
+			simplifier.Build(&heightValues[0], numberOfXPoints, numberOfZPoints);
+			vector<UINT> indices;
+			size_t previousTriangles = fullTriangles;
+			for (float tolerance : tolerances)
+			{
+				float maximumError = tolerance / WorldHeight;
+				simplifier.GenerateIndices(maximumError, indices);
+				size_t triangles = indices.size() / 3;
+				CHECK(indices.size() % 3 == 0 && triangles > 0);
+				CHECK(CoversGridOnce(indices, numberOfXPoints, numberOfZPoints));
+				CHECK(WoundLikeGrid(indices, numberOfXPoints));
+				CHECK(ReferenceMeshError(&heightValues[0], numberOfXPoints, indices) <= maximumError + ErrorSlack);
+
+				// A larger tolerance never needs more triangles, and the plateau always saves some
+				CHECK(triangles <= previousTriangles);
+				CHECK(variant == 0 || numberOfXPoints < 17 || triangles < fullTriangles);
+				previousTriangles = triangles;
+			}
+
+			// With a tolerance the whole height range, a grid of 2^n + 1 samples is two triangles
+			bool powerOfTwo = numberOfXPoints == numberOfZPoints && ((numberOfXPoints - 1) & (numberOfXPoints - 2)) == 0;
+			CHECK(!powerOfTwo || indices.size() == 6);
+		}
+	}
+}
+
+int main()
+{
+	TestGrids();
+	return TestResult();
+}
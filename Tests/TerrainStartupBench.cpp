@@ -0,0 +1,57 @@
+#include "TerrainNode.h"
+#include "TestFramework.h"
+
+// Milliseconds for LoadGeometry to read the example terrain and generate everything from it (without the
+// cache), on the calling thread and split across pools of 1 to (at least) 8 threads, with both vertex
+// layouts.  Generation is the part after the heights have been read.
+
+int main()
+{
+	const unsigned int runs = 2;
+	const TerrainVertexLayout layouts[] = { TerrainVertexLayout::PerCell, TerrainVertexLayout::SharedGrid };
+	const char * layoutNames[] = { "PerCell", "SharedGrid" };
+	vector<unsigned int> threadCounts = { 0, 1, 2, 4, 8 };
+	for (unsigned int threads = 16; threads <= thread::hardware_concurrency(); threads *= 2)
+	{
+		threadCounts.push_back(threads);
+	}
+	printf("Example terrain on %u hardware threads\n", thread::hardware_concurrency());
+
+	printf("%-12s %-10s %10s %9s %15s %9s\n", "Layout", "Threads", "Load ms", "Speed up", "Generation ms", "Speed up");
+	for (unsigned int layout = 0; layout < 2; layout++)
+	{
+		double serialLoadTime = 0.0;
+		double serialGenerationTime = 0.0;
+		for (unsigned int threads : threadCounts)
+		{
+			shared_ptr<ThreadPool> threadPool = threads == 0 ? nullptr : make_shared<ThreadPool>(threads);
+			double generationTime = 0.0;
+			bool loaded = true;
+			double loadTime = TimeMilliseconds([&]()
+			{
+				TerrainNode terrain(L"Terrain", GetDataFilename("Example_HeightMap.raw"), 0, 0, 1024, 10, layouts[layout]);
+				terrain.SetCacheEnabled(false);
+				terrain.SetThreadPool(threadPool);
+				if (layouts[layout] == TerrainVertexLayout::SharedGrid)
+				{
+					terrain.EnableLevelOfDetail(32, 2.0f);
+				}
+				loaded = loaded && terrain.LoadGeometry();
+				double time = terrain.GetStatistics().GenerationTime;
+				generationTime = generationTime == 0.0 || time < generationTime ? time : generationTime;
+			}, runs);
+			CHECK(loaded);
+			if (threads == 0)
+			{
+				serialLoadTime = loadTime;
+				serialGenerationTime = generationTime;
+			}
+
+			char name[16];
+			snprintf(name, sizeof(name), threads == 0 ? "Serial" : "%u", threads);
+			printf("%-12s %-10s %10.1f %8.2fx %15.1f %8.2fx\n", layoutNames[layout], name, loadTime, serialLoadTime / loadTime, generationTime,
+				   serialGenerationTime / generationTime);
+		}
+	}
+	return TestResult();
+}
@@ -0,0 +1,114 @@
+#include "TerrainTileStreamer.h"
+#include "TestFramework.h"
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+// Streams a 16 x 16 tile world along a scripted camera path in real time, with each tile taking 40 ms
+// to prepare, and reports how often the camera got ahead of the tiles it needed, how many tiles were
+// resident and how much was read, with and without prefetching and waiting for required tiles.
+
+const unsigned int TilesX = 16;
+const unsigned int TilesZ = 16;
+const unsigned int TileSamples = 129;
+const size_t TileBytes = (size_t)TileSamples * TileSamples * sizeof(float);
+
+static TerrainTileStreamerSettings GetSettings()
+{
+	TerrainTileStreamerSettings settings;
+	settings.FilenamePattern = GetScratchFilename("StreamerBenchTile_%u_%u.raw");
+	settings.TilesX = TilesX;
+	settings.TilesZ = TilesZ;
+	settings.TileSamples = TileSamples;
+	settings.Spacing = 10.0f;
+	settings.RequiredRadius = 1500.0f;
+	settings.LoadRadius = 1600.0f;
+	settings.PrefetchTime = 2.0f;
+	settings.MemoryBudget = 48 * TileBytes;
+	return settings;
+}
+
+static void Run(const char * name, TerrainTileStreamerSettings settings)
+{
+	TerrainTileStreamer streamer;
+	if (!CHECK(streamer.Initialise(settings, [](TerrainTile& tile)
+	{
+		this_thread::sleep_for(chrono::milliseconds(40));
+		return tile.HeightValues.size() * sizeof(float);
+	})))
+	{
+		return;
+	}
+
+	// Across the world at 600 units a second, then round a bend, with updates 60 times a second run at
+	// four times real time
+	const int frames = 1000;
+	const float elapsedSeconds = 1.0f / 60.0f;
+	float x = -9000.0f;
+	float z = 0.0f;
+	unsigned int absentTileUpdates = 0;
+	unsigned int mostResident = 0;
+	size_t mostResidentBytes = 0;
+	for (int frame = 0; frame < frames; frame++)
+	{
+		if (frame < 700)
+		{
+			x += 600.0f * elapsedSeconds;
+		}
+		else
+		{
+			float angle = (frame - 700) * 0.004f;
+			x += 600.0f * elapsedSeconds * cosf(angle);
+			z += 600.0f * elapsedSeconds * sinf(angle);
+		}
+		streamer.Update(XMFLOAT3(x, 100.0f, z), elapsedSeconds);
+		const TerrainStreamingStatistics& statistics = streamer.GetStatistics();
+		absentTileUpdates += statistics.AbsentRequiredTiles;
+		mostResident = max(mostResident, statistics.ResidentTiles);
+		mostResidentBytes = max(mostResidentBytes, statistics.ResidentBytes);
+		this_thread::sleep_for(chrono::microseconds(4000));
+	}
+	const TerrainStreamingStatistics& statistics = streamer.GetStatistics();
+	printf("%-26s %8u %11u %9.1f %8u %10.2f %10.2f %8.1f %6u %7u %9u %10u\n", name, statistics.StalledUpdates, absentTileUpdates, statistics.StallTime,
+		   mostResident, mostResidentBytes / 1048576.0, settings.MemoryBudget / 1048576.0, statistics.BytesRead / 1048576.0, statistics.TilesLoaded,
+		   statistics.TilesEvicted, statistics.TilesCancelled, statistics.TilesPrefetched);
+	CHECK(mostResidentBytes <= settings.MemoryBudget);
+	streamer.Shutdown();
+}
+
+int main()
+{
+	TerrainTileStreamerSettings settings = GetSettings();
+	ProceduralHeightMapSettings heightMapSettings;
+	heightMapSettings.Seed = 7;
+	ProceduralHeightMap heightMap(heightMapSettings);
+	ThreadPool threadPool;
+	if (!CHECK(TerrainTileStreamer::CreateTiles(settings, heightMap, &threadPool)))
+	{
+		return TestResult();
+	}
+
+	printf("%-26s %8s %11s %9s %8s %10s %10s %8s %6s %7s %9s %10s\n", "Streaming", "Stalled", "Tile stalls", "Stall ms", "Resident", "Peak MB",
+		   "Budget MB", "Read MB", "Loaded", "Evicted", "Cancelled", "Prefetched");
+	TerrainTileStreamerSettings noPrefetch = settings;
+	noPrefetch.PrefetchTime = 0.0f;
+	Run("No prefetch", noPrefetch);
+	Run("Prefetch 2 s", settings);
+	TerrainTileStreamerSettings waiting = settings;
+	waiting.WaitForRequiredTiles = true;
+	Run("Prefetch 2 s, waiting", waiting);
+	TerrainTileStreamerSettings smallBudget = settings;
+	smallBudget.MemoryBudget = 30 * TileBytes;
+	Run("Prefetch 2 s, 30 tiles", smallBudget);
+
+	for (unsigned int tileZ = 0; tileZ < TilesZ; tileZ++)
+	{
+		for (unsigned int tileX = 0; tileX < TilesX; tileX++)
+		{
+			char filename[64];
+			snprintf(filename, sizeof(filename), "StreamerBenchTile_%u_%u.raw", tileX, tileZ);
+			remove((GRAPHICS2_SCRATCH_DIRECTORY + string(filename)).c_str());
+		}
+	}
+	return TestResult();
+}
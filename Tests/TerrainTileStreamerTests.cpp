@@ -0,0 +1,257 @@
+#include "TerrainTileStreamer.h"
+#include "TestFramework.h"
+#include <cstdio>
+
+// Drives the tile streamer along a scripted camera path and checks that the tiles it has resident
+// are the ones it says they are, that it stays within its memory budget (including when tiles are
+// charged more once they are in use), that waiting for required tiles leaves none of them absent and
+// that a tile whose file is missing is left as a hole.
+
+const unsigned int TilesX = 12;
+const unsigned int TilesZ = 12;
+const unsigned int TileSamples = 65;
+const size_t TileBytes = (size_t)TileSamples * TileSamples * sizeof(float);
+
+static TerrainTileStreamerSettings GetSettings()
+{
+	TerrainTileStreamerSettings settings;
+	settings.FilenamePattern = GetScratchFilename("StreamerTestTile_%u_%u.raw");
+	settings.TilesX = TilesX;
+	settings.TilesZ = TilesZ;
+	settings.TileSamples = TileSamples;
+	settings.Spacing = 10.0f;
+	settings.RequiredRadius = 700.0f;
+	settings.LoadRadius = 800.0f;
+	settings.PrefetchTime = 1.0f;
+	settings.MemoryBudget = 40 * TileBytes;
+	settings.LoaderThreads = 2;
+	settings.WaitForRequiredTiles = true;
+	return settings;
+}
+
+static string GetTileFilename(unsigned int tileX, unsigned int tileZ)
+{
+	char filename[64];
+	snprintf(filename, sizeof(filename), "StreamerTestTile_%u_%u.raw", tileX, tileZ);
+	return GRAPHICS2_SCRATCH_DIRECTORY + string(filename);
+}
+
+static void TestTileEdges()
+{
+	// Neighbouring tiles share their edge samples, so the terrain is continuous across them
+	HeightMapFile tile;
+	HeightMapFile right;
+	HeightMapFile below;
+	string tileFilename = GetTileFilename(3, 5);
+	string rightFilename = GetTileFilename(4, 5);
+	string belowFilename = GetTileFilename(3, 6);
+	if (!CHECK(tile.Open(wstring(tileFilename.begin(), tileFilename.end()), HeightMapFormat::Unknown, TileSamples, TileSamples)) ||
+		!CHECK(right.Open(wstring(rightFilename.begin(), rightFilename.end()), HeightMapFormat::Unknown, TileSamples, TileSamples)) ||
+		!CHECK(below.Open(wstring(belowFilename.begin(), belowFilename.end()), HeightMapFormat::Unknown, TileSamples, TileSamples)))
+	{
+		return;
+	}
+	CHECK(tile.GetDataSize() == (size_t)TileSamples * TileSamples * sizeof(USHORT));
+	const USHORT * tileSamples = (const USHORT *)tile.GetData();
+	const USHORT * rightSamples = (const USHORT *)right.GetData();
+	const USHORT * belowSamples = (const USHORT *)below.GetData();
+	int mismatches = 0;
+	for (unsigned int i = 0; i < TileSamples; i++)
+	{
+		mismatches += tileSamples[i * TileSamples + TileSamples - 1] != rightSamples[i * TileSamples] ? 1 : 0;
+		mismatches += tileSamples[(TileSamples - 1) * TileSamples + i] != belowSamples[i] ? 1 : 0;
+	}
+	CHECK(mismatches == 0);
+}
+
+// Across the world from west to east at 600 units a second, then round a long bend
+static XMFLOAT3 GetPathPosition(int frame, float& x, float& z)
+{
+	const float step = 600.0f / 60.0f;
+	if (frame == 0)
+	{
+		x = -2800.0f;
+		z = 0.0f;
+	}
+	else if (frame < 560)
+	{
+		x += step;
+	}
+	else
+	{
+		float angle = (frame - 560) * 0.01f;
+		x += step * cosf(angle);
+		z += step * sinf(angle);
+	}
+	return XMFLOAT3(x, 100.0f, z);
+}
+
+// Follows the path and checks the streamer after every Update.  If growth isn't 1, each tile is charged
+// that many times its heights once it has been picked up, as the world node does once it has created the
+// tile's buffers.
+static void FollowPath(TerrainTileStreamer& streamer, size_t growth)
+{
+	const TerrainTileStreamerSettings& settings = streamer.GetSettings();
+	const int frames = 760;
+	float x;
+	float z;
+	int inconsistentFrames = 0;
+	int overBudgetFrames = 0;
+	int absentFrames = 0;
+	unsigned int mostResident = 0;
+	for (int frame = 0; frame < frames; frame++)
+	{
+		streamer.Update(GetPathPosition(frame, x, z), 1.0f / 60.0f);
+		const TerrainStreamingStatistics& statistics = streamer.GetStatistics();
+
+		// The resident tiles and their bytes add up to what the statistics say
+		size_t residentBytes = 0;
+		unsigned int residentTiles = 0;
+		for (unsigned int index = 0; index < TilesX * TilesZ; index++)
+		{
+			const TerrainTile& tile = streamer.GetTile(index);
+			if (tile.State == TerrainTileState::Resident)
+			{
+				residentBytes += tile.Bytes;
+				residentTiles++;
+			}
+		}
+		bool consistent = residentBytes == statistics.ResidentBytes && residentTiles == statistics.ResidentTiles;
+		for (unsigned int index : streamer.GetLoadedTiles())
+		{
+			consistent = consistent && streamer.GetTile(index).State == TerrainTileState::Resident;
+		}
+		for (unsigned int index : streamer.GetEvictedTiles())
+		{
+			consistent = consistent && streamer.GetTile(index).State == TerrainTileState::Unloaded;
+		}
+		inconsistentFrames += consistent ? 0 : 1;
+		overBudgetFrames += statistics.ResidentBytes > settings.MemoryBudget ? 1 : 0;
+		absentFrames += statistics.AbsentRequiredTiles > 0 ? 1 : 0;
+		mostResident = max(mostResident, statistics.ResidentTiles);
+
+		if (growth != 1)
+		{
+			for (unsigned int index : streamer.GetLoadedTiles())
+			{
+				streamer.SetTileBytes(index, streamer.GetTile(index).Bytes * growth);
+			}
+		}
+	}
+	const TerrainStreamingStatistics& statistics = streamer.GetStatistics();
+	printf("Charged %zux: %u loaded, %u evicted, %u cancelled, %u prefetched, at most %u resident, %.1f MB read, stalled %u of %d updates\n",
+		   growth, statistics.TilesLoaded, statistics.TilesEvicted, statistics.TilesCancelled, statistics.TilesPrefetched, mostResident,
+		   statistics.BytesRead / 1048576.0, statistics.StalledUpdates, frames);
+	CHECK(inconsistentFrames == 0);
+	CHECK(overBudgetFrames == 0);
+	CHECK(absentFrames == 0);
+	CHECK(statistics.TilesLoaded > 20 && statistics.TilesEvicted > 0);
+	CHECK(statistics.MissingTiles == 0);
+	CHECK(statistics.BytesRead == (UINT64)statistics.TilesLoaded * TileSamples * TileSamples * sizeof(USHORT));
+}
+
+static void TestStreaming()
+{
+	TerrainTileStreamer streamer;
+	if (!CHECK(streamer.Initialise(GetSettings())))
+	{
+		return;
+	}
+	FollowPath(streamer, 1);
+	streamer.Shutdown();
+
+	// Tiles that are charged more once they are in use are evicted to make room in the next Update
+	if (!CHECK(streamer.Initialise(GetSettings())))
+	{
+		return;
+	}
+	FollowPath(streamer, 2);
+	streamer.Shutdown();
+}
+
+static void TestGrowthWhileStill()
+{
+	// Travel far enough that tiles behind the camera are still resident, stop until everything wanted has
+	// arrived, then charge every resident tile double.  Nothing more needs queueing, but the next Update
+	// still evicts unwanted tiles to get back within the budget.
+	TerrainTileStreamer streamer;
+	if (!CHECK(streamer.Initialise(GetSettings())))
+	{
+		return;
+	}
+	float x;
+	float z;
+	XMFLOAT3 position;
+	for (int frame = 0; frame < 300; frame++)
+	{
+		position = GetPathPosition(frame, x, z);
+		streamer.Update(position, 1.0f / 60.0f);
+	}
+	for (int frame = 0; frame < 120 || streamer.GetStatistics().PendingTiles > 0; frame++)
+	{
+		streamer.Update(position, 1.0f / 60.0f);
+	}
+	const TerrainStreamingStatistics& statistics = streamer.GetStatistics();
+	for (unsigned int index = 0; index < TilesX * TilesZ; index++)
+	{
+		if (streamer.GetTile(index).State == TerrainTileState::Resident)
+		{
+			streamer.SetTileBytes(index, streamer.GetTile(index).Bytes * 2);
+		}
+	}
+	CHECK(statistics.ResidentBytes > streamer.GetSettings().MemoryBudget);
+	unsigned int evicted = statistics.TilesEvicted;
+	streamer.Update(position, 1.0f / 60.0f);
+	CHECK(statistics.ResidentBytes <= streamer.GetSettings().MemoryBudget);
+	CHECK(statistics.TilesEvicted > evicted && statistics.PendingTiles == 0);
+	streamer.Shutdown();
+}
+
+static void TestMissingTile()
+{
+	// The tile under the start of the path can't be read, so it becomes a hole rather than stalling
+	string filename = GetTileFilename(1, 6);
+	remove(filename.c_str());
+	TerrainTileStreamer streamer;
+	if (!CHECK(streamer.Initialise(GetSettings())))
+	{
+		return;
+	}
+	float x;
+	float z;
+	XMFLOAT3 position = GetPathPosition(0, x, z);
+	streamer.Update(position, 0.0f);
+	unsigned int index;
+	if (CHECK(streamer.GetTileAt(position.x, position.z, index)))
+	{
+		CHECK(index == streamer.GetTileIndex(1, 6));
+		CHECK(streamer.GetTile(index).State == TerrainTileState::Missing);
+	}
+	CHECK(streamer.GetStatistics().MissingTiles == 1);
+	CHECK(streamer.GetStatistics().AbsentRequiredTiles == 0);
+	streamer.Shutdown();
+}
+
+int main()
+{
+	ProceduralHeightMapSettings heightMapSettings;
+	heightMapSettings.Seed = 20;
+	ProceduralHeightMap heightMap(heightMapSettings);
+	ThreadPool threadPool;
+	if (!CHECK(TerrainTileStreamer::CreateTiles(GetSettings(), heightMap, &threadPool)))
+	{
+		return TestResult();
+	}
+	TestTileEdges();
+	TestStreaming();
+	TestGrowthWhileStill();
+	TestMissingTile();
+	for (unsigned int tileZ = 0; tileZ < TilesZ; tileZ++)
+	{
+		for (unsigned int tileX = 0; tileX < TilesX; tileX++)
+		{
+			remove(GetTileFilename(tileX, tileZ).c_str());
+		}
+	}
+	return TestResult();
+}
@@ -0,0 +1,146 @@
+#include "TerrainVertexFormat.h"
+#include "TestFramework.h"
+#include <cstring>
+#include <random>
+
+// Round trip errors of the compact vertex format: the normal encoding on its own, then whole vertices
+// of a grid with heights across the full range.
+
+static float GetAngle(const XMFLOAT3& first, const XMFLOAT3& second)
+{
+	float dot = XMVectorGetX(XMVector3Dot(XMVector3Normalize(XMLoadFloat3(&first)), XMVector3Normalize(XMLoadFloat3(&second))));
+	return XMConvertToDegrees(acosf(min(max(dot, -1.0f), 1.0f)));
+}
+
+static void TestNormals()
+{
+	// Random normals over the upper hemisphere, and the ones that matter most for a terrain
+	mt19937 random(14);
+	uniform_real_distribution<float> component(-1.0f, 1.0f);
+	vector<XMFLOAT3> normals = { XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT3(0.6f, 0.8f, 0.0f) };
+	while (normals.size() < 200000)
+	{
+		XMFLOAT3 normal(component(random), fabsf(component(random)), component(random));
+		float length = sqrtf(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+		if (length > 1e-3f && length <= 1.0f)
+		{
+			normals.push_back(XMFLOAT3(normal.x / length, normal.y / length, normal.z / length));
+		}
+	}
+	float largestError = 0.0f;
+	for (const XMFLOAT3& normal : normals)
+	{
+		BYTE encoded[2];
+		EncodeOctahedralNormal(normal, encoded);
+		largestError = max(largestError, GetAngle(normal, DecodeOctahedralNormal(encoded)));
+	}
+	printf("Octahedral normals: largest error %.3f degrees\n", largestError);
+	CHECK(largestError < 1.0f);
+
+	// Straight up must survive exactly, so flat ground stays flat
+	BYTE up[2];
+	EncodeOctahedralNormal(XMFLOAT3(0.0f, 1.0f, 0.0f), up);
+	CHECK(GetAngle(XMFLOAT3(0.0f, 1.0f, 0.0f), DecodeOctahedralNormal(up)) < 0.5f);
+
+	// Encoding a decoded normal gives back the same code, or one just as close (acos is only good to a few
+	// hundredths of a degree this close to 1)
+	bool stable = true;
+	for (int first = 0; first < 256; first++)
+	{
+		for (int second = 0; second < 256; second++)
+		{
+			BYTE code[2] = { (BYTE)first, (BYTE)second };
+			XMFLOAT3 normal = DecodeOctahedralNormal(code);
+			BYTE encoded[2];
+			EncodeOctahedralNormal(normal, encoded);
+			stable = stable && ((encoded[0] == code[0] && encoded[1] == code[1]) || GetAngle(normal, DecodeOctahedralNormal(encoded)) < 0.1f);
+		}
+	}
+	CHECK(stable);
+}
+
+static void TestVertices()
+{
+	CHECK(sizeof(TerrainCompactVertex) == 12);
+	CHECK(sizeof(TerrainCompactVertex) * 3 < sizeof(TerrainVertex));
+
+	TerrainCompactVertexParameters parameters;
+	parameters.StartX = -1495.0f;
+	parameters.StartZ = 1010.0f;
+	parameters.Spacing = 10.0f;
+	parameters.DetailTiling = 1.0f / 7.0f;
+	parameters.MinimumHeight = -200.0f;
+	parameters.HeightRange = 1224.0f;
+	parameters.BlendMapDu = 1.0f / 299.0f;
+	parameters.BlendMapDv = 1.0f / 199.0f;
+
+	const unsigned int numberOfXPoints = 300;
+	const unsigned int numberOfZPoints = 200;
+	mt19937 random(41);
+	uniform_real_distribution<float> height(parameters.MinimumHeight, parameters.MinimumHeight + parameters.HeightRange);
+	uniform_real_distribution<float> slope(-2.0f, 2.0f);
+	vector<TerrainVertex> vertices;
+	for (unsigned int z = 0; z < numberOfZPoints; z++)
+	{
+		for (unsigned int x = 0; x < numberOfXPoints; x++)
+		{
+			TerrainVertex vertex;
+			vertex.Position = XMFLOAT3(parameters.StartX + x * parameters.Spacing, height(random), parameters.StartZ - z * parameters.Spacing);
+			XMStoreFloat3(&vertex.Normal, XMVector3Normalize(XMVectorSet(slope(random), 1.0f, slope(random), 0.0f)));
+			vertex.TexCoord = XMFLOAT2(x * parameters.DetailTiling, z * parameters.DetailTiling);
+			vertex.BlendMapTexCoord = XMFLOAT2(x * parameters.BlendMapDu, z * parameters.BlendMapDv);
+			vertices.push_back(vertex);
+		}
+	}
+
+	// The lowest and highest heights of the range, and heights beyond it, which are clamped
+	vertices[0].Position.y = parameters.MinimumHeight;
+	vertices[1].Position.y = parameters.MinimumHeight + parameters.HeightRange;
+	TerrainVertex below = vertices[2];
+	TerrainVertex above = vertices[3];
+	below.Position.y = parameters.MinimumHeight - 50.0f;
+	above.Position.y = parameters.MinimumHeight + parameters.HeightRange + 50.0f;
+	CHECK(EncodeTerrainVertex(below, parameters).Height == 0);
+	CHECK(EncodeTerrainVertex(above, parameters).Height == 65535);
+
+	vector<TerrainCompactVertex> compactVertices(vertices.size());
+	EncodeTerrainVertices(&vertices[0], vertices.size(), parameters, &compactVertices[0]);
+	TerrainCompactVertexError expected = { 0.0f, 0.0f, 0.0f, 0.0f };
+	bool gridMatches = true;
+	bool sameAsSingle = true;
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		TerrainCompactVertex single = EncodeTerrainVertex(vertices[i], parameters);
+		sameAsSingle = sameAsSingle && memcmp(&single, &compactVertices[i], sizeof(TerrainCompactVertex)) == 0;
+		gridMatches = gridMatches && compactVertices[i].X == i % numberOfXPoints && compactVertices[i].Z == i / numberOfXPoints;
+		TerrainVertex decoded = DecodeTerrainVertex(compactVertices[i], parameters);
+		expected.Position = max(expected.Position, fabsf(decoded.Position.y - vertices[i].Position.y));
+		gridMatches = gridMatches && decoded.Position.x == vertices[i].Position.x && decoded.Position.z == vertices[i].Position.z;
+		expected.NormalAngle = max(expected.NormalAngle, GetAngle(decoded.Normal, vertices[i].Normal));
+		expected.TexCoord = max(expected.TexCoord, max(fabsf(decoded.TexCoord.x - vertices[i].TexCoord.x), fabsf(decoded.TexCoord.y - vertices[i].TexCoord.y)));
+		expected.BlendMapTexCoord = max(expected.BlendMapTexCoord, max(fabsf(decoded.BlendMapTexCoord.x - vertices[i].BlendMapTexCoord.x),
+																	   fabsf(decoded.BlendMapTexCoord.y - vertices[i].BlendMapTexCoord.y)));
+	}
+	CHECK(sameAsSingle);
+	CHECK(gridMatches);
+	TerrainCompactVertexError error = MeasureCompactVertexError(&vertices[0], &compactVertices[0], vertices.size(), parameters);
+	printf("Vertices: position %g, normal %.3f degrees, texture coordinates %g, blend map coordinates %g\n",
+		   error.Position, error.NormalAngle, error.TexCoord, error.BlendMapTexCoord);
+
+	// Heights are rounded to the nearest of 65536 steps, texture coordinates to a half float relative to their block
+	float heightStep = parameters.HeightRange / 65535.0f;
+	float blockTexCoord = TerrainCompactTexCoordBlock * parameters.DetailTiling;
+	CHECK(error.Position <= heightStep * 0.5f + 1e-4f);
+	CHECK(error.NormalAngle < 1.0f);
+	CHECK(error.TexCoord <= blockTexCoord / 2048.0f);
+	CHECK(error.BlendMapTexCoord < 1e-6f);
+	CHECK(fabsf(error.Position - expected.Position) < 1e-4f && fabsf(error.NormalAngle - expected.NormalAngle) < 0.01f);
+	CHECK(error.TexCoord == expected.TexCoord && error.BlendMapTexCoord == expected.BlendMapTexCoord);
+}
+
+int main()
+{
+	TestNormals();
+	TestVertices();
+	return TestResult();
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include "HeightMapFile.h"
+#include <cstdio>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// The little that the test and benchmark executables share.  CHECK records a failure and carries on,
+// and main returns TestResult() so that ctest sees any failure.
+
+inline int& GetFailureCount()
+{
+	static int failureCount = 0;
+	return failureCount;
+}
+
+inline bool CheckCondition(bool condition, const char * text, const char * file, int line)
+{
+	if (!condition)
+	{
+		printf("%s(%d): check failed: %s\n", file, line, text);
+		GetFailureCount()++;
+	}
+	return condition;
+}
+
+#define CHECK(condition) CheckCondition((condition), #condition, __FILE__, __LINE__)
+
+inline int TestResult()
+{
+	if (GetFailureCount() > 0)
+	{
+		printf("%d check(s) failed\n", GetFailureCount());
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
+
+// The height maps that ship with the demo
+inline wstring GetDataFilename(const string& filename)
+{
+	string path = GRAPHICS2_DATA_DIRECTORY + filename;
+	return wstring(path.begin(), path.end());
+}
+
+// Loads one of the demo's height maps as normalised heights, working the size and format out from the file
+inline bool LoadHeightMap(const string& filename, vector<float>& heightValues, unsigned int& width, unsigned int& height)
+{
+	HeightMapFile file;
+	if (!file.Open(GetDataFilename(filename)))
+	{
+		return false;
+	}
+	width = file.GetWidth();
+	height = file.GetHeight();
+	heightValues.resize((size_t)width * height);
+	file.ConvertRows(&heightValues[0], 0, height);
+	return true;
+}
+
+// Somewhere the tests can write files (the build directory)
+inline wstring GetScratchFilename(const string& filename)
+{
+	string path = GRAPHICS2_SCRATCH_DIRECTORY + filename;
+	return wstring(path.begin(), path.end());
+}
+
+// Copies one of the demo's height maps to scratchFilename in the scratch directory, without any cache file
+// next to it, so that a test can create and change files alongside it.  Each test uses its own name so that
+// they can run at the same time.
+inline wstring CopyToScratch(const string& filename, const string& scratchFilename)
+{
+	string source = GRAPHICS2_DATA_DIRECTORY + filename;
+	string destination = GRAPHICS2_SCRATCH_DIRECTORY + scratchFilename;
+	{
+		ifstream input(source, ios::binary);
+		ofstream output(destination, ios::binary | ios::trunc);
+		output << input.rdbuf();
+	}
+	remove((destination + ".cache").c_str());
+	return GetScratchFilename(scratchFilename);
+}
+
+// Milliseconds taken by work, best of the given number of runs
+template<class Work> double TimeMilliseconds(Work work, unsigned int runs = 1)
+{
+	double best = 0.0;
+	for (unsigned int run = 0; run < runs; run++)
+	{
+		auto start = chrono::high_resolution_clock::now();
+		work();
+		auto end = chrono::high_resolution_clock::now();
+		double time = chrono::duration<double, milli>(end - start).count();
+		best = run == 0 || time < best ? time : best;
+	}
+	return best;
+}
@@ -0,0 +1,194 @@
+#include "ThreadPool.h"
+#include "TestFramework.h"
+
+// Checks that ParallelFor and ParallelForDynamic cover every iteration exactly once, that a call only waits
+// for its own work when several threads use the pool at once, and that work on the pool can itself use the
+// pool without deadlocking.
+
+static bool CoversOnce(const vector<atomic<unsigned int>>& counts)
+{
+	for (const atomic<unsigned int>& count : counts)
+	{
+		if (count != 1)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void TestCoverage()
+{
+	ThreadPool threadPool(4);
+	const unsigned int counts[] = { 0, 1, 7, 64, 1000, 100003 };
+	for (unsigned int count : counts)
+	{
+		vector<atomic<unsigned int>> forCounts(count);
+		threadPool.ParallelFor(count, [&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin; i < end; i++)
+			{
+				forCounts[i]++;
+			}
+		});
+		CHECK(CoversOnce(forCounts));
+
+		const unsigned int grainSizes[] = { 0, 1, 100, 5000 };
+		for (unsigned int grainSize : grainSizes)
+		{
+			vector<atomic<unsigned int>> dynamicCounts(count);
+			threadPool.ParallelForDynamic(count, grainSize, [&](unsigned int begin, unsigned int end)
+			{
+				for (unsigned int i = begin; i < end; i++)
+				{
+					dynamicCounts[i]++;
+				}
+			});
+			CHECK(CoversOnce(dynamicCounts));
+		}
+	}
+}
+
+static void TestConcurrentCallers()
+{
+	// One thread's call holds every thread of the pool until it is released.  Another thread's call has
+	// to finish first, on its own, rather than wait for the first call's work as well.
+	ThreadPool threadPool(4);
+	atomic<unsigned int> started(0);
+	atomic<bool> release(false);
+	thread blocked([&]()
+	{
+		threadPool.ParallelFor(threadPool.GetThreadCount(), [&](unsigned int, unsigned int)
+		{
+			started++;
+			while (!release)
+			{
+				this_thread::yield();
+			}
+		});
+	});
+	while (started < threadPool.GetThreadCount())
+	{
+		this_thread::yield();
+	}
+
+	vector<atomic<unsigned int>> forCounts(1000);
+	vector<atomic<unsigned int>> dynamicCounts(1000);
+	threadPool.ParallelFor(1000, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			forCounts[i]++;
+		}
+	});
+	threadPool.ParallelForDynamic(1000, 10, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			dynamicCounts[i]++;
+		}
+	});
+	CHECK(!release && CoversOnce(forCounts) && CoversOnce(dynamicCounts));
+	release = true;
+	blocked.join();
+
+	// And many callers at once each get back all of their own work
+	const unsigned int callers = 6;
+	vector<vector<atomic<unsigned int>>> callerCounts;
+	for (unsigned int caller = 0; caller < callers; caller++)
+	{
+		callerCounts.emplace_back(20000);
+	}
+	vector<thread> threads;
+	atomic<unsigned int> incomplete(0);
+	for (unsigned int caller = 0; caller < callers; caller++)
+	{
+		threads.push_back(thread([&, caller]()
+		{
+			for (int repeat = 0; repeat < 20; repeat++)
+			{
+				vector<atomic<unsigned int>>& counts = callerCounts[caller];
+				auto work = [&](unsigned int begin, unsigned int end)
+				{
+					for (unsigned int i = begin; i < end; i++)
+					{
+						counts[i]++;
+					}
+				};
+				if (caller % 2 == 0)
+				{
+					threadPool.ParallelFor((unsigned int)counts.size(), work);
+				}
+				else
+				{
+					threadPool.ParallelForDynamic((unsigned int)counts.size(), 256, work);
+				}
+				for (const atomic<unsigned int>& count : counts)
+				{
+					incomplete += count != (unsigned int)repeat + 1 ? 1 : 0;
+				}
+			}
+		}));
+	}
+	for (thread& callerThread : threads)
+	{
+		callerThread.join();
+	}
+	CHECK(incomplete == 0);
+}
+
+static void TestNestedCalls()
+{
+	// Every band of the outer call uses the pool again, while every thread is busy with the outer call
+	ThreadPool threadPool(4);
+	const unsigned int outerCount = 16;
+	const unsigned int innerCount = 5000;
+	vector<atomic<unsigned int>> counts(outerCount * innerCount);
+	auto inner = [&](unsigned int outer, bool dynamic)
+	{
+		auto work = [&, outer](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin; i < end; i++)
+			{
+				counts[outer * innerCount + i]++;
+			}
+		};
+		if (dynamic)
+		{
+			threadPool.ParallelForDynamic(innerCount, 100, work);
+		}
+		else
+		{
+			threadPool.ParallelFor(innerCount, work);
+		}
+	};
+	threadPool.ParallelFor(outerCount, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int outer = begin; outer < end; outer++)
+		{
+			inner(outer, outer % 2 == 1);
+		}
+	});
+	CHECK(CoversOnce(counts));
+
+	for (atomic<unsigned int>& count : counts)
+	{
+		count = 0;
+	}
+	threadPool.ParallelForDynamic(outerCount, 1, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int outer = begin; outer < end; outer++)
+		{
+			inner(outer, outer % 2 == 0);
+		}
+	});
+	CHECK(CoversOnce(counts));
+}
+
+int main()
+{
+	TestCoverage();
+	TestConcurrentCallers();
+	TestNestedCalls();
+	return TestResult();
+}